@@ -0,0 +1,47 @@
+# GL entry points counted by GLCounters, shared by app/CMakeLists.txt and the host
+# build. Each name needs a matching __wrap_ function in src/main/cpp/GLCountersWrap.cpp.
+#
+# The counters are cheap enough to stay on in release builds. Configure with
+# -DGL_COUNTERS=OFF to compile them out: the wrappers are not linked and
+# GLCounters reports zeros.
+
+option(GL_COUNTERS "Count GL commands per frame and per eye" ON)
+
+set(GL_COUNTERS_WRAPPED
+    glDrawArrays
+    glDrawElements
+    glDrawArraysInstanced
+    glDrawElementsInstanced
+    glUseProgram
+    glDeleteProgram
+    glBindTexture
+    glBindBuffer
+    glBindVertexArray
+    glBindFramebuffer
+    glUniform1i
+    glUniform1f
+    glUniform2f
+    glUniform3f
+    glUniform4f
+    glUniform1fv
+    glUniform3fv
+    glUniform4fv
+    glUniformMatrix4fv
+    glEnable
+    glDisable
+    glBlendFunc
+    glDepthMask
+    glCullFace
+    glViewport
+    glActiveTexture
+    glClear
+    glBufferData
+    glBufferSubData
+    glTexImage2D
+    glTexSubImage2D
+   )
+
+set(GL_COUNTERS_LINK_FLAGS "")
+foreach(function ${GL_COUNTERS_WRAPPED})
+  set(GL_COUNTERS_LINK_FLAGS "${GL_COUNTERS_LINK_FLAGS} -Wl,--wrap=${function}")
+endforeach()
@@ -13,6 +13,11 @@ import android.view.WindowManager;
 
 public class PlatformActivity extends NativeActivity {
     static String LOGTAG = "VRBrowser";
+    // Priority classes of queueRunnable(), must be kept in sync with RunnableQueue::Priority.
+    // High priority runnables always run, the others may be deferred to a later frame.
+    static final int RUNNABLE_PRIORITY_HIGH = 0;
+    static final int RUNNABLE_PRIORITY_NORMAL = 1;
+    static final int RUNNABLE_PRIORITY_LOW = 2;
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
@@ -32,7 +37,7 @@ public class PlatformActivity extends NativeActivity {
             public void run() {
                 platformExit();
             }
-        });
+        }, RUNNABLE_PRIORITY_HIGH);
     }
 
     @Override
@@ -73,6 +78,26 @@ public class PlatformActivity extends NativeActivity {
                 });
     }
 
-    protected native void queueRunnable(Runnable aRunnable);
+    protected void queueRunnable(Runnable aRunnable) {
+        queueRunnable(aRunnable, RUNNABLE_PRIORITY_NORMAL);
+    }
+
+    protected native void queueRunnable(Runnable aRunnable, int aPriority);
     protected native boolean platformExit();
+    // Returns {p50, p95, p99 (milliseconds), over budget frame count, frames run} for each frame phase:
+    // ProcessEvents, Update, UpdateControllers, Cull, Copies, StartFrame, DrawLeft, DrawRight, EndFrame, Total.
+    // Followed by the last frame's {FrameSlack, FrameSleep, FramesMissed, PresentationDropped,
+    // PresentationRepeated, PresentationLatency, WidgetsHibernated, TextureMegabytes}.
+    protected native float[] getFrameStats();
+    // Returns the GL command counts of the last frame, all zero when built with GL_COUNTERS=OFF.
+    // {DrawCalls, Triangles, ProgramSwitches, TextureBinds, UniformUploads, BufferBinds, FramebufferBinds,
+    // StateChanges, Clears, Uploads} for each of Frame, LeftEye and RightEye, followed by the scene counts
+    // {Widgets, WidgetsCulled, WidgetsLayered, Controllers, SurfacesLatched, DrawablesEmitted}.
+    protected native int[] getGLCounters();
+    // Shows the browser widget thumbnails in a grid in front of the user.
+    protected native void setTabOverview(boolean aEnabled);
+    // Immersive presentation of side by side stereo frames, twice the eye buffer width when the
+    // size is zero. The surface is handed over through dispatchPresentationSurface().
+    protected native void startPresentation(int aWidth, int aHeight);
+    protected native void stopPresentation();
 }
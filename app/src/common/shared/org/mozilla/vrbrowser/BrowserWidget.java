@@ -8,6 +8,7 @@ package org.mozilla.vrbrowser;
 import android.content.Context;
 import android.graphics.Rect;
 import android.graphics.SurfaceTexture;
+import android.os.Handler;
 import android.view.KeyEvent;
 import android.view.MotionEvent;
 import android.view.Surface;
@@ -21,12 +22,35 @@ import org.mozilla.geckoview.GeckoSession;
 
 class BrowserWidget extends View implements Widget, SessionStore.SessionChangeListener {
     private static final String LOGTAG = "VRB";
+    // Peripheral sessions alternate between these active and inactive periods (ms), so they
+    // paint about half of the time.
+    private static final long PeripheralActiveInterval = 100;
+    private static final long PeripheralInactiveInterval = 100;
     private int mSessionId;
     private GeckoDisplay mDisplay;
     private Surface mSurface;
     private SurfaceTexture mSurfaceTexture;
     private int mWidth;
     private int mHeight;
+    // Size of the surface when it was attached. The native side keeps sending input in this
+    // space while the surface itself may be shrunk for distant windows.
+    private int mFullWidth;
+    private int mFullHeight;
+    private int mAttention = Widget.AttentionFocused;
+    private Handler mHandler = new Handler();
+    private boolean mPeripheralActive;
+    private Runnable mPeripheralRunnable = new Runnable() {
+        @Override
+        public void run() {
+            GeckoSession session = SessionStore.get().getSession(mSessionId);
+            if ((session == null) || (mAttention != Widget.AttentionPeripheral)) {
+                return;
+            }
+            mPeripheralActive = !mPeripheralActive;
+            session.setActive(mPeripheralActive);
+            mHandler.postDelayed(this, mPeripheralActive ? PeripheralActiveInterval : PeripheralInactiveInterval);
+        }
+    };
 
     BrowserWidget(Context aContext, int aSessionId) {
         super(aContext);
@@ -45,8 +69,14 @@ class BrowserWidget extends View implements Widget, SessionStore.SessionChangeLi
         if (session == null) {
             return;
         }
+        if ((aTexture == mSurfaceTexture) && (mDisplay != null)) {
+            resizeSurface(aWidth, aHeight);
+            return;
+        }
         mWidth = aWidth;
         mHeight = aHeight;
+        mFullWidth = aWidth;
+        mFullHeight = aHeight;
         mSurfaceTexture = aTexture;
         aTexture.setDefaultBufferSize(aWidth, aHeight);
         mSurface = new Surface(aTexture);
@@ -54,6 +84,23 @@ class BrowserWidget extends View implements Widget, SessionStore.SessionChangeLi
         mDisplay.surfaceChanged(mSurface, aWidth, aHeight);
     }
 
+    private void resizeSurface(final int aWidth, final int aHeight) {
+        if ((aWidth == mWidth) && (aHeight == mHeight)) {
+            return;
+        }
+        mWidth = aWidth;
+        mHeight = aHeight;
+        mSurfaceTexture.setDefaultBufferSize(aWidth, aHeight);
+        mDisplay.surfaceChanged(mSurface, aWidth, aHeight);
+    }
+
+    private void scaleToSurface(MotionEvent aEvent) {
+        if ((mFullWidth <= 0) || (mFullHeight <= 0) || ((mWidth == mFullWidth) && (mHeight == mFullHeight))) {
+            return;
+        }
+        aEvent.setLocation(aEvent.getX() * mWidth / mFullWidth, aEvent.getY() * mHeight / mFullHeight);
+    }
+
     @Override
     public void handleTouchEvent(MotionEvent aEvent) {
         if (aEvent.getActionMasked() == MotionEvent.ACTION_DOWN) {
@@ -64,6 +111,7 @@ class BrowserWidget extends View implements Widget, SessionStore.SessionChangeLi
         if (session == null) {
             return;
         }
+        scaleToSurface(aEvent);
         session.getPanZoomController().onTouchEvent(aEvent);
     }
 
@@ -73,11 +121,55 @@ class BrowserWidget extends View implements Widget, SessionStore.SessionChangeLi
         if (session == null) {
             return;
         }
+        scaleToSurface(aEvent);
         session.getPanZoomController().onMotionEvent(aEvent);
     }
 
+    @Override
+    public void setAttention(int aLevel) {
+        if (mAttention == aLevel) {
+            return;
+        }
+        mAttention = aLevel;
+        GeckoSession session = SessionStore.get().getSession(mSessionId);
+        if (session != null) {
+            updateActive(session);
+        }
+    }
+
+    // GeckoView has no paint rate control, inactive sessions stop painting and throttle their
+    // refresh driver. Peripheral sessions are toggled on a duty cycle to cut their paint rate.
+    private void updateActive(GeckoSession aSession) {
+        mHandler.removeCallbacks(mPeripheralRunnable);
+        if (mAttention == Widget.AttentionPeripheral) {
+            mPeripheralActive = true;
+            aSession.setActive(true);
+            mHandler.postDelayed(mPeripheralRunnable, PeripheralActiveInterval);
+            return;
+        }
+        aSession.setActive(mAttention == Widget.AttentionFocused);
+    }
+
+    @Override
+    public SurfaceTexture releaseSurface() {
+        GeckoSession session = SessionStore.get().getSession(mSessionId);
+        if ((mDisplay != null) && (session != null)) {
+            mDisplay.surfaceDestroyed();
+            session.releaseDisplay(mDisplay);
+        }
+        mDisplay = null;
+        if (mSurface != null) {
+            mSurface.release();
+            mSurface = null;
+        }
+        SurfaceTexture texture = mSurfaceTexture;
+        mSurfaceTexture = null;
+        return texture;
+    }
+
     @Override
     public void releaseWidget() {
+        mHandler.removeCallbacks(mPeripheralRunnable);
         SessionStore.get().removeSessionChangeListener(this);
         GeckoSession session = SessionStore.get().getSession(mSessionId);
         if (session == null) {
@@ -111,9 +203,14 @@ class BrowserWidget extends View implements Widget, SessionStore.SessionChangeLi
         }
 
         mSessionId = aId;
-        mDisplay = aSession.acquireDisplay();
-        mDisplay.surfaceChanged(mSurface, mWidth, mHeight);
+        mDisplay = null;
+        // A hibernated widget acquires the display once it gets its surface back.
+        if (mSurface != null) {
+            mDisplay = aSession.acquireDisplay();
+            mDisplay.surfaceChanged(mSurface, mWidth, mHeight);
+        }
         aSession.getTextInput().setView(this);
+        updateActive(aSession);
     }
 
     // View
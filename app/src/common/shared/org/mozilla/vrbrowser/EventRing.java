@@ -0,0 +1,109 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import android.util.Log;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+// Consumer side of the native crow::EventRing. The layout must be kept in sync with EventRing.h.
+class EventRing {
+    static final String LOGTAG = "VRB";
+
+    interface Delegate {
+        void onMotionEvent(int aHandle, int aDevice, boolean aPressed, float aX, float aY, long aEventTime);
+        void onScrollEvent(int aHandle, int aDevice, float aX, float aY, long aEventTime);
+        void onGesture(int aType);
+        void onAttentionChanged(int aHandle, int aLevel);
+        void onHibernate(int aHandle);
+    }
+
+    static final int TypeMotion = 1;
+    static final int TypeScroll = 2;
+    static final int TypeGesture = 3;
+    static final int TypeAttention = 4;
+    static final int TypeHibernate = 5;
+
+    private static final int WriteIndexOffset = 0;
+    private static final int ReadIndexOffset = 4;
+    private static final int CapacityOffset = 8;
+    private static final int RecordSizeOffset = 12;
+    private static final int HeaderSize = 16;
+
+    private static final int TypeOffset = 0;
+    private static final int HandleOffset = 4;
+    private static final int TimestampOffset = 8;
+    private static final int DeviceOffset = 16;
+    private static final int FlagsOffset = 20;
+    private static final int DataOffset = 24;
+
+    private static final int FlagPressed = 1;
+    private static final long NanosPerMilli = 1000000L;
+
+    private final ByteBuffer mBuffer;
+    private final int mCapacity;
+    private final int mRecordSize;
+    private final Delegate mDelegate;
+    private final AtomicInteger mPublishedIndex = new AtomicInteger();
+    private final AtomicBoolean mDrainPending = new AtomicBoolean();
+    private int mReadIndex;
+
+    EventRing(ByteBuffer aBuffer, Delegate aDelegate) {
+        mBuffer = aBuffer.order(ByteOrder.nativeOrder());
+        mCapacity = mBuffer.getInt(CapacityOffset);
+        mRecordSize = mBuffer.getInt(RecordSizeOffset);
+        mDelegate = aDelegate;
+        mReadIndex = mBuffer.getInt(ReadIndexOffset);
+        mPublishedIndex.set(mBuffer.getInt(WriteIndexOffset));
+    }
+
+    // Called on the render thread. Returns true when the caller needs to schedule drain().
+    boolean publish(int aWriteIndex) {
+        mPublishedIndex.set(aWriteIndex);
+        return mDrainPending.compareAndSet(false, true);
+    }
+
+    // Called on the UI thread. Processes every record published so far.
+    void drain() {
+        mDrainPending.set(false);
+        final int writeIndex = mPublishedIndex.get();
+        while (mReadIndex != writeIndex) {
+            final int record = HeaderSize + ((mReadIndex & (mCapacity - 1)) * mRecordSize);
+            final int type = mBuffer.getInt(record + TypeOffset);
+            final int handle = mBuffer.getInt(record + HandleOffset);
+            final long eventTime = mBuffer.getLong(record + TimestampOffset) / NanosPerMilli;
+            final int device = mBuffer.getInt(record + DeviceOffset);
+            final int flags = mBuffer.getInt(record + FlagsOffset);
+            final int data = record + DataOffset;
+            switch (type) {
+                case TypeMotion:
+                    mDelegate.onMotionEvent(handle, device, (flags & FlagPressed) != 0,
+                            mBuffer.getFloat(data), mBuffer.getFloat(data + 4), eventTime);
+                    break;
+                case TypeScroll:
+                    mDelegate.onScrollEvent(handle, device, mBuffer.getFloat(data), mBuffer.getFloat(data + 4), eventTime);
+                    break;
+                case TypeGesture:
+                    mDelegate.onGesture(device);
+                    break;
+                case TypeAttention:
+                    mDelegate.onAttentionChanged(handle, device);
+                    break;
+                case TypeHibernate:
+                    mDelegate.onHibernate(handle);
+                    break;
+                default:
+                    Log.e(LOGTAG, "Unknown event type in EventRing: " + type);
+                    break;
+            }
+            mReadIndex++;
+        }
+        mBuffer.putInt(ReadIndexOffset, mReadIndex);
+    }
+}
@@ -5,7 +5,6 @@
 
 package org.mozilla.vrbrowser;
 
-import android.os.SystemClock;
 import android.util.Log;
 import android.view.MotionEvent;
 import android.view.InputDevice;
@@ -36,7 +35,7 @@ class MotionEventGenerator {
 
     private static SparseArray<Device> devices = new SparseArray<Device>();
 
-    static void dispatch(Widget aWidget, int aDevice, boolean aPressed, float aX, float aY) {
+    static void dispatch(Widget aWidget, int aDevice, boolean aPressed, float aX, float aY, long aEventTime) {
         Device device = devices.get(aDevice);
         if (device == null) {
             device = new Device();
@@ -53,7 +52,7 @@ class MotionEventGenerator {
             device.mCoords[0].pressure = 0.0f;
         }
         if (aPressed && !device.mWasPressed) {
-            device.mDownTime = SystemClock.uptimeMillis();
+            device.mDownTime = aEventTime;
             device.mWasPressed = true;
             action |= MotionEvent.ACTION_DOWN;
         } else if (!aPressed && device.mWasPressed) {
@@ -75,7 +74,7 @@ class MotionEventGenerator {
 
         MotionEvent event = MotionEvent.obtain(
                 /*mDownTime*/ device.mDownTime,
-                /*eventTime*/ SystemClock.uptimeMillis(),
+                /*eventTime*/ aEventTime,
                 /*action*/ action,
                 /*pointerCount*/ 1,
                 /*pointerProperties*/ device.mProperties,
@@ -95,7 +94,7 @@ class MotionEventGenerator {
         aWidget.handleTouchEvent(event);
     }
 
-    static void dispatchScroll(Widget aWidget, int aDevice, float aX, float aY) {
+    static void dispatchScroll(Widget aWidget, int aDevice, float aX, float aY, long aEventTime) {
         Device device = devices.get(aDevice);
         if (device == null) {
             device = new Device();
@@ -106,7 +105,7 @@ class MotionEventGenerator {
         device.mCoords[0].setAxisValue(MotionEvent.AXIS_HSCROLL, aX);
         MotionEvent event = MotionEvent.obtain(
                 /*mDownTime*/ device.mDownTime,
-                /*eventTime*/ SystemClock.uptimeMillis(),
+                /*eventTime*/ aEventTime,
                 /*action*/ MotionEvent.ACTION_SCROLL,
                 /*pointerCount*/ 1,
                 /*pointerProperties*/ device.mProperties,
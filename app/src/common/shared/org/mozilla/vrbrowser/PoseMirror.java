@@ -0,0 +1,75 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+// Reader side of the native crow::PoseMirror. The layout must be kept in sync with PoseMirror.h.
+// Poses may be read from any thread without calling into native code.
+public class PoseMirror {
+    public static final int HeadIndex = 0;
+    // quaternion x, y, z, w followed by position x, y, z
+    public static final int PoseValueCount = 7;
+
+    private static final int SequenceOffset = 0;
+    private static final int CountOffset = 4;
+    private static final int HeaderSize = 16;
+    private static final int PoseSize = 32;
+    private static final int ValidOffset = 28;
+    private static final int MaxRetries = 8;
+
+    private final ByteBuffer mBuffer;
+    private final int mMaxPoses;
+    private volatile int mFence;
+
+    PoseMirror(ByteBuffer aBuffer) {
+        mBuffer = aBuffer.order(ByteOrder.nativeOrder());
+        mMaxPoses = (mBuffer.capacity() - HeaderSize) / PoseSize;
+    }
+
+    // Returns the current sequence number. It only changes when new poses are published,
+    // so pollers can compare it against the last value to skip unchanged frames.
+    public int getSequence() {
+        return mBuffer.getInt(SequenceOffset);
+    }
+
+    // Copies the pose at aIndex into aPose. Returns the sequence the pose was read at, or -1
+    // if the pose is not valid or a consistent copy could not be made.
+    public int readPose(int aIndex, float[] aPose) {
+        if ((aIndex < 0) || (aIndex >= mMaxPoses) || (aPose.length < PoseValueCount)) {
+            return -1;
+        }
+        final int offset = HeaderSize + (aIndex * PoseSize);
+        for (int retry = 0; retry < MaxRetries; retry++) {
+            final int before = mBuffer.getInt(SequenceOffset);
+            if ((before & 1) != 0) {
+                continue;
+            }
+            fence();
+            if (aIndex >= mBuffer.getInt(CountOffset)) {
+                return -1;
+            }
+            for (int ix = 0; ix < PoseValueCount; ix++) {
+                aPose[ix] = mBuffer.getFloat(offset + (ix * 4));
+            }
+            final boolean valid = mBuffer.getInt(offset + ValidOffset) != 0;
+            fence();
+            if (mBuffer.getInt(SequenceOffset) == before) {
+                return valid ? before : -1;
+            }
+        }
+        return -1;
+    }
+
+    // ByteBuffer accessors are plain loads and VarHandle fences are not available on our
+    // minimum API level. A volatile store followed by a volatile load orders the buffer
+    // reads on either side of it.
+    private void fence() {
+        mFence = 0;
+        int unused = mFence;
+    }
+}
@@ -0,0 +1,58 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+// Writer side of the native crow::PresentationFrames. The layout must be kept in sync with PresentationFrames.h.
+// Publishes the head pose and render time of each stereo frame posted to the presentation surface.
+// All writes happen on the producer thread, there is a single writer.
+class PresentationFrames {
+    private static final int CountOffset = 0;
+    private static final int AttachedOffset = 4;
+    private static final int HeaderSize = 8;
+    private static final int SlotSize = 48;
+    private static final int FrameOffset = 0;
+    private static final int TimestampOffset = 8;
+    private static final int PoseOffset = 16;
+
+    private final ByteBuffer mBuffer;
+    private final int mSlotCount;
+    private int mFrame;
+
+    PresentationFrames(ByteBuffer aBuffer) {
+        mBuffer = aBuffer.order(ByteOrder.nativeOrder());
+        mSlotCount = (mBuffer.capacity() - HeaderSize) / SlotSize;
+    }
+
+    // Called by a producer before it posts its first frame.
+    void attach() {
+        mFrame = 0;
+        mBuffer.putInt(CountOffset, 0);
+        mBuffer.putInt(AttachedOffset, 1);
+    }
+
+    // Called once the producer has released its Surface, which may then be destroyed.
+    void detach() {
+        mBuffer.putInt(AttachedOffset, 0);
+    }
+
+    // Called right after posting a frame rendered at aTimestamp (System.nanoTime()) for aPose,
+    // a PoseMirror head pose.
+    void publish(long aTimestamp, float[] aPose) {
+        mFrame++;
+        final int offset = HeaderSize + ((mFrame % mSlotCount) * SlotSize);
+        // Frame 0 is never published, the reader skips the slot while it is rewritten.
+        mBuffer.putInt(offset + FrameOffset, 0);
+        mBuffer.putLong(offset + TimestampOffset, aTimestamp);
+        for (int ix = 0; ix < PoseMirror.PoseValueCount; ix++) {
+            mBuffer.putFloat(offset + PoseOffset + (ix * 4), aPose[ix]);
+        }
+        mBuffer.putInt(offset + FrameOffset, mFrame);
+        mBuffer.putInt(CountOffset, mFrame);
+    }
+}
@@ -0,0 +1,58 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import android.graphics.SurfaceTexture;
+import android.os.Handler;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+// Writer side of the native crow::SurfaceLatch. The layout must be kept in sync with SurfaceLatch.h.
+// Counts the frames queued on each widget SurfaceTexture so the render thread only latches
+// the ones that changed. All writes happen on the handler thread, there is a single writer.
+class SurfaceFrameCounters {
+    private static final int SlotSize = 8;
+    private static final int CountOffset = 0;
+    private static final int AttachedOffset = 4;
+
+    private final ByteBuffer mBuffer;
+    private final int mMaxSurfaces;
+    private final Handler mHandler;
+
+    SurfaceFrameCounters(ByteBuffer aBuffer, Handler aHandler) {
+        mBuffer = aBuffer.order(ByteOrder.nativeOrder());
+        mMaxSurfaces = mBuffer.capacity() / SlotSize;
+        mHandler = aHandler;
+    }
+
+    // Safe to call again for the same texture, e.g. when the widget is resized.
+    void attach(SurfaceTexture aTexture, final int aHandle) {
+        if ((aTexture == null) || (aHandle < 0) || (aHandle >= mMaxSurfaces)) {
+            // The native side latches uncounted surfaces every frame.
+            return;
+        }
+        final int offset = aHandle * SlotSize;
+        aTexture.setOnFrameAvailableListener(new SurfaceTexture.OnFrameAvailableListener() {
+            @Override
+            public void onFrameAvailable(SurfaceTexture aSurfaceTexture) {
+                mBuffer.putInt(offset + CountOffset, mBuffer.getInt(offset + CountOffset) + 1);
+            }
+        }, mHandler);
+        mBuffer.putInt(offset + AttachedOffset, 1);
+    }
+
+    // Tells the native side the producer of the surface is gone and the SurfaceTexture may be destroyed.
+    void detach(SurfaceTexture aTexture, final int aHandle) {
+        if (aTexture != null) {
+            aTexture.setOnFrameAvailableListener(null);
+        }
+        if ((aHandle < 0) || (aHandle >= mMaxSurfaces)) {
+            return;
+        }
+        mBuffer.putInt((aHandle * SlotSize) + AttachedOffset, 0);
+    }
+}
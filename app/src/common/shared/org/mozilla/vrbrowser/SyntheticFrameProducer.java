@@ -0,0 +1,152 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import android.graphics.Canvas;
+import android.graphics.Color;
+import android.graphics.Paint;
+import android.graphics.SurfaceTexture;
+import android.os.Handler;
+import android.os.HandlerThread;
+import android.util.Log;
+import android.view.Choreographer;
+import android.view.Surface;
+
+// Stands in for a presenting WebVR page: draws side by side stereo test frames into the
+// presentation surface once per display frame, each for the latest head pose, so the
+// presentation path can be exercised and measured without Gecko. Started by launching with
+//   adb shell am start -a android.intent.action.VIEW --ez synthetic_presentation true <package>
+// and stopped with the back button.
+// A marker is drawn where a point straight ahead of the starting pose would appear, so
+// frames shown with the wrong pose make it jump, and a bar sweeps across each eye once a
+// second, so dropped frames show as skips.
+class SyntheticFrameProducer implements Choreographer.FrameCallback {
+    static final String LOGTAG = "VRB";
+    // Horizontal field of view assumed for placing the marker.
+    static final float EyeFieldOfView = (float) (Math.PI / 2.0);
+    static final int SweepFrames = 60;
+
+    private final HandlerThread mThread;
+    private final Handler mHandler;
+    private final Surface mSurface;
+    // Surfaces handed over by the compositor stay owned by it.
+    private final boolean mOwnsSurface;
+    private final PresentationFrames mFrames;
+    private final PoseMirror mPoseMirror;
+    private final int mWidth;
+    private final int mHeight;
+    private final float[] mPose = new float[PoseMirror.PoseValueCount];
+    private final Paint mMarkerPaint = new Paint();
+    private final Paint mSweepPaint = new Paint();
+    private boolean mRunning;
+    private int mFrame;
+
+    // Draws into aTexture, the frames are copied into the eye buffers.
+    SyntheticFrameProducer(SurfaceTexture aTexture, int aWidth, int aHeight, PresentationFrames aFrames,
+                           PoseMirror aPoseMirror) {
+        this(createSurface(aTexture, aWidth, aHeight), true, aWidth, aHeight, aFrames, aPoseMirror);
+    }
+
+    // Draws into a compositor surface of aWidth x aHeight, shown without a copy.
+    SyntheticFrameProducer(Surface aSurface, int aWidth, int aHeight, PresentationFrames aFrames,
+                           PoseMirror aPoseMirror) {
+        this(aSurface, false, aWidth, aHeight, aFrames, aPoseMirror);
+    }
+
+    private SyntheticFrameProducer(Surface aSurface, boolean aOwnsSurface, int aWidth, int aHeight,
+                                   PresentationFrames aFrames, PoseMirror aPoseMirror) {
+        mSurface = aSurface;
+        mOwnsSurface = aOwnsSurface;
+        mFrames = aFrames;
+        mPoseMirror = aPoseMirror;
+        mWidth = aWidth;
+        mHeight = aHeight;
+        // Identity until the first pose is read.
+        mPose[3] = 1.0f;
+        mMarkerPaint.setColor(Color.WHITE);
+        mMarkerPaint.setAntiAlias(true);
+        mSweepPaint.setColor(Color.rgb(255, 149, 0));
+        mThread = new HandlerThread("SyntheticFrameProducer");
+        mThread.start();
+        mHandler = new Handler(mThread.getLooper());
+    }
+
+    private static Surface createSurface(SurfaceTexture aTexture, int aWidth, int aHeight) {
+        aTexture.setDefaultBufferSize(aWidth, aHeight);
+        return new Surface(aTexture);
+    }
+
+    void start() {
+        mHandler.post(new Runnable() {
+            @Override
+            public void run() {
+                mFrames.attach();
+                mRunning = true;
+                Choreographer.getInstance().postFrameCallback(SyntheticFrameProducer.this);
+            }
+        });
+    }
+
+    // The native side destroys the surface once the producer has detached.
+    void stop() {
+        mHandler.post(new Runnable() {
+            @Override
+            public void run() {
+                mRunning = false;
+                Choreographer.getInstance().removeFrameCallback(SyntheticFrameProducer.this);
+                if (mOwnsSurface) {
+                    mSurface.release();
+                }
+                mFrames.detach();
+                Log.i(LOGTAG, "SyntheticFrameProducer stopped after " + mFrame + " frames");
+                mThread.quitSafely();
+            }
+        });
+    }
+
+    @Override
+    public void doFrame(long aFrameTimeNanos) {
+        if (!mRunning) {
+            return;
+        }
+        Choreographer.getInstance().postFrameCallback(this);
+        final long timestamp = System.nanoTime();
+        if (mPoseMirror != null) {
+            mPoseMirror.readPose(PoseMirror.HeadIndex, mPose);
+        }
+        Canvas canvas;
+        try {
+            canvas = mSurface.lockHardwareCanvas();
+        } catch (IllegalStateException e) {
+            // The consumer may already be gone while stopping.
+            Log.e(LOGTAG, "SyntheticFrameProducer failed to lock the surface: " + e);
+            return;
+        }
+        drawFrame(canvas);
+        mSurface.unlockCanvasAndPost(canvas);
+        mFrames.publish(timestamp, mPose);
+        mFrame++;
+    }
+
+    private void drawFrame(Canvas aCanvas) {
+        final float x = mPose[0], y = mPose[1], z = mPose[2], w = mPose[3];
+        // Rotation about the vertical axis, positive when turning left.
+        final float yaw = (float) Math.atan2(2.0f * ((w * y) + (x * z)), 1.0f - (2.0f * ((x * x) + (y * y))));
+        final float eyeWidth = mWidth / 2.0f;
+        final float sweep = (mFrame % SweepFrames) / (float) SweepFrames;
+        for (int eye = 0; eye < 2; eye++) {
+            final float left = eye * eyeWidth;
+            aCanvas.save();
+            aCanvas.clipRect(left, 0.0f, left + eyeWidth, mHeight);
+            aCanvas.drawColor(eye == 0 ? Color.rgb(32, 48, 96) : Color.rgb(32, 96, 48));
+            final float markerX = left + (eyeWidth * (0.5f + (yaw / EyeFieldOfView)));
+            aCanvas.drawCircle(markerX, mHeight / 2.0f, mHeight / 20.0f, mMarkerPaint);
+            final float sweepX = left + (sweep * eyeWidth);
+            aCanvas.drawRect(sweepX, mHeight * 0.9f, sweepX + (eyeWidth / SweepFrames), mHeight, mSweepPaint);
+            aCanvas.restore();
+        }
+    }
+}
@@ -5,6 +5,8 @@
 
 package org.mozilla.vrbrowser;
 
+import android.app.ActivityManager;
+import android.content.Context;
 import android.content.Intent;
 import android.graphics.SurfaceTexture;
 import android.net.Uri;
@@ -15,6 +17,7 @@ import android.os.Handler;
 import android.support.annotation.Keep;
 import android.util.DisplayMetrics;
 import android.util.Log;
+import android.view.Surface;
 import android.view.View;
 import android.widget.FrameLayout;
 
@@ -24,9 +27,10 @@ import org.mozilla.vrbrowser.ui.BrowserHeaderWidget;
 import org.mozilla.vrbrowser.ui.OffscreenDisplay;
 import org.mozilla.vrbrowser.ui.NavigationBar;
 
+import java.nio.ByteBuffer;
 import java.util.HashMap;
 
-public class VRBrowserActivity extends PlatformActivity {
+public class VRBrowserActivity extends PlatformActivity implements EventRing.Delegate, BrowserHeaderWidget.Delegate {
 
     class SwipeRunnable implements Runnable {
         boolean mCanceled = false;
@@ -47,6 +51,11 @@ public class VRBrowserActivity extends PlatformActivity {
     static final int GestureSwipeLeft = 0;
     static final int GestureSwipeRight = 1;
     static final int SwipeDelay = 1000; // milliseconds
+    static final int AudioUpdateInterval = 16; // milliseconds
+    // Share of the device memory the widget surfaces may use before hibernating.
+    static final int TextureBudgetDivisor = 16;
+    // Boolean launch intent extra that presents test frames from a SyntheticFrameProducer.
+    static final String ExtraSyntheticPresentation = "synthetic_presentation";
 
     static final String LOGTAG = "VRB";
     HashMap<Integer, Widget> mWidgets;
@@ -56,7 +65,32 @@ public class VRBrowserActivity extends PlatformActivity {
     int mLastGesture;
     SwipeRunnable mLastRunnable;
     Handler mHandler = new Handler();
-    Runnable mAudioUpdateRunnable;
+    volatile EventRing mEventRing;
+    volatile PoseMirror mPoseMirror;
+    volatile SurfaceFrameCounters mFrameCounters;
+    volatile PresentationFrames mPresentationFrames;
+    SyntheticFrameProducer mSyntheticProducer;
+    // Presentation state of the UI thread, the native side follows on its next frame.
+    boolean mPresenting;
+    boolean mSyntheticPresentation;
+    boolean mPendingSyntheticPresentation;
+    final float[] mHeadPose = new float[PoseMirror.PoseValueCount];
+    int mLastPoseSequence = -1;
+    Runnable mAudioUpdateRunnable = new Runnable() {
+        @Override
+        public void run() {
+            updateAudioPose();
+            mHandler.postDelayed(this, AudioUpdateInterval);
+        }
+    };
+    Runnable mDrainEventsRunnable = new Runnable() {
+        @Override
+        public void run() {
+            if (mEventRing != null) {
+                mEventRing.drain();
+            }
+        }
+    };
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
@@ -76,12 +110,6 @@ public class VRBrowserActivity extends PlatformActivity {
                 // mAudioEngine.playSound(AudioEngine.Sound.AMBIENT, true);
             }
         });
-        mAudioUpdateRunnable = new Runnable() {
-            @Override
-            public void run() {
-                mAudioEngine.update();
-            }
-        };
 
         loadFromIntent(getIntent());
         queueRunnable(new Runnable() {
@@ -89,12 +117,13 @@ public class VRBrowserActivity extends PlatformActivity {
             public void run() {
                 createOffscreenDisplay();
             }
-        });
+        }, RUNNABLE_PRIORITY_LOW);
     }
 
     @Override
     protected void onPause() {
         SessionStore.get().setShowSoftInputOnFocus(true);
+        mHandler.removeCallbacks(mAudioUpdateRunnable);
         mAudioEngine.pauseEngine();
         super.onPause();
     }
@@ -103,6 +132,7 @@ public class VRBrowserActivity extends PlatformActivity {
     protected void onResume() {
         SessionStore.get().setShowSoftInputOnFocus(false);
         mAudioEngine.resumeEngine();
+        mHandler.post(mAudioUpdateRunnable);
         super.onResume();
     }
 
@@ -114,6 +144,7 @@ public class VRBrowserActivity extends PlatformActivity {
         if (mAudioEngine != null) {
             mAudioEngine.release();
         }
+        stopPresentationProducer();
         super.onDestroy();
     }
 
@@ -131,6 +162,14 @@ public class VRBrowserActivity extends PlatformActivity {
     }
 
     void loadFromIntent(final Intent intent) {
+        if (intent.getBooleanExtra(ExtraSyntheticPresentation, false)) {
+            if (mPresentationFrames != null) {
+                enterPresentation(true);
+            } else {
+                // Started once the native side has shared the presentation frames.
+                mPendingSyntheticPresentation = true;
+            }
+        }
         final Uri uri = intent.getData();
         if (SessionStore.get().getCurrentSession() == null) {
             String url = (uri != null ? uri.toString() : SessionStore.DEFAULT_URL);
@@ -146,6 +185,10 @@ public class VRBrowserActivity extends PlatformActivity {
 
     @Override
     public void onBackPressed() {
+        if (mPresenting) {
+            exitPresentation();
+            return;
+        }
         if (SessionStore.get().canGoBack()) {
             SessionStore.get().goBack();
         } else {
@@ -154,6 +197,10 @@ public class VRBrowserActivity extends PlatformActivity {
     }
 
     void createWidget(final int aType, final int aHandle, SurfaceTexture aTexture, int aWidth, int aHeight) {
+        SurfaceFrameCounters counters = mFrameCounters;
+        if (counters != null) {
+            counters.attach(aTexture, aHandle);
+        }
         Widget widget = mWidgets.get(aHandle);
         if (widget != null) {
             Log.e(LOGTAG, "Widget of type: " + aType + " already created");
@@ -170,7 +217,9 @@ public class VRBrowserActivity extends PlatformActivity {
             int currentSession = SessionStore.get().getCurrentSessionId();
             widget = new BrowserWidget(this, currentSession);
         } else if (aType == Widget.URLBar) {
-            widget = new BrowserHeaderWidget(this);
+            BrowserHeaderWidget header = new BrowserHeaderWidget(this);
+            header.setDelegate(this);
+            widget = header;
         }
 
         if (widget != null) {
@@ -192,73 +241,188 @@ public class VRBrowserActivity extends PlatformActivity {
     }
 
     @Keep
-    void handleMotionEvent(final int aHandle, final int aDevice, final boolean aPressed, final float aX, final float aY) {
-        runOnUiThread(new Runnable() {
-            @Override
-            public void run() {
-                Widget widget = mWidgets.get(aHandle);
-                if (widget != null) {
-                    MotionEventGenerator.dispatch(widget, aDevice, aPressed, aX, aY);
-                } else {
-                    Log.e(LOGTAG, "Failed to find widget: " + aHandle);
-                }
-            }
-        });
+    void setSurfaceFrameCounters(final ByteBuffer aBuffer) {
+        mFrameCounters = new SurfaceFrameCounters(aBuffer, mHandler);
     }
 
     @Keep
-    void handleScrollEvent(final int aHandle, final int aDevice, final float aX, final float aY) {
+    void setEventRing(final ByteBuffer aBuffer) {
+        mEventRing = new EventRing(aBuffer, this);
+    }
+
+    // Called from the render thread at most once per frame.
+    @Keep
+    void dispatchEvents(final int aWriteIndex) {
+        EventRing ring = mEventRing;
+        if ((ring != null) && ring.publish(aWriteIndex)) {
+            runOnUiThread(mDrainEventsRunnable);
+        }
+    }
+
+    @Override
+    public void onMotionEvent(int aHandle, int aDevice, boolean aPressed, float aX, float aY, long aEventTime) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget != null) {
+            MotionEventGenerator.dispatch(widget, aDevice, aPressed, aX, aY, aEventTime);
+        } else {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+        }
+    }
+
+    @Override
+    public void onScrollEvent(int aHandle, int aDevice, float aX, float aY, long aEventTime) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget != null) {
+            MotionEventGenerator.dispatchScroll(widget, aDevice, aX, aY, aEventTime);
+        } else {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+        }
+    }
+
+    @Override
+    public void onGesture(int aType) {
+        boolean consumed = false;
+        if ((aType == GestureSwipeLeft) && (mLastGesture == GestureSwipeLeft)) {
+            Log.e(LOGTAG, "Go BACK!");
+            SessionStore.get().goBack();
+            consumed = true;
+        } else if ((aType == GestureSwipeRight) && (mLastGesture == GestureSwipeRight)) {
+            Log.e(LOGTAG, "Go FORWARD!");
+            SessionStore.get().goForward();
+            consumed = true;
+        }
+        if (mLastRunnable != null) {
+            mLastRunnable.mCanceled = true;
+            mLastRunnable = null;
+        }
+        if (consumed) {
+            mLastGesture = NoGesture;
+
+        } else {
+            mLastGesture = aType;
+            mLastRunnable = new SwipeRunnable();
+            mHandler.postDelayed(mLastRunnable, SwipeDelay);
+        }
+    }
+
+    @Override
+    public void onAttentionChanged(int aHandle, int aLevel) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget != null) {
+            widget.setAttention(aLevel);
+        } else {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+        }
+    }
+
+    @Override
+    public void onHibernate(int aHandle) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget == null) {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+            return;
+        }
+        SurfaceTexture texture = widget.releaseSurface();
+        SurfaceFrameCounters counters = mFrameCounters;
+        if (counters != null) {
+            counters.detach(texture, aHandle);
+        }
+    }
+
+    // BrowserHeaderWidget.Delegate
+    @Override
+    public void onTabOverview(boolean aEnabled) {
+        setTabOverview(aEnabled);
+    }
+
+    @Keep
+    void setPoseMirror(final ByteBuffer aBuffer) {
+        mPoseMirror = new PoseMirror(aBuffer);
+    }
+
+    @Keep
+    void setPresentationFrames(final ByteBuffer aBuffer) {
+        mPresentationFrames = new PresentationFrames(aBuffer);
         runOnUiThread(new Runnable() {
             @Override
             public void run() {
-                Widget widget = mWidgets.get(aHandle);
-                if (widget != null) {
-                    MotionEventGenerator.dispatchScroll(widget, aDevice, aX, aY);
-                } else {
-                    Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+                if (mPendingSyntheticPresentation) {
+                    mPendingSyntheticPresentation = false;
+                    enterPresentation(true);
                 }
             }
         });
     }
 
+    // Presents side by side stereo frames instead of the browser scene. Without a page
+    // producer only the synthetic test frames can be presented.
+    void enterPresentation(boolean aSynthetic) {
+        if (mPresenting) {
+            return;
+        }
+        mPresenting = true;
+        mSyntheticPresentation = aSynthetic;
+        startPresentation(0, 0);
+    }
+
+    void exitPresentation() {
+        if (!mPresenting) {
+            return;
+        }
+        mPresenting = false;
+        stopPresentation();
+    }
+
+    // Called from the render thread with the surface immersive frames are presented through,
+    // or with both null once the presentation ends. aSurface is set when the compositor shows
+    // the frames directly, otherwise they are drawn into aTexture and copied into the eye buffers.
     @Keep
-    void handleGesture(final int aType) {
+    void dispatchPresentationSurface(final SurfaceTexture aTexture, final Surface aSurface, final int aWidth,
+                                     final int aHeight) {
         runOnUiThread(new Runnable() {
             @Override
             public void run() {
-                boolean consumed = false;
-                if ((aType == GestureSwipeLeft) && (mLastGesture == GestureSwipeLeft)) {
-                    Log.e(LOGTAG, "Go BACK!");
-                    SessionStore.get().goBack();
-                    consumed = true;
-                } else if ((aType == GestureSwipeRight) && (mLastGesture == GestureSwipeRight)) {
-                    Log.e(LOGTAG, "Go FORWARD!");
-                    SessionStore.get().goForward();
-                    consumed = true;
+                stopPresentationProducer();
+                PresentationFrames frames = mPresentationFrames;
+                if (((aTexture == null) && (aSurface == null)) || (frames == null)) {
+                    return;
                 }
-                if (mLastRunnable != null) {
-                    mLastRunnable.mCanceled = true;
-                    mLastRunnable = null;
+                if (!mSyntheticPresentation) {
+                    // GeckoView does not expose a WebVR frame producer yet.
+                    Log.e(LOGTAG, "No frame producer for the presentation surface");
+                    return;
                 }
-                if (consumed) {
-                    mLastGesture = NoGesture;
-
+                if (aSurface != null) {
+                    mSyntheticProducer = new SyntheticFrameProducer(aSurface, aWidth, aHeight, frames, mPoseMirror);
                 } else {
-                    mLastGesture = aType;
-                    mLastRunnable = new SwipeRunnable();
-                    mHandler.postDelayed(mLastRunnable, SwipeDelay);
+                    mSyntheticProducer = new SyntheticFrameProducer(aTexture, aWidth, aHeight, frames, mPoseMirror);
                 }
+                mSyntheticProducer.start();
             }
         });
     }
 
-    @Keep
-    void handleAudioPose(float qx, float qy, float qz, float qw, float px, float py, float pz) {
-        mAudioEngine.setPose(qx, qy, qz, qw, px, py, pz);
+    void stopPresentationProducer() {
+        if (mSyntheticProducer != null) {
+            mSyntheticProducer.stop();
+            mSyntheticProducer = null;
+        }
+    }
+
+    void updateAudioPose() {
+        PoseMirror mirror = mPoseMirror;
+        if ((mirror != null) && (mirror.getSequence() != mLastPoseSequence)) {
+            final int sequence = mirror.readPose(PoseMirror.HeadIndex, mHeadPose);
+            if (sequence >= 0) {
+                mLastPoseSequence = sequence;
+                mAudioEngine.setPose(mHeadPose[0], mHeadPose[1], mHeadPose[2], mHeadPose[3],
+                        mHeadPose[4], mHeadPose[5], mHeadPose[6]);
+            }
+        }
 
         // https://developers.google.com/vr/reference/android/com/google/vr/sdk/audio/GvrAudioEngine.html#resume()
         // The update method must be called from the main thread at a regular rate.
-        runOnUiThread(mAudioUpdateRunnable);
+        mAudioEngine.update();
     }
 
     @Keep
@@ -267,6 +431,18 @@ public class VRBrowserActivity extends PlatformActivity {
         return dm.densityDpi;
     }
 
+    // Widget texture budget in megabytes, 256 MB on a 4 GB headset.
+    @Keep
+    int getTextureBudget() {
+        ActivityManager manager = (ActivityManager) getSystemService(Context.ACTIVITY_SERVICE);
+        if (manager == null) {
+            return 0;
+        }
+        ActivityManager.MemoryInfo info = new ActivityManager.MemoryInfo();
+        manager.getMemoryInfo(info);
+        return (int) (info.totalMem / TextureBudgetDivisor / (1024 * 1024));
+    }
+
     void createOffscreenDisplay() {
         int[] ids = new int[1];
         GLES20.glGenTextures(1, ids, 0);
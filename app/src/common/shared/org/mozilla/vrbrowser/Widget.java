@@ -11,8 +11,17 @@ import android.view.MotionEvent;
 public interface Widget {
     int Browser = 0;
     int URLBar = 1;
+    // Attention levels, must be kept in sync with WidgetAttention.h
+    int AttentionFocused = 0;
+    int AttentionPeripheral = 1;
+    int AttentionInvisible = 2;
     void setSurfaceTexture(SurfaceTexture aTexture, final int aWidth, final int aHeight);
     void handleTouchEvent(MotionEvent aEvent);
     void handleHoverEvent(MotionEvent aEvent);
+    // Hint to throttle or pause painting while the user is not looking at the widget.
+    void setAttention(int aLevel);
+    // Stops drawing into the surface and releases it. Returns the released SurfaceTexture, or
+    // null. The native side then destroys it and restores the widget with setSurfaceTexture().
+    SurfaceTexture releaseSurface();
     void releaseWidget();
 }
@@ -25,6 +25,12 @@ public class BrowserHeaderWidget extends UIWidget
     private boolean mIsTruncatingTabs = false;
     private int mHeaderButtonMargin;
     private int mTabLayoutAddMargin;
+    private boolean mTabOverview;
+    private BrowserHeaderWidget.Delegate mDelegate;
+
+    public interface Delegate {
+        void onTabOverview(boolean aEnabled);
+    }
 
     public BrowserHeaderWidget(Context aContext) {
         super(aContext);
@@ -86,7 +92,10 @@ public class BrowserHeaderWidget extends UIWidget
         tabListAllButton.setOnClickListener(new OnClickListener() {
             @Override
             public void onClick(View v) {
-
+                mTabOverview = !mTabOverview;
+                if (mDelegate != null) {
+                    mDelegate.onTabOverview(mTabOverview);
+                }
             }
         });
 
@@ -120,6 +129,10 @@ public class BrowserHeaderWidget extends UIWidget
         SessionStore.get().addProgressListener(this);
     }
 
+    public void setDelegate(Delegate aDelegate) {
+        mDelegate = aDelegate;
+    }
+
     private void addTabClick() {
         int sessionId = SessionStore.get().createSession();
         SessionStore.get().setCurrentSession(sessionId, mContext);
@@ -143,6 +156,7 @@ public class BrowserHeaderWidget extends UIWidget
         SessionStore.get().removeSessionChangeListener(this);
         SessionStore.get().removeContentListener(this);
         SessionStore.get().removeProgressListener(this);
+        mDelegate = null;
         super.releaseWidget();
     }
 
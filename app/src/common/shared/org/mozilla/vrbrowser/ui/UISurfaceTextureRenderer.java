@@ -29,6 +29,24 @@ class UISurfaceTextureRenderer {
         mSurface = new Surface(mSurfaceTexture);
     }
 
+    void resize(int aWidth, int aHeight) {
+        if ((mSurfaceTexture == null) || ((aWidth == mTextureWidth) && (aHeight == mTextureHeight))) {
+            return;
+        }
+        mTextureWidth = aWidth;
+        mTextureHeight = aHeight;
+        mSurfaceTexture.setDefaultBufferSize(aWidth, aHeight);
+    }
+
+    // Only drops the producer, the SurfaceTexture is left to its owner.
+    void releaseSurface() {
+        if (mSurface != null) {
+            mSurface.release();
+        }
+        mSurface = null;
+        mSurfaceTexture = null;
+    }
+
     void release() {
         if(mSurface != null){
             mSurface.release();
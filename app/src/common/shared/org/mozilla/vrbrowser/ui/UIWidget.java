@@ -9,6 +9,7 @@ import android.content.Context;
 import android.graphics.Canvas;
 import android.graphics.Rect;
 import android.graphics.SurfaceTexture;
+import android.os.SystemClock;
 import android.util.AttributeSet;
 import android.view.MotionEvent;
 import android.view.ViewParent;
@@ -22,7 +23,14 @@ public class UIWidget extends FrameLayout implements Widget {
     UISurfaceTextureRenderer mRenderer;
     SurfaceTexture mTexture;
     int mOffset[] = new int[2];
+    int mAttention = AttentionFocused;
+    // An invalidation arrived while invisible, or was delayed while peripheral. The widget is
+    // redrawn once visible again, or once the peripheral draw interval has passed.
+    boolean mDrawPending;
+    long mLastDrawTime;
     static final String LOGTAG = "VRB";
+    // Peripheral widgets draw into their surface at most at about 30 fps.
+    static final long PeripheralDrawInterval = 33;
 
     public UIWidget(Context aContext) {
         super(aContext);
@@ -39,7 +47,11 @@ public class UIWidget extends FrameLayout implements Widget {
     @Override
     public void setSurfaceTexture(SurfaceTexture aTexture, final int aWidth, final int aHeight) {
         if (mTexture!= null && (mTexture.equals(aTexture))) {
-            Log.e(LOGTAG, "TEXTURE ALREADY SET");
+            // Only the buffer is resized, the view keeps its layout size and draw() scales to fit.
+            if (mRenderer != null) {
+                mRenderer.resize(aWidth, aHeight);
+                postInvalidate();
+            }
             return;
         }
         mTexture = aTexture;
@@ -68,6 +80,28 @@ public class UIWidget extends FrameLayout implements Widget {
         this.dispatchGenericMotionEvent(aEvent);
     }
 
+    @Override
+    public void setAttention(int aLevel) {
+        final boolean wasInvisible = mAttention == AttentionInvisible;
+        mAttention = aLevel;
+        if (wasInvisible && (aLevel != AttentionInvisible) && mDrawPending) {
+            mDrawPending = false;
+            postInvalidate();
+        }
+    }
+
+    @Override
+    public SurfaceTexture releaseSurface() {
+        if (mRenderer != null) {
+            mRenderer.releaseSurface();
+            mRenderer = null;
+        }
+        SurfaceTexture texture = mTexture;
+        mTexture = null;
+        setWillNotDraw(true);
+        return texture;
+    }
+
     @Override
     public void releaseWidget() {
         if (mRenderer != null) {
@@ -83,6 +117,20 @@ public class UIWidget extends FrameLayout implements Widget {
             super.draw(aCanvas);
             return;
         }
+        if (mAttention == AttentionInvisible) {
+            mDrawPending = true;
+            return;
+        }
+        final long now = SystemClock.uptimeMillis();
+        if ((mAttention == AttentionPeripheral) && ((now - mLastDrawTime) < PeripheralDrawInterval)) {
+            if (!mDrawPending) {
+                mDrawPending = true;
+                postInvalidateDelayed(PeripheralDrawInterval - (now - mLastDrawTime));
+            }
+            return;
+        }
+        mDrawPending = false;
+        mLastDrawTime = now;
         Canvas textureCanvas = mRenderer.drawBegin();
         if(textureCanvas != null) {
             // set the proper scale
@@ -327,6 +327,13 @@ DeviceDelegateGoogleVR::GetControllerScrolled(const int32_t aWhichController, fl
   return m.touched;
 }
 
+void
+DeviceDelegateGoogleVR::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  // Both eyes share one side by side buffer.
+  aWidth = m.frameBufferSize.width / 2;
+  aHeight = m.frameBufferSize.height;
+}
+
 void
 DeviceDelegateGoogleVR::StartFrame() {
 
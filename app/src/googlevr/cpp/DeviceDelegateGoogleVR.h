@@ -31,6 +31,7 @@ public:
   const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
   bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton, bool& aChangedState) override;
   bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override;
+  void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const override;
   void StartFrame() override;
   void BindEye(const CameraEnum aWhich) override;
   void EndFrame() override;
@@ -63,6 +63,43 @@ JNI_METHOD(void, drawGL)
   sWorld->Draw();
 }
 
+JNI_METHOD(jfloatArray, getFrameStats)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetFrameStats()->GetJavaSummaries(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(jintArray, getGLCounters)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetGLCounters()->GetJavaCounters(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(void, setTabOverview)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  if (sWorld) {
+    sWorld->SetTabOverview(aEnabled != JNI_FALSE);
+  }
+}
+
+JNI_METHOD(void, startPresentation)
+(JNIEnv*, jobject, jint aWidth, jint aHeight) {
+  if (sWorld) {
+    sWorld->StartPresentation(aWidth, aHeight);
+  }
+}
+
+JNI_METHOD(void, stopPresentation)
+(JNIEnv*, jobject) {
+  if (sWorld) {
+    sWorld->StopPresentation();
+  }
+}
+
 jint JNI_OnLoad(JavaVM* aVm, void*) {
   sWorld = crow::BrowserWorld::Create();
   return JNI_VERSION_1_6;
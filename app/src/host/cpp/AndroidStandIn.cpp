@@ -0,0 +1,217 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host implementations of the few NDK APIs used by the native core.
+
+#include "HostSupport.h"
+
+#include <android/asset_manager.h>
+#include <android/asset_manager_jni.h>
+#include <android/log.h>
+#include <sys/system_properties.h>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct AAssetManager {
+  std::string root;
+};
+
+struct AAsset {
+  std::vector<char> data;
+  size_t position;
+  AAsset() : position(0) {}
+};
+
+namespace {
+
+AAssetManager sAssetManager;
+std::map<std::string, std::string> sProperties;
+bool sQuiet = false;
+
+const char*
+PriorityName(const int aPriority) {
+  switch (aPriority) {
+    case ANDROID_LOG_VERBOSE: return "V";
+    case ANDROID_LOG_DEBUG: return "D";
+    case ANDROID_LOG_INFO: return "I";
+    case ANDROID_LOG_WARN: return "W";
+    case ANDROID_LOG_ERROR: return "E";
+    case ANDROID_LOG_FATAL: return "F";
+  }
+  return "?";
+}
+
+} // namespace
+
+namespace crow {
+namespace host {
+
+void
+SetAssetRoot(const std::string& aPath) {
+  sAssetManager.root = aPath;
+}
+
+void
+SetSystemProperty(const std::string& aName, const std::string& aValue) {
+  sProperties[aName] = aValue;
+}
+
+void
+SetQuietLogging(const bool aQuiet) {
+  sQuiet = aQuiet;
+}
+
+} // namespace host
+} // namespace crow
+
+extern "C" {
+
+int
+__android_log_vprint(int aPriority, const char* aTag, const char* aFormat, va_list aArgs) {
+  if (sQuiet && (aPriority < ANDROID_LOG_WARN)) {
+    return 0;
+  }
+  fprintf(stderr, "%s/%s: ", PriorityName(aPriority), aTag ? aTag : "");
+  const int result = vfprintf(stderr, aFormat, aArgs);
+  fputc('\n', stderr);
+  return result;
+}
+
+int
+__android_log_print(int aPriority, const char* aTag, const char* aFormat, ...) {
+  va_list args;
+  va_start(args, aFormat);
+  const int result = __android_log_vprint(aPriority, aTag, aFormat, args);
+  va_end(args);
+  return result;
+}
+
+int
+__android_log_write(int aPriority, const char* aTag, const char* aText) {
+  return __android_log_print(aPriority, aTag, "%s", aText);
+}
+
+void
+__android_log_assert(const char* aCondition, const char* aTag, const char* aFormat, ...) {
+  fprintf(stderr, "F/%s: assertion failed: %s ", aTag ? aTag : "", aCondition ? aCondition : "");
+  if (aFormat) {
+    va_list args;
+    va_start(args, aFormat);
+    vfprintf(stderr, aFormat, args);
+    va_end(args);
+  }
+  fputc('\n', stderr);
+  abort();
+}
+
+int
+__system_property_get(const char* aName, char* aValue) {
+  aValue[0] = '\0';
+  std::string value;
+  auto property = sProperties.find(aName);
+  if (property != sProperties.end()) {
+    value = property->second;
+  } else {
+    std::string variable(aName);
+    for (char& c: variable) {
+      c = (c == '.') ? '_' : (char)toupper((unsigned char)c);
+    }
+    const char* env = getenv(variable.c_str());
+    if (env) {
+      value = env;
+    }
+  }
+  const size_t length = std::min(value.size(), (size_t)PROP_VALUE_MAX - 1);
+  memcpy(aValue, value.data(), length);
+  aValue[length] = '\0';
+  return (int)length;
+}
+
+AAssetManager*
+AAssetManager_fromJava(JNIEnv*, jobject) {
+  return &sAssetManager;
+}
+
+AAsset*
+AAssetManager_open(AAssetManager* aManager, const char* aFileName, int) {
+  if (!aManager || !aFileName) {
+    return nullptr;
+  }
+  const std::string path = aManager->root.empty() ? std::string(aFileName) : aManager->root + "/" + aFileName;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return nullptr;
+  }
+  AAsset* asset = new AAsset;
+  char buffer[4096];
+  size_t count = 0;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    asset->data.insert(asset->data.end(), buffer, buffer + count);
+  }
+  fclose(file);
+  return asset;
+}
+
+int
+AAsset_read(AAsset* aAsset, void* aBuffer, size_t aCount) {
+  const size_t count = std::min(aCount, aAsset->data.size() - aAsset->position);
+  memcpy(aBuffer, aAsset->data.data() + aAsset->position, count);
+  aAsset->position += count;
+  return (int)count;
+}
+
+off_t
+AAsset_seek(AAsset* aAsset, off_t aOffset, int aWhence) {
+  off_t base = 0;
+  if (aWhence == SEEK_CUR) {
+    base = (off_t)aAsset->position;
+  } else if (aWhence == SEEK_END) {
+    base = (off_t)aAsset->data.size();
+  }
+  const off_t position = base + aOffset;
+  if ((position < 0) || (position > (off_t)aAsset->data.size())) {
+    return (off_t)-1;
+  }
+  aAsset->position = (size_t)position;
+  return position;
+}
+
+void
+AAsset_close(AAsset* aAsset) {
+  delete aAsset;
+}
+
+const void*
+AAsset_getBuffer(AAsset* aAsset) {
+  return aAsset->data.data();
+}
+
+off_t
+AAsset_getLength(AAsset* aAsset) {
+  return (off_t)aAsset->data.size();
+}
+
+off64_t
+AAsset_getLength64(AAsset* aAsset) {
+  return (off64_t)aAsset->data.size();
+}
+
+off_t
+AAsset_getRemainingLength(AAsset* aAsset) {
+  return (off_t)(aAsset->data.size() - aAsset->position);
+}
+
+off64_t
+AAsset_getRemainingLength64(AAsset* aAsset) {
+  return (off64_t)(aAsset->data.size() - aAsset->position);
+}
+
+} // extern "C"
@@ -0,0 +1,395 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Unit tests of the native core parts that do not need a device, run by ctest:
+//   cmake -S app/src/host -B build-host && cmake --build build-host
+//   ctest --test-dir build-host --output-on-failure
+// Each test prints the checks that failed, the exit code is the number of failed tests.
+// Hit tests run against the SIMD path of the host CPU and are compared with a scalar
+// reference, runnables run against the JNI stand-in.
+
+#include "HostSupport.h"
+#include "JNIStandIn.h"
+#include "JobSystem.h"
+#include "PickTree.h"
+#include "RunnableQueue.h"
+#include "SkylinePacker.h"
+#include "TextureBudget.h"
+#include "WidgetHitTable.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <atomic>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+static const float kDistanceTolerance = 0.001f;
+// Frames a widget stays off screen before TextureBudget may evict it, kMinIdleFrames.
+static const int32_t kIdleFrames = 144;
+
+int32_t sFailures = 0;
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+    sFailures++; \
+  }
+
+// Deterministic, so a failure reproduces.
+float
+Random(uint32_t& aSeed, const float aMin, const float aMax) {
+  aSeed = (aSeed * 1664525u) + 1013904223u;
+  return aMin + ((aMax - aMin) * ((float)(aSeed >> 8) / (float)(1u << 24)));
+}
+
+// A transform turning aYaw radians about the vertical axis, then moving to aPosition.
+vrb::Matrix
+YawTransform(const float aYaw, const vrb::Vector& aPosition) {
+  vrb::Matrix result = vrb::Matrix::Rotation(vrb::Quaternion(0.0f, sinf(aYaw * 0.5f), 0.0f, cosf(aYaw * 0.5f)));
+  result.TranslateInPlace(aPosition);
+  return result;
+}
+
+void
+TestPickTree() {
+  PickTreePtr tree = PickTree::Create();
+  std::vector<int32_t> boxes;
+  // A wall of boxes, each further away than the one before.
+  for (int32_t ix = 0; ix < 200; ix++) {
+    const int32_t item = tree->AddBox(vrb::Vector(-1.0f, 0.0f, -0.1f), vrb::Vector(1.0f, 1.0f, 0.1f));
+    tree->SetTransform(item, vrb::Matrix::Position(
+        vrb::Vector((float)(ix % 20) * 3.0f, (float)(ix / 20) * 2.0f, -10.0f - ((float)ix * 0.01f))));
+    boxes.push_back(item);
+  }
+  const std::vector<vrb::Vector> vertices = {
+    vrb::Vector(-5.0f, 0.0f, 5.0f), vrb::Vector(5.0f, 0.0f, 5.0f),
+    vrb::Vector(5.0f, 0.0f, -5.0f), vrb::Vector(-5.0f, 0.0f, -5.0f)
+  };
+  const std::vector<int32_t> triangles = { 0, 1, 2, 0, 2, 3 };
+  const int32_t floor = tree->AddMesh(vertices, triangles);
+  tree->Update();
+  CHECK(tree->GetItemCount() == 201);
+
+  PickTree::Hit hit;
+  // Box 43 is at column 3, row 2.
+  CHECK(tree->PickNearest(vrb::Vector(9.0f, 4.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 100.0f, -1, hit));
+  CHECK(hit.item == boxes[43]);
+  CHECK(fabsf(hit.distance - (10.0f + 0.43f - 0.1f)) < kDistanceTolerance);
+  // Triangles are hit from both sides.
+  CHECK(tree->PickNearest(vrb::Vector(0.0f, 2.0f, 0.0f), vrb::Vector(0.0f, -1.0f, 0.0f), 100.0f, -1, hit));
+  CHECK((hit.item == floor) && (fabsf(hit.distance - 2.0f) < kDistanceTolerance));
+  CHECK(tree->PickNearest(vrb::Vector(0.0f, -2.0f, 0.0f), vrb::Vector(0.0f, 1.0f, 0.0f), 100.0f, -1, hit));
+  CHECK(hit.item == floor);
+  CHECK(!tree->PickNearest(vrb::Vector(0.0f, 2.0f, 0.0f), vrb::Vector(0.0f, -1.0f, 0.0f), 100.0f, floor, hit));
+  CHECK(!tree->PickNearest(vrb::Vector(9.0f, 4.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 5.0f, -1, hit));
+  tree->SetEnabled(boxes[43], false);
+  tree->Update();
+  CHECK(!tree->PickNearest(vrb::Vector(9.0f, 4.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 100.0f, -1, hit));
+  // Moving an item every frame refits, and eventually rebuilds, the tree.
+  for (int32_t frame = 0; frame < 100; frame++) {
+    tree->SetTransform(boxes[5], vrb::Matrix::Position(vrb::Vector((float)frame * 0.5f, 30.0f, -5.0f)));
+    tree->Update();
+  }
+  CHECK(tree->PickNearest(vrb::Vector(49.5f, 30.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 100.0f, -1, hit));
+  CHECK((hit.item == boxes[5]) && (fabsf(hit.distance - 4.9f) < kDistanceTolerance));
+  CHECK(!tree->PickNearest(vrb::Vector(0.5f, 30.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 100.0f, -1, hit));
+  tree->RemoveItem(boxes[5]);
+  tree->Update();
+  CHECK(!tree->PickNearest(vrb::Vector(49.5f, 30.5f, 0.0f), vrb::Vector(0.0f, 0.0f, -1.0f), 100.0f, -1, hit));
+}
+
+struct ReferenceWidget {
+  vrb::Matrix inverse;
+  vrb::Vector min;
+  vrb::Vector max;
+  bool enabled;
+  ReferenceWidget() : inverse(vrb::Matrix::Identity()), enabled(false) {}
+};
+
+// Scalar reference, one widget at a time with the full inverse matrices.
+bool
+ReferenceIntersect(const std::vector<ReferenceWidget>& aWidgets, const vrb::Vector& aStart,
+                   const vrb::Vector& aDirection, const float aMaxDistance, WidgetHitTable::Hit& aHit) {
+  float nearest = aMaxDistance;
+  aHit = WidgetHitTable::Hit();
+  for (size_t ix = 0; ix < aWidgets.size(); ix++) {
+    const ReferenceWidget& widget = aWidgets[ix];
+    if (!widget.enabled) {
+      continue;
+    }
+    const vrb::Vector start = widget.inverse.MultiplyPosition(aStart);
+    const vrb::Vector direction = widget.inverse.MultiplyDirection(aDirection);
+    if (direction.z() >= 0.0f) {
+      continue;
+    }
+    const float distance = (widget.min.z() - start.z()) / direction.z();
+    if ((distance < 0.0f) || (distance >= nearest)) {
+      continue;
+    }
+    const vrb::Vector point = start + (direction * distance);
+    if ((point.x() < widget.min.x()) || (point.x() > widget.max.x()) ||
+        (point.y() < widget.min.y()) || (point.y() > widget.max.y())) {
+      continue;
+    }
+    nearest = distance;
+    aHit.index = (int32_t)ix;
+    aHit.distance = distance;
+    aHit.point = point;
+  }
+  return aHit.index >= 0;
+}
+
+void
+TestWidgetHitTable() {
+  WidgetHitTablePtr table = WidgetHitTable::Create();
+  uint32_t seed = 1;
+  // Not a multiple of the SIMD width, so the padding lanes of the last block are exercised.
+  const int32_t count = 23;
+  std::vector<ReferenceWidget> widgets((size_t)count);
+  table->SetCount(count);
+  for (int32_t ix = 0; ix < count; ix++) {
+    ReferenceWidget& widget = widgets[ix];
+    const vrb::Vector position(Random(seed, -4.0f, 4.0f), Random(seed, -2.0f, 2.0f), Random(seed, -12.0f, -2.0f));
+    widget.inverse = YawTransform(Random(seed, -0.6f, 0.6f), position).AfineInverse();
+    widget.min = vrb::Vector(Random(seed, -2.0f, -0.5f), Random(seed, -1.5f, -0.2f), 0.0f);
+    widget.max = vrb::Vector(Random(seed, 0.5f, 2.0f), Random(seed, 0.2f, 1.5f), 0.0f);
+    widget.enabled = (ix % 7) != 3;
+    table->SetWidget(ix, widget.inverse, widget.min, widget.max);
+    table->SetEnabled(ix, widget.enabled);
+  }
+  CHECK(table->GetCount() == count);
+  int32_t hits = 0;
+  for (int32_t ray = 0; ray < 2000; ray++) {
+    const vrb::Vector start(Random(seed, -1.0f, 1.0f), Random(seed, -1.0f, 1.0f), Random(seed, -1.0f, 1.0f));
+    const vrb::Vector direction = vrb::Vector(Random(seed, -0.5f, 0.5f), Random(seed, -0.4f, 0.4f),
+                                              Random(seed, -1.0f, 0.2f)).Normalize();
+    WidgetHitTable::Hit expected, actual;
+    const bool expectedHit = ReferenceIntersect(widgets, start, direction, 20.0f, expected);
+    const bool actualHit = table->Intersect(start, direction, 20.0f, actual);
+    CHECK(expectedHit == actualHit);
+    if (expectedHit && actualHit) {
+      hits++;
+      CHECK(expected.index == actual.index);
+      CHECK(fabsf(expected.distance - actual.distance) < kDistanceTolerance);
+      CHECK(fabsf(expected.point.x() - actual.point.x()) < kDistanceTolerance);
+      CHECK(fabsf(expected.point.y() - actual.point.y()) < kDistanceTolerance);
+    }
+  }
+  // Otherwise the comparison above proves little.
+  CHECK(hits > 100);
+  // Growing the table leaves the new entries disabled.
+  table->SetCount(count + 5);
+  WidgetHitTable::Hit hit;
+  for (int32_t ray = 0; ray < 200; ray++) {
+    const vrb::Vector start(Random(seed, -1.0f, 1.0f), Random(seed, -1.0f, 1.0f), 0.0f);
+    if (table->Intersect(start, vrb::Vector(0.0f, 0.0f, -1.0f), 20.0f, hit)) {
+      CHECK(hit.index < count);
+    }
+  }
+}
+
+void
+TestSkylinePacker() {
+  SkylinePackerPtr packer = SkylinePacker::Create();
+  const int32_t size = 2048;
+  const int32_t padding = 2;
+  packer->Reset(size, size, padding);
+  CHECK(packer->GetOccupancy() == 0.0f);
+  std::vector<SkylinePacker::Rect> packed;
+  SkylinePacker::Rect rect;
+  while (packer->Insert(256, (packed.size() % 3) == 0 ? 37 : 144, rect)) {
+    CHECK((rect.x >= 0) && (rect.y >= 0) && ((rect.x + rect.width) <= size) && ((rect.y + rect.height) <= size));
+    for (const SkylinePacker::Rect& other: packed) {
+      // The padding is kept free between neighbors too.
+      const bool apart = ((rect.x + rect.width + padding) <= other.x) || ((other.x + other.width + padding) <= rect.x) ||
+                         ((rect.y + rect.height + padding) <= other.y) || ((other.y + other.height + padding) <= rect.y);
+      CHECK(apart);
+    }
+    packed.push_back(rect);
+  }
+  // 7 columns of 258 pixels, rows of 39 or 146.
+  CHECK(packed.size() >= 70);
+  CHECK(packer->GetOccupancy() > 0.8f);
+  SkylinePacker::Rect untouched;
+  untouched.x = -1;
+  CHECK(!packer->Insert(size + 1, 1, untouched));
+  CHECK(untouched.x == -1);
+  packer->Reset(size, size, padding);
+  CHECK(packer->Insert(size - padding, size - padding, rect));
+  CHECK((rect.x == 0) && (rect.y == 0));
+  CHECK(!packer->Insert(1, 1, rect));
+}
+
+void
+TestTextureBudget() {
+  TextureBudgetPtr budget = TextureBudget::Create();
+  budget->SetBudget(100);
+  budget->SetCount(3);
+  for (int32_t frame = 0; frame < 200; frame++) {
+    budget->BeginFrame();
+    budget->Update(0, 50, true);
+    budget->Update(1, 50, frame < 20);
+    budget->Update(2, 50, frame < 10);
+    if (frame < (10 + kIdleFrames)) {
+      // Widgets seen recently are never evicted, even over budget.
+      CHECK(budget->FindEviction() == -1);
+    }
+  }
+  CHECK(budget->GetUsedBytes() == 150);
+  // Least recently viewed first.
+  CHECK(budget->FindEviction() == 2);
+  budget->SetResidency(2, TextureBudget::Residency::Releasing);
+  CHECK(budget->GetResidency(2) == TextureBudget::Residency::Releasing);
+  CHECK(budget->GetResidencyFrames(2) == 0);
+  // The memory being released is already counted as freed.
+  CHECK(budget->FindEviction() == -1);
+  budget->BeginFrame();
+  budget->Update(2, 0, false);
+  budget->SetResidency(2, TextureBudget::Residency::Hibernated);
+  budget->SetBudget(50);
+  CHECK(budget->FindEviction() == 1);
+  budget->SetBudget(0);
+  CHECK(budget->FindEviction() == -1);
+}
+
+void
+TestRunnableQueue() {
+  host::JNIStandInPtr jni = host::JNIStandIn::Create();
+  JNIEnv* env = jni->GetEnv();
+  jobject runnable = jni->NewObject("org/mozilla/vrbrowser/TestRunnable");
+  RunnableQueuePtr queue = RunnableQueue::Create(jni->GetJavaVM());
+
+  struct pollfd wake = { queue->GetWakeFd(), POLLIN, 0 };
+  CHECK(wake.fd >= 0);
+  CHECK(poll(&wake, 1, 0) == 0);
+  queue->AddRunnable(env, runnable, RunnableQueue::Priority::Low);
+  CHECK(poll(&wake, 1, 0) == 1);
+  CHECK(queue->ProcessRunnables() == 1);
+  CHECK(poll(&wake, 1, 0) == 0);
+
+  // High priority runnables run whatever the budget, of the others at least one per pass.
+  queue->SetBudget(0.000001f);
+  for (int32_t ix = 0; ix < 4; ix++) {
+    queue->AddRunnable(env, runnable, RunnableQueue::Priority::Low);
+    queue->AddRunnable(env, runnable, RunnableQueue::Priority::High);
+  }
+  CHECK(queue->ProcessRunnables() == 5);
+  CHECK(queue->GetLastStats().deferred == 3);
+  CHECK(queue->ProcessRunnables() == 1);
+  CHECK(queue->GetLastStats().deferred == 2);
+  queue->SetBudget(0.0f);
+  CHECK(queue->ProcessRunnables() == 2);
+  CHECK(queue->GetLastStats().deferred == 0);
+
+  // Past the ring capacity runnables spill to the overflow list and none is lost.
+  const int32_t count = RunnableQueue::kCapacity + 10;
+  for (int32_t ix = 0; ix < count; ix++) {
+    queue->AddRunnable(env, runnable, RunnableQueue::Priority::Normal);
+  }
+  CHECK(queue->GetOverflowCount() == 10);
+  CHECK(queue->ProcessRunnables() == count);
+
+  // Several producers racing one consumer.
+  const int32_t producers = 4;
+  const int32_t perProducer = 5000;
+  std::atomic<int32_t> running(producers);
+  std::vector<std::thread> threads;
+  for (int32_t producer = 0; producer < producers; producer++) {
+    threads.emplace_back([&, producer]() {
+      for (int32_t ix = 0; ix < perProducer; ix++) {
+        queue->AddRunnable(env, runnable, static_cast<RunnableQueue::Priority>((producer + ix) % 3));
+      }
+      running.fetch_sub(1);
+    });
+  }
+  int32_t ran = 0;
+  while (running.load() > 0) {
+    ran += queue->ProcessRunnables();
+  }
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+  ran += queue->ProcessRunnables();
+  CHECK(ran == (producers * perProducer));
+}
+
+void
+TestJobSystem() {
+  JobSystemPtr jobs = JobSystem::Create();
+  // Without Start() every job runs on the calling thread.
+  int32_t ranInline = 0;
+  JobSystem::Handle handle = jobs->Run([&ranInline]() { ranInline++; });
+  CHECK(handle.IsDone() && (ranInline == 1));
+  CHECK(jobs->GetWorkerCount() == 0);
+
+  jobs->Start(3, JobSystem::Affinity::Any);
+  CHECK(jobs->GetWorkerCount() == 3);
+  std::atomic<int32_t> sum(0);
+  handle = jobs->ParallelFor(1000, 0, [&sum](const int32_t aBegin, const int32_t aEnd) {
+    sum.fetch_add(aEnd - aBegin);
+  });
+  std::atomic<int32_t> after(0);
+  JobSystem::Handle then = jobs->Then(handle, [&sum, &after]() { after.store(sum.load()); });
+  jobs->Wait(then);
+  CHECK(sum.load() == 1000);
+  CHECK(after.load() == 1000);
+
+  // Stopping while other threads keep scheduling runs every job exactly once.
+  std::atomic<int32_t> ran(0);
+  std::vector<std::thread> threads;
+  for (int32_t thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&jobs, &ran]() {
+      for (int32_t ix = 0; ix < 2000; ix++) {
+        JobSystem::Handle job = jobs->Run([&ran]() { ran++; });
+        jobs->Then(job, [&ran]() { ran++; });
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(200));
+  jobs->Stop();
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+  CHECK(ran.load() == 16000);
+  CHECK(jobs->GetWorkerCount() == 0);
+}
+
+struct Test {
+  const char* name;
+  void (*run)();
+};
+
+} // namespace
+
+int
+main(int aArgc, char** aArgv) {
+  host::SetQuietLogging(true);
+  const Test tests[] = {
+    { "PickTree", TestPickTree },
+    { "WidgetHitTable", TestWidgetHitTable },
+    { "SkylinePacker", TestSkylinePacker },
+    { "TextureBudget", TestTextureBudget },
+    { "RunnableQueue", TestRunnableQueue },
+    { "JobSystem", TestJobSystem }
+  };
+  int failed = 0;
+  for (const Test& test: tests) {
+    const int32_t before = sFailures;
+    test.run();
+    const bool passed = sFailures == before;
+    printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+    failed += passed ? 0 : 1;
+  }
+  return failed;
+}
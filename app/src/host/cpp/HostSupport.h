@@ -0,0 +1,25 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_HOSTSUPPORT_H
+#define VRBROWSER_HOSTSUPPORT_H
+
+#include <string>
+
+namespace crow {
+namespace host {
+
+// Directory the host AAssetManager reads from, normally app/src/main/assets.
+void SetAssetRoot(const std::string& aPath);
+// Properties set here take precedence. Otherwise __system_property_get() falls back to the
+// environment, with the name upper cased and dots replaced, e.g. DEBUG_VRBROWSER_TRACE.
+void SetSystemProperty(const std::string& aName, const std::string& aValue);
+// Drops messages below ANDROID_LOG_WARN so logging does not skew timings.
+void SetQuietLogging(const bool aQuiet);
+
+} // namespace host
+} // namespace crow
+
+#endif // VRBROWSER_HOSTSUPPORT_H
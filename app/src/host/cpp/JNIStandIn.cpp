@@ -0,0 +1,338 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "JNIStandIn.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct StandInObject {
+  std::string className;
+  void* address;
+  jlong capacity;
+  std::vector<jfloat> floats;
+  std::string utf;
+  StandInObject() : address(nullptr), capacity(0) {}
+};
+
+struct StandInMethod {
+  std::string name;
+  std::atomic<uint64_t> calls;
+  StandInMethod() : calls(0) {}
+};
+
+const size_t kTableSize = sizeof(JNINativeInterface_) / sizeof(void*);
+
+// Catch all for every table entry without an implementation below. Extra arguments are
+// ignored by the calling convention of the host platforms.
+template<size_t N> void*
+Unimplemented(JNIEnv*) {
+  static bool sReported = false;
+  if (!sReported) {
+    fprintf(stderr, "JNIStandIn: JNI function at table index %d is not implemented\n", (int)N);
+    sReported = true;
+  }
+  return nullptr;
+}
+
+template<size_t... N> void
+FillUnimplemented(void** aTable, std::index_sequence<N...>) {
+  void* stubs[] = { reinterpret_cast<void*>(&Unimplemented<N>)... };
+  std::copy(stubs, stubs + sizeof...(N), aTable);
+}
+
+} // namespace
+
+namespace crow {
+namespace host {
+
+struct JNIStandIn::State {
+  struct Env : public JNIEnv {
+    State* owner;
+  };
+  struct VM : public JavaVM {
+    State* owner;
+  };
+  JNINativeInterface_ functions;
+  JNIInvokeInterface_ invoke;
+  Env env;
+  VM vm;
+  // Guards objects and methods, the queue benchmark calls in from several threads.
+  std::mutex lock;
+  std::deque<StandInObject> objects;
+  std::map<std::string, StandInMethod> methods;
+  std::atomic<uint64_t> calls;
+  State() : calls(0) {
+    FillUnimplemented(reinterpret_cast<void**>(&functions), std::make_index_sequence<kTableSize>());
+    InitializeFunctions();
+    invoke.reserved0 = invoke.reserved1 = invoke.reserved2 = nullptr;
+    invoke.DestroyJavaVM = [](JavaVM*) -> jint { return JNI_OK; };
+    invoke.AttachCurrentThread = [](JavaVM* aVM, void** aEnv, void*) -> jint {
+      *aEnv = &Get(aVM).env;
+      return JNI_OK;
+    };
+    invoke.DetachCurrentThread = [](JavaVM*) -> jint { return JNI_OK; };
+    invoke.GetEnv = [](JavaVM* aVM, void** aEnv, jint) -> jint {
+      *aEnv = &Get(aVM).env;
+      return JNI_OK;
+    };
+    invoke.AttachCurrentThreadAsDaemon = invoke.AttachCurrentThread;
+    env.functions = &functions;
+    env.owner = this;
+    vm.functions = &invoke;
+    vm.owner = this;
+  }
+
+  static State& Get(JNIEnv* aEnv) { return *static_cast<Env*>(aEnv)->owner; }
+  static State& Get(JavaVM* aVM) { return *static_cast<VM*>(aVM)->owner; }
+  static StandInObject* Object(jobject aObject) { return reinterpret_cast<StandInObject*>(aObject); }
+
+  jobject CreateObject(const std::string& aClassName) {
+    std::lock_guard<std::mutex> guard(lock);
+    objects.emplace_back();
+    objects.back().className = aClassName;
+    return reinterpret_cast<jobject>(&objects.back());
+  }
+
+  StandInMethod* GetMethod(jclass aClass, const char* aName, const char* aSignature) {
+    const std::string className = aClass ? Object(aClass)->className : std::string();
+    const std::string key = className + "." + aName + aSignature;
+    std::lock_guard<std::mutex> guard(lock);
+    StandInMethod& method = methods[key];
+    method.name = key;
+    return &method;
+  }
+
+  template<typename T> struct Zero {
+    static T Value() { return T(); }
+  };
+
+  static void Count(JNIEnv* aEnv, jmethodID aMethod) {
+    State& self = Get(aEnv);
+    self.calls++;
+    if (aMethod) {
+      reinterpret_cast<StandInMethod*>(aMethod)->calls++;
+    }
+  }
+
+  template<typename T, typename Receiver> static T
+  Call(JNIEnv* aEnv, Receiver, jmethodID aMethod, ...) {
+    Count(aEnv, aMethod);
+    return Zero<T>::Value();
+  }
+
+  template<typename T, typename Receiver> static T
+  CallV(JNIEnv* aEnv, Receiver, jmethodID aMethod, va_list) {
+    Count(aEnv, aMethod);
+    return Zero<T>::Value();
+  }
+
+  template<typename T, typename Receiver> static T
+  CallA(JNIEnv* aEnv, Receiver, jmethodID aMethod, const jvalue*) {
+    Count(aEnv, aMethod);
+    return Zero<T>::Value();
+  }
+
+  static jobject NewObjectV(JNIEnv* aEnv, jclass aClass, jmethodID aMethod, va_list) {
+    Count(aEnv, aMethod);
+    return Get(aEnv).CreateObject(aClass ? Object(aClass)->className : std::string());
+  }
+
+  static jobject NewObject(JNIEnv* aEnv, jclass aClass, jmethodID aMethod, ...) {
+    va_list args;
+    va_start(args, aMethod);
+    jobject result = NewObjectV(aEnv, aClass, aMethod, args);
+    va_end(args);
+    return result;
+  }
+
+  void InitializeFunctions() {
+    functions.GetVersion = [](JNIEnv*) -> jint { return JNI_VERSION_1_6; };
+    functions.FindClass = [](JNIEnv* aEnv, const char* aName) -> jclass {
+      return static_cast<jclass>(Get(aEnv).CreateObject(aName));
+    };
+    functions.ExceptionOccurred = [](JNIEnv*) -> jthrowable { return nullptr; };
+    functions.ExceptionDescribe = [](JNIEnv*) {};
+    functions.ExceptionClear = [](JNIEnv*) {};
+    functions.ExceptionCheck = [](JNIEnv*) -> jboolean { return JNI_FALSE; };
+    functions.PushLocalFrame = [](JNIEnv*, jint) -> jint { return JNI_OK; };
+    functions.PopLocalFrame = [](JNIEnv*, jobject aResult) -> jobject { return aResult; };
+    functions.NewGlobalRef = [](JNIEnv*, jobject aObject) -> jobject { return aObject; };
+    functions.DeleteGlobalRef = [](JNIEnv*, jobject) {};
+    functions.NewLocalRef = [](JNIEnv*, jobject aObject) -> jobject { return aObject; };
+    functions.DeleteLocalRef = [](JNIEnv*, jobject) {};
+    functions.NewWeakGlobalRef = [](JNIEnv*, jobject aObject) -> jweak { return aObject; };
+    functions.DeleteWeakGlobalRef = [](JNIEnv*, jweak) {};
+    functions.IsSameObject = [](JNIEnv*, jobject aLeft, jobject aRight) -> jboolean {
+      return aLeft == aRight ? JNI_TRUE : JNI_FALSE;
+    };
+    functions.IsInstanceOf = [](JNIEnv*, jobject, jclass) -> jboolean { return JNI_TRUE; };
+    functions.MonitorEnter = [](JNIEnv*, jobject) -> jint { return JNI_OK; };
+    functions.MonitorExit = [](JNIEnv*, jobject) -> jint { return JNI_OK; };
+    functions.RegisterNatives = [](JNIEnv*, jclass, const JNINativeMethod*, jint) -> jint { return JNI_OK; };
+    functions.GetJavaVM = [](JNIEnv* aEnv, JavaVM** aVM) -> jint {
+      *aVM = &Get(aEnv).vm;
+      return JNI_OK;
+    };
+
+    functions.GetObjectClass = [](JNIEnv* aEnv, jobject aObject) -> jclass {
+      const std::string name = aObject ? Object(aObject)->className : std::string();
+      return static_cast<jclass>(Get(aEnv).CreateObject(name));
+    };
+    functions.GetMethodID = [](JNIEnv* aEnv, jclass aClass, const char* aName, const char* aSignature) -> jmethodID {
+      return reinterpret_cast<jmethodID>(Get(aEnv).GetMethod(aClass, aName, aSignature));
+    };
+    functions.GetStaticMethodID = functions.GetMethodID;
+    functions.GetFieldID = [](JNIEnv* aEnv, jclass aClass, const char* aName, const char* aSignature) -> jfieldID {
+      return reinterpret_cast<jfieldID>(Get(aEnv).GetMethod(aClass, aName, aSignature));
+    };
+    functions.GetStaticFieldID = functions.GetFieldID;
+
+    functions.NewObject = &NewObject;
+    functions.NewObjectV = &NewObjectV;
+    functions.NewObjectA = [](JNIEnv* aEnv, jclass aClass, jmethodID aMethod, const jvalue*) -> jobject {
+      Count(aEnv, aMethod);
+      return Get(aEnv).CreateObject(aClass ? Object(aClass)->className : std::string());
+    };
+
+#define STANDIN_CALL(Type, Name) \
+    functions.Call##Name##Method = &Call<Type, jobject>; \
+    functions.Call##Name##MethodV = &CallV<Type, jobject>; \
+    functions.Call##Name##MethodA = &CallA<Type, jobject>; \
+    functions.CallStatic##Name##Method = &Call<Type, jclass>; \
+    functions.CallStatic##Name##MethodV = &CallV<Type, jclass>; \
+    functions.CallStatic##Name##MethodA = &CallA<Type, jclass>;
+    STANDIN_CALL(jobject, Object)
+    STANDIN_CALL(jboolean, Boolean)
+    STANDIN_CALL(jbyte, Byte)
+    STANDIN_CALL(jchar, Char)
+    STANDIN_CALL(jshort, Short)
+    STANDIN_CALL(jint, Int)
+    STANDIN_CALL(jlong, Long)
+    STANDIN_CALL(jfloat, Float)
+    STANDIN_CALL(jdouble, Double)
+    STANDIN_CALL(void, Void)
+#undef STANDIN_CALL
+
+    functions.NewStringUTF = [](JNIEnv* aEnv, const char* aValue) -> jstring {
+      jobject result = Get(aEnv).CreateObject("java/lang/String");
+      Object(result)->utf = aValue ? aValue : "";
+      return static_cast<jstring>(result);
+    };
+    functions.GetStringUTFLength = [](JNIEnv*, jstring aString) -> jsize {
+      return aString ? (jsize)Object(aString)->utf.size() : 0;
+    };
+    functions.GetStringLength = functions.GetStringUTFLength;
+    functions.GetStringUTFChars = [](JNIEnv*, jstring aString, jboolean* aIsCopy) -> const char* {
+      if (aIsCopy) {
+        *aIsCopy = JNI_FALSE;
+      }
+      return aString ? Object(aString)->utf.c_str() : "";
+    };
+    functions.ReleaseStringUTFChars = [](JNIEnv*, jstring, const char*) {};
+
+    functions.GetArrayLength = [](JNIEnv*, jarray aArray) -> jsize {
+      return aArray ? (jsize)Object(aArray)->floats.size() : 0;
+    };
+    functions.NewFloatArray = [](JNIEnv* aEnv, jsize aLength) -> jfloatArray {
+      jobject result = Get(aEnv).CreateObject("[F");
+      Object(result)->floats.assign((size_t)aLength, 0.0f);
+      return static_cast<jfloatArray>(result);
+    };
+    functions.GetFloatArrayRegion = [](JNIEnv*, jfloatArray aArray, jsize aStart, jsize aLength, jfloat* aBuffer) {
+      const std::vector<jfloat>& floats = Object(aArray)->floats;
+      if ((aStart >= 0) && (aLength >= 0) && ((size_t)(aStart + aLength) <= floats.size())) {
+        std::copy(floats.begin() + aStart, floats.begin() + aStart + aLength, aBuffer);
+      }
+    };
+    functions.SetFloatArrayRegion = [](JNIEnv*, jfloatArray aArray, jsize aStart, jsize aLength, const jfloat* aBuffer) {
+      std::vector<jfloat>& floats = Object(aArray)->floats;
+      if ((aStart >= 0) && (aLength >= 0) && ((size_t)(aStart + aLength) <= floats.size())) {
+        std::copy(aBuffer, aBuffer + aLength, floats.begin() + aStart);
+      }
+    };
+
+    functions.NewDirectByteBuffer = [](JNIEnv* aEnv, void* aAddress, jlong aCapacity) -> jobject {
+      jobject result = Get(aEnv).CreateObject("java/nio/DirectByteBuffer");
+      Object(result)->address = aAddress;
+      Object(result)->capacity = aCapacity;
+      return result;
+    };
+    functions.GetDirectBufferAddress = [](JNIEnv*, jobject aBuffer) -> void* {
+      return aBuffer ? Object(aBuffer)->address : nullptr;
+    };
+    functions.GetDirectBufferCapacity = [](JNIEnv*, jobject aBuffer) -> jlong {
+      return aBuffer ? Object(aBuffer)->capacity : -1;
+    };
+  }
+};
+
+JNIStandInPtr
+JNIStandIn::Create() {
+  return std::make_shared<vrb::ConcreteClass<JNIStandIn, JNIStandIn::State> >();
+}
+
+JNIEnv*
+JNIStandIn::GetEnv() {
+  return &m.env;
+}
+
+JavaVM*
+JNIStandIn::GetJavaVM() {
+  return &m.vm;
+}
+
+jobject
+JNIStandIn::NewObject(const char* aClassName) {
+  return m.CreateObject(aClassName);
+}
+
+uint64_t
+JNIStandIn::GetCallCount() const {
+  return m.calls;
+}
+
+void
+JNIStandIn::ResetCallCounts() {
+  m.calls = 0;
+  for (auto& method: m.methods) {
+    method.second.calls = 0;
+  }
+}
+
+void
+JNIStandIn::PrintCallCounts(FILE* aFile, const uint64_t aFrames) const {
+  std::vector<const StandInMethod*> order;
+  for (const auto& method: m.methods) {
+    if (method.second.calls > 0) {
+      order.push_back(&method.second);
+    }
+  }
+  std::sort(order.begin(), order.end(), [](const StandInMethod* aLeft, const StandInMethod* aRight) {
+    return aLeft->calls > aRight->calls;
+  });
+  const double frames = aFrames > 0 ? (double)aFrames : 1.0;
+  fprintf(aFile, "JNI calls into Java: %llu total, %.1f per frame\n", (unsigned long long)m.calls,
+          (double)m.calls / frames);
+  for (const StandInMethod* method: order) {
+    fprintf(aFile, "  %-60s %10llu %10.1f/frame\n", method->name.c_str(), (unsigned long long)method->calls,
+            (double)method->calls / frames);
+  }
+}
+
+JNIStandIn::JNIStandIn(State& aState) : m(aState) {}
+JNIStandIn::~JNIStandIn() {}
+
+} // namespace host
+} // namespace crow
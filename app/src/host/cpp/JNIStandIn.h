@@ -0,0 +1,51 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_JNISTANDIN_H
+#define VRBROWSER_JNISTANDIN_H
+
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+#include <stdio.h>
+
+namespace crow {
+namespace host {
+
+class JNIStandIn;
+typedef std::shared_ptr<JNIStandIn> JNIStandInPtr;
+
+// A JNIEnv with no Java VM behind it, so the native core can run on a host. Classes and
+// methods always resolve, calls into Java do nothing and return zero, and direct byte
+// buffers, strings and float arrays are backed by native memory. Calls into Java are
+// counted per method. JNI functions the stand-in does not implement log their table
+// index the first time they are used and return zero. Every thread shares the same JNIEnv,
+// object creation and method lookup are thread safe.
+class JNIStandIn {
+public:
+  static JNIStandInPtr Create();
+  JNIEnv* GetEnv();
+  JavaVM* GetJavaVM();
+  // Creates a placeholder instance, e.g. for the activity passed to BrowserWorld.
+  jobject NewObject(const char* aClassName);
+  uint64_t GetCallCount() const;
+  void ResetCallCounts();
+  // Prints the Java methods called since the last reset, most frequent first.
+  void PrintCallCounts(FILE* aFile, const uint64_t aFrames) const;
+protected:
+  struct State;
+  JNIStandIn(State& aState);
+  ~JNIStandIn();
+private:
+  State& m;
+  JNIStandIn() = delete;
+  VRB_NO_DEFAULTS(JNIStandIn)
+};
+
+} // namespace host
+} // namespace crow
+
+#endif // VRBROWSER_JNISTANDIN_H
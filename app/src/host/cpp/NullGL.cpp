@@ -0,0 +1,386 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "NullGL.h"
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include <algorithm>
+#include <set>
+
+namespace {
+
+enum Function : uint16_t {
+#define NULLGL_FUNCTION(ret, name, params) name##_id,
+#define NULLGL_CUSTOM(ret, name, params) name##_id,
+#include "NullGLFunctions.h"
+#undef NULLGL_FUNCTION
+#undef NULLGL_CUSTOM
+  FunctionCount
+};
+
+const char* kFunctionNames[] = {
+#define NULLGL_FUNCTION(ret, name, params) #name,
+#define NULLGL_CUSTOM(ret, name, params) #name,
+#include "NullGLFunctions.h"
+#undef NULLGL_FUNCTION
+#undef NULLGL_CUSTOM
+};
+
+uint64_t sCallCounts[FunctionCount];
+uint64_t sTotalCalls;
+bool sRecording;
+std::vector<uint16_t> sRecordedCalls;
+
+GLuint sNextName = 1;
+GLint sNextLocation = 0;
+std::set<GLenum> sEnabled;
+std::vector<uint8_t> sMappedBuffer;
+int sSync;
+
+inline void
+Record(const Function aFunction) {
+  sCallCounts[aFunction]++;
+  sTotalCalls++;
+  if (sRecording) {
+    sRecordedCalls.push_back(aFunction);
+  }
+}
+
+void
+GenNames(const GLsizei aCount, GLuint* aNames) {
+  for (GLsizei ix = 0; ix < aCount; ix++) {
+    aNames[ix] = sNextName++;
+  }
+}
+
+void
+GetInfoLog(const GLsizei aBufSize, GLsizei* aLength, GLchar* aInfoLog) {
+  if (aLength) {
+    *aLength = 0;
+  }
+  if (aInfoLog && (aBufSize > 0)) {
+    aInfoLog[0] = '\0';
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+#define NULLGL_FUNCTION(ret, name, params) \
+  GL_APICALL ret GL_APIENTRY name params { Record(name##_id); return ret(); }
+#define NULLGL_CUSTOM(ret, name, params)
+#include "NullGLFunctions.h"
+#undef NULLGL_FUNCTION
+#undef NULLGL_CUSTOM
+
+GL_APICALL GLenum GL_APIENTRY
+glCheckFramebufferStatus(GLenum) {
+  Record(glCheckFramebufferStatus_id);
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+GL_APICALL GLuint GL_APIENTRY
+glCreateProgram() {
+  Record(glCreateProgram_id);
+  return sNextName++;
+}
+
+GL_APICALL GLuint GL_APIENTRY
+glCreateShader(GLenum) {
+  Record(glCreateShader_id);
+  return sNextName++;
+}
+
+GL_APICALL void GL_APIENTRY
+glDisable(GLenum aCap) {
+  Record(glDisable_id);
+  sEnabled.erase(aCap);
+}
+
+GL_APICALL void GL_APIENTRY
+glEnable(GLenum aCap) {
+  Record(glEnable_id);
+  sEnabled.insert(aCap);
+}
+
+GL_APICALL GLboolean GL_APIENTRY
+glIsEnabled(GLenum aCap) {
+  Record(glIsEnabled_id);
+  return sEnabled.count(aCap) ? GL_TRUE : GL_FALSE;
+}
+
+GL_APICALL void GL_APIENTRY
+glGenBuffers(GLsizei aCount, GLuint* aNames) {
+  Record(glGenBuffers_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenFramebuffers(GLsizei aCount, GLuint* aNames) {
+  Record(glGenFramebuffers_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenRenderbuffers(GLsizei aCount, GLuint* aNames) {
+  Record(glGenRenderbuffers_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenTextures(GLsizei aCount, GLuint* aNames) {
+  Record(glGenTextures_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenQueries(GLsizei aCount, GLuint* aNames) {
+  Record(glGenQueries_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenVertexArrays(GLsizei aCount, GLuint* aNames) {
+  Record(glGenVertexArrays_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL void GL_APIENTRY
+glGenSamplers(GLsizei aCount, GLuint* aNames) {
+  Record(glGenSamplers_id);
+  GenNames(aCount, aNames);
+}
+
+GL_APICALL GLint GL_APIENTRY
+glGetAttribLocation(GLuint, const GLchar*) {
+  Record(glGetAttribLocation_id);
+  return sNextLocation++;
+}
+
+GL_APICALL GLint GL_APIENTRY
+glGetUniformLocation(GLuint, const GLchar*) {
+  Record(glGetUniformLocation_id);
+  return sNextLocation++;
+}
+
+GL_APICALL void GL_APIENTRY
+glGetBooleanv(GLenum, GLboolean* aData) {
+  Record(glGetBooleanv_id);
+  aData[0] = GL_FALSE;
+}
+
+GL_APICALL GLenum GL_APIENTRY
+glGetError() {
+  Record(glGetError_id);
+  return GL_NO_ERROR;
+}
+
+GL_APICALL void GL_APIENTRY
+glGetFloatv(GLenum, GLfloat* aData) {
+  Record(glGetFloatv_id);
+  aData[0] = 0.0f;
+}
+
+GL_APICALL void GL_APIENTRY
+glGetIntegerv(GLenum aName, GLint* aData) {
+  Record(glGetIntegerv_id);
+  switch (aName) {
+    case GL_MAX_TEXTURE_SIZE:
+    case GL_MAX_RENDERBUFFER_SIZE:
+      aData[0] = 4096;
+      break;
+    case GL_MAX_VERTEX_ATTRIBS:
+    case GL_MAX_TEXTURE_IMAGE_UNITS:
+      aData[0] = 16;
+      break;
+    case GL_MAX_SAMPLES:
+      aData[0] = 4;
+      break;
+    case GL_VIEWPORT:
+    case GL_SCISSOR_BOX:
+      aData[0] = aData[1] = aData[2] = aData[3] = 0;
+      break;
+    default:
+      aData[0] = 0;
+      break;
+  }
+}
+
+GL_APICALL void GL_APIENTRY
+glGetProgramiv(GLuint, GLenum aName, GLint* aParam) {
+  Record(glGetProgramiv_id);
+  *aParam = ((aName == GL_LINK_STATUS) || (aName == GL_VALIDATE_STATUS)) ? GL_TRUE : 0;
+}
+
+GL_APICALL void GL_APIENTRY
+glGetProgramInfoLog(GLuint, GLsizei aBufSize, GLsizei* aLength, GLchar* aInfoLog) {
+  Record(glGetProgramInfoLog_id);
+  GetInfoLog(aBufSize, aLength, aInfoLog);
+}
+
+GL_APICALL void GL_APIENTRY
+glGetShaderiv(GLuint, GLenum aName, GLint* aParam) {
+  Record(glGetShaderiv_id);
+  *aParam = (aName == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+GL_APICALL void GL_APIENTRY
+glGetShaderInfoLog(GLuint, GLsizei aBufSize, GLsizei* aLength, GLchar* aInfoLog) {
+  Record(glGetShaderInfoLog_id);
+  GetInfoLog(aBufSize, aLength, aInfoLog);
+}
+
+GL_APICALL const GLubyte* GL_APIENTRY
+glGetString(GLenum aName) {
+  Record(glGetString_id);
+  const char* result = "";
+  switch (aName) {
+    case GL_VENDOR: result = "Mozilla"; break;
+    case GL_RENDERER: result = "Null GL"; break;
+    case GL_VERSION: result = "OpenGL ES 3.0 Null GL"; break;
+    case GL_SHADING_LANGUAGE_VERSION: result = "OpenGL ES GLSL ES 3.00"; break;
+    case GL_EXTENSIONS: result = "GL_OES_EGL_image_external GL_OES_EGL_image_external_essl3"; break;
+  }
+  return (const GLubyte*)result;
+}
+
+GL_APICALL const GLubyte* GL_APIENTRY
+glGetStringi(GLenum, GLuint) {
+  Record(glGetStringi_id);
+  return (const GLubyte*)"";
+}
+
+GL_APICALL void* GL_APIENTRY
+glMapBufferRange(GLenum, GLintptr, GLsizeiptr aLength, GLbitfield) {
+  Record(glMapBufferRange_id);
+  if (sMappedBuffer.size() < (size_t)aLength) {
+    sMappedBuffer.resize((size_t)aLength);
+  }
+  return sMappedBuffer.data();
+}
+
+GL_APICALL GLboolean GL_APIENTRY
+glUnmapBuffer(GLenum) {
+  Record(glUnmapBuffer_id);
+  return GL_TRUE;
+}
+
+GL_APICALL GLsync GL_APIENTRY
+glFenceSync(GLenum, GLbitfield) {
+  Record(glFenceSync_id);
+  return (GLsync)&sSync;
+}
+
+GL_APICALL GLenum GL_APIENTRY
+glClientWaitSync(GLsync, GLbitfield, GLuint64) {
+  Record(glClientWaitSync_id);
+  return GL_ALREADY_SIGNALED;
+}
+
+// The EGL entry points the native code relies on outside of context creation. There is
+// no display, so extensions are never found and the current context is a placeholder.
+EGLAPI __eglMustCastToProperFunctionPointerType EGLAPIENTRY
+eglGetProcAddress(const char*) {
+  return nullptr;
+}
+
+EGLAPI EGLContext EGLAPIENTRY
+eglGetCurrentContext() {
+  return (EGLContext)&sSync;
+}
+
+EGLAPI EGLDisplay EGLAPIENTRY
+eglGetCurrentDisplay() {
+  return (EGLDisplay)&sSync;
+}
+
+EGLAPI EGLSurface EGLAPIENTRY
+eglGetCurrentSurface(EGLint) {
+  return EGL_NO_SURFACE;
+}
+
+EGLAPI EGLint EGLAPIENTRY
+eglGetError() {
+  return EGL_SUCCESS;
+}
+
+} // extern "C"
+
+namespace crow {
+namespace nullgl {
+
+int32_t
+GetFunctionCount() {
+  return FunctionCount;
+}
+
+const char*
+GetFunctionName(const int32_t aFunction) {
+  if ((aFunction < 0) || (aFunction >= FunctionCount)) {
+    return "";
+  }
+  return kFunctionNames[aFunction];
+}
+
+uint64_t
+GetCallCount(const int32_t aFunction) {
+  if ((aFunction < 0) || (aFunction >= FunctionCount)) {
+    return 0;
+  }
+  return sCallCounts[aFunction];
+}
+
+uint64_t
+GetTotalCallCount() {
+  return sTotalCalls;
+}
+
+void
+ResetCallCounts() {
+  std::fill(sCallCounts, sCallCounts + FunctionCount, 0);
+  sTotalCalls = 0;
+}
+
+void
+SetRecording(const bool aEnabled) {
+  sRecording = aEnabled;
+}
+
+const std::vector<uint16_t>&
+GetRecordedCalls() {
+  return sRecordedCalls;
+}
+
+void
+ClearRecordedCalls() {
+  sRecordedCalls.clear();
+}
+
+void
+PrintCallCounts(FILE* aFile, const uint64_t aFrames) {
+  std::vector<int32_t> order;
+  for (int32_t ix = 0; ix < FunctionCount; ix++) {
+    if (sCallCounts[ix] > 0) {
+      order.push_back(ix);
+    }
+  }
+  std::sort(order.begin(), order.end(), [](const int32_t aLeft, const int32_t aRight) {
+    return sCallCounts[aLeft] > sCallCounts[aRight];
+  });
+  const double frames = aFrames > 0 ? (double)aFrames : 1.0;
+  fprintf(aFile, "GL calls: %llu total, %.1f per frame\n", (unsigned long long)sTotalCalls,
+          (double)sTotalCalls / frames);
+  for (const int32_t function: order) {
+    fprintf(aFile, "  %-36s %10llu %10.1f/frame\n", kFunctionNames[function],
+            (unsigned long long)sCallCounts[function], (double)sCallCounts[function] / frames);
+  }
+}
+
+} // namespace nullgl
+} // namespace crow
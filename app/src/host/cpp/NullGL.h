@@ -0,0 +1,34 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_NULLGL_H
+#define VRBROWSER_NULLGL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+namespace crow {
+namespace nullgl {
+
+// The null GL backend implements the GLES 3.0 entry points listed in NullGLFunctions.h
+// without a GPU. Every call is counted, and optionally recorded in order, so the GL
+// volume of a frame can be compared between builds. Not thread safe, GL is only
+// called from the render thread.
+int32_t GetFunctionCount();
+const char* GetFunctionName(const int32_t aFunction);
+uint64_t GetCallCount(const int32_t aFunction);
+uint64_t GetTotalCallCount();
+void ResetCallCounts();
+void SetRecording(const bool aEnabled);
+const std::vector<uint16_t>& GetRecordedCalls();
+void ClearRecordedCalls();
+// Prints the functions called since the last reset, most frequent first.
+void PrintCallCounts(FILE* aFile, const uint64_t aFrames);
+
+} // namespace nullgl
+} // namespace crow
+
+#endif // VRBROWSER_NULLGL_H
@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// GLES 3.0 entry points provided by the null GL backend. Included several times with
+// different definitions of the macros below, so there is deliberately no include guard.
+//
+// NULLGL_FUNCTION(ReturnType, Name, Parameters)
+//   Generated implementation that only records the call and returns zero.
+// NULLGL_CUSTOM(ReturnType, Name, Parameters)
+//   Recorded like the others but implemented by hand in NullGL.cpp because callers
+//   depend on the result (object names, status queries, strings).
+
+NULLGL_FUNCTION(void, glActiveTexture, (GLenum))
+NULLGL_FUNCTION(void, glAttachShader, (GLuint, GLuint))
+NULLGL_FUNCTION(void, glBindAttribLocation, (GLuint, GLuint, const GLchar*))
+NULLGL_FUNCTION(void, glBindBuffer, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glBindFramebuffer, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glBindRenderbuffer, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glBindTexture, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glBlendColor, (GLfloat, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glBlendEquation, (GLenum))
+NULLGL_FUNCTION(void, glBlendEquationSeparate, (GLenum, GLenum))
+NULLGL_FUNCTION(void, glBlendFunc, (GLenum, GLenum))
+NULLGL_FUNCTION(void, glBlendFuncSeparate, (GLenum, GLenum, GLenum, GLenum))
+NULLGL_FUNCTION(void, glBufferData, (GLenum, GLsizeiptr, const void*, GLenum))
+NULLGL_FUNCTION(void, glBufferSubData, (GLenum, GLintptr, GLsizeiptr, const void*))
+NULLGL_CUSTOM(GLenum, glCheckFramebufferStatus, (GLenum))
+NULLGL_FUNCTION(void, glClear, (GLbitfield))
+NULLGL_FUNCTION(void, glClearColor, (GLfloat, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glClearDepthf, (GLfloat))
+NULLGL_FUNCTION(void, glClearStencil, (GLint))
+NULLGL_FUNCTION(void, glColorMask, (GLboolean, GLboolean, GLboolean, GLboolean))
+NULLGL_FUNCTION(void, glCompileShader, (GLuint))
+NULLGL_FUNCTION(void, glCompressedTexImage2D, (GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const void*))
+NULLGL_FUNCTION(void, glCompressedTexSubImage2D, (GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei, const void*))
+NULLGL_FUNCTION(void, glCopyTexImage2D, (GLenum, GLint, GLenum, GLint, GLint, GLsizei, GLsizei, GLint))
+NULLGL_FUNCTION(void, glCopyTexSubImage2D, (GLenum, GLint, GLint, GLint, GLint, GLint, GLsizei, GLsizei))
+NULLGL_CUSTOM(GLuint, glCreateProgram, (void))
+NULLGL_CUSTOM(GLuint, glCreateShader, (GLenum))
+NULLGL_FUNCTION(void, glCullFace, (GLenum))
+NULLGL_FUNCTION(void, glDeleteBuffers, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glDeleteFramebuffers, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glDeleteProgram, (GLuint))
+NULLGL_FUNCTION(void, glDeleteRenderbuffers, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glDeleteShader, (GLuint))
+NULLGL_FUNCTION(void, glDeleteTextures, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glDepthFunc, (GLenum))
+NULLGL_FUNCTION(void, glDepthMask, (GLboolean))
+NULLGL_FUNCTION(void, glDepthRangef, (GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glDetachShader, (GLuint, GLuint))
+NULLGL_CUSTOM(void, glDisable, (GLenum))
+NULLGL_FUNCTION(void, glDisableVertexAttribArray, (GLuint))
+NULLGL_FUNCTION(void, glDrawArrays, (GLenum, GLint, GLsizei))
+NULLGL_FUNCTION(void, glDrawElements, (GLenum, GLsizei, GLenum, const void*))
+NULLGL_CUSTOM(void, glEnable, (GLenum))
+NULLGL_FUNCTION(void, glEnableVertexAttribArray, (GLuint))
+NULLGL_FUNCTION(void, glFinish, (void))
+NULLGL_FUNCTION(void, glFlush, (void))
+NULLGL_FUNCTION(void, glFramebufferRenderbuffer, (GLenum, GLenum, GLenum, GLuint))
+NULLGL_FUNCTION(void, glFramebufferTexture2D, (GLenum, GLenum, GLenum, GLuint, GLint))
+NULLGL_FUNCTION(void, glFrontFace, (GLenum))
+NULLGL_CUSTOM(void, glGenBuffers, (GLsizei, GLuint*))
+NULLGL_FUNCTION(void, glGenerateMipmap, (GLenum))
+NULLGL_CUSTOM(void, glGenFramebuffers, (GLsizei, GLuint*))
+NULLGL_CUSTOM(void, glGenRenderbuffers, (GLsizei, GLuint*))
+NULLGL_CUSTOM(void, glGenTextures, (GLsizei, GLuint*))
+NULLGL_FUNCTION(void, glGetActiveAttrib, (GLuint, GLuint, GLsizei, GLsizei*, GLint*, GLenum*, GLchar*))
+NULLGL_FUNCTION(void, glGetActiveUniform, (GLuint, GLuint, GLsizei, GLsizei*, GLint*, GLenum*, GLchar*))
+NULLGL_FUNCTION(void, glGetAttachedShaders, (GLuint, GLsizei, GLsizei*, GLuint*))
+NULLGL_CUSTOM(GLint, glGetAttribLocation, (GLuint, const GLchar*))
+NULLGL_CUSTOM(void, glGetBooleanv, (GLenum, GLboolean*))
+NULLGL_FUNCTION(void, glGetBufferParameteriv, (GLenum, GLenum, GLint*))
+NULLGL_CUSTOM(GLenum, glGetError, (void))
+NULLGL_CUSTOM(void, glGetFloatv, (GLenum, GLfloat*))
+NULLGL_FUNCTION(void, glGetFramebufferAttachmentParameteriv, (GLenum, GLenum, GLenum, GLint*))
+NULLGL_CUSTOM(void, glGetIntegerv, (GLenum, GLint*))
+NULLGL_CUSTOM(void, glGetProgramiv, (GLuint, GLenum, GLint*))
+NULLGL_CUSTOM(void, glGetProgramInfoLog, (GLuint, GLsizei, GLsizei*, GLchar*))
+NULLGL_FUNCTION(void, glGetRenderbufferParameteriv, (GLenum, GLenum, GLint*))
+NULLGL_CUSTOM(void, glGetShaderiv, (GLuint, GLenum, GLint*))
+NULLGL_CUSTOM(void, glGetShaderInfoLog, (GLuint, GLsizei, GLsizei*, GLchar*))
+NULLGL_FUNCTION(void, glGetShaderPrecisionFormat, (GLenum, GLenum, GLint*, GLint*))
+NULLGL_FUNCTION(void, glGetShaderSource, (GLuint, GLsizei, GLsizei*, GLchar*))
+NULLGL_CUSTOM(const GLubyte*, glGetString, (GLenum))
+NULLGL_FUNCTION(void, glGetTexParameterfv, (GLenum, GLenum, GLfloat*))
+NULLGL_FUNCTION(void, glGetTexParameteriv, (GLenum, GLenum, GLint*))
+NULLGL_FUNCTION(void, glGetUniformfv, (GLuint, GLint, GLfloat*))
+NULLGL_FUNCTION(void, glGetUniformiv, (GLuint, GLint, GLint*))
+NULLGL_CUSTOM(GLint, glGetUniformLocation, (GLuint, const GLchar*))
+NULLGL_FUNCTION(void, glGetVertexAttribfv, (GLuint, GLenum, GLfloat*))
+NULLGL_FUNCTION(void, glGetVertexAttribiv, (GLuint, GLenum, GLint*))
+NULLGL_FUNCTION(void, glGetVertexAttribPointerv, (GLuint, GLenum, void**))
+NULLGL_FUNCTION(void, glHint, (GLenum, GLenum))
+NULLGL_FUNCTION(GLboolean, glIsBuffer, (GLuint))
+NULLGL_CUSTOM(GLboolean, glIsEnabled, (GLenum))
+NULLGL_FUNCTION(GLboolean, glIsFramebuffer, (GLuint))
+NULLGL_FUNCTION(GLboolean, glIsProgram, (GLuint))
+NULLGL_FUNCTION(GLboolean, glIsRenderbuffer, (GLuint))
+NULLGL_FUNCTION(GLboolean, glIsShader, (GLuint))
+NULLGL_FUNCTION(GLboolean, glIsTexture, (GLuint))
+NULLGL_FUNCTION(void, glLineWidth, (GLfloat))
+NULLGL_FUNCTION(void, glLinkProgram, (GLuint))
+NULLGL_FUNCTION(void, glPixelStorei, (GLenum, GLint))
+NULLGL_FUNCTION(void, glPolygonOffset, (GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glReadPixels, (GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void*))
+NULLGL_FUNCTION(void, glReleaseShaderCompiler, (void))
+NULLGL_FUNCTION(void, glRenderbufferStorage, (GLenum, GLenum, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glSampleCoverage, (GLfloat, GLboolean))
+NULLGL_FUNCTION(void, glScissor, (GLint, GLint, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glShaderBinary, (GLsizei, const GLuint*, GLenum, const void*, GLsizei))
+NULLGL_FUNCTION(void, glShaderSource, (GLuint, GLsizei, const GLchar* const*, const GLint*))
+NULLGL_FUNCTION(void, glStencilFunc, (GLenum, GLint, GLuint))
+NULLGL_FUNCTION(void, glStencilFuncSeparate, (GLenum, GLenum, GLint, GLuint))
+NULLGL_FUNCTION(void, glStencilMask, (GLuint))
+NULLGL_FUNCTION(void, glStencilMaskSeparate, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glStencilOp, (GLenum, GLenum, GLenum))
+NULLGL_FUNCTION(void, glStencilOpSeparate, (GLenum, GLenum, GLenum, GLenum))
+NULLGL_FUNCTION(void, glTexImage2D, (GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*))
+NULLGL_FUNCTION(void, glTexParameterf, (GLenum, GLenum, GLfloat))
+NULLGL_FUNCTION(void, glTexParameterfv, (GLenum, GLenum, const GLfloat*))
+NULLGL_FUNCTION(void, glTexParameteri, (GLenum, GLenum, GLint))
+NULLGL_FUNCTION(void, glTexParameteriv, (GLenum, GLenum, const GLint*))
+NULLGL_FUNCTION(void, glTexSubImage2D, (GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*))
+NULLGL_FUNCTION(void, glUniform1f, (GLint, GLfloat))
+NULLGL_FUNCTION(void, glUniform1fv, (GLint, GLsizei, const GLfloat*))
+NULLGL_FUNCTION(void, glUniform1i, (GLint, GLint))
+NULLGL_FUNCTION(void, glUniform1iv, (GLint, GLsizei, const GLint*))
+NULLGL_FUNCTION(void, glUniform2f, (GLint, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glUniform2fv, (GLint, GLsizei, const GLfloat*))
+NULLGL_FUNCTION(void, glUniform2i, (GLint, GLint, GLint))
+NULLGL_FUNCTION(void, glUniform2iv, (GLint, GLsizei, const GLint*))
+NULLGL_FUNCTION(void, glUniform3f, (GLint, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glUniform3fv, (GLint, GLsizei, const GLfloat*))
+NULLGL_FUNCTION(void, glUniform3i, (GLint, GLint, GLint, GLint))
+NULLGL_FUNCTION(void, glUniform3iv, (GLint, GLsizei, const GLint*))
+NULLGL_FUNCTION(void, glUniform4f, (GLint, GLfloat, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glUniform4fv, (GLint, GLsizei, const GLfloat*))
+NULLGL_FUNCTION(void, glUniform4i, (GLint, GLint, GLint, GLint, GLint))
+NULLGL_FUNCTION(void, glUniform4iv, (GLint, GLsizei, const GLint*))
+NULLGL_FUNCTION(void, glUniformMatrix2fv, (GLint, GLsizei, GLboolean, const GLfloat*))
+NULLGL_FUNCTION(void, glUniformMatrix3fv, (GLint, GLsizei, GLboolean, const GLfloat*))
+NULLGL_FUNCTION(void, glUniformMatrix4fv, (GLint, GLsizei, GLboolean, const GLfloat*))
+NULLGL_FUNCTION(void, glUseProgram, (GLuint))
+NULLGL_FUNCTION(void, glValidateProgram, (GLuint))
+NULLGL_FUNCTION(void, glVertexAttrib1f, (GLuint, GLfloat))
+NULLGL_FUNCTION(void, glVertexAttrib1fv, (GLuint, const GLfloat*))
+NULLGL_FUNCTION(void, glVertexAttrib2f, (GLuint, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glVertexAttrib2fv, (GLuint, const GLfloat*))
+NULLGL_FUNCTION(void, glVertexAttrib3f, (GLuint, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glVertexAttrib3fv, (GLuint, const GLfloat*))
+NULLGL_FUNCTION(void, glVertexAttrib4f, (GLuint, GLfloat, GLfloat, GLfloat, GLfloat))
+NULLGL_FUNCTION(void, glVertexAttrib4fv, (GLuint, const GLfloat*))
+NULLGL_FUNCTION(void, glVertexAttribPointer, (GLuint, GLint, GLenum, GLboolean, GLsizei, const void*))
+NULLGL_FUNCTION(void, glViewport, (GLint, GLint, GLsizei, GLsizei))
+// GLES 3.0
+NULLGL_FUNCTION(void, glReadBuffer, (GLenum))
+NULLGL_FUNCTION(void, glDrawRangeElements, (GLenum, GLuint, GLuint, GLsizei, GLenum, const void*))
+NULLGL_FUNCTION(void, glTexImage3D, (GLenum, GLint, GLint, GLsizei, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*))
+NULLGL_FUNCTION(void, glTexSubImage3D, (GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, const void*))
+NULLGL_CUSTOM(void, glGenQueries, (GLsizei, GLuint*))
+NULLGL_FUNCTION(void, glDeleteQueries, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glBeginQuery, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glEndQuery, (GLenum))
+NULLGL_FUNCTION(void, glGetQueryObjectuiv, (GLuint, GLenum, GLuint*))
+NULLGL_CUSTOM(GLboolean, glUnmapBuffer, (GLenum))
+NULLGL_FUNCTION(void, glDrawBuffers, (GLsizei, const GLenum*))
+NULLGL_FUNCTION(void, glBlitFramebuffer, (GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum))
+NULLGL_FUNCTION(void, glRenderbufferStorageMultisample, (GLenum, GLsizei, GLenum, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glFramebufferTextureLayer, (GLenum, GLenum, GLuint, GLint, GLint))
+NULLGL_CUSTOM(void*, glMapBufferRange, (GLenum, GLintptr, GLsizeiptr, GLbitfield))
+NULLGL_FUNCTION(void, glFlushMappedBufferRange, (GLenum, GLintptr, GLsizeiptr))
+NULLGL_FUNCTION(void, glBindVertexArray, (GLuint))
+NULLGL_FUNCTION(void, glDeleteVertexArrays, (GLsizei, const GLuint*))
+NULLGL_CUSTOM(void, glGenVertexArrays, (GLsizei, GLuint*))
+NULLGL_FUNCTION(GLboolean, glIsVertexArray, (GLuint))
+NULLGL_FUNCTION(void, glGetIntegeri_v, (GLenum, GLuint, GLint*))
+NULLGL_FUNCTION(void, glBindBufferRange, (GLenum, GLuint, GLuint, GLintptr, GLsizeiptr))
+NULLGL_FUNCTION(void, glBindBufferBase, (GLenum, GLuint, GLuint))
+NULLGL_FUNCTION(void, glVertexAttribIPointer, (GLuint, GLint, GLenum, GLsizei, const void*))
+NULLGL_FUNCTION(void, glUniform1ui, (GLint, GLuint))
+NULLGL_FUNCTION(void, glClearBufferiv, (GLenum, GLint, const GLint*))
+NULLGL_FUNCTION(void, glClearBufferfv, (GLenum, GLint, const GLfloat*))
+NULLGL_FUNCTION(void, glClearBufferfi, (GLenum, GLint, GLfloat, GLint))
+NULLGL_CUSTOM(const GLubyte*, glGetStringi, (GLenum, GLuint))
+NULLGL_FUNCTION(void, glCopyBufferSubData, (GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr))
+NULLGL_FUNCTION(GLuint, glGetUniformBlockIndex, (GLuint, const GLchar*))
+NULLGL_FUNCTION(void, glUniformBlockBinding, (GLuint, GLuint, GLuint))
+NULLGL_FUNCTION(void, glDrawArraysInstanced, (GLenum, GLint, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glDrawElementsInstanced, (GLenum, GLsizei, GLenum, const void*, GLsizei))
+NULLGL_CUSTOM(GLsync, glFenceSync, (GLenum, GLbitfield))
+NULLGL_FUNCTION(GLboolean, glIsSync, (GLsync))
+NULLGL_FUNCTION(void, glDeleteSync, (GLsync))
+NULLGL_CUSTOM(GLenum, glClientWaitSync, (GLsync, GLbitfield, GLuint64))
+NULLGL_FUNCTION(void, glWaitSync, (GLsync, GLbitfield, GLuint64))
+NULLGL_FUNCTION(void, glGetInteger64v, (GLenum, GLint64*))
+NULLGL_CUSTOM(void, glGenSamplers, (GLsizei, GLuint*))
+NULLGL_FUNCTION(void, glDeleteSamplers, (GLsizei, const GLuint*))
+NULLGL_FUNCTION(void, glBindSampler, (GLuint, GLuint))
+NULLGL_FUNCTION(void, glSamplerParameteri, (GLuint, GLenum, GLint))
+NULLGL_FUNCTION(void, glVertexAttribDivisor, (GLuint, GLuint))
+NULLGL_FUNCTION(void, glInvalidateFramebuffer, (GLenum, GLsizei, const GLenum*))
+NULLGL_FUNCTION(void, glTexStorage2D, (GLenum, GLsizei, GLenum, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glTexStorage3D, (GLenum, GLsizei, GLenum, GLsizei, GLsizei, GLsizei))
+NULLGL_FUNCTION(void, glGetInternalformativ, (GLenum, GLenum, GLenum, GLsizei, GLint*))
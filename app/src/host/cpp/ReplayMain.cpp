@@ -0,0 +1,297 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Drives BrowserWorld::Draw() from a recorded device trace on a host without a headset
+// and reports the CPU cost of each frame phase, and the GL and JNI call volume.
+
+#include "BrowserWorld.h"
+#include "DeviceDelegateReplay.h"
+#include "FrameStats.h"
+#include "GLCounters.h"
+#include "HostSupport.h"
+#include "JNIStandIn.h"
+#if defined(VRBROWSER_HOST_NULL_GL)
+#include "NullGL.h"
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif // defined(VRBROWSER_HOST_NULL_GL)
+
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+static const char* kPhaseNames[] = {
+  "ProcessEvents", "Update", "UpdateControllers", "Cull", "Copies", "StartFrame", "DrawLeft", "DrawRight", "EndFrame", "Total"
+};
+
+struct Options {
+  std::string trace;
+  std::string assets;
+  int32_t frames;
+  int32_t warmup;
+  int32_t width;
+  int32_t height;
+  bool loop;
+  bool glCalls;
+  bool jniCalls;
+  bool verbose;
+  Options() : frames(-1), warmup(30), width(1920), height(1080), loop(false), glCalls(false), jniCalls(false),
+              verbose(false) {}
+};
+
+void
+PrintUsage(const char* aName) {
+  fprintf(stderr,
+          "usage: %s [options] <trace>\n"
+          "  --frames N     frames to measure, defaults to the length of the trace\n"
+          "  --warmup N     frames drawn before measuring, default 30\n"
+          "  --loop         restart the trace instead of holding the last frame\n"
+          "  --size WxH     viewport size, default 1920x1080\n"
+          "  --assets DIR   asset directory, default app/src/main/assets\n"
+          "  --gl-calls     print per function GL call counts (null GL backend only)\n"
+          "  --jni-calls    print per method counts of calls into Java\n"
+          "  --verbose      keep informational log output\n", aName);
+}
+
+bool
+ParseOptions(int aArgc, char** aArgv, Options& aOptions) {
+  for (int ix = 1; ix < aArgc; ix++) {
+    const char* arg = aArgv[ix];
+    const bool hasValue = (ix + 1) < aArgc;
+    if (!strcmp(arg, "--frames") && hasValue) {
+      aOptions.frames = atoi(aArgv[++ix]);
+    } else if (!strcmp(arg, "--warmup") && hasValue) {
+      aOptions.warmup = atoi(aArgv[++ix]);
+    } else if (!strcmp(arg, "--loop")) {
+      aOptions.loop = true;
+    } else if (!strcmp(arg, "--size") && hasValue) {
+      if (sscanf(aArgv[++ix], "%dx%d", &aOptions.width, &aOptions.height) != 2) {
+        return false;
+      }
+    } else if (!strcmp(arg, "--assets") && hasValue) {
+      aOptions.assets = aArgv[++ix];
+    } else if (!strcmp(arg, "--gl-calls")) {
+      aOptions.glCalls = true;
+    } else if (!strcmp(arg, "--jni-calls")) {
+      aOptions.jniCalls = true;
+    } else if (!strcmp(arg, "--verbose")) {
+      aOptions.verbose = true;
+    } else if ((arg[0] != '-') && aOptions.trace.empty()) {
+      aOptions.trace = arg;
+    } else {
+      return false;
+    }
+  }
+  return !aOptions.trace.empty();
+}
+
+double
+NowMilliseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((double)now.tv_sec * 1000.0) + ((double)now.tv_nsec / 1000000.0);
+}
+
+double
+Percentile(const std::vector<double>& aSorted, const double aPercentile) {
+  if (aSorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(aSorted.size() - 1, (size_t)(aPercentile * (double)aSorted.size()));
+  return aSorted[index];
+}
+
+#if !defined(VRBROWSER_HOST_NULL_GL)
+// Surfaceless Mesa (llvmpipe) context rendering into an offscreen framebuffer.
+struct HostGL {
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  GLuint framebuffer = 0;
+  GLuint renderbuffers[2] = {0, 0};
+
+  bool Initialize(const int32_t aWidth, const int32_t aHeight) {
+    display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, nullptr, nullptr)) {
+      fprintf(stderr, "Unable to initialize a surfaceless EGL display\n");
+      return false;
+    }
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &count) || (count == 0)) {
+      fprintf(stderr, "No GLES 3 EGL config available\n");
+      return false;
+    }
+    const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if ((context == EGL_NO_CONTEXT) || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+      fprintf(stderr, "Unable to create a surfaceless GLES 3 context\n");
+      return false;
+    }
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, aWidth, aHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, aWidth, aHeight);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+      return false;
+    }
+    glViewport(0, 0, aWidth, aHeight);
+    return true;
+  }
+
+  // Waits for llvmpipe so the GPU side of the frame is not deferred into the next one.
+  void Finish() {
+    glFinish();
+  }
+
+  void Shutdown() {
+    if (context != EGL_NO_CONTEXT) {
+      glDeleteFramebuffers(1, &framebuffer);
+      glDeleteRenderbuffers(2, renderbuffers);
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+      eglDestroyContext(display, context);
+      context = EGL_NO_CONTEXT;
+    }
+    if (display != EGL_NO_DISPLAY) {
+      eglTerminate(display);
+      display = EGL_NO_DISPLAY;
+    }
+  }
+};
+#else
+struct HostGL {
+  bool Initialize(const int32_t, const int32_t) { return true; }
+  void Finish() {}
+  void Shutdown() {}
+};
+#endif // !defined(VRBROWSER_HOST_NULL_GL)
+
+} // namespace
+
+int
+main(int aArgc, char** aArgv) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    PrintUsage(aArgv[0]);
+    return 2;
+  }
+  crow::host::SetQuietLogging(!options.verbose);
+  crow::host::SetAssetRoot(options.assets.empty() ? std::string(VRBROWSER_HOST_ASSET_DIR) : options.assets);
+
+  HostGL gl;
+  if (!gl.Initialize(options.width, options.height)) {
+    return 1;
+  }
+
+  crow::host::JNIStandInPtr jni = crow::host::JNIStandIn::Create();
+  jobject activity = jni->NewObject("org/mozilla/vrbrowser/VRBrowserActivity");
+  jobject assetManager = jni->NewObject("android/content/res/AssetManager");
+
+  crow::BrowserWorldPtr world = crow::BrowserWorld::Create();
+  crow::DeviceDelegateReplayPtr device = crow::DeviceDelegateReplay::Create(world->GetWeakContext(), options.trace);
+  if (!device->IsValid()) {
+    fprintf(stderr, "Unable to load device trace: %s\n", options.trace.c_str());
+    return 1;
+  }
+  device->SetLooping(options.loop);
+  device->SetViewport(options.width, options.height);
+  const int32_t frames = options.frames > 0 ? options.frames : std::max(device->GetFrameCount() - options.warmup, 1);
+
+  world->RegisterDeviceDelegate(device);
+  world->InitializeJava(jni->GetEnv(), activity, assetManager);
+  world->InitializeGL();
+  world->Resume();
+
+  for (int32_t ix = 0; ix < options.warmup; ix++) {
+    world->Draw();
+    gl.Finish();
+  }
+
+  crow::FrameStatsPtr stats = world->GetFrameStats();
+  stats->Reset();
+  jni->ResetCallCounts();
+#if defined(VRBROWSER_HOST_NULL_GL)
+  crow::nullgl::ResetCallCounts();
+#endif // defined(VRBROWSER_HOST_NULL_GL)
+
+  std::vector<double> durations;
+  durations.reserve((size_t)frames);
+  for (int32_t ix = 0; ix < frames; ix++) {
+    const double start = NowMilliseconds();
+    world->Draw();
+    gl.Finish();
+    durations.push_back(NowMilliseconds() - start);
+  }
+
+  std::sort(durations.begin(), durations.end());
+  double total = 0.0;
+  for (const double duration: durations) {
+    total += duration;
+  }
+  printf("Replayed %d frames of %s (%d frames recorded)\n", frames, options.trace.c_str(), device->GetFrameCount());
+  printf("Frame CPU ms: mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n", total / (double)frames,
+         Percentile(durations, 0.5), Percentile(durations, 0.95), Percentile(durations, 0.99), durations.back());
+  printf("%-20s %10s %10s %10s %10s\n", "Phase", "p50", "p95", "p99", "frames");
+  crow::FrameStats::Summary summaries[crow::FrameStats::kPhaseCount];
+  if (stats->GetSummaries(summaries) > 0) {
+    for (int32_t phase = 0; phase < crow::FrameStats::kPhaseCount; phase++) {
+      const crow::FrameStats::Summary& summary = summaries[phase];
+      printf("%-20s %10.3f %10.3f %10.3f %10d\n", kPhaseNames[phase], summary.p50, summary.p95, summary.p99,
+             summary.frames);
+    }
+  }
+#if defined(VRBROWSER_HOST_NULL_GL)
+  if (options.glCalls) {
+    crow::nullgl::PrintCallCounts(stdout, (uint64_t)frames);
+  } else {
+    printf("GL calls per frame: %.1f\n", (double)crow::nullgl::GetTotalCallCount() / (double)frames);
+  }
+#else
+  if (options.glCalls) {
+    fprintf(stderr, "GL call counts require the null GL backend\n");
+  }
+#endif // defined(VRBROWSER_HOST_NULL_GL)
+  crow::GLCounters::Snapshot counters;
+  if (world->GetGLCounters()->GetLastFrame(counters)) {
+    typedef crow::GLCounters::Counter Counter;
+    printf("Last frame GL: draws %u triangles %u programs %u textures %u uniforms %u buffers %u framebuffers %u\n",
+           counters.Total(Counter::DrawCalls), counters.Total(Counter::Triangles),
+           counters.Total(Counter::ProgramSwitches), counters.Total(Counter::TextureBinds),
+           counters.Total(Counter::UniformUploads), counters.Total(Counter::BufferBinds),
+           counters.Total(Counter::FramebufferBinds));
+  }
+  if (options.jniCalls) {
+    jni->PrintCallCounts(stdout, (uint64_t)frames);
+  } else {
+    printf("JNI calls per frame: %.1f\n", (double)jni->GetCallCount() / (double)frames);
+  }
+
+  world->Pause();
+  world->ShutdownGL();
+  world->ShutdownJava();
+  world->RegisterDeviceDelegate(nullptr);
+  device = nullptr;
+  world = nullptr;
+  gl.Shutdown();
+  return 0;
+}
@@ -0,0 +1,197 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Compares crow::RunnableQueue with vrb::RunnableQueue under contention: several producer
+// threads post runnables like the Java UI thread does through queueRunnable() while a
+// consumer thread drains the queue at a fixed interval. Reports the cost of each
+// AddRunnable() call and of each drain. Runnables do nothing with the JNI stand-in, so
+// the numbers are the queue overhead alone.
+
+#include "HostSupport.h"
+#include "JNIStandIn.h"
+#include "RunnableQueue.h"
+#include "vrb/RunnableQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+  int32_t producers;
+  int32_t runnables;
+  int32_t spacing;
+  int32_t interval;
+  Options() : producers(4), runnables(20000), spacing(50), interval(1000) {}
+};
+
+struct Result {
+  std::vector<double> enqueue; // nanoseconds
+  std::vector<double> drain; // microseconds
+  uint64_t ran;
+  double seconds;
+  Result() : ran(0), seconds(0.0) {}
+};
+
+void
+PrintUsage(const char* aName) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --producers N    producer threads, default 4\n"
+          "  --runnables N    runnables posted by each producer, default 20000\n"
+          "  --spacing US     pause between two runnables of a producer, default 50\n"
+          "  --interval US    pause between two drains of the consumer, default 1000\n", aName);
+}
+
+bool
+ParseOptions(int aArgc, char** aArgv, Options& aOptions) {
+  for (int ix = 1; ix < aArgc; ix++) {
+    const char* arg = aArgv[ix];
+    if ((ix + 1) >= aArgc) {
+      return false;
+    }
+    const int32_t value = atoi(aArgv[++ix]);
+    if (!strcmp(arg, "--producers")) {
+      aOptions.producers = value;
+    } else if (!strcmp(arg, "--runnables")) {
+      aOptions.runnables = value;
+    } else if (!strcmp(arg, "--spacing")) {
+      aOptions.spacing = value;
+    } else if (!strcmp(arg, "--interval")) {
+      aOptions.interval = value;
+    } else {
+      return false;
+    }
+  }
+  return (aOptions.producers > 0) && (aOptions.runnables > 0) && (aOptions.spacing >= 0) && (aOptions.interval >= 0);
+}
+
+double
+NowNanoseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((double)now.tv_sec * 1.0e9) + (double)now.tv_nsec;
+}
+
+void
+SleepMicroseconds(const int32_t aMicroseconds) {
+  if (aMicroseconds > 0) {
+    struct timespec duration = { aMicroseconds / 1000000, (long)(aMicroseconds % 1000000) * 1000 };
+    nanosleep(&duration, nullptr);
+  }
+}
+
+double
+Percentile(const std::vector<double>& aSorted, const double aPercentile) {
+  if (aSorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = std::min(aSorted.size() - 1, (size_t)(aPercentile * (double)aSorted.size()));
+  return aSorted[index];
+}
+
+template<typename QueuePtr> Result
+Run(QueuePtr aQueue, crow::host::JNIStandIn& aJNI, const Options& aOptions) {
+  Result result;
+  JNIEnv* env = aJNI.GetEnv();
+  jobject runnable = aJNI.NewObject("org/mozilla/vrbrowser/BenchRunnable");
+  const uint64_t calls = aJNI.GetCallCount();
+  std::atomic<bool> start(false);
+  std::atomic<int32_t> running(aOptions.producers);
+  std::vector<std::vector<double> > enqueue((size_t)aOptions.producers);
+
+  std::thread consumer([&]() {
+    while (!start.load()) {
+      std::this_thread::yield();
+    }
+    bool last = false;
+    while (!last) {
+      last = running.load() == 0;
+      const double begin = NowNanoseconds();
+      aQueue->ProcessRunnables();
+      result.drain.push_back((NowNanoseconds() - begin) / 1000.0);
+      if (!last) {
+        SleepMicroseconds(aOptions.interval);
+      }
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (int32_t producer = 0; producer < aOptions.producers; producer++) {
+    producers.emplace_back([&, producer]() {
+      std::vector<double>& samples = enqueue[(size_t)producer];
+      samples.reserve((size_t)aOptions.runnables);
+      while (!start.load()) {
+        std::this_thread::yield();
+      }
+      for (int32_t ix = 0; ix < aOptions.runnables; ix++) {
+        const double begin = NowNanoseconds();
+        aQueue->AddRunnable(env, runnable);
+        samples.push_back(NowNanoseconds() - begin);
+        SleepMicroseconds(aOptions.spacing);
+      }
+      running.fetch_sub(1);
+    });
+  }
+
+  const double begin = NowNanoseconds();
+  start.store(true);
+  for (std::thread& producer: producers) {
+    producer.join();
+  }
+  consumer.join();
+  result.seconds = (NowNanoseconds() - begin) / 1.0e9;
+  result.ran = aJNI.GetCallCount() - calls;
+  for (const std::vector<double>& samples: enqueue) {
+    result.enqueue.insert(result.enqueue.end(), samples.begin(), samples.end());
+  }
+  std::sort(result.enqueue.begin(), result.enqueue.end());
+  std::sort(result.drain.begin(), result.drain.end());
+  return result;
+}
+
+void
+PrintResult(const char* aName, const Result& aResult, const uint64_t aExpected) {
+  printf("%-6s %9.0f %9.0f %9.0f %9.1f %9.1f %9.1f %9llu/%llu %6.2fs\n", aName,
+         Percentile(aResult.enqueue, 0.5), Percentile(aResult.enqueue, 0.99),
+         aResult.enqueue.empty() ? 0.0 : aResult.enqueue.back(),
+         Percentile(aResult.drain, 0.5), Percentile(aResult.drain, 0.99),
+         aResult.drain.empty() ? 0.0 : aResult.drain.back(),
+         (unsigned long long)aResult.ran, (unsigned long long)aExpected, aResult.seconds);
+}
+
+} // namespace
+
+int
+main(int aArgc, char** aArgv) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    PrintUsage(aArgv[0]);
+    return 2;
+  }
+  crow::host::SetQuietLogging(true);
+  crow::host::JNIStandInPtr jni = crow::host::JNIStandIn::Create();
+  const uint64_t expected = (uint64_t)options.producers * (uint64_t)options.runnables;
+
+  printf("%d producers x %d runnables, %dus apart, drained every %dus\n", options.producers, options.runnables,
+         options.spacing, options.interval);
+  printf("%-6s %9s %9s %9s %9s %9s %9s %16s\n", "Queue", "add p50", "add p99", "add max", "drain p50",
+         "drain p99", "drain max", "ran");
+  printf("%-6s %9s %9s %9s %9s %9s %9s\n", "", "ns", "ns", "ns", "us", "us", "us");
+  PrintResult("vrb", Run(vrb::RunnableQueue::Create(jni->GetJavaVM()), *jni, options), expected);
+  crow::RunnableQueuePtr queue = crow::RunnableQueue::Create(jni->GetJavaVM());
+  PrintResult("crow", Run(queue, *jni, options), expected);
+  if (queue->GetOverflowCount() > 0) {
+    printf("crow: %u runnables overflowed the %d slot ring\n", queue->GetOverflowCount(),
+           crow::RunnableQueue::kCapacity);
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host stand-in for the NDK asset manager. Assets are read from the directory set with
+// crow::host::SetAssetRoot(), see AndroidStandIn.cpp.
+
+#ifndef VRBROWSER_HOST_ANDROID_ASSET_MANAGER_H
+#define VRBROWSER_HOST_ANDROID_ASSET_MANAGER_H
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct AAssetManager;
+typedef struct AAssetManager AAssetManager;
+
+struct AAsset;
+typedef struct AAsset AAsset;
+
+enum {
+  AASSET_MODE_UNKNOWN = 0,
+  AASSET_MODE_RANDOM = 1,
+  AASSET_MODE_STREAMING = 2,
+  AASSET_MODE_BUFFER = 3
+};
+
+AAsset* AAssetManager_open(AAssetManager* mgr, const char* filename, int mode);
+int AAsset_read(AAsset* asset, void* buf, size_t count);
+off_t AAsset_seek(AAsset* asset, off_t offset, int whence);
+void AAsset_close(AAsset* asset);
+const void* AAsset_getBuffer(AAsset* asset);
+off_t AAsset_getLength(AAsset* asset);
+off64_t AAsset_getLength64(AAsset* asset);
+off_t AAsset_getRemainingLength(AAsset* asset);
+off64_t AAsset_getRemainingLength64(AAsset* asset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VRBROWSER_HOST_ANDROID_ASSET_MANAGER_H
@@ -0,0 +1,25 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host stand-in for Android system properties. Values come from
+// crow::host::SetSystemProperty() or from the environment, see AndroidStandIn.cpp.
+
+#ifndef VRBROWSER_HOST_SYS_SYSTEM_PROPERTIES_H
+#define VRBROWSER_HOST_SYS_SYSTEM_PROPERTIES_H
+
+#define PROP_NAME_MAX 32
+#define PROP_VALUE_MAX 92
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int __system_property_get(const char* name, char* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VRBROWSER_HOST_SYS_SYSTEM_PROPERTIES_H
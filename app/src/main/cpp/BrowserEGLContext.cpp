@@ -12,7 +12,7 @@ namespace crow {
 
 BrowserEGLContext::BrowserEGLContext()
   : mMajorVersion(0), mMinorVersion(0), mDisplay(0), mConfig(0), mSurface(0), mContext(0),
-    mNativeWindow(nullptr) {
+    mNativeWindow(nullptr), mShared(false) {
 }
 
 BrowserEGLContextPtr
@@ -92,12 +92,31 @@ BrowserEGLContext::Initialize(ANativeWindow *aNativeWindow) {
   eglGetConfigAttrib(mDisplay, mConfig, EGL_NATIVE_VISUAL_ID, &format);
   ANativeWindow_setBuffersGeometry(aNativeWindow, 0, 0, format);
 
+  return CreateContext(EGL_NO_CONTEXT);
+}
+
+bool
+BrowserEGLContext::InitializeShared(const BrowserEGLContext& aContext) {
+  mDisplay = aContext.mDisplay;
+  mConfig = aContext.mConfig;
+  mMajorVersion = aContext.mMajorVersion;
+  mMinorVersion = aContext.mMinorVersion;
+  mShared = true;
+  if (!mDisplay || (aContext.mContext == EGL_NO_CONTEXT)) {
+    VRB_LOG("InitializeShared() failed: no context to share with");
+    return false;
+  }
+  return CreateContext(aContext.mContext);
+}
+
+bool
+BrowserEGLContext::CreateContext(EGLContext aShareContext) {
   EGLint contextAttribs[] = {
           EGL_CONTEXT_CLIENT_VERSION, 3,
           EGL_NONE
   };
 
-  mContext = eglCreateContext(mDisplay, mConfig, EGL_NO_CONTEXT, contextAttribs);
+  mContext = eglCreateContext(mDisplay, mConfig, aShareContext, contextAttribs);
   if (mContext == EGL_NO_CONTEXT) {
     VRB_LOG("eglCreateContext() failed: %s", ErrorToString(eglGetError()));
     return false;
@@ -148,12 +167,12 @@ BrowserEGLContext::Destroy() {
     }
     mSurface = EGL_NO_SURFACE;
   }
-  if (mDisplay) {
+  if (mDisplay && !mShared) {
     if (eglTerminate(mDisplay) == EGL_FALSE) {
       VRB_LOG("eglTerminate() failed: %s", ErrorToString(eglGetError()));
     }
-    mDisplay = 0;
   }
+  mDisplay = 0;
 }
 
 void
@@ -18,6 +18,9 @@ public:
   static const char *ErrorToString(EGLint error);
 
   bool Initialize(ANativeWindow *aWindow);
+  // Creates a context sharing textures and buffers with aContext, for GL work done on
+  // another thread. Destroy() leaves the display of aContext initialized.
+  bool InitializeShared(const BrowserEGLContext& aContext);
   void Destroy();
   void UpdateNativeWindow(ANativeWindow *aWindow);
   bool IsSurfaceReady() const;
@@ -29,6 +32,7 @@ public:
 
   BrowserEGLContext();
 private:
+  bool CreateContext(EGLContext aShareContext);
   EGLint mMajorVersion;
   EGLint mMinorVersion;
   EGLDisplay mDisplay;
@@ -36,6 +40,7 @@ private:
   EGLSurface mSurface;
   EGLContext mContext;
   ANativeWindow *mNativeWindow;
+  bool mShared;
 };
 
 } // namespace crow
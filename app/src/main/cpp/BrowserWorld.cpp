@@ -4,7 +4,25 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "BrowserWorld.h"
+#include "DeviceDelegateRecorder.h"
+#include "EventRing.h"
+#include "FrameScheduler.h"
+#include "GLCounters.h"
+#include "JobSystem.h"
+#include "PickTree.h"
+#include "PoseMirror.h"
+#include "PresentationFrames.h"
+#include "SurfaceLatch.h"
+#include "QuadLayerRenderer.h"
+#include "TextureBudget.h"
+#include "ThumbnailAtlas.h"
+#include "ViewFrustum.h"
 #include "Widget.h"
+#include "WidgetAttention.h"
+#include "WidgetHitTable.h"
+#include "WidgetQuadRenderer.h"
+#include "WidgetResolution.h"
+#include "WidgetSnapshots.h"
 #include "vrb/CameraSimple.h"
 #include "vrb/Color.h"
 #include "vrb/ConcreteClass.h"
@@ -26,6 +44,14 @@
 #include "vrb/VertexArray.h"
 #include "vrb/Vector.h"
 
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sys/system_properties.h>
+
 using namespace vrb;
 
 namespace {
@@ -38,19 +64,62 @@ static const int GestureSwipeLeft = 0;
 static const int GestureSwipeRight = 1;
 
 static const float kScrollFactor = 20.0f; // Just picked what fell right.
+// The frustum is built from the previous frame's cameras, so pad the bounds by the
+// distance the view may sweep during one frame of fast head rotation (~5 degrees).
+static const float kCullMarginScale = 0.09f;
+
+// Widget surface sizes are re-evaluated this often, in frames.
+static const int32_t kResolutionInterval = 15;
+
+// Widgets classified per job, the evaluation is a few dot products per widget.
+static const int32_t kClassifyGrain = 4;
+
+// Texture memory of a live widget: the BufferQueue behind a SurfaceTexture holds up to
+// three RGBA buffers of the surface size.
+static const int64_t kSurfaceBufferCount = 3;
+static const int64_t kBytesPerTexel = 4;
+// Snapshots are a quarter of the full surface size in each dimension.
+static const int32_t kSnapshotDivisor = 4;
+// Java normally confirms the release of a surface producer within a few frames.
+static const int32_t kReleaseTimeoutFrames = 90;
+static const int64_t kBytesPerMegabyte = 1024 * 1024;
+// Overrides the texture budget from Java, in megabytes. 0 disables hibernation.
+static const char* kTextureBudgetProperty = "debug.vrbrowser.texture_budget";
+
+// Tab overview thumbnails share one atlas, 45 of them fit at 16:9.
+static const int32_t kThumbnailAtlasSize = 1024;
+static const int32_t kThumbnailWidth = 192;
+// Copies into the atlas per frame, so refreshing many thumbnails is spread over frames.
+static const int32_t kThumbnailCopiesPerFrame = 2;
+// Frames between refreshes of a changing thumbnail while the overview is shown.
+static const int32_t kOverviewRefreshFrames = 15;
+// Overview grid in world units, centered in front of the user when it is opened.
+static const int32_t kOverviewColumns = 6;
+static const float kOverviewThumbnailWidth = 3.0f;
+static const float kOverviewGap = 0.4f;
+static const float kOverviewDistance = 10.0f;
+
+// Immersive presentation surface, shared by the page or the synthetic producer.
+static const char* kPresentationSurfaceName = "crow::Presentation";
+
+// Job system workers, "big" or "little" keeps them on those cores of a big.LITTLE SoC.
+static const char* kJobAffinityProperty = "debug.vrbrowser.job_affinity";
+// Number of job workers, by default one per core of the affinity minus one.
+static const char* kJobWorkersProperty = "debug.vrbrowser.job_workers";
+
+// Controller space box used to pick the controller models.
+static const Vector kControllerPickMin(-0.04f, -0.04f, -0.12f);
+static const Vector kControllerPickMax(0.04f, 0.04f, 0.06f);
 
 static const char* kDispatchCreateWidgetName = "dispatchCreateWidget";
 static const char* kDispatchCreateWidgetSignature = "(IILandroid/graphics/SurfaceTexture;II)V";
 static const char* kGetDisplayDensityName = "getDisplayDensity";
 static const char* kGetDisplayDensitySignature = "()I";
-static const char* kHandleMotionEventName = "handleMotionEvent";
-static const char* kHandleMotionEventSignature = "(IIZFF)V";
-static const char* kHandleScrollEvent = "handleScrollEvent";
-static const char* kHandleScrollEventSignature = "(IIFF)V";
-static const char* kHandleAudioPoseName = "handleAudioPose";
-static const char* kHandleAudioPoseSignature = "(FFFFFFF)V";
-static const char* kHandleGestureName = "handleGesture";
-static const char* kHandleGestureSignature = "(I)V";
+static const char* kDispatchPresentationSurfaceName = "dispatchPresentationSurface";
+static const char* kDispatchPresentationSurfaceSignature =
+    "(Landroid/graphics/SurfaceTexture;Landroid/view/Surface;II)V";
+static const char* kGetTextureBudgetName = "getTextureBudget";
+static const char* kGetTextureBudgetSignature = "()I";
 static const char* kTileTexture = "tile.png";
 class SurfaceObserver;
 typedef std::shared_ptr<SurfaceObserver> SurfaceObserverPtr;
@@ -75,18 +144,25 @@ void
 SurfaceObserver::SurfaceTextureCreated(const std::string& aName, GLuint aHandle, jobject aSurfaceTexture) {
   crow::BrowserWorldPtr world = mWorld.lock();
   if (world) {
+    world->SetSurfaceTextureHandle(aName, aHandle);
     world->SetSurfaceTexture(aName, aSurfaceTexture);
   }
 }
 
 void
-SurfaceObserver::SurfaceTextureHandleUpdated(const std::string aName, GLuint aHandle) {}
+SurfaceObserver::SurfaceTextureHandleUpdated(const std::string aName, GLuint aHandle) {
+  crow::BrowserWorldPtr world = mWorld.lock();
+  if (world) {
+    world->SetSurfaceTextureHandle(aName, aHandle);
+  }
+}
 
 void
 SurfaceObserver::SurfaceTextureDestroyed(const std::string& aName) {
   crow::BrowserWorldPtr world = mWorld.lock();
   if (world) {
     jobject nullObject = nullptr;
+    world->SetSurfaceTextureHandle(aName, 0);
     world->SetSurfaceTexture(aName, nullObject);
   }
 }
@@ -96,6 +172,22 @@ SurfaceObserver::SurfaceTextureCreationError(const std::string& aName, const std
   
 }
 
+void
+GetSnapshotSize(const crow::Widget& aWidget, int32_t& aWidth, int32_t& aHeight) {
+  aWidget.GetSurfaceTextureSize(aWidth, aHeight);
+  aWidth = std::max(1, aWidth / kSnapshotDivisor);
+  aHeight = std::max(1, aHeight / kSnapshotDivisor);
+}
+
+// Height over width of the widget window.
+float
+GetAspect(const crow::Widget& aWidget) {
+  vrb::Vector min, max;
+  aWidget.GetWidgetMinAndMax(min, max);
+  const float width = max.x() - min.x();
+  return width > 0.0f ? (max.y() - min.y()) / width : 0.0f;
+}
+
 struct ControllerRecord {
   int32_t index;
   uint32_t widget;
@@ -105,13 +197,17 @@ struct ControllerRecord {
   float touched;
   float touchPadX;
   float touchPadY;
+  int32_t pickItem;
+  crow::Widget* pointerWidget;
   TransformPtr controller;
   ControllerRecord(const int32_t aIndex) : widget(0), index(aIndex), pressed(false), xx(0.0f), yy(0.0f),
-                                           touched(false), touchPadX(0.0f), touchPadY(0.0f) {}
-  ControllerRecord(const ControllerRecord& aRecord) : widget(aRecord.widget), index(aRecord.index), controller(aRecord.controller) {}
-  ControllerRecord(ControllerRecord&& aRecord) : widget(aRecord.widget), index(aRecord.index), controller(std::move(aRecord.controller)) {}
+                                           touched(false), touchPadX(0.0f), touchPadY(0.0f), pickItem(-1), pointerWidget(nullptr) {}
+  ControllerRecord(const ControllerRecord& aRecord) : widget(aRecord.widget), index(aRecord.index), pickItem(aRecord.pickItem), pointerWidget(aRecord.pointerWidget), controller(aRecord.controller) {}
+  ControllerRecord(ControllerRecord&& aRecord) : widget(aRecord.widget), index(aRecord.index), pickItem(aRecord.pickItem), pointerWidget(aRecord.pointerWidget), controller(std::move(aRecord.controller)) {}
   void CopyValues(const ControllerRecord& aRecord) {
     index = aRecord.index;
+    pickItem = aRecord.pickItem;
+    pointerWidget = aRecord.pointerWidget;
     widget = aRecord.widget;
     pressed = aRecord.pressed;
     xx = aRecord.xx;
@@ -142,6 +238,64 @@ namespace crow {
 struct BrowserWorld::State {
   BrowserWorldWeakPtr self;
   std::vector<WidgetPtr> widgets;
+  // Widget quads, in the same order as widgets.
+  WidgetHitTablePtr widgetHits;
+  // 3D nodes that can be pointed at, e.g. the floor and the controllers.
+  PickTreePtr pickTree;
+  // Widgets showing a pointer this frame and the last one.
+  std::vector<Widget*> pointedWidgets;
+  std::vector<Widget*> previousPointedWidgets;
+  // Draws every visible widget quad that is not layer backed, one instanced draw per texture.
+  QuadLayerRendererPtr quadRenderer;
+  WidgetQuadRendererPtr widgetRenderer;
+  NodePtr widgetPointer;
+  // Surface sizes chosen from the projected texel density, in the same order as widgets.
+  WidgetResolutionPtr resolution;
+  int32_t resolutionFrame;
+  // Focused, peripheral or invisible, in the same order as widgets.
+  WidgetAttentionPtr attention;
+  // Set by the ClassifyWidgets() jobs for the widgets whose level must be reported.
+  std::vector<uint8_t> attentionChanged;
+  // Hibernates the least recently viewed widgets when their surfaces exceed the budget.
+  TextureBudgetPtr budget;
+  WidgetSnapshotsPtr snapshots;
+  // Thumbnails of the browser widgets for the tab overview.
+  ThumbnailAtlasPtr thumbnails;
+  std::vector<const Widget*> overviewWidgets;
+  bool tabOverview;
+  // Set by SetTabOverview() from any thread, applied at the start of the next frame.
+  std::atomic<bool> tabOverviewRequest;
+  bool overviewAnchored;
+  vrb::Vector overviewCenter;
+  vrb::Vector overviewRight;
+  vrb::Vector overviewForward;
+  // Immersive presentation, drawn instead of the scene once it has a frame.
+  enum class Presentation {
+    Off,
+    Starting, // Waiting for the SurfaceTexture.
+    Presenting,
+    Stopping // Waiting for the producer to let go of the surface.
+  };
+  PresentationFramesPtr presentation;
+  Presentation presentationState;
+  uint32_t presentationHandle;
+  int32_t presentationWidth;
+  int32_t presentationHeight;
+  int32_t presentationStopFrames;
+  // The producer draws into a device surface the compositor shows in place of the eye buffers.
+  bool presentationDirect;
+  // Set by StartPresentation() and StopPresentation() from any thread, applied by
+  // UpdatePresentation(). A start without a size waits for the eye buffer size.
+  enum class PresentationRequest {
+    None,
+    Start,
+    Stop
+  };
+  std::mutex presentationRequestLock;
+  PresentationRequest presentationRequest;
+  int32_t requestedWidth;
+  int32_t requestedHeight;
+  jmethodID dispatchPresentationSurfaceMethod;
   SurfaceObserverPtr surfaceObserver;
   DeviceDelegatePtr device;
   bool paused;
@@ -156,6 +310,10 @@ struct BrowserWorld::State {
   std::vector<ControllerRecord> controllers;
   CullVisitorPtr cullVisitor;
   DrawableListPtr drawList;
+  // Widgets drawn by the instanced quad renderer.
+  std::vector<WidgetQuadRenderer::Instance> widgetInstances;
+  // The frame shows the immersive presentation instead of the scene.
+  bool presentationFrame;
   CameraPtr leftCamera;
   CameraPtr rightCamera;
   float nearClip;
@@ -164,13 +322,23 @@ struct BrowserWorld::State {
   jobject activity;
   int displayDensity;
   jmethodID dispatchCreateWidgetMethod;
-  jmethodID handleMotionEventMethod;
-  jmethodID handleScrollEventMethod;
-  jmethodID handleAudioPoseMethod;
-  jmethodID handleGestureMethod;
+  EventRingPtr events;
+  PoseMirrorPtr poses;
   GestureDelegateConstPtr gestures;
+  FrameSchedulerPtr scheduler;
+  JobSystemPtr jobs;
+  double scheduledPeriod;
+  FrameStatsPtr frameStats;
+  GLCountersPtr glCounters;
+  SurfaceLatchPtr latch;
+  ViewFrustumPtr frustum;
   State() : paused(true), glInitialized(false), controllerCount(0), env(nullptr), nearClip(0.1f), farClip(100.0f), activity(nullptr),
-            dispatchCreateWidgetMethod(nullptr), handleMotionEventMethod(nullptr), handleScrollEventMethod(nullptr), handleAudioPoseMethod(nullptr), handleGestureMethod(nullptr) {
+            dispatchCreateWidgetMethod(nullptr), resolutionFrame(0), tabOverview(false), tabOverviewRequest(false),
+            overviewAnchored(false),
+            presentationState(Presentation::Off), presentationHandle(0), presentationWidth(0), presentationHeight(0),
+            presentationStopFrames(0), presentationDirect(false), presentationRequest(PresentationRequest::None),
+            requestedWidth(0), requestedHeight(0),
+            dispatchPresentationSurfaceMethod(nullptr), presentationFrame(false), scheduledPeriod(0.0) {
     context = Context::Create();
     contextWeak = context;
     factory = NodeFactoryObj::Create(contextWeak);
@@ -181,18 +349,64 @@ struct BrowserWorld::State {
     root->AddLight(light);
     cullVisitor = CullVisitor::Create(contextWeak);
     drawList = DrawableList::Create(contextWeak);
+    scheduler = FrameScheduler::Create();
+    jobs = JobSystem::Create();
+    frameStats = FrameStats::Create();
+    glCounters = GLCounters::Create();
+    latch = SurfaceLatch::Create();
+    frustum = ViewFrustum::Create();
+    widgetHits = WidgetHitTable::Create();
+    pickTree = PickTree::Create();
+    quadRenderer = QuadLayerRenderer::Create();
+    widgetRenderer = WidgetQuadRenderer::Create();
+    widgetRenderer->SetLight(*light);
+    resolution = WidgetResolution::Create();
+    attention = WidgetAttention::Create();
+    budget = TextureBudget::Create();
+    snapshots = WidgetSnapshots::Create();
+    thumbnails = ThumbnailAtlas::Create();
+    events = EventRing::Create();
+    poses = PoseMirror::Create();
+    presentation = PresentationFrames::Create();
   }
 
   void InitializeWindows();
+  void UpdatePickTree();
   void UpdateControllers();
+  void UpdatePointers();
+  void CullWidgets();
+  void ClassifyWidgets();
+  int32_t UpdateBudget();
+  void Hibernate(const int32_t aIndex);
+  void LatchSurfaces();
+  void UpdateQuadLayers();
+  void ReleaseQuadLayers();
+  void UpdateTabOverview();
+  void UpdateThumbnails();
+  void UpdateWidgetInstances(std::vector<WidgetQuadRenderer::Instance>& aInstances);
+  void AddOverviewInstances(std::vector<WidgetQuadRenderer::Instance>& aInstances);
+  void UpdateResolution();
+  void ResizeSurface(Widget& aWidget, const int32_t aWidth, const int32_t aHeight);
+  void AddWidget(WidgetPtr&& aWidget);
+  void WaitForFrame();
+  void Simulate();
+  void SimulateScene();
+  void Render();
+  void DrawEyes(DrawableList& aDrawList);
+  void CountScene();
+  void StartPresentation(const int32_t aWidth, const int32_t aHeight);
+  void StopPresentation();
+  void TakePresentationRequest();
+  void UpdatePresentation();
+  void DrawPresentation();
+  void DispatchPresentationSurface(jobject aTexture, jobject aSurface);
 };
 
 void
 BrowserWorld::State::InitializeWindows() {
     WidgetPtr browser = Widget::Create(contextWeak, WidgetTypeBrowser);
     browser->SetTransform(Matrix::Position(Vector(0.0f, -3.0f, -18.0f)));
-    root->AddNode(browser->GetRoot());
-    widgets.push_back(std::move(browser));
+    AddWidget(std::move(browser));
 /*#if defined(VRBROWSER_GOOGLEVR)
     static const float kUIScaleFactor = 1.0f;
 #else
@@ -204,34 +418,432 @@ BrowserWorld::State::InitializeWindows() {
                                       (int32_t) (1920.0f * uiScaleFactor),
                                       (int32_t) (275.0f * uiScaleFactor), 9.0f);
     urlbar->SetTransform(Matrix::Position(Vector(0.0f, 7.15f, -18.0f)));
-    root->AddNode(urlbar->GetRoot());
-    widgets.push_back(std::move(urlbar));
+    AddWidget(std::move(urlbar));
+}
+
+void
+BrowserWorld::State::AddWidget(WidgetPtr&& aWidget) {
+  root->AddNode(aWidget->GetRoot());
+  if (!widgetPointer) {
+    widgetPointer = Widget::CreatePointerGeometry(contextWeak);
+  }
+  aWidget->SetPointerGeometry(widgetPointer);
+  int32_t width = 0, height = 0;
+  aWidget->GetSurfaceTextureSize(width, height);
+  widgets.push_back(std::move(aWidget));
+  widgetHits->SetCount((int32_t)widgets.size());
+  resolution->SetCount((int32_t)widgets.size());
+  resolution->SetFullSize((int32_t)widgets.size() - 1, width, height);
+  attention->SetCount((int32_t)widgets.size());
+  budget->SetCount((int32_t)widgets.size());
+}
+
+void
+BrowserWorld::State::UpdatePickTree() {
+  // The inverse transforms are cached by the widgets, this only copies them.
+  for (size_t ix = 0; ix < widgets.size(); ix++) {
+    const Widget& widget = *widgets[ix];
+    vrb::Vector min, max;
+    widget.GetWidgetMinAndMax(min, max);
+    widgetHits->SetWidget((int32_t)ix, widget.GetInverseTransform(), min, max);
+    widgetHits->SetEnabled((int32_t)ix, widget.IsEnabled());
+  }
+  // Only moved items are refit, unchanged transforms are skipped.
+  for (ControllerRecord& record: controllers) {
+    if (record.controller) {
+      pickTree->SetTransform(record.pickItem, record.controller->GetTransform());
+    }
+  }
+  pickTree->Update();
+}
+
+void
+BrowserWorld::State::CullWidgets() {
+  if (!leftCamera || !rightCamera) {
+    return;
+  }
+  frustum->Update(*leftCamera, *rightCamera);
+  const vrb::Vector head = device->GetHeadTransform().GetTranslation();
+  for (WidgetPtr& widget: widgets) {
+    vrb::Vector center;
+    float radius = 0.0f;
+    widget->GetBoundingSphere(center, radius);
+    radius += (center - head).Magnitude() * kCullMarginScale;
+    widget->SetCulled(!frustum->IntersectsSphere(center, radius));
+  }
+}
+
+void
+BrowserWorld::State::ClassifyWidgets() {
+  attention->SetHead(device->GetHeadTransform());
+  const int32_t count = (int32_t)widgets.size();
+  attentionChanged.assign(widgets.size(), 0);
+  // Each job only reads the widgets and writes their own attention entries.
+  JobSystem::Handle evaluated = jobs->ParallelFor(count, kClassifyGrain, [this](const int32_t aBegin,
+                                                                                const int32_t aEnd) {
+    for (int32_t ix = aBegin; ix < aEnd; ix++) {
+      const Widget& widget = *widgets[ix];
+      vrb::Vector min, max;
+      widget.GetWidgetMinAndMax(min, max);
+      const bool visible = !widget.IsCulled() && widget.IsEnabled();
+      // UpdatePointers() left this frame's pointed widgets in previousPointedWidgets.
+      const bool pointed = std::find(previousPointedWidgets.begin(), previousPointedWidgets.end(), &widget) !=
+                           previousPointedWidgets.end();
+      attentionChanged[ix] = attention->Evaluate(ix, widget.GetTransform(), min, max, visible, pointed) ? 1 : 0;
+    }
+  });
+  jobs->Wait(evaluated);
+  for (int32_t ix = 0; ix < count; ix++) {
+    if (!attentionChanged[ix]) {
+      continue;
+    }
+    const Widget& widget = *widgets[ix];
+    // Java throttles or pauses the painting of the widget content. Surfaces are always latched
+    // as soon as they have a new frame, holding buffers back would stall the producers.
+    events->PushAttention(widget.GetHandle(), static_cast<int32_t>(attention->GetLevel(ix)));
+  }
+}
+
+int32_t
+BrowserWorld::State::UpdateBudget() {
+  budget->BeginFrame();
+  SurfaceTextureFactoryPtr factory = context->GetSurfaceTextureFactory();
+  int32_t hibernated = 0;
+  for (size_t ix = 0; ix < widgets.size(); ix++) {
+    Widget& widget = *widgets[ix];
+    const int32_t index = (int32_t)ix;
+    const bool viewed = attention->GetLevel(index) != WidgetAttention::Level::Invisible;
+    switch (budget->GetResidency(index)) {
+      case TextureBudget::Residency::Live:
+        break;
+      case TextureBudget::Residency::Releasing:
+        // Java clears the attached flag once the producer is gone.
+        if (!latch->IsAttached(widget.GetHandle()) ||
+            (budget->GetResidencyFrames(index) >= kReleaseTimeoutFrames)) {
+          factory->DestroySurfaceTexture(widget.GetSurfaceTextureName());
+          budget->SetResidency(index, TextureBudget::Residency::Hibernated);
+        }
+        break;
+      case TextureBudget::Residency::Hibernated:
+        if (viewed && env && activity) {
+          // SetSurfaceTexture() hands the new surface to the Java widget.
+          factory->CreateSurfaceTexture(widget.GetSurfaceTextureName(), nullptr);
+          budget->SetResidency(index, TextureBudget::Residency::Restoring);
+        }
+        break;
+      case TextureBudget::Residency::Restoring:
+        // The snapshot is shown until the new surface has content.
+        if (widget.IsContentChanged() || !widget.GetSnapshot()) {
+          snapshots->Release(widget.GetSnapshot());
+          widget.SetSnapshot(0);
+          budget->SetResidency(index, TextureBudget::Residency::Live);
+        }
+        break;
+    }
+    int64_t bytes = 0;
+    int32_t width = 0, height = 0;
+    if (widget.GetSurfaceTextureHandle()) {
+      widget.GetSurfaceSize(width, height);
+      bytes += (int64_t)width * (int64_t)height * kBytesPerTexel * kSurfaceBufferCount;
+    }
+    if (widget.GetQuadLayer() >= 0) {
+      bytes += device->GetQuadLayerBytes(widget.GetQuadLayer());
+    }
+    if (widget.GetSnapshot()) {
+      GetSnapshotSize(widget, width, height);
+      bytes += (int64_t)width * (int64_t)height * kBytesPerTexel;
+      hibernated++;
+    }
+    budget->Update(index, bytes, viewed);
+  }
+  frameStats->SetGauge(FrameStats::Gauge::WidgetsHibernated, hibernated);
+  frameStats->SetGauge(FrameStats::Gauge::TextureMegabytes,
+                       (int32_t)((budget->GetUsedBytes() + thumbnails->GetBytes()) / kBytesPerMegabyte));
+  // Only idle widgets are evicted, so hibernating after the instances are built shows no gap.
+  return budget->FindEviction();
+}
+
+void
+BrowserWorld::State::Hibernate(const int32_t aIndex) {
+  Widget& widget = *widgets[aIndex];
+  // Only Java can stop the producer, without it the surface is kept.
+  if (!widget.GetSurfaceTextureHandle() || !env || !activity) {
+    return;
+  }
+  if (quadRenderer->IsInitialized() || quadRenderer->Initialize()) {
+    int32_t width = 0, height = 0;
+    GetSnapshotSize(widget, width, height);
+    // Without a snapshot the widget is blank until it is restored.
+    widget.SetSnapshot(snapshots->Capture(*quadRenderer, widget.GetSurfaceTextureHandle(), width, height));
+  }
+  if (widget.IsLayerBacked()) {
+    device->DestroyQuadLayer(widget.GetQuadLayer());
+    widget.SetQuadLayer(-1);
+  }
+  events->PushHibernate(widget.GetHandle());
+  budget->SetResidency(aIndex, TextureBudget::Residency::Releasing);
+}
+
+void
+BrowserWorld::State::LatchSurfaces() {
+  latch->Update();
+  for (WidgetPtr& widget: widgets) {
+    widget->SetContentChanged(latch->IsChanged(widget->GetHandle()));
+  }
+  int32_t latched = 0, skipped = 0;
+  latch->GetLastCounts(latched, skipped);
+  glCounters->SetSceneCount(GLCounters::Scene::SurfacesLatched, latched);
+}
+
+void
+BrowserWorld::State::UpdateQuadLayers() {
+  if (!device->SupportsQuadLayers()) {
+    ReleaseQuadLayers();
+    return;
+  }
+  for (WidgetPtr& widget: widgets) {
+    int32_t layer = widget->GetQuadLayer();
+    // Widgets shown from a snapshot are drawn with the other instances.
+    if ((layer < 0) && widget->GetSurfaceTextureHandle() && !widget->GetSnapshot()) {
+      int32_t width = 0, height = 0;
+      widget->GetSurfaceSize(width, height);
+      layer = device->CreateQuadLayer(widget->GetSurfaceTextureHandle(), width, height);
+      widget->SetQuadLayer(layer);
+    }
+    if (layer >= 0) {
+      vrb::Vector min, max;
+      widget->GetWidgetMinAndMax(min, max);
+      device->UpdateQuadLayer(layer, widget->GetTransform(), min, max, !widget->IsCulled(),
+                              widget->IsContentChanged());
+    }
+  }
+}
+
+void
+BrowserWorld::State::ReleaseQuadLayers() {
+  for (WidgetPtr& widget: widgets) {
+    if (widget->IsLayerBacked()) {
+      if (device) {
+        device->DestroyQuadLayer(widget->GetQuadLayer());
+      }
+      widget->SetQuadLayer(-1);
+    }
+  }
+}
+
+void
+BrowserWorld::State::UpdateTabOverview() {
+  const bool enabled = tabOverviewRequest.load();
+  if (enabled == tabOverview) {
+    return;
+  }
+  tabOverview = enabled;
+  // Placed in front of the user on this frame.
+  overviewAnchored = false;
+}
+
+void
+BrowserWorld::State::UpdateThumbnails() {
+  if (!tabOverview) {
+    // Nothing is copied while the overview is closed, changed content only marks the kept
+    // thumbnails stale so they are refreshed once it opens again.
+    if (thumbnails->IsInitialized()) {
+      for (const WidgetPtr& widget: widgets) {
+        if ((widget->GetType() == WidgetTypeBrowser) && widget->IsContentChanged()) {
+          thumbnails->Invalidate(widget->GetHandle());
+        }
+      }
+    }
+    return;
+  }
+  if (!quadRenderer->IsInitialized() && !quadRenderer->Initialize()) {
+    return;
+  }
+  if (!thumbnails->IsInitialized() && !thumbnails->Initialize(kThumbnailAtlasSize)) {
+    return;
+  }
+  for (size_t ix = 0; ix < widgets.size(); ix++) {
+    const Widget& widget = *widgets[ix];
+    const uint32_t key = widget.GetHandle();
+    if (widget.GetType() != WidgetTypeBrowser) {
+      continue;
+    }
+    if (widget.IsContentChanged()) {
+      thumbnails->Invalidate(key);
+    }
+    // Hibernated widgets keep their last thumbnail, a restored surface is blank until it
+    // has content again.
+    if (!widget.GetSurfaceTextureHandle() || thumbnails->IsCopyPending(key) ||
+        (budget->GetResidency((int32_t)ix) != TextureBudget::Residency::Live)) {
+      continue;
+    }
+    if (thumbnails->HasThumbnail(key) &&
+        (!thumbnails->IsStale(key) || (thumbnails->GetAge(key) < kOverviewRefreshFrames))) {
+      continue;
+    }
+    int32_t width = 0, height = 0;
+    widget.GetSurfaceTextureSize(width, height);
+    if ((width <= 0) || (height <= 0)) {
+      continue;
+    }
+    thumbnails->RequestCopy(key, widget.GetSurfaceTextureHandle(), kThumbnailWidth,
+                            std::max(1, (kThumbnailWidth * height) / width));
+  }
+  thumbnails->Update(*quadRenderer, kThumbnailCopiesPerFrame);
+}
+
+void
+BrowserWorld::State::UpdateWidgetInstances(std::vector<WidgetQuadRenderer::Instance>& aInstances) {
+  aInstances.clear();
+  if (!widgetRenderer->IsInitialized() && !widgetRenderer->Initialize()) {
+    return;
+  }
+  for (const WidgetPtr& widget: widgets) {
+    if (widget->IsCulled() || widget->IsLayerBacked() || !widget->IsEnabled()) {
+      continue;
+    }
+    GLuint texture = widget->GetSnapshot();
+    GLenum target = GL_TEXTURE_2D;
+    if (!texture) {
+      texture = widget->GetSurfaceTextureHandle();
+      target = GL_TEXTURE_EXTERNAL_OES;
+    }
+    if (!texture) {
+      continue;
+    }
+    vrb::Vector min, max;
+    widget->GetWidgetMinAndMax(min, max);
+    aInstances.emplace_back();
+    aInstances.back().Set(widget->GetTransform(), min, max, texture, target);
+  }
+  if (tabOverview) {
+    AddOverviewInstances(aInstances);
+  }
+}
+
+void
+BrowserWorld::State::AddOverviewInstances(std::vector<WidgetQuadRenderer::Instance>& aInstances) {
+  if (!overviewAnchored) {
+    // Level with the user's eyes, in the direction they are facing.
+    const vrb::Matrix& head = device->GetHeadTransform();
+    vrb::Vector forward = head.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f));
+    forward = vrb::Vector(forward.x(), 0.0f, forward.z());
+    if (forward.Magnitude() < 0.01f) {
+      forward = vrb::Vector(0.0f, 0.0f, -1.0f);
+    }
+    overviewForward = forward.Normalize();
+    overviewRight = vrb::Vector(-overviewForward.z(), 0.0f, overviewForward.x());
+    overviewCenter = head.GetTranslation() + (overviewForward * kOverviewDistance);
+    overviewAnchored = true;
+  }
+  overviewWidgets.clear();
+  float aspect = 0.0f;
+  for (const WidgetPtr& widget: widgets) {
+    if ((widget->GetType() == WidgetTypeBrowser) && thumbnails->HasThumbnail(widget->GetHandle())) {
+      overviewWidgets.push_back(widget.get());
+      aspect = std::max(aspect, GetAspect(*widget));
+    }
+  }
+  const int32_t count = (int32_t)overviewWidgets.size();
+  const int32_t columns = std::min(count, kOverviewColumns);
+  const int32_t rows = (count + kOverviewColumns - 1) / kOverviewColumns;
+  const float columnPitch = kOverviewThumbnailWidth + kOverviewGap;
+  const float rowPitch = (kOverviewThumbnailWidth * aspect) + kOverviewGap;
+  for (int32_t ix = 0; ix < count; ix++) {
+    const Widget& widget = *overviewWidgets[ix];
+    const float halfWidth = kOverviewThumbnailWidth * 0.5f;
+    const float halfHeight = halfWidth * GetAspect(widget);
+    const float x = ((float)(ix % kOverviewColumns) - ((float)(columns - 1) * 0.5f)) * columnPitch;
+    const float y = (((float)(rows - 1) * 0.5f) - (float)(ix / kOverviewColumns)) * rowPitch;
+    const vrb::Vector position = overviewCenter + (overviewRight * x) + vrb::Vector(0.0f, y, 0.0f);
+    // Facing back at the user.
+    float values[4][4] = {
+        {overviewRight.x(), overviewRight.y(), overviewRight.z(), 0.0f},
+        {0.0f, 1.0f, 0.0f, 0.0f},
+        {-overviewForward.x(), -overviewForward.y(), -overviewForward.z(), 0.0f},
+        {position.x(), position.y(), position.z(), 1.0f}
+    };
+    aInstances.emplace_back();
+    WidgetQuadRenderer::Instance& instance = aInstances.back();
+    instance.Set(vrb::Matrix::FromColumnMajor(values), vrb::Vector(-halfWidth, -halfHeight, 0.0f),
+                 vrb::Vector(halfWidth, halfHeight, 0.0f), 0, GL_TEXTURE_2D);
+    thumbnails->SetInstance(widget.GetHandle(), instance);
+  }
+}
+
+void
+BrowserWorld::State::UpdateResolution() {
+  resolutionFrame++;
+  if (resolutionFrame < kResolutionInterval) {
+    return;
+  }
+  resolutionFrame = 0;
+  int32_t eyeWidth = 0, eyeHeight = 0;
+  device->GetEyeBufferSize(eyeWidth, eyeHeight);
+  if (!eyeWidth || !eyeHeight || !leftCamera || !env || !activity || !dispatchCreateWidgetMethod) {
+    return;
+  }
+  resolution->SetEyeBuffer(eyeWidth, eyeHeight, leftCamera->GetPerspective());
+  const vrb::Vector eye = device->GetHeadTransform().GetTranslation();
+  for (size_t ix = 0; ix < widgets.size(); ix++) {
+    Widget& widget = *widgets[ix];
+    // Nothing to resize until Java has attached the surface, or while it is hibernated.
+    if (!widget.GetSurfaceTextureHandle() ||
+        (budget->GetResidency((int32_t)ix) != TextureBudget::Residency::Live)) {
+      continue;
+    }
+    vrb::Vector min, max;
+    widget.GetWidgetMinAndMax(min, max);
+    const bool visible = !widget.IsCulled() && widget.IsEnabled();
+    if (resolution->Evaluate((int32_t)ix, widget.GetTransform(), min, max, eye, visible)) {
+      int32_t width = 0, height = 0;
+      resolution->GetSize((int32_t)ix, width, height);
+      ResizeSurface(widget, width, height);
+    }
+  }
+}
+
+void
+BrowserWorld::State::ResizeSurface(Widget& aWidget, const int32_t aWidth, const int32_t aHeight) {
+  jobject surface = context->GetSurfaceTextureFactory()->LookupSurfaceTexture(aWidget.GetSurfaceTextureName());
+  if (!surface) {
+    return;
+  }
+  aWidget.SetSurfaceSize(aWidth, aHeight);
+  // The layer copies the surface at its old size, it is recreated on the next frame.
+  if (aWidget.IsLayerBacked()) {
+    device->DestroyQuadLayer(aWidget.GetQuadLayer());
+    aWidget.SetQuadLayer(-1);
+  }
+  // The texture is unchanged, so Java only resizes the buffers of the existing widget.
+  env->CallVoidMethod(activity, dispatchCreateWidgetMethod, aWidget.GetType(), aWidget.GetHandle(), surface,
+                      aWidth, aHeight);
 }
 
 void
 BrowserWorld::State::UpdateControllers() {
-  std::vector<Widget*> active;
   for (ControllerRecord& record: controllers) {
-    vrb::Matrix transform = device->GetControllerTransform(record.index);
-    record.controller->SetTransform(transform);
+    record.controller->SetTransform(device->GetControllerTransform(record.index));
+  }
+  UpdatePickTree();
+  for (ControllerRecord& record: controllers) {
+    const vrb::Matrix& transform = record.controller->GetTransform();
+    poses->SetPose(PoseMirror::kHeadIndex + 1 + record.index, transform);
     vrb::Vector start = transform.MultiplyPosition(vrb::Vector());
-    vrb::Vector direction = transform.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f));
-    WidgetPtr hitWidget;
-    float hitDistance = farClip;
+    vrb::Vector direction = transform.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f)).Normalize();
+    Widget* hitWidget = nullptr;
     vrb::Vector hitPoint;
-    for (WidgetPtr widget: widgets) {
-      widget->TogglePointer(false);
-      vrb::Vector result;
-      float distance = 0.0f;
-      bool isInWidget = false;
-      if (widget->TestControllerIntersection(start, direction, result, isInWidget, distance)) {
-        if (isInWidget && (distance < hitDistance)) {
-          hitWidget = widget;
-          hitDistance = distance;
-          hitPoint = result;
-        }
+    WidgetHitTable::Hit widgetHit;
+    if (widgetHits->Intersect(start, direction, farClip, widgetHit)) {
+      // A 3D node such as the floor or the other controller hides the widgets behind it.
+      PickTree::Hit sceneHit;
+      if (!pickTree->PickNearest(start, direction, widgetHit.distance, record.pickItem, sceneHit)) {
+        hitWidget = widgets[widgetHit.index].get();
+        hitPoint = widgetHit.point;
+        hitWidget->SetPointerPosition(hitPoint);
       }
     }
+    record.pointerWidget = hitWidget;
     if (gestures) {
       const int32_t gestureCount = gestures->GetGestureCount();
       for (int32_t count = 0; count < gestureCount; count++) {
@@ -242,21 +854,19 @@ BrowserWorld::State::UpdateControllers() {
         } else if (type == GestureType::SwipeRight) {
           javaType = GestureSwipeRight;
         }
-        if (javaType >= 0 &&handleGestureMethod) {
-         env->CallVoidMethod(activity, handleGestureMethod, javaType);
+        if (javaType >= 0) {
+          events->PushGesture(javaType);
         }
       }
     }
-    if (handleMotionEventMethod && hitWidget) {
-      active.push_back(hitWidget.get());
+    if (hitWidget) {
       float theX = 0.0f, theY = 0.0f;
       hitWidget->ConvertToWidgetCoordinates(hitPoint, theX, theY);
       bool changed = false; // not used yet.
       bool pressed = device->GetControllerButtonState(record.index, 0, changed);
       const uint32_t handle = hitWidget->GetHandle();
       if ((record.xx != theX) || (record.yy != theY) || (record.pressed != pressed) || record.widget != handle) {
-        env->CallVoidMethod(activity, handleMotionEventMethod, handle, record.index, pressed,
-                            theX, theY);
+        events->PushMotion(handle, record.index, pressed, theX, theY);
         record.widget = handle;
         record.xx = theX;
         record.yy = theY;
@@ -265,8 +875,8 @@ BrowserWorld::State::UpdateControllers() {
       float scrollX = 0.0f, scrollY = 0.0f;
       if (device->GetControllerScrolled(record.index, scrollX, scrollY)) {
         if (record.touched && !record.pressed) {
-          env->CallVoidMethod(activity, handleScrollEventMethod, record.widget, record.index,
-                              (scrollX - record.touchPadX) * kScrollFactor, (scrollY - record.touchPadY) * kScrollFactor);
+          events->PushScroll(record.widget, record.index, (scrollX - record.touchPadX) * kScrollFactor,
+                             (scrollY - record.touchPadY) * kScrollFactor);
         }
         record.touched = true;
         record.touchPadX = scrollX;
@@ -276,12 +886,280 @@ BrowserWorld::State::UpdateControllers() {
       }
     }
   }
-  for (Widget* widget: active) {
+  UpdatePointers();
+}
+
+void
+BrowserWorld::State::UpdatePointers() {
+  // Diff the (controller, widget) pairs against the previous frame so only widgets
+  // gaining or losing their last pointing controller toggle their pointer.
+  pointedWidgets.clear();
+  for (const ControllerRecord& record: controllers) {
+    if (record.pointerWidget &&
+        (std::find(pointedWidgets.begin(), pointedWidgets.end(), record.pointerWidget) == pointedWidgets.end())) {
+      pointedWidgets.push_back(record.pointerWidget);
+    }
+  }
+  for (Widget* widget: previousPointedWidgets) {
+    if (std::find(pointedWidgets.begin(), pointedWidgets.end(), widget) == pointedWidgets.end()) {
+      widget->TogglePointer(false);
+    }
+  }
+  for (Widget* widget: pointedWidgets) {
     widget->TogglePointer(true);
   }
-  active.clear();
+  previousPointedWidgets.swap(pointedWidgets);
+}
+
+void
+BrowserWorld::State::WaitForFrame() {
+  double displayTime = 0.0, displayPeriod = 0.0;
+  if (!device->GetDisplayTiming(displayTime, displayPeriod)) {
+    scheduler->StartFrame();
+    return;
+  }
+  scheduler->WaitForFrame(displayTime, displayPeriod);
+  if (displayPeriod != scheduledPeriod) {
+    scheduledPeriod = displayPeriod;
+    frameStats->SetBudget((float)(displayPeriod * 1000.0));
+  }
+}
+
+void
+BrowserWorld::State::Simulate() {
+  device->ProcessEvents();
+  frameStats->Mark(FrameStats::Phase::ProcessEvents);
+  context->Update();
+  UpdatePresentation();
+  presentationFrame = (presentationState == Presentation::Presenting) && presentation->HasFrame() &&
+                      (presentationDirect || quadRenderer->IsInitialized() || quadRenderer->Initialize());
+  if (presentationFrame) {
+    // The widget scene is neither updated nor drawn, the frame goes straight to the eye buffers.
+    frameStats->Mark(FrameStats::Phase::Update);
+    return;
+  }
+  SimulateScene();
+}
+
+void
+BrowserWorld::State::SimulateScene() {
+  LatchSurfaces();
+  UpdateTabOverview();
+  frameStats->Mark(FrameStats::Phase::Update);
+  UpdateControllers();
+  frameStats->Mark(FrameStats::Phase::UpdateControllers);
+  CullWidgets();
+  ClassifyWidgets();
+  const int32_t eviction = UpdateBudget();
+  UpdateResolution();
+  UpdateQuadLayers();
+  UpdateWidgetInstances(widgetInstances);
+  drawList->Reset();
+  root->Cull(*cullVisitor, *drawList);
+  CountScene();
+  frameStats->Mark(FrameStats::Phase::Cull);
+  // The GPU copies are timed on their own so they do not show up as culling.
+  if (eviction >= 0) {
+    Hibernate(eviction);
+  }
+  UpdateThumbnails();
+  frameStats->Mark(FrameStats::Phase::Copies);
+}
+
+void
+BrowserWorld::State::Render() {
+  if (presentationFrame) {
+    DrawPresentation();
+    return;
+  }
+  widgetRenderer->SetInstances(widgetInstances);
+  device->StartFrame();
+  frameStats->Mark(FrameStats::Phase::StartFrame);
+  DrawEyes(*drawList);
+  scheduler->FrameSubmitting();
+  device->EndFrame();
+  frameStats->Mark(FrameStats::Phase::EndFrame);
+}
+
+void
+BrowserWorld::State::DrawEyes(DrawableList& aDrawList) {
+  // Each eye submits the draw list again. Drawing both eyes in one pass with OVR_multiview2
+  // is blocked until vrb has a two camera DrawableList::Draw() and multiview shader variants.
+  glCounters->SetSection(GLCounters::Section::LeftEye);
+  device->BindEye(DeviceDelegate::CameraEnum::Left);
+  const uint32_t draws = GLCounters::GetRunningCount(GLCounters::Counter::DrawCalls);
+  aDrawList.Draw(*leftCamera);
+  glCounters->SetSceneCount(GLCounters::Scene::DrawablesEmitted,
+                            (int32_t)(GLCounters::GetRunningCount(GLCounters::Counter::DrawCalls) - draws));
+  widgetRenderer->DrawInstances(*leftCamera);
+  device->DrawQuadLayers(*leftCamera);
+  frameStats->Mark(FrameStats::Phase::DrawLeft);
+  // When running the noapi flavor, we only want to render one eye.
+#if !defined(VRBROWSER_NO_VR_API)
+  glCounters->SetSection(GLCounters::Section::RightEye);
+  device->BindEye(DeviceDelegate::CameraEnum::Right);
+  aDrawList.Draw(*rightCamera);
+  widgetRenderer->DrawInstances(*rightCamera);
+  device->DrawQuadLayers(*rightCamera);
+  frameStats->Mark(FrameStats::Phase::DrawRight);
+#endif // !defined(VRBROWSER_NO_VR_API)
+  glCounters->SetSection(GLCounters::Section::Frame);
+}
+
+void
+BrowserWorld::State::CountScene() {
+  int32_t culled = 0;
+  int32_t layered = 0;
+  for (const WidgetPtr& widget: widgets) {
+    if (widget->IsCulled()) {
+      culled++;
+    } else if (widget->IsLayerBacked()) {
+      layered++;
+    }
+  }
+  int32_t controllerCount = 0;
+  for (const ControllerRecord& record: controllers) {
+    if (record.controller) {
+      controllerCount++;
+    }
+  }
+  glCounters->SetSceneCount(GLCounters::Scene::Widgets, (int32_t)widgets.size());
+  glCounters->SetSceneCount(GLCounters::Scene::WidgetsCulled, culled);
+  glCounters->SetSceneCount(GLCounters::Scene::WidgetsLayered, layered);
+  glCounters->SetSceneCount(GLCounters::Scene::Controllers, controllerCount);
+}
+
+void
+BrowserWorld::State::StartPresentation(const int32_t aWidth, const int32_t aHeight) {
+  if ((presentationState != Presentation::Off) || (aWidth <= 0) || (aHeight <= 0) || !env || !activity) {
+    return;
+  }
+  presentationWidth = aWidth;
+  presentationHeight = aHeight;
+  presentationStopFrames = 0;
+  presentation->ResetStats();
+  presentationState = Presentation::Starting;
+  jobject surface = device->CreatePresentationSurface(aWidth, aHeight);
+  if (surface) {
+    presentationDirect = true;
+    presentation->SetDirect();
+    DispatchPresentationSurface(nullptr, surface);
+    presentationState = Presentation::Presenting;
+    return;
+  }
+  // SetSurfaceTexture() hands the surface to the producer.
+  context->GetSurfaceTextureFactory()->CreateSurfaceTexture(kPresentationSurfaceName, nullptr);
+}
+
+void
+BrowserWorld::State::StopPresentation() {
+  if ((presentationState != Presentation::Starting) && (presentationState != Presentation::Presenting)) {
+    return;
+  }
+  DispatchPresentationSurface(nullptr, nullptr);
+  presentationStopFrames = 0;
+  presentationState = Presentation::Stopping;
+}
+
+void
+BrowserWorld::State::TakePresentationRequest() {
+  int32_t eyeWidth = 0, eyeHeight = 0;
+  device->GetEyeBufferSize(eyeWidth, eyeHeight);
+  PresentationRequest request = PresentationRequest::None;
+  int32_t width = 0, height = 0;
+  {
+    std::lock_guard<std::mutex> guard(presentationRequestLock);
+    width = requestedWidth;
+    height = requestedHeight;
+    if ((width <= 0) || (height <= 0)) {
+      // Side by side at the eye buffer resolution.
+      width = eyeWidth * 2;
+      height = eyeHeight;
+    }
+    // A start is kept until the previous presentation has ended and the size is known.
+    const bool waiting = (presentationRequest == PresentationRequest::Start) &&
+                         ((presentationState == Presentation::Stopping) || (width <= 0) || (height <= 0));
+    if (!waiting) {
+      request = presentationRequest;
+      presentationRequest = PresentationRequest::None;
+    }
+  }
+  if (request == PresentationRequest::Start) {
+    StartPresentation(width, height);
+  } else if (request == PresentationRequest::Stop) {
+    StopPresentation();
+  }
+}
+
+void
+BrowserWorld::State::UpdatePresentation() {
+  TakePresentationRequest();
+  if (presentationState == Presentation::Presenting) {
+    presentation->Update();
+  } else if (presentationState == Presentation::Stopping) {
+    presentationStopFrames++;
+    // Java clears the attached flag once the producer released the surface.
+    if (!presentation->IsAttached() || (presentationStopFrames >= kReleaseTimeoutFrames)) {
+      PresentationFrames::Stats stats;
+      presentation->GetStats(stats);
+      VRB_LOG("Presentation ended: %d frames shown, %d dropped, %d repeated, latency p50 %.1f ms p95 %.1f ms",
+              stats.presented, stats.dropped, stats.repeated, stats.latencyP50, stats.latencyP95);
+      presentation->SetSurfaceTexture(nullptr);
+      if (presentationDirect) {
+        device->DestroyPresentationSurface();
+        presentationDirect = false;
+      } else {
+        context->GetSurfaceTextureFactory()->DestroySurfaceTexture(kPresentationSurfaceName);
+      }
+      presentationHandle = 0;
+      presentationState = Presentation::Off;
+    }
+  }
 }
 
+void
+BrowserWorld::State::DrawPresentation() {
+  device->StartFrame();
+  frameStats->Mark(FrameStats::Phase::StartFrame);
+  vrb::Matrix pose;
+  if (presentation->GetFramePose(pose)) {
+    device->SetEyeBufferPose(pose);
+  }
+  if (presentationDirect) {
+    device->SubmitPresentationSurface();
+  } else {
+    // Fallback for devices without a compositor surface, each half is copied into its eye buffer.
+    glCounters->SetSection(GLCounters::Section::LeftEye);
+    device->BindEye(DeviceDelegate::CameraEnum::Left);
+    quadRenderer->BlitRegion(presentationHandle, 0.0f, 0.0f, 0.5f, 1.0f);
+    frameStats->Mark(FrameStats::Phase::DrawLeft);
+#if !defined(VRBROWSER_NO_VR_API)
+    glCounters->SetSection(GLCounters::Section::RightEye);
+    device->BindEye(DeviceDelegate::CameraEnum::Right);
+    quadRenderer->BlitRegion(presentationHandle, 0.5f, 0.0f, 0.5f, 1.0f);
+    frameStats->Mark(FrameStats::Phase::DrawRight);
+#endif // !defined(VRBROWSER_NO_VR_API)
+    glCounters->SetSection(GLCounters::Section::Frame);
+  }
+  scheduler->FrameSubmitting();
+  device->EndFrame();
+  frameStats->Mark(FrameStats::Phase::EndFrame);
+  presentation->FrameSubmitted();
+  int32_t dropped = 0, latency = 0;
+  presentation->GetLastFrame(dropped, latency);
+  const bool changed = presentation->IsChanged();
+  frameStats->SetGauge(FrameStats::Gauge::PresentationDropped, dropped);
+  frameStats->SetGauge(FrameStats::Gauge::PresentationRepeated, changed ? 0 : 1);
+  frameStats->SetGauge(FrameStats::Gauge::PresentationLatency, changed ? latency : 0);
+}
+
+void
+BrowserWorld::State::DispatchPresentationSurface(jobject aTexture, jobject aSurface) {
+  if (env && activity && dispatchPresentationSurfaceMethod) {
+    env->CallVoidMethod(activity, dispatchPresentationSurfaceMethod, aTexture, aSurface, presentationWidth,
+                        presentationHeight);
+  }
+}
 
 BrowserWorldPtr
 BrowserWorld::Create() {
@@ -299,7 +1177,9 @@ BrowserWorld::GetWeakContext() {
 
 void
 BrowserWorld::RegisterDeviceDelegate(DeviceDelegatePtr aDelegate) {
-  m.device = aDelegate;
+  // Layers belong to the device that created them.
+  m.ReleaseQuadLayers();
+  m.device = DeviceDelegateRecorder::WrapIfRequested(aDelegate);
   if (m.device) {
     m.device->SetClearColor(vrb::Color(0.15f, 0.15f, 0.15f));
     m.leftCamera = m.device->GetCamera(DeviceDelegate::CameraEnum::Left);
@@ -313,8 +1193,11 @@ BrowserWorld::RegisterDeviceDelegate(DeviceDelegatePtr aDelegate) {
       if (record.controller) {
         m.root->RemoveNode(*record.controller);
       }
+      m.pickTree->RemoveItem(record.pickItem);
     }
     m.controllers.clear();
+    // Hides the pointers left by the removed controllers.
+    m.UpdatePointers();
     m.controllerCount = 0;
     m.gestures = nullptr;
   }
@@ -360,34 +1243,47 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
     VRB_LOG("Failed to find Java method: %s %s", kDispatchCreateWidgetName, kDispatchCreateWidgetSignature);
   }
 
-  m.handleMotionEventMethod = m.env->GetMethodID(clazz, kHandleMotionEventName, kHandleMotionEventSignature);
+  m.events->InitializeJava(m.env, m.activity);
+  m.latch->InitializeJava(m.env, m.activity);
+  m.poses->InitializeJava(m.env, m.activity);
+  m.presentation->InitializeJava(m.env, m.activity);
 
-  if (!m.handleMotionEventMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleMotionEventName, kHandleMotionEventSignature);
+  m.dispatchPresentationSurfaceMethod = m.env->GetMethodID(clazz, kDispatchPresentationSurfaceName,
+                                                           kDispatchPresentationSurfaceSignature);
+  if (!m.dispatchPresentationSurfaceMethod) {
+    VRB_LOG("Failed to find Java method: %s %s", kDispatchPresentationSurfaceName,
+            kDispatchPresentationSurfaceSignature);
   }
 
-  m.handleScrollEventMethod = m.env->GetMethodID(clazz, kHandleScrollEvent, kHandleScrollEventSignature);
-
-  if (m.handleScrollEventMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleScrollEvent, kHandleScrollEventSignature)
+  jmethodID getDisplayDensityMethod =  m.env->GetMethodID(clazz, kGetDisplayDensityName, kGetDisplayDensitySignature);
+  if (getDisplayDensityMethod) {
+    m.displayDensity = m.env->CallIntMethod(m.activity, getDisplayDensityMethod);
   }
 
-  m.handleAudioPoseMethod =  m.env->GetMethodID(clazz, kHandleAudioPoseName, kHandleAudioPoseSignature);
-
-  if (!m.handleAudioPoseMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleAudioPoseName, kHandleAudioPoseSignature);
+  jmethodID getTextureBudgetMethod = m.env->GetMethodID(clazz, kGetTextureBudgetName, kGetTextureBudgetSignature);
+  int64_t megabytes = 0;
+  if (getTextureBudgetMethod) {
+    megabytes = (int64_t)m.env->CallIntMethod(m.activity, getTextureBudgetMethod);
   }
-
-  m.handleGestureMethod = m.env->GetMethodID(clazz, kHandleGestureName, kHandleGestureSignature);
-
-  if (!m.handleGestureMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleGestureName, kHandleGestureSignature);
+  char property[PROP_VALUE_MAX];
+  if (__system_property_get(kTextureBudgetProperty, property) > 0) {
+    megabytes = (int64_t)atoi(property);
   }
-
-  jmethodID getDisplayDensityMethod =  m.env->GetMethodID(clazz, kGetDisplayDensityName, kGetDisplayDensitySignature);
-  if (getDisplayDensityMethod) {
-    m.displayDensity = m.env->CallIntMethod(m.activity, getDisplayDensityMethod);
+  m.budget->SetBudget(megabytes * kBytesPerMegabyte);
+  VRB_LOG("Widget texture budget: %d MB", (int)megabytes);
+  JobSystem::Affinity affinity = JobSystem::Affinity::Any;
+  if (__system_property_get(kJobAffinityProperty, property) > 0) {
+    if (!strcmp(property, "big")) {
+      affinity = JobSystem::Affinity::Big;
+    } else if (!strcmp(property, "little")) {
+      affinity = JobSystem::Affinity::Little;
+    }
   }
+  int32_t workers = 0;
+  if (__system_property_get(kJobWorkersProperty, property) > 0) {
+    workers = atoi(property);
+  }
+  m.jobs->Start(workers, affinity);
 
   m.InitializeWindows();
 
@@ -400,6 +1296,8 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
         m.factory->SetModelRoot(record.controller);
         m.parser->LoadModel(m.device->GetControllerModelName(ix));
         m.root->AddNode(record.controller);
+        // The model is only known to the parser, a box around the handle stands in for it.
+        record.pickItem = m.pickTree->AddBox(kControllerPickMin, kControllerPickMax);
       }
       m.controllers.push_back(std::move(record));
     }
@@ -425,6 +1323,10 @@ BrowserWorld::InitializeGL() {
           SetSurfaceTexture(name, surface);
         }
       }
+      jobject surface = factory->LookupSurfaceTexture(kPresentationSurfaceName);
+      if (surface) {
+        m.presentation->SetSurfaceTexture(surface);
+      }
     }
   }
 }
@@ -437,16 +1339,26 @@ BrowserWorld::ShutdownJava() {
   }
   m.activity = nullptr;
   m.dispatchCreateWidgetMethod = nullptr;
-  m.handleMotionEventMethod = nullptr;
-  m.handleScrollEventMethod = nullptr;
-  m.handleAudioPoseMethod = nullptr;
-  m.handleGestureMethod = nullptr;
+  m.dispatchPresentationSurfaceMethod = nullptr;
+  m.events->ShutdownJava();
+  m.latch->ShutdownJava();
+  m.poses->ShutdownJava();
+  m.presentation->ShutdownJava();
+  m.jobs->Stop();
   m.env = nullptr;
 }
 
 void
 BrowserWorld::ShutdownGL() {
   VRB_LOG("BrowserWorld::ShutdownGL");
+  // The snapshots go with the context, hibernated widgets stay blank until they are restored.
+  for (WidgetPtr& widget: m.widgets) {
+    widget->SetSnapshot(0);
+  }
+  m.snapshots->Shutdown();
+  m.thumbnails->Shutdown();
+  m.quadRenderer->Shutdown();
+  m.widgetRenderer->Shutdown();
   if (m.context) {
     m.context->ShutdownGL();
   }
@@ -470,47 +1382,122 @@ BrowserWorld::Draw() {
       return;
     }
   }
-  m.device->ProcessEvents();
-  m.context->Update();
-  m.UpdateControllers();
-  m.drawList->Reset();
-  m.root->Cull(*m.cullVisitor, *m.drawList);
-  m.device->StartFrame();
-  m.device->BindEye(DeviceDelegate::CameraEnum::Left);
-  m.drawList->Draw(*m.leftCamera);
-  // When running the noapi flavor, we only want to render one eye.
-#if !defined(VRBROWSER_NO_VR_API)
-  m.device->BindEye(DeviceDelegate::CameraEnum::Right);
-  m.drawList->Draw(*m.rightCamera);
-#endif // !defined(VRBROWSER_NO_VR_API)
-  m.device->EndFrame();
-
-  // Update the 3d audio engine with the most recent head rotation.
-  if (m.handleAudioPoseMethod) {
-    const vrb::Matrix &head = m.device->GetHeadTransform();
-    const vrb::Vector p = head.GetTranslation();
-    const vrb::Quaternion q(head);
-    m.env->CallVoidMethod(m.activity, m.handleAudioPoseMethod, q.x(), q.y(), q.z(), q.w(), p.x(), p.y(), p.z());
-  }
-
+  // Sleeps until the latest start that still makes the next display refresh, so the frame
+  // is simulated from fresh input instead of queueing up behind the previous one.
+  m.WaitForFrame();
+  m.frameStats->BeginFrame();
+  m.glCounters->BeginFrame();
+  m.Simulate();
+  m.Render();
+  m.frameStats->SetGauge(FrameStats::Gauge::FrameSlack, (int32_t)(m.scheduler->GetSlack() * 1.0e6));
+  m.frameStats->SetGauge(FrameStats::Gauge::FrameSleep, (int32_t)(m.scheduler->GetSleep() * 1.0e6));
+  m.frameStats->SetGauge(FrameStats::Gauge::FramesMissed, m.scheduler->GetMissedFrames());
+
+  // Java polls the mirror for the 3d audio engine, so nothing is sent when the head is still.
+  m.poses->SetPose(PoseMirror::kHeadIndex, m.device->GetHeadTransform());
+  m.poses->Publish();
+  // Deliver every event queued this frame with a single JNI call.
+  m.events->Flush();
+  m.glCounters->EndFrame();
+  m.frameStats->EndFrame();
 }
 
 void
 BrowserWorld::SetSurfaceTexture(const std::string& aName, jobject& aSurface) {
   VRB_LOG("SetSurfaceTexture: %s", aName.c_str());
-  if (m.env && m.activity && m.dispatchCreateWidgetMethod) {
-    for (WidgetPtr& widget: m.widgets) {
-      if (aName == widget->GetSurfaceTextureName()) {
-        int32_t width = 0, height = 0;
-        widget->GetSurfaceTextureSize(width, height);
-        m.env->CallVoidMethod(m.activity, m.dispatchCreateWidgetMethod, widget->GetType(),
-                              widget->GetHandle(), aSurface, width, height);
+  if (aName == kPresentationSurfaceName) {
+    m.presentation->SetSurfaceTexture(aSurface);
+    if (aSurface && (m.presentationState == State::Presentation::Starting)) {
+      m.DispatchPresentationSurface(aSurface, nullptr);
+      m.presentationState = State::Presentation::Presenting;
+    }
+    return;
+  }
+  for (size_t ix = 0; ix < m.widgets.size(); ix++) {
+    WidgetPtr& widget = m.widgets[ix];
+    if (aName != widget->GetSurfaceTextureName()) {
+      continue;
+    }
+    m.latch->SetSurfaceTexture(widget->GetHandle(), aSurface);
+    // A destroyed surface, e.g. of a hibernated widget, has nothing to send to Java.
+    if (aSurface && m.env && m.activity && m.dispatchCreateWidgetMethod) {
+      // A new surface starts at full size, WidgetResolution scales it down again if needed.
+      int32_t width = 0, height = 0;
+      widget->GetSurfaceTextureSize(width, height);
+      widget->SetSurfaceSize(width, height);
+      m.resolution->SetFullSize((int32_t)ix, width, height);
+      // The Java widget may be new, send it the current attention level with the next events.
+      m.attention->Reset((int32_t)ix);
+      m.env->CallVoidMethod(m.activity, m.dispatchCreateWidgetMethod, widget->GetType(),
+                            widget->GetHandle(), aSurface, width, height);
+    }
+    return;
+  }
+}
+
+void
+BrowserWorld::SetSurfaceTextureHandle(const std::string& aName, const uint32_t aHandle) {
+  if (aName == kPresentationSurfaceName) {
+    m.presentationHandle = aHandle;
+    return;
+  }
+  for (WidgetPtr& widget: m.widgets) {
+    if (aName == widget->GetSurfaceTextureName()) {
+      if (widget->GetSurfaceTextureHandle() == aHandle) {
         return;
       }
+      // The layer samples the old texture, it is recreated on the next frame.
+      if (widget->IsLayerBacked() && m.device) {
+        m.device->DestroyQuadLayer(widget->GetQuadLayer());
+        widget->SetQuadLayer(-1);
+      }
+      // A queued thumbnail copy would sample the old texture.
+      m.thumbnails->CancelCopy(widget->GetHandle());
+      widget->SetSurfaceTextureHandle(aHandle);
+      return;
     }
   }
 }
 
+void
+BrowserWorld::SetTabOverview(const bool aEnabled) {
+  m.tabOverviewRequest.store(aEnabled);
+}
+
+void
+BrowserWorld::StartPresentation(const int32_t aWidth, const int32_t aHeight) {
+  std::lock_guard<std::mutex> guard(m.presentationRequestLock);
+  m.presentationRequest = State::PresentationRequest::Start;
+  m.requestedWidth = aWidth;
+  m.requestedHeight = aHeight;
+}
+
+void
+BrowserWorld::StopPresentation() {
+  std::lock_guard<std::mutex> guard(m.presentationRequestLock);
+  m.presentationRequest = State::PresentationRequest::Stop;
+}
+
+bool
+BrowserWorld::IsPresenting() const {
+  return m.presentationState == State::Presentation::Presenting;
+}
+
+FrameStatsPtr
+BrowserWorld::GetFrameStats() const {
+  return m.frameStats;
+}
+
+GLCountersPtr
+BrowserWorld::GetGLCounters() const {
+  return m.glCounters;
+}
+
+JobSystemPtr
+BrowserWorld::GetJobSystem() const {
+  return m.jobs;
+}
+
 BrowserWorld::BrowserWorld(State& aState) : m(aState) {}
 
 BrowserWorld::~BrowserWorld() {}
@@ -560,6 +1547,14 @@ BrowserWorld::CreateFloor() {
   geometry->AddFace(index, index, normalIndex);
 
   m.root->AddNode(geometry);
+
+  std::vector<Vector> vertices;
+  vertices.push_back(Vector(-kLength, kFloor, kLength));
+  vertices.push_back(Vector(kLength, kFloor, kLength));
+  vertices.push_back(Vector(kLength, kFloor, -kLength));
+  vertices.push_back(Vector(-kLength, kFloor, -kLength));
+  const int32_t triangles[] = {0, 1, 2, 0, 2, 3};
+  m.pickTree->AddMesh(vertices, std::vector<int32_t>(triangles, triangles + 6));
 }
 
 void
@@ -10,6 +10,9 @@
 #include "vrb/MacroUtils.h"
 
 #include "DeviceDelegate.h"
+#include "FrameStats.h"
+#include "GLCounters.h"
+#include "JobSystem.h"
 
 #include <jni.h>
 #include <memory>
@@ -32,8 +35,27 @@ public:
   void InitializeGL();
   void ShutdownJava();
   void ShutdownGL();
+  // Waits for the start of the next frame scheduled against the device display timing, then
+  // simulates and renders it. Called on the render thread, which owns the GL context.
   void Draw();
   void SetSurfaceTexture(const std::string& aName, jobject& aSurface);
+  void SetSurfaceTextureHandle(const std::string& aName, const uint32_t aHandle);
+  // Shows the thumbnails of the browser widgets in a grid in front of the user. The atlas is
+  // only filled while the overview is shown. May be called from any thread, it takes effect
+  // on the next frame.
+  void SetTabOverview(const bool aEnabled);
+  // Immersive presentation. The producer is handed a aWidth x aHeight surface for side by
+  // side stereo frames, which replace the scene in the eye buffers once the first one arrives.
+  // Without a size the surface is twice the eye buffer width. May be called from any thread,
+  // the request is applied on the next frame.
+  void StartPresentation(const int32_t aWidth, const int32_t aHeight);
+  void StopPresentation();
+  bool IsPresenting() const;
+  FrameStatsPtr GetFrameStats() const;
+  GLCountersPtr GetGLCounters() const;
+  // Thread pool for parallel and background work of the native subsystems. Runs from
+  // InitializeJava() to ShutdownJava(), jobs run on the calling thread outside of that.
+  JobSystemPtr GetJobSystem() const;
 protected:
   struct State;
   BrowserWorld(State& aState);
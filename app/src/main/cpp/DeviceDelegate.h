@@ -10,6 +10,7 @@
 #include "vrb/Forward.h"
 #include "GestureDelegate.h"
 
+#include <jni.h>
 #include <memory>
 
 namespace crow {
@@ -34,9 +35,42 @@ public:
   virtual bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton,
                                         bool& aChangedState) = 0;
   virtual bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) = 0;
+  // Size in pixels of the buffer each eye is drawn into, zero when unknown.
+  virtual void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const { aWidth = aHeight = 0; }
+  // Display timing of the next frame in seconds on the CLOCK_MONOTONIC timeline: when it is
+  // predicted to be shown and the display refresh period. Devices unable to predict it return false.
+  virtual bool GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const { return false; }
   virtual void StartFrame() = 0;
   virtual void BindEye(const CameraEnum aWhich) = 0;
   virtual void EndFrame() = 0;
+  // Compositor quad layers. A layer presents an external (SurfaceTexture) texture on the
+  // quad spanning aMin to aMax in aTransform space, so the widget using it does not need
+  // to be drawn into the eye buffers. Devices without layer support return -1.
+  virtual bool SupportsQuadLayers() const { return false; }
+  virtual int32_t CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) { return -1; }
+  // aContentChanged is false when the texture holds the same frame as on the previous update.
+  virtual void UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                               const vrb::Vector& aMax, const bool aVisible, const bool aContentChanged) {}
+  virtual void DestroyQuadLayer(const int32_t aLayer) {}
+  // Texture memory the compositor holds for the layer, zero until it has been presented.
+  virtual int64_t GetQuadLayerBytes(const int32_t aLayer) const { return 0; }
+  // Called once the scene has been drawn for the eye seen by aCamera.
+  virtual void DrawQuadLayers(const vrb::Camera& aCamera) {}
+  // Immersive presentation. The next eye buffers hold a frame rendered for aHeadTransform,
+  // a GetHeadTransform() of an earlier frame, instead of the current pose. Devices that
+  // reproject the eye buffers submit them with that pose so the head motion since then is
+  // corrected. Applies to the frame between the next StartFrame() and EndFrame().
+  virtual void SetEyeBufferPose(const vrb::Matrix& aHeadTransform) {}
+  // Immersive presentation straight to the compositor. Devices able to show the frames of an
+  // android.view.Surface as the eye buffers return one of aWidth x aHeight for side by side
+  // stereo frames, nothing is then copied. Others return nullptr, the frames are drawn into
+  // the eye buffers instead.
+  virtual jobject CreatePresentationSurface(const int32_t aWidth, const int32_t aHeight) { return nullptr; }
+  // The next EndFrame() submits the newest frame of the presentation surface in place of the
+  // eye buffers, BindEye() is not called for that frame.
+  virtual void SubmitPresentationSurface() {}
+  // Called once the producer has let go of the surface.
+  virtual void DestroyPresentationSurface() {}
 protected:
   DeviceDelegate() {}
 
@@ -0,0 +1,279 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "DeviceDelegateRecorder.h"
+#include "DeviceTrace.h"
+#include "vrb/Camera.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+
+#include <sys/system_properties.h>
+#include <time.h>
+
+namespace {
+
+static const char* kTraceProperty = "debug.vrbrowser.trace";
+
+int64_t
+Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)now.tv_sec * 1000000000ll) + (int64_t)now.tv_nsec;
+}
+
+} // namespace
+
+namespace crow {
+
+struct DeviceDelegateRecorder::State {
+  DeviceDelegatePtr device;
+  DeviceTraceWriterPtr writer;
+  bool headerWritten;
+  bool inFrame;
+  int64_t startTime;
+  DeviceTraceFrame frame;
+  State() : headerWritten(false), inFrame(false), startTime(0) {}
+
+  DeviceTraceController* GetController(const int32_t aWhichController) {
+    if (!inFrame || (aWhichController < 0) || (aWhichController >= frame.controllers.size())) {
+      return nullptr;
+    }
+    return &frame.controllers[aWhichController];
+  }
+
+  void WriteHeader() {
+    DeviceTraceHeader header;
+    const int32_t count = device->GetControllerCount();
+    for (int32_t ix = 0; ix < count; ix++) {
+      header.controllerModels.push_back(device->GetControllerModelName(ix));
+    }
+    writer->WriteHeader(header);
+    headerWritten = true;
+  }
+};
+
+DeviceDelegateRecorderPtr
+DeviceDelegateRecorder::Create(DeviceDelegatePtr aDevice, const std::string& aPath) {
+  DeviceDelegateRecorderPtr result = std::make_shared<vrb::ConcreteClass<DeviceDelegateRecorder, DeviceDelegateRecorder::State> >();
+  result->m.device = aDevice;
+  result->m.writer = DeviceTraceWriter::Create(aPath);
+  if (result->m.writer->IsOpen()) {
+    VRB_LOG("Recording device trace to: %s", aPath.c_str());
+  }
+  return result;
+}
+
+DeviceDelegatePtr
+DeviceDelegateRecorder::WrapIfRequested(DeviceDelegatePtr aDevice) {
+  char path[PROP_VALUE_MAX] = {};
+  if (!aDevice || (__system_property_get(kTraceProperty, path) <= 0)) {
+    return aDevice;
+  }
+  return Create(aDevice, path);
+}
+
+DeviceDelegatePtr
+DeviceDelegateRecorder::GetDevice() const {
+  return m.device;
+}
+
+GestureDelegateConstPtr
+DeviceDelegateRecorder::GetGestureDelegate() {
+  return m.device->GetGestureDelegate();
+}
+
+vrb::CameraPtr
+DeviceDelegateRecorder::GetCamera(const CameraEnum aWhich) {
+  return m.device->GetCamera(aWhich);
+}
+
+const vrb::Matrix&
+DeviceDelegateRecorder::GetHeadTransform() const {
+  return m.device->GetHeadTransform();
+}
+
+void
+DeviceDelegateRecorder::SetClearColor(const vrb::Color& aColor) {
+  m.device->SetClearColor(aColor);
+}
+
+void
+DeviceDelegateRecorder::SetClipPlanes(const float aNear, const float aFar) {
+  m.device->SetClipPlanes(aNear, aFar);
+}
+
+int32_t
+DeviceDelegateRecorder::GetControllerCount() const {
+  return m.device->GetControllerCount();
+}
+
+const std::string
+DeviceDelegateRecorder::GetControllerModelName(const int32_t aWhichController) const {
+  return m.device->GetControllerModelName(aWhichController);
+}
+
+void
+DeviceDelegateRecorder::ProcessEvents() {
+  m.device->ProcessEvents();
+  if (!m.writer->IsOpen()) {
+    return;
+  }
+  if (!m.headerWritten) {
+    m.WriteHeader();
+  }
+  const int64_t now = Now();
+  if (m.startTime == 0) {
+    m.startTime = now;
+  }
+  m.frame.Clear(m.device->GetControllerCount());
+  m.frame.timestamp = now - m.startTime;
+  m.frame.inputHead = m.device->GetHeadTransform();
+  m.inFrame = true;
+}
+
+const vrb::Matrix&
+DeviceDelegateRecorder::GetControllerTransform(const int32_t aWhichController) {
+  const vrb::Matrix& result = m.device->GetControllerTransform(aWhichController);
+  DeviceTraceController* controller = m.GetController(aWhichController);
+  if (controller) {
+    controller->transform = result;
+  }
+  return result;
+}
+
+bool
+DeviceDelegateRecorder::GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton,
+                                                 bool& aChangedState) {
+  const bool result = m.device->GetControllerButtonState(aWhichController, aWhichButton, aChangedState);
+  DeviceTraceController* controller = m.GetController(aWhichController);
+  if (controller && (aWhichButton >= 0) && (aWhichButton < kTraceButtonCount)) {
+    const uint32_t bit = 1u << aWhichButton;
+    controller->buttonsSampled |= bit;
+    if (result) { controller->buttons |= bit; }
+    if (aChangedState) { controller->buttonsChanged |= bit; }
+  }
+  return result;
+}
+
+bool
+DeviceDelegateRecorder::GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) {
+  const bool result = m.device->GetControllerScrolled(aWhichController, aScrollX, aScrollY);
+  DeviceTraceController* controller = m.GetController(aWhichController);
+  if (controller) {
+    controller->scrollSampled = true;
+    controller->scrolled = result;
+    controller->scrollX = aScrollX;
+    controller->scrollY = aScrollY;
+  }
+  return result;
+}
+
+void
+DeviceDelegateRecorder::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  m.device->GetEyeBufferSize(aWidth, aHeight);
+}
+
+bool
+DeviceDelegateRecorder::GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const {
+  return m.device->GetDisplayTiming(aPredictedDisplayTime, aDisplayPeriod);
+}
+
+void
+DeviceDelegateRecorder::StartFrame() {
+  if (m.inFrame) {
+    // Gestures are consumed by BrowserWorld before the frame starts.
+    GestureDelegateConstPtr gestures = m.device->GetGestureDelegate();
+    const int32_t count = gestures ? gestures->GetGestureCount() : 0;
+    for (int32_t ix = 0; ix < count; ix++) {
+      m.frame.gestures.push_back(gestures->GetGestureType(ix));
+    }
+  }
+  m.device->StartFrame();
+  if (!m.inFrame) {
+    return;
+  }
+  m.frame.head = m.device->GetHeadTransform();
+  const CameraEnum eyes[] = {CameraEnum::Left, CameraEnum::Right};
+  for (int32_t ix = 0; ix < 2; ix++) {
+    vrb::CameraPtr camera = m.device->GetCamera(eyes[ix]);
+    if (camera) {
+      m.frame.eyeTransforms[ix] = camera->GetTransform();
+      m.frame.eyePerspectives[ix] = camera->GetPerspective();
+    }
+  }
+}
+
+void
+DeviceDelegateRecorder::BindEye(const CameraEnum aWhich) {
+  m.device->BindEye(aWhich);
+}
+
+void
+DeviceDelegateRecorder::EndFrame() {
+  m.device->EndFrame();
+  if (m.inFrame) {
+    m.writer->WriteFrame(m.frame);
+    m.inFrame = false;
+  }
+}
+
+bool
+DeviceDelegateRecorder::SupportsQuadLayers() const {
+  return m.device->SupportsQuadLayers();
+}
+
+int32_t
+DeviceDelegateRecorder::CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) {
+  return m.device->CreateQuadLayer(aTexture, aWidth, aHeight);
+}
+
+void
+DeviceDelegateRecorder::UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                                        const vrb::Vector& aMax, const bool aVisible,
+                                        const bool aContentChanged) {
+  m.device->UpdateQuadLayer(aLayer, aTransform, aMin, aMax, aVisible, aContentChanged);
+}
+
+void
+DeviceDelegateRecorder::DestroyQuadLayer(const int32_t aLayer) {
+  m.device->DestroyQuadLayer(aLayer);
+}
+
+int64_t
+DeviceDelegateRecorder::GetQuadLayerBytes(const int32_t aLayer) const {
+  return m.device->GetQuadLayerBytes(aLayer);
+}
+
+void
+DeviceDelegateRecorder::DrawQuadLayers(const vrb::Camera& aCamera) {
+  m.device->DrawQuadLayers(aCamera);
+}
+
+void
+DeviceDelegateRecorder::SetEyeBufferPose(const vrb::Matrix& aHeadTransform) {
+  m.device->SetEyeBufferPose(aHeadTransform);
+}
+
+jobject
+DeviceDelegateRecorder::CreatePresentationSurface(const int32_t aWidth, const int32_t aHeight) {
+  return m.device->CreatePresentationSurface(aWidth, aHeight);
+}
+
+void
+DeviceDelegateRecorder::SubmitPresentationSurface() {
+  m.device->SubmitPresentationSurface();
+}
+
+void
+DeviceDelegateRecorder::DestroyPresentationSurface() {
+  m.device->DestroyPresentationSurface();
+}
+
+DeviceDelegateRecorder::DeviceDelegateRecorder(State& aState) : m(aState) {}
+
+DeviceDelegateRecorder::~DeviceDelegateRecorder() {}
+
+} // namespace crow
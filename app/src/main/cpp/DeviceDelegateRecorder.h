@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_DEVICEDELEGATERECORDER_H
+#define VRBROWSER_DEVICEDELEGATERECORDER_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "DeviceDelegate.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class DeviceDelegateRecorder;
+typedef std::shared_ptr<DeviceDelegateRecorder> DeviceDelegateRecorderPtr;
+
+// Wraps a live device and writes every answer it gives BrowserWorld to a DeviceTrace
+// so the session can be replayed with DeviceDelegateReplay.
+class DeviceDelegateRecorder : public DeviceDelegate {
+public:
+  static DeviceDelegateRecorderPtr Create(DeviceDelegatePtr aDevice, const std::string& aPath);
+  // Returns aDevice wrapped in a recorder when the debug.vrbrowser.trace system property
+  // holds a trace path, otherwise aDevice itself.
+  static DeviceDelegatePtr WrapIfRequested(DeviceDelegatePtr aDevice);
+  DeviceDelegatePtr GetDevice() const;
+  // DeviceDelegate interface
+  GestureDelegateConstPtr GetGestureDelegate() override;
+  vrb::CameraPtr GetCamera(const CameraEnum aWhich) override;
+  const vrb::Matrix& GetHeadTransform() const override;
+  void SetClearColor(const vrb::Color& aColor) override;
+  void SetClipPlanes(const float aNear, const float aFar) override;
+  int32_t GetControllerCount() const override;
+  const std::string GetControllerModelName(const int32_t aWhichController) const override;
+  void ProcessEvents() override;
+  const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
+  bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton,
+                                bool& aChangedState) override;
+  bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override;
+  void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const override;
+  bool GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const override;
+  void StartFrame() override;
+  void BindEye(const CameraEnum aWhich) override;
+  void EndFrame() override;
+  bool SupportsQuadLayers() const override;
+  int32_t CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) override;
+  void UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                       const vrb::Vector& aMax, const bool aVisible, const bool aContentChanged) override;
+  void DestroyQuadLayer(const int32_t aLayer) override;
+  int64_t GetQuadLayerBytes(const int32_t aLayer) const override;
+  void DrawQuadLayers(const vrb::Camera& aCamera) override;
+  void SetEyeBufferPose(const vrb::Matrix& aHeadTransform) override;
+  jobject CreatePresentationSurface(const int32_t aWidth, const int32_t aHeight) override;
+  void SubmitPresentationSurface() override;
+  void DestroyPresentationSurface() override;
+protected:
+  struct State;
+  DeviceDelegateRecorder(State& aState);
+  virtual ~DeviceDelegateRecorder();
+private:
+  State& m;
+  VRB_NO_DEFAULTS(DeviceDelegateRecorder)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_DEVICEDELEGATERECORDER_H
@@ -0,0 +1,259 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "DeviceDelegateReplay.h"
+#include "DeviceTrace.h"
+#include "vrb/CameraEye.h"
+#include "vrb/Color.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+
+#include <sys/system_properties.h>
+
+namespace {
+
+static const char* kReplayProperty = "debug.vrbrowser.replay";
+
+} // namespace
+
+namespace crow {
+
+struct DeviceDelegateReplay::State {
+  vrb::ContextWeak context;
+  DeviceTraceReaderPtr reader;
+  GestureDelegatePtr gestures;
+  vrb::CameraEyePtr cameras[2];
+  vrb::Color clearColor;
+  int32_t frameIndex;
+  bool looping;
+  bool started;
+  int viewportWidth;
+  int viewportHeight;
+  // Returned for queries outside of a recorded frame.
+  DeviceTraceFrame emptyFrame;
+  vrb::Matrix identity;
+  State()
+      : frameIndex(-1)
+      , looping(false)
+      , started(false)
+      , viewportWidth(0)
+      , viewportHeight(0)
+      , identity(vrb::Matrix::Identity())
+  {}
+
+  const DeviceTraceFrame& CurrentFrame() const {
+    if (!reader || (frameIndex < 0)) {
+      return emptyFrame;
+    }
+    return reader->GetFrame(frameIndex);
+  }
+
+  const DeviceTraceController* GetController(const int32_t aWhichController) const {
+    const DeviceTraceFrame& frame = CurrentFrame();
+    if ((aWhichController < 0) || (aWhichController >= frame.controllers.size())) {
+      return nullptr;
+    }
+    return &frame.controllers[aWhichController];
+  }
+};
+
+DeviceDelegateReplayPtr
+DeviceDelegateReplay::Create(vrb::ContextWeak aContext, const std::string& aPath) {
+  DeviceDelegateReplayPtr result = std::make_shared<vrb::ConcreteClass<DeviceDelegateReplay, DeviceDelegateReplay::State> >();
+  result->m.context = aContext;
+  result->m.reader = DeviceTraceReader::Create(aPath);
+  result->m.gestures = GestureDelegate::Create();
+  for (int32_t ix = 0; ix < 2; ix++) {
+    // The recorded eye transforms already include the head, multiplying by identity keeps them exact.
+    result->m.cameras[ix] = vrb::CameraEye::Create(aContext);
+    result->m.cameras[ix]->SetHeadTransform(vrb::Matrix::Identity());
+  }
+  return result;
+}
+
+DeviceDelegateReplayPtr
+DeviceDelegateReplay::CreateIfRequested(vrb::ContextWeak aContext) {
+  char path[PROP_VALUE_MAX] = {};
+  if (__system_property_get(kReplayProperty, path) <= 0) {
+    return nullptr;
+  }
+  DeviceDelegateReplayPtr result = Create(aContext, path);
+  return result->IsValid() ? result : nullptr;
+}
+
+bool
+DeviceDelegateReplay::IsValid() const {
+  return m.reader && m.reader->IsValid();
+}
+
+void
+DeviceDelegateReplay::SetLooping(const bool aLooping) {
+  m.looping = aLooping;
+}
+
+int32_t
+DeviceDelegateReplay::GetFrameCount() const {
+  return m.reader ? m.reader->GetFrameCount() : 0;
+}
+
+int32_t
+DeviceDelegateReplay::GetFrameIndex() const {
+  return m.frameIndex;
+}
+
+bool
+DeviceDelegateReplay::IsFinished() const {
+  return !m.looping && (m.frameIndex >= (GetFrameCount() - 1));
+}
+
+int64_t
+DeviceDelegateReplay::GetFrameTimestamp() const {
+  return m.CurrentFrame().timestamp;
+}
+
+void
+DeviceDelegateReplay::Rewind() {
+  m.frameIndex = -1;
+  m.started = false;
+  m.gestures->Reset();
+}
+
+void
+DeviceDelegateReplay::SetViewport(const int aWidth, const int aHeight) {
+  m.viewportWidth = aWidth;
+  m.viewportHeight = aHeight;
+}
+
+GestureDelegateConstPtr
+DeviceDelegateReplay::GetGestureDelegate() {
+  return m.gestures;
+}
+
+vrb::CameraPtr
+DeviceDelegateReplay::GetCamera(const CameraEnum aWhich) {
+  return m.cameras[aWhich == CameraEnum::Left ? 0 : 1];
+}
+
+const vrb::Matrix&
+DeviceDelegateReplay::GetHeadTransform() const {
+  const DeviceTraceFrame& frame = m.CurrentFrame();
+  return m.started ? frame.head : frame.inputHead;
+}
+
+void
+DeviceDelegateReplay::SetClearColor(const vrb::Color& aColor) {
+  m.clearColor = aColor;
+}
+
+void
+DeviceDelegateReplay::SetClipPlanes(const float, const float) {
+  // The recorded perspective matrices are used as is.
+}
+
+int32_t
+DeviceDelegateReplay::GetControllerCount() const {
+  return m.reader ? (int32_t)m.reader->GetHeader().controllerModels.size() : 0;
+}
+
+const std::string
+DeviceDelegateReplay::GetControllerModelName(const int32_t aWhichController) const {
+  if ((aWhichController < 0) || (aWhichController >= GetControllerCount())) {
+    return std::string();
+  }
+  return m.reader->GetHeader().controllerModels[aWhichController];
+}
+
+void
+DeviceDelegateReplay::ProcessEvents() {
+  m.started = false;
+  m.gestures->Reset();
+  const int32_t count = GetFrameCount();
+  if (count == 0) {
+    return;
+  }
+  if (m.frameIndex < (count - 1)) {
+    m.frameIndex++;
+  } else if (m.looping) {
+    m.frameIndex = 0;
+  } else {
+    // Hold the last frame without replaying its gestures again.
+    return;
+  }
+  for (const GestureType gesture: m.CurrentFrame().gestures) {
+    m.gestures->AddGesture(gesture);
+  }
+}
+
+const vrb::Matrix&
+DeviceDelegateReplay::GetControllerTransform(const int32_t aWhichController) {
+  const DeviceTraceController* controller = m.GetController(aWhichController);
+  return controller ? controller->transform : m.identity;
+}
+
+bool
+DeviceDelegateReplay::GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton,
+                                               bool& aChangedState) {
+  const DeviceTraceController* controller = m.GetController(aWhichController);
+  if (!controller || (aWhichButton < 0) || (aWhichButton >= kTraceButtonCount)) {
+    return false;
+  }
+  const uint32_t bit = 1u << aWhichButton;
+  if ((controller->buttonsSampled & bit) == 0) {
+    VRB_LOG("Button %d of controller %d was not recorded in frame %d", aWhichButton, aWhichController, m.frameIndex);
+    return false;
+  }
+  aChangedState = (controller->buttonsChanged & bit) != 0;
+  return (controller->buttons & bit) != 0;
+}
+
+bool
+DeviceDelegateReplay::GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) {
+  const DeviceTraceController* controller = m.GetController(aWhichController);
+  if (!controller || !controller->scrollSampled) {
+    return false;
+  }
+  aScrollX = controller->scrollX;
+  aScrollY = controller->scrollY;
+  return controller->scrolled;
+}
+
+void
+DeviceDelegateReplay::StartFrame() {
+  const DeviceTraceFrame& frame = m.CurrentFrame();
+  for (int32_t ix = 0; ix < 2; ix++) {
+    m.cameras[ix]->SetEyeTransform(frame.eyeTransforms[ix]);
+    m.cameras[ix]->SetPerspective(frame.eyePerspectives[ix]);
+  }
+  m.started = true;
+  VRB_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  VRB_CHECK(glEnable(GL_DEPTH_TEST));
+  VRB_CHECK(glEnable(GL_CULL_FACE));
+  VRB_CHECK(glEnable(GL_BLEND));
+}
+
+void
+DeviceDelegateReplay::BindEye(const CameraEnum aWhich) {
+  // Both eyes share the window, side by side.
+  if ((m.viewportWidth > 0) && (m.viewportHeight > 0)) {
+    const int width = m.viewportWidth / 2;
+    VRB_CHECK(glViewport(aWhich == CameraEnum::Left ? 0 : width, 0, width, m.viewportHeight));
+  }
+  if (aWhich == CameraEnum::Left) {
+    VRB_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+  }
+}
+
+void
+DeviceDelegateReplay::EndFrame() {
+  // noop
+}
+
+DeviceDelegateReplay::DeviceDelegateReplay(State& aState) : m(aState) {}
+
+DeviceDelegateReplay::~DeviceDelegateReplay() {}
+
+} // namespace crow
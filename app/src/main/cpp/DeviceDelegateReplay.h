@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_DEVICEDELEGATEREPLAY_H
+#define VRBROWSER_DEVICEDELEGATEREPLAY_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "DeviceDelegate.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class DeviceDelegateReplay;
+typedef std::shared_ptr<DeviceDelegateReplay> DeviceDelegateReplayPtr;
+
+// Plays back a trace written by DeviceDelegateRecorder. Each ProcessEvents() call advances
+// one recorded frame, so BrowserWorld::Draw() sees exactly the answers the live device gave.
+class DeviceDelegateReplay : public DeviceDelegate {
+public:
+  static DeviceDelegateReplayPtr Create(vrb::ContextWeak aContext, const std::string& aPath);
+  // Returns the replay delegate when the debug.vrbrowser.replay system property holds a
+  // trace path that could be loaded, otherwise nullptr.
+  static DeviceDelegateReplayPtr CreateIfRequested(vrb::ContextWeak aContext);
+  bool IsValid() const;
+  // When looping the trace restarts after the last frame, otherwise the last frame is held.
+  void SetLooping(const bool aLooping);
+  int32_t GetFrameCount() const;
+  // Index of the frame being replayed, -1 before the first ProcessEvents() call.
+  int32_t GetFrameIndex() const;
+  bool IsFinished() const;
+  // Recorded nanoseconds since the start of the trace for the current frame.
+  int64_t GetFrameTimestamp() const;
+  void Rewind();
+  void SetViewport(const int aWidth, const int aHeight);
+  // DeviceDelegate interface
+  GestureDelegateConstPtr GetGestureDelegate() override;
+  vrb::CameraPtr GetCamera(const CameraEnum aWhich) override;
+  const vrb::Matrix& GetHeadTransform() const override;
+  void SetClearColor(const vrb::Color& aColor) override;
+  void SetClipPlanes(const float aNear, const float aFar) override;
+  int32_t GetControllerCount() const override;
+  const std::string GetControllerModelName(const int32_t aWhichController) const override;
+  void ProcessEvents() override;
+  const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
+  bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton,
+                                bool& aChangedState) override;
+  bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override;
+  void StartFrame() override;
+  void BindEye(const CameraEnum aWhich) override;
+  void EndFrame() override;
+protected:
+  struct State;
+  DeviceDelegateReplay(State& aState);
+  virtual ~DeviceDelegateReplay();
+private:
+  State& m;
+  VRB_NO_DEFAULTS(DeviceDelegateReplay)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_DEVICEDELEGATEREPLAY_H
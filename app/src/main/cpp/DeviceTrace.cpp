@@ -0,0 +1,277 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "DeviceTrace.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+#include <stdio.h>
+
+namespace {
+
+static const uint32_t kTraceMagic = 0x52544352; // "CRTR"
+static const uint32_t kTraceVersion = 1;
+static const uint32_t kMaxStringLength = 1024;
+static const int32_t kMaxTraceControllers = 16;
+static const int32_t kMaxTraceGestures = 64;
+
+template<typename T> bool
+Write(FILE* aFile, const T& aValue) {
+  return fwrite(&aValue, sizeof(T), 1, aFile) == 1;
+}
+
+template<typename T> bool
+Read(FILE* aFile, T& aValue) {
+  return fread(&aValue, sizeof(T), 1, aFile) == 1;
+}
+
+// Matrices are stored column major, exactly as vrb keeps them, so a replayed frame is bit identical.
+bool
+WriteMatrix(FILE* aFile, const vrb::Matrix& aMatrix) {
+  return fwrite(aMatrix.Data(), sizeof(float), 16, aFile) == 16;
+}
+
+bool
+ReadMatrix(FILE* aFile, vrb::Matrix& aMatrix) {
+  float values[4][4];
+  if (fread(values, sizeof(float), 16, aFile) != 16) {
+    return false;
+  }
+  aMatrix = vrb::Matrix::FromColumnMajor(values);
+  return true;
+}
+
+bool
+WriteString(FILE* aFile, const std::string& aValue) {
+  const uint32_t length = (uint32_t)aValue.size();
+  return Write(aFile, length) && (fwrite(aValue.data(), 1, length, aFile) == length);
+}
+
+bool
+ReadString(FILE* aFile, std::string& aValue) {
+  uint32_t length = 0;
+  if (!Read(aFile, length) || (length > kMaxStringLength)) {
+    return false;
+  }
+  aValue.resize(length);
+  return (length == 0) || (fread(&aValue[0], 1, length, aFile) == length);
+}
+
+} // namespace
+
+namespace crow {
+
+DeviceTraceController::DeviceTraceController()
+    : transform(vrb::Matrix::Identity())
+    , buttonsSampled(0)
+    , buttons(0)
+    , buttonsChanged(0)
+    , scrollSampled(false)
+    , scrolled(false)
+    , scrollX(0.0f)
+    , scrollY(0.0f)
+{}
+
+DeviceTraceFrame::DeviceTraceFrame()
+    : timestamp(0)
+    , inputHead(vrb::Matrix::Identity())
+    , head(vrb::Matrix::Identity())
+{
+  for (int32_t ix = 0; ix < 2; ix++) {
+    eyeTransforms[ix] = vrb::Matrix::Identity();
+    eyePerspectives[ix] = vrb::Matrix::Identity();
+  }
+}
+
+void
+DeviceTraceFrame::Clear(const int32_t aControllerCount) {
+  timestamp = 0;
+  controllers.assign((size_t)aControllerCount, DeviceTraceController());
+  gestures.clear();
+}
+
+struct DeviceTraceWriter::State {
+  FILE* file;
+  State() : file(nullptr) {}
+  ~State() { Close(); }
+  void Close() {
+    if (file) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+};
+
+DeviceTraceWriterPtr
+DeviceTraceWriter::Create(const std::string& aPath) {
+  DeviceTraceWriterPtr result = std::make_shared<vrb::ConcreteClass<DeviceTraceWriter, DeviceTraceWriter::State> >();
+  result->m.file = fopen(aPath.c_str(), "wb");
+  if (!result->m.file) {
+    VRB_LOG("Unable to open device trace for writing: %s", aPath.c_str());
+  }
+  return result;
+}
+
+bool
+DeviceTraceWriter::IsOpen() const {
+  return m.file != nullptr;
+}
+
+bool
+DeviceTraceWriter::WriteHeader(const DeviceTraceHeader& aHeader) {
+  if (!m.file) {
+    return false;
+  }
+  bool ok = Write(m.file, kTraceMagic) && Write(m.file, kTraceVersion);
+  ok = ok && Write(m.file, (int32_t)aHeader.controllerModels.size());
+  for (const std::string& model: aHeader.controllerModels) {
+    ok = ok && WriteString(m.file, model);
+  }
+  if (!ok) {
+    VRB_LOG("Failed to write device trace header");
+    m.Close();
+  }
+  return ok;
+}
+
+bool
+DeviceTraceWriter::WriteFrame(const DeviceTraceFrame& aFrame) {
+  if (!m.file) {
+    return false;
+  }
+  bool ok = Write(m.file, aFrame.timestamp) && WriteMatrix(m.file, aFrame.inputHead) && WriteMatrix(m.file, aFrame.head);
+  for (int32_t ix = 0; ix < 2; ix++) {
+    ok = ok && WriteMatrix(m.file, aFrame.eyeTransforms[ix]) && WriteMatrix(m.file, aFrame.eyePerspectives[ix]);
+  }
+  ok = ok && Write(m.file, (int32_t)aFrame.controllers.size());
+  for (const DeviceTraceController& controller: aFrame.controllers) {
+    ok = ok && WriteMatrix(m.file, controller.transform) &&
+         Write(m.file, controller.buttonsSampled) && Write(m.file, controller.buttons) &&
+         Write(m.file, controller.buttonsChanged) && Write(m.file, (uint8_t)controller.scrollSampled) &&
+         Write(m.file, (uint8_t)controller.scrolled) && Write(m.file, controller.scrollX) &&
+         Write(m.file, controller.scrollY);
+  }
+  ok = ok && Write(m.file, (int32_t)aFrame.gestures.size());
+  for (const GestureType gesture: aFrame.gestures) {
+    ok = ok && Write(m.file, (int32_t)gesture);
+  }
+  if (!ok) {
+    VRB_LOG("Failed to write device trace frame, recording stopped");
+    m.Close();
+  }
+  return ok;
+}
+
+void
+DeviceTraceWriter::Close() {
+  m.Close();
+}
+
+DeviceTraceWriter::DeviceTraceWriter(State& aState) : m(aState) {}
+DeviceTraceWriter::~DeviceTraceWriter() {}
+
+struct DeviceTraceReader::State {
+  bool valid;
+  DeviceTraceHeader header;
+  std::vector<DeviceTraceFrame> frames;
+  State() : valid(false) {}
+
+  bool ReadHeader(FILE* aFile) {
+    uint32_t magic = 0, version = 0;
+    int32_t count = 0;
+    if (!Read(aFile, magic) || (magic != kTraceMagic) || !Read(aFile, version) || (version != kTraceVersion)) {
+      VRB_LOG("Device trace has an unknown format");
+      return false;
+    }
+    if (!Read(aFile, count) || (count < 0) || (count > kMaxTraceControllers)) {
+      return false;
+    }
+    header.controllerModels.resize((size_t)count);
+    for (std::string& model: header.controllerModels) {
+      if (!ReadString(aFile, model)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns false at the end of the file or on a truncated frame.
+  bool ReadFrame(FILE* aFile, DeviceTraceFrame& aFrame) {
+    bool ok = Read(aFile, aFrame.timestamp) && ReadMatrix(aFile, aFrame.inputHead) && ReadMatrix(aFile, aFrame.head);
+    for (int32_t ix = 0; ix < 2; ix++) {
+      ok = ok && ReadMatrix(aFile, aFrame.eyeTransforms[ix]) && ReadMatrix(aFile, aFrame.eyePerspectives[ix]);
+    }
+    int32_t count = 0;
+    if (!ok || !Read(aFile, count) || (count < 0) || (count > kMaxTraceControllers)) {
+      return false;
+    }
+    aFrame.Clear(count);
+    for (DeviceTraceController& controller: aFrame.controllers) {
+      uint8_t scrollSampled = 0, scrolled = 0;
+      ok = ok && ReadMatrix(aFile, controller.transform) &&
+           Read(aFile, controller.buttonsSampled) && Read(aFile, controller.buttons) &&
+           Read(aFile, controller.buttonsChanged) && Read(aFile, scrollSampled) && Read(aFile, scrolled) &&
+           Read(aFile, controller.scrollX) && Read(aFile, controller.scrollY);
+      controller.scrollSampled = scrollSampled != 0;
+      controller.scrolled = scrolled != 0;
+    }
+    if (!ok || !Read(aFile, count) || (count < 0) || (count > kMaxTraceGestures)) {
+      return false;
+    }
+    for (int32_t ix = 0; ix < count; ix++) {
+      int32_t gesture = 0;
+      if (!Read(aFile, gesture)) {
+        return false;
+      }
+      aFrame.gestures.push_back((GestureType)gesture);
+    }
+    return true;
+  }
+};
+
+DeviceTraceReaderPtr
+DeviceTraceReader::Create(const std::string& aPath) {
+  DeviceTraceReaderPtr result = std::make_shared<vrb::ConcreteClass<DeviceTraceReader, DeviceTraceReader::State> >();
+  FILE* file = fopen(aPath.c_str(), "rb");
+  if (!file) {
+    VRB_LOG("Unable to open device trace: %s", aPath.c_str());
+    return result;
+  }
+  if (result->m.ReadHeader(file)) {
+    DeviceTraceFrame frame;
+    while (result->m.ReadFrame(file, frame)) {
+      result->m.frames.push_back(frame);
+    }
+    result->m.valid = !result->m.frames.empty();
+    VRB_LOG("Loaded %d frames from device trace: %s", (int)result->m.frames.size(), aPath.c_str());
+  }
+  fclose(file);
+  return result;
+}
+
+bool
+DeviceTraceReader::IsValid() const {
+  return m.valid;
+}
+
+const DeviceTraceHeader&
+DeviceTraceReader::GetHeader() const {
+  return m.header;
+}
+
+int32_t
+DeviceTraceReader::GetFrameCount() const {
+  return (int32_t)m.frames.size();
+}
+
+const DeviceTraceFrame&
+DeviceTraceReader::GetFrame(const int32_t aIndex) const {
+  return m.frames[aIndex];
+}
+
+DeviceTraceReader::DeviceTraceReader(State& aState) : m(aState) {}
+DeviceTraceReader::~DeviceTraceReader() {}
+
+} // namespace crow
@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_DEVICETRACE_H
+#define VRBROWSER_DEVICETRACE_H
+
+#include "vrb/MacroUtils.h"
+#include "vrb/Matrix.h"
+#include "GestureDelegate.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace crow {
+
+// Binary trace of everything a DeviceDelegate reports to BrowserWorld, one record per frame.
+// The trace is written in native byte order and is not meant to be portable across ABIs.
+static const int32_t kTraceButtonCount = 3;
+
+struct DeviceTraceController {
+  vrb::Matrix transform;
+  // One bit per button in each mask. Only queries made by BrowserWorld are recorded,
+  // so the sampled masks tell which answers are valid.
+  uint32_t buttonsSampled;
+  uint32_t buttons;
+  uint32_t buttonsChanged;
+  bool scrollSampled;
+  bool scrolled;
+  float scrollX;
+  float scrollY;
+  DeviceTraceController();
+};
+
+struct DeviceTraceFrame {
+  int64_t timestamp; // Nanoseconds since the first frame of the trace.
+  // Head transform as seen before StartFrame().
+  vrb::Matrix inputHead;
+  // Head and eye cameras as set by StartFrame().
+  vrb::Matrix head;
+  vrb::Matrix eyeTransforms[2];
+  vrb::Matrix eyePerspectives[2];
+  std::vector<DeviceTraceController> controllers;
+  std::vector<GestureType> gestures;
+  DeviceTraceFrame();
+  void Clear(const int32_t aControllerCount);
+};
+
+struct DeviceTraceHeader {
+  std::vector<std::string> controllerModels;
+};
+
+class DeviceTraceWriter;
+typedef std::shared_ptr<DeviceTraceWriter> DeviceTraceWriterPtr;
+
+class DeviceTraceWriter {
+public:
+  static DeviceTraceWriterPtr Create(const std::string& aPath);
+  bool IsOpen() const;
+  bool WriteHeader(const DeviceTraceHeader& aHeader);
+  bool WriteFrame(const DeviceTraceFrame& aFrame);
+  void Close();
+protected:
+  struct State;
+  DeviceTraceWriter(State& aState);
+  ~DeviceTraceWriter();
+private:
+  State& m;
+  DeviceTraceWriter() = delete;
+  VRB_NO_DEFAULTS(DeviceTraceWriter)
+};
+
+class DeviceTraceReader;
+typedef std::shared_ptr<DeviceTraceReader> DeviceTraceReaderPtr;
+
+// Loads the whole trace up front so replaying a frame never touches the file system.
+class DeviceTraceReader {
+public:
+  static DeviceTraceReaderPtr Create(const std::string& aPath);
+  bool IsValid() const;
+  const DeviceTraceHeader& GetHeader() const;
+  int32_t GetFrameCount() const;
+  const DeviceTraceFrame& GetFrame(const int32_t aIndex) const;
+protected:
+  struct State;
+  DeviceTraceReader(State& aState);
+  ~DeviceTraceReader();
+private:
+  State& m;
+  DeviceTraceReader() = delete;
+  VRB_NO_DEFAULTS(DeviceTraceReader)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_DEVICETRACE_H
@@ -0,0 +1,233 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EventRing.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+
+#include <cstring>
+#include <time.h>
+
+namespace {
+
+static const char* kSetEventRingName = "setEventRing";
+static const char* kSetEventRingSignature = "(Ljava/nio/ByteBuffer;)V";
+static const char* kDispatchEventsName = "dispatchEvents";
+static const char* kDispatchEventsSignature = "(I)V";
+
+static const int32_t kWriteIndexOffset = 0;
+static const int32_t kReadIndexOffset = 4;
+static const int32_t kCapacityOffset = 8;
+static const int32_t kRecordSizeOffset = 12;
+
+static const int32_t kTypeOffset = 0;
+static const int32_t kHandleOffset = 4;
+static const int32_t kTimestampOffset = 8;
+static const int32_t kDeviceOffset = 16;
+static const int32_t kFlagsOffset = 20;
+static const int32_t kDataOffset = 24;
+
+static const int32_t kFlagPressed = 1;
+
+static const size_t kBufferSize = crow::EventRing::kHeaderSize +
+    (crow::EventRing::kCapacity * crow::EventRing::kRecordSize);
+
+int64_t
+Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)now.tv_sec * 1000000000ll) + (int64_t)now.tv_nsec;
+}
+
+template <typename T>
+T*
+At(uint8_t* aBase, const int32_t aOffset) {
+  return reinterpret_cast<T*>(aBase + aOffset);
+}
+
+} // namespace
+
+namespace crow {
+
+struct EventRing::State {
+  // int64_t storage keeps the 8 byte timestamps aligned.
+  int64_t storage[(kBufferSize + sizeof(int64_t) - 1) / sizeof(int64_t)];
+  uint8_t* buffer;
+  uint8_t* records;
+  uint32_t writeIndex;
+  uint32_t notifiedIndex;
+  uint32_t dropped;
+  JNIEnv* env;
+  jobject activity;
+  jmethodID dispatchEventsMethod;
+
+  State()
+      : writeIndex(0)
+      , notifiedIndex(0)
+      , dropped(0)
+      , env(nullptr)
+      , activity(nullptr)
+      , dispatchEventsMethod(nullptr)
+  {
+    buffer = reinterpret_cast<uint8_t*>(storage);
+    records = buffer + kHeaderSize;
+    Reset();
+  }
+
+  void Reset() {
+    memset(storage, 0, sizeof(storage));
+    writeIndex = notifiedIndex = 0;
+    *At<int32_t>(buffer, kCapacityOffset) = kCapacity;
+    *At<int32_t>(buffer, kRecordSizeOffset) = kRecordSize;
+  }
+
+  uint8_t* Reserve(const Type aType) {
+    if (!dispatchEventsMethod) {
+      return nullptr;
+    }
+    const uint32_t readIndex = __atomic_load_n(At<uint32_t>(buffer, kReadIndexOffset), __ATOMIC_ACQUIRE);
+    if ((writeIndex - readIndex) >= kCapacity) {
+      if ((dropped % 100) == 0) {
+        VRB_LOG("EventRing full, dropped %u events", dropped + 1);
+      }
+      dropped++;
+      return nullptr;
+    }
+    uint8_t* record = records + ((writeIndex & (kCapacity - 1)) * kRecordSize);
+    memset(record, 0, kRecordSize);
+    *At<int32_t>(record, kTypeOffset) = static_cast<int32_t>(aType);
+    *At<int64_t>(record, kTimestampOffset) = Now();
+    return record;
+  }
+
+  void Commit() {
+    writeIndex++;
+    __atomic_store_n(At<uint32_t>(buffer, kWriteIndexOffset), writeIndex, __ATOMIC_RELEASE);
+  }
+};
+
+EventRingPtr
+EventRing::Create() {
+  return std::make_shared<vrb::ConcreteClass<EventRing, EventRing::State> >();
+}
+
+void
+EventRing::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
+  m.Reset();
+  m.env = aEnv;
+  m.activity = aActivity;
+  if (!m.env || !m.activity) {
+    return;
+  }
+  jclass clazz = m.env->GetObjectClass(m.activity);
+  if (!clazz) {
+    return;
+  }
+  jmethodID setEventRing = m.env->GetMethodID(clazz, kSetEventRingName, kSetEventRingSignature);
+  if (!setEventRing) {
+    VRB_LOG("Failed to find Java method: %s %s", kSetEventRingName, kSetEventRingSignature);
+    return;
+  }
+  m.dispatchEventsMethod = m.env->GetMethodID(clazz, kDispatchEventsName, kDispatchEventsSignature);
+  if (!m.dispatchEventsMethod) {
+    VRB_LOG("Failed to find Java method: %s %s", kDispatchEventsName, kDispatchEventsSignature);
+    return;
+  }
+  jobject byteBuffer = m.env->NewDirectByteBuffer(m.buffer, kBufferSize);
+  if (!byteBuffer) {
+    VRB_LOG("Failed to create EventRing ByteBuffer");
+    m.dispatchEventsMethod = nullptr;
+    return;
+  }
+  m.env->CallVoidMethod(m.activity, setEventRing, byteBuffer);
+  m.env->DeleteLocalRef(byteBuffer);
+}
+
+void
+EventRing::ShutdownJava() {
+  m.env = nullptr;
+  m.activity = nullptr;
+  m.dispatchEventsMethod = nullptr;
+}
+
+void
+EventRing::PushMotion(const uint32_t aHandle, const int32_t aDevice, const bool aPressed, const float aX, const float aY) {
+  uint8_t* record = m.Reserve(Type::Motion);
+  if (!record) {
+    return;
+  }
+  *At<uint32_t>(record, kHandleOffset) = aHandle;
+  *At<int32_t>(record, kDeviceOffset) = aDevice;
+  *At<int32_t>(record, kFlagsOffset) = aPressed ? kFlagPressed : 0;
+  float* data = At<float>(record, kDataOffset);
+  data[0] = aX;
+  data[1] = aY;
+  m.Commit();
+}
+
+void
+EventRing::PushScroll(const uint32_t aHandle, const int32_t aDevice, const float aX, const float aY) {
+  uint8_t* record = m.Reserve(Type::Scroll);
+  if (!record) {
+    return;
+  }
+  *At<uint32_t>(record, kHandleOffset) = aHandle;
+  *At<int32_t>(record, kDeviceOffset) = aDevice;
+  float* data = At<float>(record, kDataOffset);
+  data[0] = aX;
+  data[1] = aY;
+  m.Commit();
+}
+
+void
+EventRing::PushGesture(const int32_t aType) {
+  uint8_t* record = m.Reserve(Type::Gesture);
+  if (!record) {
+    return;
+  }
+  *At<int32_t>(record, kDeviceOffset) = aType;
+  m.Commit();
+}
+
+void
+EventRing::PushAttention(const uint32_t aHandle, const int32_t aLevel) {
+  uint8_t* record = m.Reserve(Type::Attention);
+  if (!record) {
+    return;
+  }
+  *At<uint32_t>(record, kHandleOffset) = aHandle;
+  *At<int32_t>(record, kDeviceOffset) = aLevel;
+  m.Commit();
+}
+
+void
+EventRing::PushHibernate(const uint32_t aHandle) {
+  uint8_t* record = m.Reserve(Type::Hibernate);
+  if (!record) {
+    return;
+  }
+  *At<uint32_t>(record, kHandleOffset) = aHandle;
+  m.Commit();
+}
+
+void
+EventRing::Flush() {
+  if (!m.env || !m.dispatchEventsMethod || (m.writeIndex == m.notifiedIndex)) {
+    return;
+  }
+  m.env->CallVoidMethod(m.activity, m.dispatchEventsMethod, (jint)m.writeIndex);
+  m.notifiedIndex = m.writeIndex;
+}
+
+uint32_t
+EventRing::GetDroppedCount() const {
+  return m.dropped;
+}
+
+EventRing::EventRing(State& aState) : m(aState) {}
+EventRing::~EventRing() {}
+
+} // namespace crow
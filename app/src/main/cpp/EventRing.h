@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_EVENTRING_H
+#define VRBROWSER_EVENTRING_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class EventRing;
+typedef std::shared_ptr<EventRing> EventRingPtr;
+
+// Single producer / single consumer ring of fixed size event records shared with Java
+// through a direct ByteBuffer. The render thread pushes records during the frame and
+// Flush() sends at most one notification per frame. Java drains the batch on the UI
+// thread and publishes its read index back into the header.
+//
+// Layout (native byte order), must be kept in sync with EventRing.java:
+//   header:  int32 writeIndex, int32 readIndex, int32 capacity, int32 recordSize
+//   record:  int32 type, int32 widget handle, int64 timestamp (CLOCK_MONOTONIC ns),
+//            int32 device, int32 flags, float data[kDataCount]
+class EventRing {
+public:
+  enum class Type : int32_t {
+    Motion = 1,  // data: x, y. flags: pressed
+    Scroll = 2,  // data: x, y
+    Gesture = 3, // device: gesture type
+    Attention = 4, // device: WidgetAttention::Level
+    Hibernate = 5 // Release the widget surface producer, see TextureBudget.
+  };
+  static const int32_t kCapacity = 256; // Must be a power of two.
+  static const int32_t kHeaderSize = 16;
+  static const int32_t kRecordSize = 64;
+  static const int32_t kDataCount = 8;
+
+  static EventRingPtr Create();
+  void InitializeJava(JNIEnv* aEnv, jobject aActivity);
+  void ShutdownJava();
+  void PushMotion(const uint32_t aHandle, const int32_t aDevice, const bool aPressed, const float aX, const float aY);
+  void PushScroll(const uint32_t aHandle, const int32_t aDevice, const float aX, const float aY);
+  void PushGesture(const int32_t aType);
+  void PushAttention(const uint32_t aHandle, const int32_t aLevel);
+  void PushHibernate(const uint32_t aHandle);
+  void Flush();
+  uint32_t GetDroppedCount() const;
+protected:
+  struct State;
+  EventRing(State& aState);
+  ~EventRing();
+private:
+  State& m;
+  EventRing() = delete;
+  VRB_NO_DEFAULTS(EventRing)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_EVENTRING_H
@@ -0,0 +1,148 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameScheduler.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <time.h>
+
+namespace {
+
+static const int32_t kWorkSamples = 32;
+// The work estimate is the 90th percentile of the recent frames.
+static const int32_t kWorkPercentile = 90;
+static const double kMinMargin = 0.001;
+static const double kMarginStep = 0.001;
+static const double kMarginDecay = 0.00001;
+
+void
+SleepUntil(const double aTime) {
+  struct timespec until;
+  until.tv_sec = (time_t)aTime;
+  until.tv_nsec = (long)((aTime - (double)until.tv_sec) * 1.0e9);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR) {}
+}
+
+} // namespace
+
+namespace crow {
+
+struct FrameScheduler::State {
+  double work[kWorkSamples];
+  int32_t next;
+  int32_t count;
+  double period;
+  double previousDisplayTime;
+  // Zero when the frame was started without display timing.
+  double deadline;
+  double frameStart;
+  double margin;
+  double slack;
+  double sleep;
+  int32_t missed;
+  State() : next(0), count(0), period(0.0), previousDisplayTime(0.0), deadline(0.0), frameStart(0.0),
+            margin(kMinMargin), slack(0.0), sleep(0.0), missed(0) {}
+
+  double WorkEstimate() const {
+    if (count == 0) {
+      return 0.0;
+    }
+    double sorted[kWorkSamples];
+    std::copy(work, work + count, sorted);
+    const int32_t index = (count * kWorkPercentile) / 100;
+    std::nth_element(sorted, sorted + index, sorted + count);
+    return sorted[index];
+  }
+};
+
+FrameSchedulerPtr
+FrameScheduler::Create() {
+  return std::make_shared<vrb::ConcreteClass<FrameScheduler, FrameScheduler::State> >();
+}
+
+double
+FrameScheduler::Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + ((double)now.tv_nsec * 1.0e-9);
+}
+
+void
+FrameScheduler::WaitForFrame(const double aPredictedDisplayTime, const double aDisplayPeriod) {
+  if (aDisplayPeriod <= 0.0) {
+    StartFrame();
+    return;
+  }
+  m.missed = 0;
+  if ((m.previousDisplayTime > 0.0) && (aPredictedDisplayTime > m.previousDisplayTime)) {
+    const double refreshes = (aPredictedDisplayTime - m.previousDisplayTime) / aDisplayPeriod;
+    m.missed = std::max((int32_t)(refreshes + 0.5) - 1, 0);
+  }
+  if (m.missed > 0) {
+    m.margin = std::min(m.margin + kMarginStep, aDisplayPeriod * 0.5);
+  } else {
+    m.margin = std::max(m.margin - kMarginDecay, kMinMargin);
+  }
+  m.period = aDisplayPeriod;
+  m.previousDisplayTime = aPredictedDisplayTime;
+  m.deadline = aPredictedDisplayTime - aDisplayPeriod;
+
+  const double start = m.deadline - m.WorkEstimate() - m.margin;
+  const double now = Now();
+  // A bogus prediction must not stall the render thread for longer than a refresh.
+  m.sleep = std::min(start - now, aDisplayPeriod);
+  if (m.sleep > 0.0) {
+    SleepUntil(now + m.sleep);
+  } else {
+    m.sleep = 0.0;
+  }
+  m.frameStart = Now();
+}
+
+void
+FrameScheduler::StartFrame() {
+  m.period = 0.0;
+  m.previousDisplayTime = 0.0;
+  m.deadline = 0.0;
+  m.sleep = 0.0;
+  m.missed = 0;
+  m.frameStart = Now();
+}
+
+void
+FrameScheduler::FrameSubmitting() {
+  const double now = Now();
+  m.work[m.next] = now - m.frameStart;
+  m.next = (m.next + 1) % kWorkSamples;
+  m.count = std::min(m.count + 1, kWorkSamples);
+  m.slack = m.deadline > 0.0 ? m.deadline - now : 0.0;
+}
+
+double
+FrameScheduler::GetDisplayPeriod() const {
+  return m.period;
+}
+
+double
+FrameScheduler::GetSlack() const {
+  return m.slack;
+}
+
+double
+FrameScheduler::GetSleep() const {
+  return m.sleep;
+}
+
+int32_t
+FrameScheduler::GetMissedFrames() const {
+  return m.missed;
+}
+
+FrameScheduler::FrameScheduler(State& aState) : m(aState) {}
+FrameScheduler::~FrameScheduler() {}
+
+} // namespace crow
@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAMESCHEDULER_H
+#define VRBROWSER_FRAMESCHEDULER_H
+
+#include "vrb/MacroUtils.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace crow {
+
+class FrameScheduler;
+typedef std::shared_ptr<FrameScheduler> FrameSchedulerPtr;
+
+// Starts each frame as late as possible while still submitting it in time for the display
+// refresh it is predicted for. Frame submission must happen one display period before the
+// predicted display time, so the frame starts that deadline minus the recent CPU cost of a
+// frame and a safety margin. The margin grows when a refresh is missed and slowly shrinks
+// again while frames are on time. Starting late keeps the head pose prediction short and
+// stops the render thread from running ahead and blocking in the VR API. All times are
+// seconds on the CLOCK_MONOTONIC timeline.
+class FrameScheduler {
+public:
+  static FrameSchedulerPtr Create();
+  static double Now();
+  // Sleeps until the start of the frame shown at aPredictedDisplayTime.
+  void WaitForFrame(const double aPredictedDisplayTime, const double aDisplayPeriod);
+  // Starts the frame immediately, for devices unable to predict their display timing.
+  void StartFrame();
+  // Called right before the frame is handed to the device.
+  void FrameSubmitting();
+  // Zero when the display period is unknown.
+  double GetDisplayPeriod() const;
+  // Of the last frame. Slack is the time left before the submission deadline, negative when late.
+  double GetSlack() const;
+  double GetSleep() const;
+  // Display refreshes skipped since the previous frame.
+  int32_t GetMissedFrames() const;
+protected:
+  struct State;
+  FrameScheduler(State& aState);
+  ~FrameScheduler();
+private:
+  State& m;
+  FrameScheduler() = delete;
+  VRB_NO_DEFAULTS(FrameScheduler)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAMESCHEDULER_H
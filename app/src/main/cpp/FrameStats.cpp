@@ -0,0 +1,263 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameStats.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+static const int32_t kMaxFrames = 256;
+static const int32_t kMarkCount = crow::FrameStats::kPhaseCount - 1;
+static const float kDefaultBudget = 1000.0f / 72.0f;
+static const int32_t kJavaValueCount =
+    (crow::FrameStats::kPhaseCount * crow::FrameStats::kSummaryFieldCount) + crow::FrameStats::kGaugeCount;
+
+uint64_t
+Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000ull) + (uint64_t)now.tv_nsec;
+}
+
+struct FrameRecord {
+  uint64_t start;
+  uint64_t end;
+  // Zero when the phase did not run during the frame.
+  uint64_t marks[kMarkCount];
+  FrameRecord() : start(0), end(0) { Clear(); }
+  void Clear() {
+    start = end = 0;
+    for (int32_t ix = 0; ix < kMarkCount; ix++) {
+      marks[ix] = 0;
+    }
+  }
+  bool Ran(const int32_t aPhase) const {
+    return (aPhase >= kMarkCount) || (marks[aPhase] != 0);
+  }
+  // Only meaningful when Ran(aPhase).
+  float Duration(const int32_t aPhase) const {
+    if (aPhase >= kMarkCount) {
+      return (float)(end - start) / 1000000.0f;
+    }
+    if (marks[aPhase] == 0) {
+      return 0.0f;
+    }
+    uint64_t previous = start;
+    for (int32_t ix = aPhase - 1; ix >= 0; ix--) {
+      if (marks[ix] != 0) {
+        previous = marks[ix];
+        break;
+      }
+    }
+    return (float)(marks[aPhase] - previous) / 1000000.0f;
+  }
+};
+
+float
+Percentile(const std::vector<float>& aSorted, const float aPercentile) {
+  if (aSorted.empty()) {
+    return 0.0f;
+  }
+  size_t rank = (size_t)(aPercentile * (float)aSorted.size() + 0.5f);
+  if (rank > 0) {
+    rank--;
+  }
+  return aSorted[std::min(rank, aSorted.size() - 1)];
+}
+
+} // namespace
+
+namespace crow {
+
+struct FrameStats::State {
+  mutable std::mutex lock;
+  FrameRecord frames[kMaxFrames];
+  int32_t next;
+  int32_t count;
+  float budget;
+  bool inFrame;
+  FrameRecord current;
+  int32_t gauges[kGaugeCount];
+  int32_t lastGauges[kGaugeCount];
+  State() : next(0), count(0), budget(kDefaultBudget), inFrame(false) {
+    memset(gauges, 0, sizeof(gauges));
+    memset(lastGauges, 0, sizeof(lastGauges));
+  }
+
+  // The percentiles of every phase are computed from a single pass under one lock, the
+  // gauges of the last frame are copied under the same lock when requested.
+  int32_t Summarize(Summary aResult[kPhaseCount], int32_t* aGauges = nullptr) const {
+    std::vector<float> durations[kPhaseCount];
+    std::unique_lock<std::mutex> guard(lock);
+    const int32_t recorded = count;
+    if (aGauges) {
+      memcpy(aGauges, lastGauges, sizeof(lastGauges));
+    }
+    for (int32_t frame = 0; frame < count; frame++) {
+      const FrameRecord& record = frames[frame];
+      int32_t slowest = 0;
+      float slowestDuration = -1.0f;
+      for (int32_t phase = 0; phase < kPhaseCount; phase++) {
+        // A phase skipped in this frame, e.g. the culling of a presentation frame, is left
+        // out rather than counted as taking no time.
+        if (!record.Ran(phase)) {
+          continue;
+        }
+        const float duration = record.Duration(phase);
+        durations[phase].push_back(duration);
+        if ((phase < kMarkCount) && (duration > slowestDuration)) {
+          slowest = phase;
+          slowestDuration = duration;
+        }
+      }
+      if (record.Duration(kMarkCount) > budget) {
+        aResult[kMarkCount].overBudget++;
+        aResult[slowest].overBudget++;
+      }
+    }
+    guard.unlock();
+    for (int32_t phase = 0; phase < kPhaseCount; phase++) {
+      std::sort(durations[phase].begin(), durations[phase].end());
+      aResult[phase].p50 = Percentile(durations[phase], 0.50f);
+      aResult[phase].p95 = Percentile(durations[phase], 0.95f);
+      aResult[phase].p99 = Percentile(durations[phase], 0.99f);
+      aResult[phase].frames = (int32_t)durations[phase].size();
+    }
+    return recorded;
+  }
+};
+
+FrameStatsPtr
+FrameStats::Create() {
+  return std::make_shared<vrb::ConcreteClass<FrameStats, FrameStats::State> >();
+}
+
+void
+FrameStats::SetBudget(const float aMilliseconds) {
+  std::lock_guard<std::mutex> guard(m.lock);
+  m.budget = aMilliseconds;
+}
+
+float
+FrameStats::GetBudget() const {
+  std::lock_guard<std::mutex> guard(m.lock);
+  return m.budget;
+}
+
+void
+FrameStats::Reset() {
+  std::lock_guard<std::mutex> guard(m.lock);
+  m.next = 0;
+  m.count = 0;
+}
+
+void
+FrameStats::BeginFrame() {
+  m.current.Clear();
+  m.current.start = Now();
+  memset(m.gauges, 0, sizeof(m.gauges));
+  m.inFrame = true;
+}
+
+void
+FrameStats::Mark(const Phase aPhase) {
+  const int32_t index = static_cast<int32_t>(aPhase);
+  if (!m.inFrame || (index >= kMarkCount)) {
+    return;
+  }
+  m.current.marks[index] = Now();
+}
+
+void
+FrameStats::SetGauge(const Gauge aGauge, const int32_t aValue) {
+  const int32_t index = static_cast<int32_t>(aGauge);
+  if (!m.inFrame || (index < 0) || (index >= kGaugeCount)) {
+    return;
+  }
+  m.gauges[index] = aValue;
+}
+
+void
+FrameStats::EndFrame() {
+  if (!m.inFrame) {
+    return;
+  }
+  m.current.end = Now();
+  m.inFrame = false;
+  std::lock_guard<std::mutex> guard(m.lock);
+  m.frames[m.next] = m.current;
+  memcpy(m.lastGauges, m.gauges, sizeof(m.gauges));
+  m.next = (m.next + 1) % kMaxFrames;
+  if (m.count < kMaxFrames) {
+    m.count++;
+  }
+}
+
+int32_t
+FrameStats::GetFrameCount() const {
+  std::lock_guard<std::mutex> guard(m.lock);
+  return m.count;
+}
+
+bool
+FrameStats::GetSummary(const Phase aPhase, Summary& aSummary) const {
+  Summary summaries[kPhaseCount];
+  const int32_t recorded = m.Summarize(summaries);
+  aSummary = summaries[static_cast<int32_t>(aPhase)];
+  return recorded > 0;
+}
+
+int32_t
+FrameStats::GetSummaries(Summary aSummaries[kPhaseCount]) const {
+  return m.Summarize(aSummaries);
+}
+
+int32_t
+FrameStats::GetGauge(const Gauge aGauge) const {
+  const int32_t index = static_cast<int32_t>(aGauge);
+  if ((index < 0) || (index >= kGaugeCount)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(m.lock);
+  return m.lastGauges[index];
+}
+
+jfloatArray
+FrameStats::GetJavaSummaries(JNIEnv* aEnv) const {
+  if (!aEnv) {
+    return nullptr;
+  }
+  Summary summaries[kPhaseCount];
+  int32_t gauges[kGaugeCount];
+  m.Summarize(summaries, gauges);
+  float values[kJavaValueCount];
+  for (int32_t phase = 0; phase < kPhaseCount; phase++) {
+    float* value = &values[phase * kSummaryFieldCount];
+    value[0] = summaries[phase].p50;
+    value[1] = summaries[phase].p95;
+    value[2] = summaries[phase].p99;
+    value[3] = (float)summaries[phase].overBudget;
+    value[4] = (float)summaries[phase].frames;
+  }
+  for (int32_t gauge = 0; gauge < kGaugeCount; gauge++) {
+    values[(kPhaseCount * kSummaryFieldCount) + gauge] = (float)gauges[gauge];
+  }
+  jfloatArray result = aEnv->NewFloatArray(kJavaValueCount);
+  if (result) {
+    aEnv->SetFloatArrayRegion(result, 0, kJavaValueCount, values);
+  }
+  return result;
+}
+
+FrameStats::FrameStats(State& aState) : m(aState) {}
+FrameStats::~FrameStats() {}
+
+} // namespace crow
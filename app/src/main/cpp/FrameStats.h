@@ -0,0 +1,94 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAMESTATS_H
+#define VRBROWSER_FRAMESTATS_H
+
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class FrameStats;
+typedef std::shared_ptr<FrameStats> FrameStatsPtr;
+
+// Keeps a fixed size ring of per-phase CPU timestamps for the most recent frames.
+// Mark() is called by the render thread at the end of each phase. Phases that are not
+// marked in a frame did not run and are left out of that phase's summary. The gauges hold
+// the scheduling, presentation and memory values of the last frame. The summaries and
+// gauges may be queried from any thread.
+class FrameStats {
+public:
+  // Must be kept in sync with the getFrameStats() layout documented in PlatformActivity.java
+  enum class Phase {
+    ProcessEvents,
+    Update,
+    UpdateControllers,
+    Cull,
+    Copies, // Widget snapshots and tab thumbnails copied on the GPU.
+    StartFrame,
+    DrawLeft,
+    DrawRight,
+    EndFrame,
+    Total // Computed from the start of the frame to the last mark.
+  };
+  static const int32_t kPhaseCount = static_cast<int32_t>(Phase::Total) + 1;
+  static const int32_t kSummaryFieldCount = 5;
+  // Also part of the getFrameStats() layout, zero when not set during the frame.
+  enum class Gauge {
+    FrameSlack, // Microseconds left before the submission deadline, negative when late.
+    FrameSleep, // Microseconds the frame start was delayed to match the display.
+    FramesMissed, // Display refreshes skipped before this frame.
+    PresentationDropped, // Immersive frames posted by the producer and replaced before being shown.
+    PresentationRepeated, // 1 when the producer had no new immersive frame for this frame.
+    PresentationLatency, // Milliseconds from rendering the shown immersive frame to submitting it.
+    WidgetsHibernated, // Widgets drawn from a snapshot after releasing their surface.
+    TextureMegabytes, // Widget surface, snapshot and thumbnail atlas memory.
+    Count
+  };
+  static const int32_t kGaugeCount = static_cast<int32_t>(Gauge::Count);
+
+  struct Summary {
+    float p50; // milliseconds
+    float p95;
+    float p99;
+    // For Phase::Total the number of frames that exceeded the budget, otherwise the
+    // number of over budget frames where this was the most expensive phase.
+    int32_t overBudget;
+    // Frames in which the phase ran, the percentiles only cover those.
+    int32_t frames;
+    Summary() : p50(0.0f), p95(0.0f), p99(0.0f), overBudget(0), frames(0) {}
+  };
+
+  static FrameStatsPtr Create();
+  void SetBudget(const float aMilliseconds);
+  float GetBudget() const;
+  void Reset();
+  void BeginFrame();
+  void Mark(const Phase aPhase);
+  void SetGauge(const Gauge aGauge, const int32_t aValue);
+  void EndFrame();
+  int32_t GetFrameCount() const;
+  bool GetSummary(const Phase aPhase, Summary& aSummary) const;
+  // Fills one summary per phase, returns the number of recorded frames.
+  int32_t GetSummaries(Summary aSummaries[kPhaseCount]) const;
+  // The gauges of the last completed frame.
+  int32_t GetGauge(const Gauge aGauge) const;
+  jfloatArray GetJavaSummaries(JNIEnv* aEnv) const;
+protected:
+  struct State;
+  FrameStats(State& aState);
+  ~FrameStats();
+private:
+  State& m;
+  FrameStats() = delete;
+  VRB_NO_DEFAULTS(FrameStats)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAMESTATS_H
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "GLCounters.h"
+#include "vrb/ConcreteClass.h"
+
+#include <mutex>
+#include <string.h>
+
+namespace {
+
+static const int32_t kJavaCounterCount =
+    (crow::GLCounters::kSectionCount * crow::GLCounters::kCounterCount) + crow::GLCounters::kSceneCount;
+
+// Written by the wrappers through sCurrent on the render thread. Calls made between
+// frames land here too and are discarded by the next BeginFrame().
+thread_local uint32_t sTally[crow::GLCounters::kSectionCount][crow::GLCounters::kCounterCount];
+
+} // namespace
+
+namespace crow {
+
+thread_local uint32_t* GLCounters::sCurrent = nullptr;
+
+void
+GLCounters::Snapshot::Clear() {
+  frame = 0;
+  memset(counters, 0, sizeof(counters));
+  memset(scene, 0, sizeof(scene));
+}
+
+uint32_t
+GLCounters::Snapshot::Total(const Counter aCounter) const {
+  uint32_t result = 0;
+  for (int32_t section = 0; section < kSectionCount; section++) {
+    result += counters[section][static_cast<int32_t>(aCounter)];
+  }
+  return result;
+}
+
+struct GLCounters::State {
+  mutable std::mutex lock;
+  uint64_t frame;
+  int32_t scene[kSceneCount];
+  Snapshot published;
+  State() : frame(0) {
+    memset(scene, 0, sizeof(scene));
+  }
+};
+
+GLCountersPtr
+GLCounters::Create() {
+  return std::make_shared<vrb::ConcreteClass<GLCounters, GLCounters::State> >();
+}
+
+bool
+GLCounters::IsEnabled() {
+#if defined(VRBROWSER_GL_COUNTERS)
+  return true;
+#else
+  return false;
+#endif // defined(VRBROWSER_GL_COUNTERS)
+}
+
+void
+GLCounters::BeginFrame() {
+  memset(sTally, 0, sizeof(sTally));
+  memset(m.scene, 0, sizeof(m.scene));
+  sCurrent = sTally[static_cast<int32_t>(Section::Frame)];
+}
+
+void
+GLCounters::SetSection(const Section aSection) {
+  const int32_t index = static_cast<int32_t>(aSection);
+  // Threads that did not begin the frame keep not counting.
+  if ((index < 0) || (index >= kSectionCount) || !sCurrent) {
+    return;
+  }
+  sCurrent = sTally[index];
+}
+
+void
+GLCounters::SetSceneCount(const Scene aScene, const int32_t aCount) {
+  const int32_t index = static_cast<int32_t>(aScene);
+  if ((index < 0) || (index >= kSceneCount)) {
+    return;
+  }
+  m.scene[index] = aCount;
+}
+
+void
+GLCounters::EndFrame() {
+  m.frame++;
+  std::lock_guard<std::mutex> guard(m.lock);
+  m.published.frame = m.frame;
+  memcpy(m.published.counters, sTally, sizeof(sTally));
+  memcpy(m.published.scene, m.scene, sizeof(m.scene));
+  sCurrent = sTally[static_cast<int32_t>(Section::Frame)];
+}
+
+bool
+GLCounters::GetLastFrame(Snapshot& aSnapshot) const {
+  std::lock_guard<std::mutex> guard(m.lock);
+  aSnapshot = m.published;
+  return m.published.frame > 0;
+}
+
+jintArray
+GLCounters::GetJavaCounters(JNIEnv* aEnv) const {
+  if (!aEnv) {
+    return nullptr;
+  }
+  Snapshot snapshot;
+  GetLastFrame(snapshot);
+  jint values[kJavaCounterCount];
+  jint* value = values;
+  for (int32_t section = 0; section < kSectionCount; section++) {
+    for (int32_t counter = 0; counter < kCounterCount; counter++) {
+      *value++ = (jint)snapshot.counters[section][counter];
+    }
+  }
+  for (int32_t scene = 0; scene < kSceneCount; scene++) {
+    *value++ = snapshot.scene[scene];
+  }
+  jintArray result = aEnv->NewIntArray(kJavaCounterCount);
+  if (result) {
+    aEnv->SetIntArrayRegion(result, 0, kJavaCounterCount, values);
+  }
+  return result;
+}
+
+GLCounters::GLCounters(State& aState) : m(aState) {}
+GLCounters::~GLCounters() {}
+
+} // namespace crow
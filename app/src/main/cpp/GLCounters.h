@@ -0,0 +1,106 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GLCOUNTERS_H
+#define VRBROWSER_GLCOUNTERS_H
+
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+#include <stdint.h>
+
+namespace crow {
+
+class GLCounters;
+typedef std::shared_ptr<GLCounters> GLCountersPtr;
+
+// Tallies the GL commands issued by the render thread per frame and per eye.
+// The GL entry points are wrapped at link time (see app/gl-counters.cmake) so
+// the calls made inside vrb are counted without touching it. When built with
+// -DGL_COUNTERS=OFF the wrappers are not linked and every count stays zero.
+// The tally is thread local: only the thread calling BeginFrame() counts, the
+// calls made on the other threads with a shared context are not counted.
+class GLCounters {
+public:
+  // Must be kept in sync with the getGLCounters() layout documented in PlatformActivity.java
+  enum class Counter {
+    DrawCalls,
+    Triangles,
+    ProgramSwitches,
+    TextureBinds,
+    UniformUploads,
+    BufferBinds,
+    FramebufferBinds,
+    StateChanges,
+    Clears,
+    Uploads, // glBufferData, glTexImage2D and their sub image variants.
+    Count
+  };
+  // Calls made outside of BindEye()/DrawQuadLayers() are attributed to Frame.
+  enum class Section {
+    Frame,
+    LeftEye,
+    RightEye,
+    Count
+  };
+  enum class Scene {
+    Widgets,
+    WidgetsCulled,
+    WidgetsLayered,
+    Controllers,
+    SurfacesLatched, // Widget surfaces with a new frame, the others were not updated.
+    // Drawables the cull put in the draw list, from the draw calls of the left eye pass
+    // since vrb draws each one with a single call. Zero when built with GL_COUNTERS=OFF.
+    DrawablesEmitted,
+    Count
+  };
+  static const int32_t kCounterCount = static_cast<int32_t>(Counter::Count);
+  static const int32_t kSectionCount = static_cast<int32_t>(Section::Count);
+  static const int32_t kSceneCount = static_cast<int32_t>(Scene::Count);
+
+  struct Snapshot {
+    uint64_t frame;
+    uint32_t counters[kSectionCount][kCounterCount];
+    int32_t scene[kSceneCount];
+    Snapshot() { Clear(); }
+    void Clear();
+    uint32_t Total(const Counter aCounter) const;
+  };
+
+  static GLCountersPtr Create();
+  static bool IsEnabled();
+  // Called by the GL wrappers from any thread.
+  static void Add(const Counter aCounter, const uint32_t aAmount = 1) {
+    if (sCurrent) {
+      sCurrent[static_cast<int32_t>(aCounter)] += aAmount;
+    }
+  }
+  // The running count of the current section, zero on the threads that do not count.
+  static uint32_t GetRunningCount(const Counter aCounter) {
+    return sCurrent ? sCurrent[static_cast<int32_t>(aCounter)] : 0;
+  }
+  void BeginFrame();
+  void SetSection(const Section aSection);
+  void SetSceneCount(const Scene aScene, const int32_t aCount);
+  void EndFrame();
+  // The counts of the last completed frame, safe to call from any thread.
+  bool GetLastFrame(Snapshot& aSnapshot) const;
+  jintArray GetJavaCounters(JNIEnv* aEnv) const;
+protected:
+  struct State;
+  GLCounters(State& aState);
+  ~GLCounters();
+private:
+  // Null on the threads that do not count.
+  static thread_local uint32_t* sCurrent;
+  State& m;
+  GLCounters() = delete;
+  VRB_NO_DEFAULTS(GLCounters)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_GLCOUNTERS_H
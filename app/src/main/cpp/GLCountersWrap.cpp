@@ -0,0 +1,143 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Link time wrappers for the GL entry points counted by GLCounters. The linker
+// resolves every reference to glX in native-lib to __wrap_glX, which forwards to
+// the real entry point as __real_glX. Only built with GL_COUNTERS enabled and the
+// function list must match GL_COUNTERS_WRAPPED in app/gl-counters.cmake.
+
+#include "GLCounters.h"
+
+#include <GLES3/gl3.h>
+
+using crow::GLCounters;
+
+namespace {
+
+// Each thread has its own context current, and so its own program.
+thread_local GLuint sProgram = 0;
+
+uint32_t
+Triangles(const GLenum aMode, const GLsizei aCount, const GLsizei aInstances) {
+  if (aCount < 3) {
+    return 0;
+  }
+  uint32_t result = 0;
+  if (aMode == GL_TRIANGLES) {
+    result = (uint32_t)aCount / 3;
+  } else if ((aMode == GL_TRIANGLE_STRIP) || (aMode == GL_TRIANGLE_FAN)) {
+    result = (uint32_t)aCount - 2;
+  }
+  return result * (uint32_t)aInstances;
+}
+
+} // namespace
+
+#define GL_COUNTERS_WRAP(counter, name, params, args) \
+  void __real_##name params; \
+  void __wrap_##name params { \
+    GLCounters::Add(GLCounters::Counter::counter); \
+    __real_##name args; \
+  }
+
+extern "C" {
+
+void __real_glDrawArrays(GLenum, GLint, GLsizei);
+void __wrap_glDrawArrays(GLenum aMode, GLint aFirst, GLsizei aCount) {
+  GLCounters::Add(GLCounters::Counter::DrawCalls);
+  GLCounters::Add(GLCounters::Counter::Triangles, Triangles(aMode, aCount, 1));
+  __real_glDrawArrays(aMode, aFirst, aCount);
+}
+
+void __real_glDrawElements(GLenum, GLsizei, GLenum, const void*);
+void __wrap_glDrawElements(GLenum aMode, GLsizei aCount, GLenum aType, const void* aIndices) {
+  GLCounters::Add(GLCounters::Counter::DrawCalls);
+  GLCounters::Add(GLCounters::Counter::Triangles, Triangles(aMode, aCount, 1));
+  __real_glDrawElements(aMode, aCount, aType, aIndices);
+}
+
+void __real_glDrawArraysInstanced(GLenum, GLint, GLsizei, GLsizei);
+void __wrap_glDrawArraysInstanced(GLenum aMode, GLint aFirst, GLsizei aCount, GLsizei aInstances) {
+  GLCounters::Add(GLCounters::Counter::DrawCalls);
+  GLCounters::Add(GLCounters::Counter::Triangles, Triangles(aMode, aCount, aInstances));
+  __real_glDrawArraysInstanced(aMode, aFirst, aCount, aInstances);
+}
+
+void __real_glDrawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei);
+void __wrap_glDrawElementsInstanced(GLenum aMode, GLsizei aCount, GLenum aType, const void* aIndices,
+                                    GLsizei aInstances) {
+  GLCounters::Add(GLCounters::Counter::DrawCalls);
+  GLCounters::Add(GLCounters::Counter::Triangles, Triangles(aMode, aCount, aInstances));
+  __real_glDrawElementsInstanced(aMode, aCount, aType, aIndices, aInstances);
+}
+
+// Only actual changes of program are counted, vrb rebinds the program for every drawable.
+void __real_glUseProgram(GLuint);
+void __wrap_glUseProgram(GLuint aProgram) {
+  if (aProgram != sProgram) {
+    GLCounters::Add(GLCounters::Counter::ProgramSwitches);
+    sProgram = aProgram;
+  }
+  __real_glUseProgram(aProgram);
+}
+
+void __real_glDeleteProgram(GLuint);
+void __wrap_glDeleteProgram(GLuint aProgram) {
+  // A new program may reuse the name.
+  if (aProgram == sProgram) {
+    sProgram = 0;
+  }
+  __real_glDeleteProgram(aProgram);
+}
+
+GL_COUNTERS_WRAP(TextureBinds, glBindTexture, (GLenum aTarget, GLuint aTexture), (aTarget, aTexture))
+GL_COUNTERS_WRAP(BufferBinds, glBindBuffer, (GLenum aTarget, GLuint aBuffer), (aTarget, aBuffer))
+GL_COUNTERS_WRAP(BufferBinds, glBindVertexArray, (GLuint aArray), (aArray))
+GL_COUNTERS_WRAP(FramebufferBinds, glBindFramebuffer, (GLenum aTarget, GLuint aFramebuffer), (aTarget, aFramebuffer))
+
+GL_COUNTERS_WRAP(UniformUploads, glUniform1i, (GLint aLocation, GLint aV0), (aLocation, aV0))
+GL_COUNTERS_WRAP(UniformUploads, glUniform1f, (GLint aLocation, GLfloat aV0), (aLocation, aV0))
+GL_COUNTERS_WRAP(UniformUploads, glUniform2f, (GLint aLocation, GLfloat aV0, GLfloat aV1), (aLocation, aV0, aV1))
+GL_COUNTERS_WRAP(UniformUploads, glUniform3f, (GLint aLocation, GLfloat aV0, GLfloat aV1, GLfloat aV2),
+                 (aLocation, aV0, aV1, aV2))
+GL_COUNTERS_WRAP(UniformUploads, glUniform4f, (GLint aLocation, GLfloat aV0, GLfloat aV1, GLfloat aV2, GLfloat aV3),
+                 (aLocation, aV0, aV1, aV2, aV3))
+GL_COUNTERS_WRAP(UniformUploads, glUniform1fv, (GLint aLocation, GLsizei aCount, const GLfloat* aValue),
+                 (aLocation, aCount, aValue))
+GL_COUNTERS_WRAP(UniformUploads, glUniform3fv, (GLint aLocation, GLsizei aCount, const GLfloat* aValue),
+                 (aLocation, aCount, aValue))
+GL_COUNTERS_WRAP(UniformUploads, glUniform4fv, (GLint aLocation, GLsizei aCount, const GLfloat* aValue),
+                 (aLocation, aCount, aValue))
+GL_COUNTERS_WRAP(UniformUploads, glUniformMatrix4fv,
+                 (GLint aLocation, GLsizei aCount, GLboolean aTranspose, const GLfloat* aValue),
+                 (aLocation, aCount, aTranspose, aValue))
+
+GL_COUNTERS_WRAP(StateChanges, glEnable, (GLenum aCap), (aCap))
+GL_COUNTERS_WRAP(StateChanges, glDisable, (GLenum aCap), (aCap))
+GL_COUNTERS_WRAP(StateChanges, glBlendFunc, (GLenum aSource, GLenum aDestination), (aSource, aDestination))
+GL_COUNTERS_WRAP(StateChanges, glDepthMask, (GLboolean aFlag), (aFlag))
+GL_COUNTERS_WRAP(StateChanges, glCullFace, (GLenum aMode), (aMode))
+GL_COUNTERS_WRAP(StateChanges, glViewport, (GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight),
+                 (aX, aY, aWidth, aHeight))
+GL_COUNTERS_WRAP(StateChanges, glActiveTexture, (GLenum aTexture), (aTexture))
+
+GL_COUNTERS_WRAP(Clears, glClear, (GLbitfield aMask), (aMask))
+
+GL_COUNTERS_WRAP(Uploads, glBufferData, (GLenum aTarget, GLsizeiptr aSize, const void* aData, GLenum aUsage),
+                 (aTarget, aSize, aData, aUsage))
+GL_COUNTERS_WRAP(Uploads, glBufferSubData, (GLenum aTarget, GLintptr aOffset, GLsizeiptr aSize, const void* aData),
+                 (aTarget, aOffset, aSize, aData))
+GL_COUNTERS_WRAP(Uploads, glTexImage2D,
+                 (GLenum aTarget, GLint aLevel, GLint aInternalFormat, GLsizei aWidth, GLsizei aHeight, GLint aBorder,
+                  GLenum aFormat, GLenum aType, const void* aPixels),
+                 (aTarget, aLevel, aInternalFormat, aWidth, aHeight, aBorder, aFormat, aType, aPixels))
+GL_COUNTERS_WRAP(Uploads, glTexSubImage2D,
+                 (GLenum aTarget, GLint aLevel, GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight,
+                  GLenum aFormat, GLenum aType, const void* aPixels),
+                 (aTarget, aLevel, aX, aY, aWidth, aHeight, aFormat, aType, aPixels))
+
+} // extern "C"
+
+#undef GL_COUNTERS_WRAP
@@ -0,0 +1,396 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "JobSystem.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <shared_mutex>
+#include <stdio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Chunks per worker when ParallelFor() picks the grain.
+static const int32_t kChunksPerWorker = 4;
+// Wait() looks for jobs to help with at least this often.
+static const std::chrono::milliseconds kWaitPoll(1);
+
+int64_t
+GetMaxFrequency(const int32_t aCore) {
+  char path[96];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", aCore);
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    return 0;
+  }
+  long long result = 0;
+  if (fscanf(file, "%lld", &result) != 1) {
+    result = 0;
+  }
+  fclose(file);
+  return (int64_t)result;
+}
+
+std::vector<int32_t>
+GetCores(const crow::JobSystem::Affinity aAffinity) {
+  typedef crow::JobSystem::Affinity Affinity;
+  const int32_t count = std::max((int32_t)sysconf(_SC_NPROCESSORS_CONF), 1);
+  std::vector<int64_t> frequencies;
+  int64_t highest = 0;
+  int64_t lowest = 0;
+  for (int32_t core = 0; core < count; core++) {
+    const int64_t frequency = GetMaxFrequency(core);
+    frequencies.push_back(frequency);
+    highest = std::max(highest, frequency);
+    if ((frequency > 0) && ((lowest == 0) || (frequency < lowest))) {
+      lowest = frequency;
+    }
+  }
+  std::vector<int32_t> result;
+  for (int32_t core = 0; core < count; core++) {
+    const int64_t frequency = frequencies[core];
+    // Cores with an unknown frequency, or all cores when they are the same, match both.
+    const bool uniform = (frequency == 0) || (highest == lowest);
+    if ((aAffinity == Affinity::Any) || uniform ||
+        ((aAffinity == Affinity::Big) && (frequency == highest)) ||
+        ((aAffinity == Affinity::Little) && (frequency < highest))) {
+      result.push_back(core);
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+namespace crow {
+
+struct JobSystem::State {
+  struct Task {
+    Job job;
+    std::shared_ptr<Handle::Group> group;
+  };
+
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  // Held shared while using the workers, exclusively to start or stop them.
+  std::shared_timed_mutex workersLock;
+  std::vector<std::unique_ptr<Worker> > workers;
+  // Set by Start(), the workers are only started by the first job scheduled.
+  std::atomic<int32_t> workerCount;
+  std::vector<int32_t> cores;
+  std::atomic<int32_t> queued;
+  std::atomic<uint32_t> next;
+  std::mutex sleepLock;
+  std::condition_variable sleepCondition;
+  bool stop;
+  State() : workerCount(0), queued(0), next(0), stop(false) {}
+
+  static thread_local State* sOwner;
+  static thread_local int32_t sWorker;
+
+  int32_t CurrentWorker() const {
+    return sOwner == this ? sWorker : -1;
+  }
+
+  // Called with workersLock held shared and workers not empty.
+  void Push(Task&& aTask) {
+    int32_t index = CurrentWorker();
+    if (index < 0) {
+      index = (int32_t)(next.fetch_add(1, std::memory_order_relaxed) % (uint32_t)workers.size());
+    }
+    {
+      Worker& worker = *workers[index];
+      std::lock_guard<std::mutex> guard(worker.lock);
+      worker.tasks.push_back(std::move(aTask));
+    }
+    queued.fetch_add(1);
+    std::lock_guard<std::mutex> guard(sleepLock);
+    sleepCondition.notify_one();
+  }
+
+  // A worker takes its newest job first, stealing is from the oldest end.
+  bool Take(const int32_t aWorker, Task& aTask) {
+    if (queued.load() == 0) {
+      return false;
+    }
+    std::shared_lock<std::shared_timed_mutex> workersGuard(workersLock);
+    if (workers.empty()) {
+      return false;
+    }
+    if (aWorker >= 0) {
+      Worker& worker = *workers[aWorker];
+      std::lock_guard<std::mutex> guard(worker.lock);
+      if (!worker.tasks.empty()) {
+        aTask = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        queued.fetch_sub(1);
+        return true;
+      }
+    }
+    const size_t count = workers.size();
+    const size_t start = aWorker >= 0 ? (size_t)aWorker + 1 : (size_t)next.load(std::memory_order_relaxed);
+    for (size_t ix = 0; ix < count; ix++) {
+      Worker& victim = *workers[(start + ix) % count];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.tasks.empty()) {
+        aTask = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Schedule(Task&& aTask) {
+    do {
+      std::shared_lock<std::shared_timed_mutex> guard(workersLock);
+      if (!workers.empty()) {
+        Push(std::move(aTask));
+        return;
+      }
+    } while (StartWorkers());
+    // Without workers, jobs run on the calling thread.
+    Execute(aTask);
+  }
+
+  // Returns false if the job system is not started.
+  bool StartWorkers() {
+    std::unique_lock<std::shared_timed_mutex> guard(workersLock);
+    if (!workers.empty()) {
+      return true;
+    }
+    const int32_t count = workerCount.load();
+    if (count <= 0) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> sleepGuard(sleepLock);
+      stop = false;
+    }
+    for (int32_t ix = 0; ix < count; ix++) {
+      workers.emplace_back(new Worker);
+    }
+    // The workers wait for the lock to be released before looking for jobs.
+    for (int32_t ix = 0; ix < count; ix++) {
+      workers[ix]->thread = std::thread(&State::RunWorker, this, ix);
+    }
+    VRB_LOG("Job system started with %d workers on %d cores", count, (int)cores.size());
+    return true;
+  }
+
+  void Execute(Task& aTask) {
+    aTask.job();
+    aTask.job = nullptr;
+    Complete(aTask.group);
+  }
+
+  void Complete(const std::shared_ptr<Handle::Group>& aGroup);
+
+  void ApplyAffinity() {
+    if (cores.empty()) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int32_t core: cores) {
+      CPU_SET(core, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      VRB_LOG("Failed to set the affinity of a job worker");
+    }
+  }
+
+  void RunWorker(const int32_t aIndex) {
+    sOwner = this;
+    sWorker = aIndex;
+    char name[16];
+    snprintf(name, sizeof(name), "VRBJob%d", aIndex);
+    pthread_setname_np(pthread_self(), name);
+    ApplyAffinity();
+    while (true) {
+      Task task;
+      if (Take(aIndex, task)) {
+        Execute(task);
+        continue;
+      }
+      std::unique_lock<std::mutex> guard(sleepLock);
+      sleepCondition.wait(guard, [this]() { return stop || (queued.load() > 0); });
+      // Stop() runs the jobs left behind.
+      if (stop) {
+        break;
+      }
+    }
+    sOwner = nullptr;
+    sWorker = -1;
+  }
+};
+
+thread_local JobSystem::State* JobSystem::State::sOwner = nullptr;
+thread_local int32_t JobSystem::State::sWorker = -1;
+
+struct JobSystem::Handle::Group {
+  std::atomic<int32_t> pending;
+  std::mutex lock;
+  std::condition_variable condition;
+  // Guarded by lock.
+  bool done;
+  std::vector<State::Task> continuations;
+  Group(const int32_t aPending) : pending(aPending), done(false) {}
+};
+
+void
+JobSystem::State::Complete(const std::shared_ptr<Handle::Group>& aGroup) {
+  if (aGroup->pending.fetch_sub(1) != 1) {
+    return;
+  }
+  std::vector<Task> continuations;
+  {
+    std::lock_guard<std::mutex> guard(aGroup->lock);
+    aGroup->done = true;
+    continuations.swap(aGroup->continuations);
+  }
+  aGroup->condition.notify_all();
+  for (Task& continuation: continuations) {
+    Schedule(std::move(continuation));
+  }
+}
+
+bool
+JobSystem::Handle::IsDone() const {
+  return !mGroup || (mGroup->pending.load() <= 0);
+}
+
+JobSystemPtr
+JobSystem::Create() {
+  return std::make_shared<vrb::ConcreteClass<JobSystem, JobSystem::State> >();
+}
+
+void
+JobSystem::Start(const int32_t aWorkers, const Affinity aAffinity) {
+  std::unique_lock<std::shared_timed_mutex> guard(m.workersLock);
+  if (m.workerCount.load() > 0) {
+    return;
+  }
+  m.cores = GetCores(aAffinity);
+  m.workerCount = aWorkers > 0 ? aWorkers : std::max((int32_t)m.cores.size() - 1, 1);
+}
+
+void
+JobSystem::Stop() {
+  std::vector<std::unique_ptr<State::Worker> > workers;
+  {
+    // Jobs scheduled from here on run on the calling thread.
+    std::unique_lock<std::shared_timed_mutex> guard(m.workersLock);
+    m.workerCount = 0;
+    workers.swap(m.workers);
+  }
+  if (workers.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(m.sleepLock);
+    m.stop = true;
+  }
+  m.sleepCondition.notify_all();
+  for (std::unique_ptr<State::Worker>& worker: workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  for (std::unique_ptr<State::Worker>& worker: workers) {
+    for (State::Task& task: worker->tasks) {
+      m.queued.fetch_sub(1);
+      m.Execute(task);
+    }
+  }
+}
+
+int32_t
+JobSystem::GetWorkerCount() const {
+  return m.workerCount.load();
+}
+
+JobSystem::Handle
+JobSystem::Run(Job&& aJob) {
+  Handle result;
+  result.mGroup = std::make_shared<Handle::Group>(1);
+  m.Schedule(State::Task{std::move(aJob), result.mGroup});
+  return result;
+}
+
+JobSystem::Handle
+JobSystem::ParallelFor(const int32_t aCount, const int32_t aGrain, RangeJob&& aJob) {
+  Handle result;
+  if (aCount <= 0) {
+    return result;
+  }
+  int32_t grain = aGrain;
+  if (grain <= 0) {
+    grain = std::max(aCount / std::max(GetWorkerCount() * kChunksPerWorker, 1), 1);
+  }
+  const int32_t chunks = (aCount + grain - 1) / grain;
+  result.mGroup = std::make_shared<Handle::Group>(chunks);
+  std::shared_ptr<RangeJob> job = std::make_shared<RangeJob>(std::move(aJob));
+  for (int32_t begin = 0; begin < aCount; begin += grain) {
+    const int32_t end = std::min(begin + grain, aCount);
+    m.Schedule(State::Task{[job, begin, end]() { (*job)(begin, end); }, result.mGroup});
+  }
+  return result;
+}
+
+JobSystem::Handle
+JobSystem::Then(const Handle& aHandle, Job&& aJob) {
+  Handle result;
+  result.mGroup = std::make_shared<Handle::Group>(1);
+  State::Task task{std::move(aJob), result.mGroup};
+  if (aHandle.mGroup) {
+    std::lock_guard<std::mutex> guard(aHandle.mGroup->lock);
+    if (!aHandle.mGroup->done) {
+      aHandle.mGroup->continuations.push_back(std::move(task));
+      return result;
+    }
+  }
+  m.Schedule(std::move(task));
+  return result;
+}
+
+void
+JobSystem::Wait(const Handle& aHandle) {
+  const int32_t worker = m.CurrentWorker();
+  while (!aHandle.IsDone()) {
+    State::Task task;
+    if (m.Take(worker, task)) {
+      m.Execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(aHandle.mGroup->lock);
+    aHandle.mGroup->condition.wait_for(guard, kWaitPoll, [&aHandle]() { return aHandle.mGroup->done; });
+  }
+}
+
+JobSystem::JobSystem(State& aState) : m(aState) {}
+
+JobSystem::~JobSystem() {
+  Stop();
+}
+
+} // namespace crow
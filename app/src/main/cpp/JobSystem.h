@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_JOBSYSTEM_H
+#define VRBROWSER_JOBSYSTEM_H
+
+#include "vrb/MacroUtils.h"
+
+#include <functional>
+#include <memory>
+
+namespace crow {
+
+class JobSystem;
+typedef std::shared_ptr<JobSystem> JobSystemPtr;
+
+// Work stealing thread pool shared by the native subsystems for parallel and background
+// work. Each worker owns a deque: it pushes and pops its own jobs at the back and, once
+// it runs out, steals from the front of the others. Jobs queued from other threads are
+// spread over the workers. A Handle tracks a job, or all the chunks of a ParallelFor(),
+// and continuations added with Then() are queued once it completes. Without workers,
+// jobs run on the calling thread. Jobs must not touch GL, the workers have no context.
+class JobSystem {
+public:
+  // Which cores the workers may run on. On big.LITTLE SoCs the big cores are those with
+  // the highest maximum frequency, elsewhere every core counts as both.
+  enum class Affinity {
+    Any,
+    Big,
+    Little
+  };
+  typedef std::function<void()> Job;
+  typedef std::function<void(const int32_t aBegin, const int32_t aEnd)> RangeJob;
+
+  class Handle {
+  public:
+    Handle() {}
+    // An empty handle is always done.
+    bool IsDone() const;
+  private:
+    struct Group;
+    std::shared_ptr<Group> mGroup;
+    friend class JobSystem;
+  };
+
+  static JobSystemPtr Create();
+  // Zero workers picks one per core of aAffinity, leaving one core for the caller. The
+  // threads are not created until the first job is scheduled.
+  void Start(const int32_t aWorkers, const Affinity aAffinity);
+  // Joins the workers, then runs the jobs they left queued on the calling thread. Safe to
+  // call while other threads schedule jobs, those run on the scheduling thread from then on.
+  void Stop();
+  // Workers the job system runs once started, zero when stopped.
+  int32_t GetWorkerCount() const;
+  Handle Run(Job&& aJob);
+  // Calls aJob over [0, aCount) in chunks of at most aGrain, in parallel.
+  Handle ParallelFor(const int32_t aCount, const int32_t aGrain, RangeJob&& aJob);
+  // Queues aJob once aHandle is done.
+  Handle Then(const Handle& aHandle, Job&& aJob);
+  // Runs queued jobs on the calling thread until aHandle is done.
+  void Wait(const Handle& aHandle);
+protected:
+  struct State;
+  JobSystem(State& aState);
+  ~JobSystem();
+private:
+  State& m;
+  JobSystem() = delete;
+  VRB_NO_DEFAULTS(JobSystem)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_JOBSYSTEM_H
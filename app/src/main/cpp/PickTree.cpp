@@ -0,0 +1,446 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PickTree.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+namespace {
+
+static const float kEpsilon = 0.00000001f;
+// Rebuild once the summed surface area of the refitted boxes has grown this much.
+static const float kRebuildRatio = 2.0f;
+static const int32_t kMaxDepth = 64;
+
+float
+Component(const vrb::Vector& aVector, const int32_t aAxis) {
+  return aAxis == 0 ? aVector.x() : (aAxis == 1 ? aVector.y() : aVector.z());
+}
+
+struct Bounds {
+  float lo[3];
+  float hi[3];
+  Bounds() { Reset(); }
+  void Reset() {
+    for (int32_t axis = 0; axis < 3; axis++) {
+      lo[axis] = FLT_MAX;
+      hi[axis] = -FLT_MAX;
+    }
+  }
+  void Extend(const vrb::Vector& aPoint) {
+    for (int32_t axis = 0; axis < 3; axis++) {
+      lo[axis] = std::min(lo[axis], Component(aPoint, axis));
+      hi[axis] = std::max(hi[axis], Component(aPoint, axis));
+    }
+  }
+  void Extend(const Bounds& aBounds) {
+    for (int32_t axis = 0; axis < 3; axis++) {
+      lo[axis] = std::min(lo[axis], aBounds.lo[axis]);
+      hi[axis] = std::max(hi[axis], aBounds.hi[axis]);
+    }
+  }
+  float Center(const int32_t aAxis) const {
+    return (lo[aAxis] + hi[aAxis]) * 0.5f;
+  }
+  float Area() const {
+    const float x = hi[0] - lo[0];
+    const float y = hi[1] - lo[1];
+    const float z = hi[2] - lo[2];
+    return 2.0f * ((x * y) + (y * z) + (z * x));
+  }
+  // Slab test, aNear is the entry distance when the ray starts outside.
+  bool Intersects(const float aOrigin[3], const float aInverse[3], const float aMaxDistance, float& aNear) const {
+    float tMin = 0.0f;
+    float tMax = aMaxDistance;
+    for (int32_t axis = 0; axis < 3; axis++) {
+      float t0 = (lo[axis] - aOrigin[axis]) * aInverse[axis];
+      float t1 = (hi[axis] - aOrigin[axis]) * aInverse[axis];
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      tMin = std::max(tMin, t0);
+      tMax = std::min(tMax, t1);
+      if (tMin > tMax) {
+        return false;
+      }
+    }
+    aNear = tMin;
+    return true;
+  }
+};
+
+enum class Kind { Mesh, Box };
+
+struct Item {
+  Kind kind;
+  bool used;
+  bool enabled;
+  bool dirty;
+  int32_t leaf;
+  vrb::Matrix transform;
+  vrb::Matrix inverse;
+  std::vector<vrb::Vector> vertices;
+  std::vector<int32_t> triangles;
+  Bounds local;
+  Bounds world;
+  Item() : kind(Kind::Box), used(false), enabled(true), dirty(false), leaf(-1),
+           transform(vrb::Matrix::Identity()), inverse(vrb::Matrix::Identity()) {}
+
+  void UpdateWorldBounds() {
+    world.Reset();
+    for (int32_t corner = 0; corner < 8; corner++) {
+      const vrb::Vector point((corner & 1) ? local.hi[0] : local.lo[0],
+                              (corner & 2) ? local.hi[1] : local.lo[1],
+                              (corner & 4) ? local.hi[2] : local.lo[2]);
+      world.Extend(transform.MultiplyPosition(point));
+    }
+  }
+
+  // aStart and aDirection are in local space. The direction is not renormalized so
+  // the returned distance stays in world units.
+  bool Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection, float& aDistance) const {
+    if (kind == Kind::Box) {
+      float origin[3];
+      float inverseDirection[3];
+      for (int32_t axis = 0; axis < 3; axis++) {
+        origin[axis] = Component(aStart, axis);
+        inverseDirection[axis] = 1.0f / Component(aDirection, axis);
+      }
+      return local.Intersects(origin, inverseDirection, FLT_MAX, aDistance);
+    }
+    // Möller-Trumbore, both faces.
+    bool hit = false;
+    for (size_t ix = 0; (ix + 2) < triangles.size(); ix += 3) {
+      const vrb::Vector& a = vertices[triangles[ix]];
+      const vrb::Vector edge1 = vertices[triangles[ix + 1]] - a;
+      const vrb::Vector edge2 = vertices[triangles[ix + 2]] - a;
+      const vrb::Vector p = aDirection.Cross(edge2);
+      const float determinant = edge1.Dot(p);
+      if ((determinant < kEpsilon) && (determinant > -kEpsilon)) {
+        continue;
+      }
+      const float inverseDeterminant = 1.0f / determinant;
+      const vrb::Vector s = aStart - a;
+      const float u = s.Dot(p) * inverseDeterminant;
+      if ((u < 0.0f) || (u > 1.0f)) {
+        continue;
+      }
+      const vrb::Vector q = s.Cross(edge1);
+      const float v = aDirection.Dot(q) * inverseDeterminant;
+      if ((v < 0.0f) || ((u + v) > 1.0f)) {
+        continue;
+      }
+      const float t = edge2.Dot(q) * inverseDeterminant;
+      if ((t >= 0.0f) && (!hit || (t < aDistance))) {
+        aDistance = t;
+        hit = true;
+      }
+    }
+    return hit;
+  }
+};
+
+// Leaves hold exactly one item, so n items use 2n - 1 nodes.
+struct Node {
+  Bounds bounds;
+  int32_t parent;
+  int32_t left;
+  int32_t right;
+  int32_t item;
+  Node() : parent(-1), left(-1), right(-1), item(-1) {}
+  bool IsLeaf() const { return item >= 0; }
+};
+
+} // namespace
+
+namespace crow {
+
+struct PickTree::State {
+  std::vector<Item> items;
+  std::vector<int32_t> freeItems;
+  std::vector<Node> nodes;
+  std::vector<int32_t> dirtyItems;
+  std::vector<int32_t> buildItems;
+  int32_t root;
+  int32_t itemCount;
+  bool needsBuild;
+  float builtArea;
+  float area;
+  State() : root(-1), itemCount(0), needsBuild(true), builtArea(0.0f), area(0.0f) {}
+
+  bool IsValidItem(const int32_t aItem) const {
+    return (aItem >= 0) && (aItem < items.size()) && items[aItem].used;
+  }
+
+  int32_t AllocateItem(const Kind aKind) {
+    int32_t index = -1;
+    if (!freeItems.empty()) {
+      index = freeItems.back();
+      freeItems.pop_back();
+    } else {
+      index = (int32_t)items.size();
+      items.emplace_back();
+    }
+    Item& item = items[index];
+    item = Item();
+    item.kind = aKind;
+    item.used = true;
+    item.UpdateWorldBounds();
+    itemCount++;
+    needsBuild = true;
+    return index;
+  }
+
+  void MarkDirty(const int32_t aItem) {
+    Item& item = items[aItem];
+    if (!item.dirty) {
+      item.dirty = true;
+      dirtyItems.push_back(aItem);
+    }
+  }
+
+  int32_t Build(const int32_t aBegin, const int32_t aEnd, const int32_t aParent) {
+    const int32_t index = (int32_t)nodes.size();
+    nodes.emplace_back();
+    nodes[index].parent = aParent;
+    if ((aEnd - aBegin) == 1) {
+      const int32_t itemIndex = buildItems[aBegin];
+      nodes[index].item = itemIndex;
+      nodes[index].bounds = items[itemIndex].world;
+      items[itemIndex].leaf = index;
+      area += nodes[index].bounds.Area();
+      return index;
+    }
+    // Median split along the widest axis of the item centers.
+    Bounds centers;
+    for (int32_t ix = aBegin; ix < aEnd; ix++) {
+      const Bounds& world = items[buildItems[ix]].world;
+      centers.Extend(vrb::Vector(world.Center(0), world.Center(1), world.Center(2)));
+    }
+    int32_t axis = 0;
+    for (int32_t candidate = 1; candidate < 3; candidate++) {
+      if ((centers.hi[candidate] - centers.lo[candidate]) > (centers.hi[axis] - centers.lo[axis])) {
+        axis = candidate;
+      }
+    }
+    const int32_t middle = aBegin + ((aEnd - aBegin) / 2);
+    std::nth_element(buildItems.begin() + aBegin, buildItems.begin() + middle, buildItems.begin() + aEnd,
+                     [this, axis](const int32_t aLeft, const int32_t aRight) {
+      return items[aLeft].world.Center(axis) < items[aRight].world.Center(axis);
+    });
+    // Children are built before the references into nodes are taken, it may reallocate.
+    const int32_t left = Build(aBegin, middle, index);
+    const int32_t right = Build(middle, aEnd, index);
+    Node& node = nodes[index];
+    node.left = left;
+    node.right = right;
+    node.bounds = nodes[left].bounds;
+    node.bounds.Extend(nodes[right].bounds);
+    area += node.bounds.Area();
+    return index;
+  }
+
+  void Rebuild() {
+    nodes.clear();
+    buildItems.clear();
+    area = 0.0f;
+    for (int32_t ix = 0; ix < items.size(); ix++) {
+      if (items[ix].used) {
+        buildItems.push_back(ix);
+      }
+    }
+    nodes.reserve(buildItems.empty() ? 0 : (buildItems.size() * 2) - 1);
+    root = buildItems.empty() ? -1 : Build(0, (int32_t)buildItems.size(), -1);
+    builtArea = area;
+    needsBuild = false;
+  }
+
+  void Refit(const int32_t aItem) {
+    int32_t index = items[aItem].leaf;
+    if (index < 0) {
+      return;
+    }
+    area -= nodes[index].bounds.Area();
+    nodes[index].bounds = items[aItem].world;
+    area += nodes[index].bounds.Area();
+    index = nodes[index].parent;
+    while (index >= 0) {
+      Node& node = nodes[index];
+      area -= node.bounds.Area();
+      node.bounds = nodes[node.left].bounds;
+      node.bounds.Extend(nodes[node.right].bounds);
+      area += node.bounds.Area();
+      index = node.parent;
+    }
+  }
+};
+
+PickTreePtr
+PickTree::Create() {
+  return std::make_shared<vrb::ConcreteClass<PickTree, PickTree::State> >();
+}
+
+int32_t
+PickTree::AddMesh(const std::vector<vrb::Vector>& aVertices, const std::vector<int32_t>& aTriangles) {
+  for (const int32_t index: aTriangles) {
+    if ((index < 0) || (index >= aVertices.size())) {
+      VRB_LOG("PickTree mesh index %d is out of range", index);
+      return -1;
+    }
+  }
+  const int32_t result = m.AllocateItem(Kind::Mesh);
+  Item& item = m.items[result];
+  item.vertices = aVertices;
+  item.triangles = aTriangles;
+  for (const vrb::Vector& vertex: aVertices) {
+    item.local.Extend(vertex);
+  }
+  item.UpdateWorldBounds();
+  return result;
+}
+
+int32_t
+PickTree::AddBox(const vrb::Vector& aMin, const vrb::Vector& aMax) {
+  const int32_t result = m.AllocateItem(Kind::Box);
+  Item& item = m.items[result];
+  item.local.Extend(aMin);
+  item.local.Extend(aMax);
+  item.UpdateWorldBounds();
+  return result;
+}
+
+void
+PickTree::RemoveItem(const int32_t aItem) {
+  if (!m.IsValidItem(aItem)) {
+    return;
+  }
+  m.items[aItem] = Item();
+  m.freeItems.push_back(aItem);
+  m.itemCount--;
+  m.needsBuild = true;
+}
+
+void
+PickTree::SetTransform(const int32_t aItem, const vrb::Matrix& aTransform) {
+  if (!m.IsValidItem(aItem)) {
+    return;
+  }
+  Item& item = m.items[aItem];
+  if (memcmp(item.transform.Data(), aTransform.Data(), sizeof(float) * 16) == 0) {
+    return;
+  }
+  item.transform = aTransform;
+  item.inverse = aTransform.AfineInverse();
+  m.MarkDirty(aItem);
+}
+
+void
+PickTree::SetEnabled(const int32_t aItem, const bool aEnabled) {
+  if (m.IsValidItem(aItem)) {
+    m.items[aItem].enabled = aEnabled;
+  }
+}
+
+int32_t
+PickTree::GetItemCount() const {
+  return m.itemCount;
+}
+
+void
+PickTree::Update() {
+  for (const int32_t index: m.dirtyItems) {
+    Item& item = m.items[index];
+    if (item.used) {
+      item.UpdateWorldBounds();
+      if (!m.needsBuild) {
+        m.Refit(index);
+      }
+    }
+    item.dirty = false;
+  }
+  m.dirtyItems.clear();
+  if (!m.needsBuild && (m.area > (m.builtArea * kRebuildRatio))) {
+    m.needsBuild = true;
+  }
+  if (m.needsBuild) {
+    m.Rebuild();
+  }
+}
+
+bool
+PickTree::PickNearest(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                      const int32_t aIgnore, Hit& aHit) const {
+  if (m.root < 0) {
+    return false;
+  }
+  if (m.needsBuild || !m.dirtyItems.empty()) {
+    VRB_LOG("PickTree::PickNearest called with pending changes, call Update() first");
+  }
+  float origin[3];
+  float inverse[3];
+  for (int32_t axis = 0; axis < 3; axis++) {
+    origin[axis] = Component(aStart, axis);
+    inverse[axis] = 1.0f / Component(aDirection, axis);
+  }
+  float nearest = aMaxDistance;
+  int32_t hitItem = -1;
+  int32_t stack[kMaxDepth];
+  int32_t depth = 0;
+  float entry = 0.0f;
+  if (m.nodes[m.root].bounds.Intersects(origin, inverse, nearest, entry)) {
+    stack[depth++] = m.root;
+  }
+  while (depth > 0) {
+    const Node& node = m.nodes[stack[--depth]];
+    if (node.IsLeaf()) {
+      const Item& item = m.items[node.item];
+      if (!item.enabled || (node.item == aIgnore)) {
+        continue;
+      }
+      float distance = 0.0f;
+      if (item.Intersect(item.inverse.MultiplyPosition(aStart), item.inverse.MultiplyDirection(aDirection), distance) &&
+          (distance < nearest)) {
+        nearest = distance;
+        hitItem = node.item;
+      }
+      continue;
+    }
+    // Boxes are rechecked against the nearest hit so far, and the closer child is visited first.
+    float leftEntry = 0.0f, rightEntry = 0.0f;
+    const bool left = m.nodes[node.left].bounds.Intersects(origin, inverse, nearest, leftEntry);
+    const bool right = m.nodes[node.right].bounds.Intersects(origin, inverse, nearest, rightEntry);
+    if ((depth + 2) > kMaxDepth) {
+      VRB_LOG("PickTree exceeded the maximum depth");
+      break;
+    }
+    if (left && right) {
+      const bool leftFirst = leftEntry <= rightEntry;
+      stack[depth++] = leftFirst ? node.right : node.left;
+      stack[depth++] = leftFirst ? node.left : node.right;
+    } else if (left) {
+      stack[depth++] = node.left;
+    } else if (right) {
+      stack[depth++] = node.right;
+    }
+  }
+  if (hitItem < 0) {
+    return false;
+  }
+  aHit.item = hitItem;
+  aHit.distance = nearest;
+  aHit.point = aStart + (aDirection * nearest);
+  return true;
+}
+
+PickTree::PickTree(State& aState) : m(aState) {}
+PickTree::~PickTree() {}
+
+} // namespace crow
@@ -0,0 +1,61 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_PICKTREE_H
+#define VRBROWSER_PICKTREE_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "vrb/Vector.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class PickTree;
+typedef std::shared_ptr<PickTree> PickTreePtr;
+
+// Bounding volume hierarchy over the pickable parts of the scene, answering nearest hit
+// queries along a controller ray. Items are boxes or triangle meshes given in local
+// space and placed in the world with SetTransform(). Moving an item only refits
+// the boxes on its path to the root, the tree is rebuilt when items are added or
+// removed, or once refitting has loosened it too much.
+class PickTree {
+public:
+  struct Hit {
+    int32_t item;
+    float distance; // World units along the ray.
+    vrb::Vector point; // World space.
+    Hit() : item(-1), distance(0.0f) {}
+  };
+
+  static PickTreePtr Create();
+  // Triangles are index triples into aVertices and are hit from both sides.
+  int32_t AddMesh(const std::vector<vrb::Vector>& aVertices, const std::vector<int32_t>& aTriangles);
+  int32_t AddBox(const vrb::Vector& aMin, const vrb::Vector& aMax);
+  void RemoveItem(const int32_t aItem);
+  // Does nothing when the transform is unchanged, so it is cheap to call every frame.
+  void SetTransform(const int32_t aItem, const vrb::Matrix& aTransform);
+  void SetEnabled(const int32_t aItem, const bool aEnabled);
+  int32_t GetItemCount() const;
+  // Applies pending transform changes. Called once per frame before picking.
+  void Update();
+  // aDirection must be normalized. aIgnore is skipped, e.g. the controller casting the ray.
+  bool PickNearest(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                   const int32_t aIgnore, Hit& aHit) const;
+protected:
+  struct State;
+  PickTree(State& aState);
+  ~PickTree();
+private:
+  State& m;
+  PickTree() = delete;
+  VRB_NO_DEFAULTS(PickTree)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_PICKTREE_H
@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PoseMirror.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <time.h>
+
+namespace {
+
+static const char* kSetPoseMirrorName = "setPoseMirror";
+static const char* kSetPoseMirrorSignature = "(Ljava/nio/ByteBuffer;)V";
+
+static const int32_t kSequenceOffset = 0;
+static const int32_t kCountOffset = 4;
+static const int32_t kTimestampOffset = 8;
+
+static const float kDefaultAngle = 0.25f * (float)M_PI / 180.0f;
+static const float kDefaultDistance = 0.001f;
+
+static const size_t kBufferSize = crow::PoseMirror::kHeaderSize +
+    (crow::PoseMirror::kMaxPoses * crow::PoseMirror::kPoseSize);
+
+int64_t
+Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)now.tv_sec * 1000000000ll) + (int64_t)now.tv_nsec;
+}
+
+struct Pose {
+  float values[7]; // quaternion x, y, z, w, position x, y, z
+  int32_t valid;
+  Pose() : valid(0) { memset(values, 0, sizeof(values)); }
+};
+
+static_assert(sizeof(Pose) == crow::PoseMirror::kPoseSize, "Pose must match the Java layout");
+
+} // namespace
+
+namespace crow {
+
+struct PoseMirror::State {
+  // int64_t storage keeps the timestamp aligned.
+  int64_t storage[(kBufferSize + sizeof(int64_t) - 1) / sizeof(int64_t)];
+  uint8_t* buffer;
+  Pose staged[kMaxPoses];
+  Pose published[kMaxPoses];
+  int32_t count;
+  uint32_t sequence;
+  float minCosHalfAngle;
+  float distanceSquared;
+  bool initialized;
+  bool forcePublish;
+
+  State()
+      : count(0)
+      , sequence(0)
+      , initialized(false)
+      , forcePublish(true)
+  {
+    buffer = reinterpret_cast<uint8_t*>(storage);
+    memset(storage, 0, sizeof(storage));
+    SetThresholds(kDefaultAngle, kDefaultDistance);
+  }
+
+  void SetThresholds(const float aAngle, const float aDistance) {
+    minCosHalfAngle = cosf(aAngle * 0.5f);
+    distanceSquared = aDistance * aDistance;
+  }
+
+  bool HasMoved(const Pose& aCurrent, const Pose& aPrevious) const {
+    if (aCurrent.valid != aPrevious.valid) {
+      return true;
+    }
+    const float* c = aCurrent.values;
+    const float* p = aPrevious.values;
+    const float dot = fabsf((c[0] * p[0]) + (c[1] * p[1]) + (c[2] * p[2]) + (c[3] * p[3]));
+    if (dot < minCosHalfAngle) {
+      return true;
+    }
+    const float dx = c[4] - p[4];
+    const float dy = c[5] - p[5];
+    const float dz = c[6] - p[6];
+    return ((dx * dx) + (dy * dy) + (dz * dz)) > distanceSquared;
+  }
+
+  uint32_t* Sequence() {
+    return reinterpret_cast<uint32_t*>(buffer + kSequenceOffset);
+  }
+
+  void Write() {
+    // Sequence lock writer: odd sequence, release fence, payload, even sequence.
+    sequence++;
+    __atomic_store_n(Sequence(), sequence, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+    *reinterpret_cast<int32_t*>(buffer + kCountOffset) = count;
+    *reinterpret_cast<int64_t*>(buffer + kTimestampOffset) = Now();
+    memcpy(buffer + kHeaderSize, staged, sizeof(Pose) * kMaxPoses);
+    sequence++;
+    __atomic_store_n(Sequence(), sequence, __ATOMIC_RELEASE);
+    memcpy(published, staged, sizeof(published));
+  }
+};
+
+PoseMirrorPtr
+PoseMirror::Create() {
+  return std::make_shared<vrb::ConcreteClass<PoseMirror, PoseMirror::State> >();
+}
+
+void
+PoseMirror::SetThresholds(const float aAngle, const float aDistance) {
+  m.SetThresholds(aAngle, aDistance);
+}
+
+void
+PoseMirror::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
+  m.initialized = false;
+  if (!aEnv || !aActivity) {
+    return;
+  }
+  jclass clazz = aEnv->GetObjectClass(aActivity);
+  if (!clazz) {
+    return;
+  }
+  jmethodID setPoseMirror = aEnv->GetMethodID(clazz, kSetPoseMirrorName, kSetPoseMirrorSignature);
+  if (!setPoseMirror) {
+    VRB_LOG("Failed to find Java method: %s %s", kSetPoseMirrorName, kSetPoseMirrorSignature);
+    return;
+  }
+  jobject byteBuffer = aEnv->NewDirectByteBuffer(m.buffer, kBufferSize);
+  if (!byteBuffer) {
+    VRB_LOG("Failed to create PoseMirror ByteBuffer");
+    return;
+  }
+  aEnv->CallVoidMethod(aActivity, setPoseMirror, byteBuffer);
+  aEnv->DeleteLocalRef(byteBuffer);
+  m.initialized = true;
+  m.forcePublish = true;
+}
+
+void
+PoseMirror::ShutdownJava() {
+  m.initialized = false;
+}
+
+void
+PoseMirror::SetPose(const int32_t aIndex, const vrb::Matrix& aTransform) {
+  if ((aIndex < 0) || (aIndex >= kMaxPoses)) {
+    return;
+  }
+  const vrb::Quaternion q(aTransform);
+  const vrb::Vector p = aTransform.GetTranslation();
+  Pose& pose = m.staged[aIndex];
+  pose.values[0] = q.x();
+  pose.values[1] = q.y();
+  pose.values[2] = q.z();
+  pose.values[3] = q.w();
+  pose.values[4] = p.x();
+  pose.values[5] = p.y();
+  pose.values[6] = p.z();
+  pose.valid = 1;
+  if (aIndex >= m.count) {
+    m.count = aIndex + 1;
+  }
+}
+
+void
+PoseMirror::ClearPose(const int32_t aIndex) {
+  if ((aIndex < 0) || (aIndex >= kMaxPoses)) {
+    return;
+  }
+  m.staged[aIndex] = Pose();
+}
+
+bool
+PoseMirror::Publish() {
+  if (!m.initialized) {
+    return false;
+  }
+  bool moved = m.forcePublish;
+  for (int32_t ix = 0; !moved && (ix < m.count); ix++) {
+    moved = m.HasMoved(m.staged[ix], m.published[ix]);
+  }
+  if (!moved) {
+    return false;
+  }
+  m.Write();
+  m.forcePublish = false;
+  return true;
+}
+
+PoseMirror::PoseMirror(State& aState) : m(aState) {}
+PoseMirror::~PoseMirror() {}
+
+} // namespace crow
@@ -0,0 +1,56 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_POSEMIRROR_H
+#define VRBROWSER_POSEMIRROR_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class PoseMirror;
+typedef std::shared_ptr<PoseMirror> PoseMirrorPtr;
+
+// Publishes the most recent head and controller poses into a direct ByteBuffer that Java
+// polls without any JNI calls. Writes are guarded by a sequence lock: the sequence is odd
+// while a write is in progress and readers retry when it changes under them.
+//
+// Layout (native byte order), must be kept in sync with PoseMirror.java:
+//   header: int32 sequence, int32 pose count, int64 timestamp (CLOCK_MONOTONIC ns)
+//   pose:   float quaternion x, y, z, w, float position x, y, z, int32 valid
+class PoseMirror {
+public:
+  static const int32_t kHeadIndex = 0;
+  static const int32_t kMaxPoses = 4; // Head and up to three controllers.
+  static const int32_t kHeaderSize = 16;
+  static const int32_t kPoseSize = 32;
+
+  static PoseMirrorPtr Create();
+  // Poses are only republished once one of them has rotated more than aAngle radians
+  // or moved further than aDistance since the last publish.
+  void SetThresholds(const float aAngle, const float aDistance);
+  void InitializeJava(JNIEnv* aEnv, jobject aActivity);
+  void ShutdownJava();
+  void SetPose(const int32_t aIndex, const vrb::Matrix& aTransform);
+  void ClearPose(const int32_t aIndex);
+  // Returns true if the mirror was updated.
+  bool Publish();
+protected:
+  struct State;
+  PoseMirror(State& aState);
+  ~PoseMirror();
+private:
+  State& m;
+  PoseMirror() = delete;
+  VRB_NO_DEFAULTS(PoseMirror)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_POSEMIRROR_H
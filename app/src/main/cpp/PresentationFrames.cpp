@@ -0,0 +1,294 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PresentationFrames.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+static const char* kSetPresentationFramesName = "setPresentationFrames";
+static const char* kSetPresentationFramesSignature = "(Ljava/nio/ByteBuffer;)V";
+static const char* kSurfaceTextureClass = "android/graphics/SurfaceTexture";
+static const char* kUpdateTexImageName = "updateTexImage";
+static const char* kUpdateTexImageSignature = "()V";
+
+static const int32_t kCountOffset = 0;
+static const int32_t kAttachedOffset = 4;
+static const int32_t kFrameOffset = 0;
+static const int32_t kTimestampOffset = 8;
+static const int32_t kPoseOffset = 16;
+static const int32_t kPoseValueCount = 7;
+
+// A SurfaceTexture BufferQueue holds at most three frames, anything past that in one
+// display frame means the counts are out of step and only the newest frame matters.
+static const uint32_t kMaxLatches = 3;
+// Latency samples kept for the percentiles, about three seconds.
+static const size_t kLatencySamples = 256;
+static const double kNanosecondsPerMillisecond = 1000000.0;
+
+static const size_t kBufferSize = crow::PresentationFrames::kHeaderSize +
+                                  (crow::PresentationFrames::kFrameSlots * crow::PresentationFrames::kSlotSize);
+
+int64_t
+Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)now.tv_sec * 1000000000LL) + (int64_t)now.tv_nsec;
+}
+
+} // namespace
+
+namespace crow {
+
+struct PresentationFrames::State {
+  int64_t buffer[kBufferSize / sizeof(int64_t)];
+  JNIEnv* env;
+  jmethodID updateTexImageMethod;
+  jobject texture;
+  // Frames go to the compositor without a SurfaceTexture.
+  bool direct;
+  uint32_t latched;
+  bool hasFrame;
+  bool changed;
+  // Metadata of the latched frame, valid when poseValid.
+  bool poseValid;
+  int64_t timestamp;
+  float pose[kPoseValueCount];
+  Stats stats;
+  std::vector<float> latencies;
+  size_t nextLatency;
+  int32_t lastDropped;
+  int32_t lastLatency;
+
+  State()
+      : env(nullptr)
+      , updateTexImageMethod(nullptr)
+      , texture(nullptr)
+      , direct(false)
+      , latched(0)
+      , hasFrame(false)
+      , changed(false)
+      , poseValid(false)
+      , timestamp(0)
+      , nextLatency(0)
+      , lastDropped(0)
+      , lastLatency(0)
+  {
+    memset(buffer, 0, sizeof(buffer));
+    memset(pose, 0, sizeof(pose));
+  }
+
+  const uint8_t* Bytes() const {
+    return reinterpret_cast<const uint8_t*>(buffer);
+  }
+
+  uint32_t Load(const size_t aOffset) const {
+    return __atomic_load_n(reinterpret_cast<const uint32_t*>(Bytes() + aOffset), __ATOMIC_ACQUIRE);
+  }
+
+  // Copies the metadata of aFrame if the producer has not reused its slot yet.
+  bool ReadSlot(const uint32_t aFrame) {
+    const size_t slot = kHeaderSize + ((aFrame % kFrameSlots) * kSlotSize);
+    if (Load(slot + kFrameOffset) != aFrame) {
+      return false;
+    }
+    memcpy(&timestamp, Bytes() + slot + kTimestampOffset, sizeof(timestamp));
+    memcpy(pose, Bytes() + slot + kPoseOffset, sizeof(pose));
+    // The slot was rewritten while being copied.
+    return Load(slot + kFrameOffset) == aFrame;
+  }
+
+  void ReleaseTexture() {
+    if (texture && env) {
+      env->DeleteGlobalRef(texture);
+    }
+    texture = nullptr;
+    direct = false;
+    latched = 0;
+    hasFrame = false;
+    changed = false;
+    poseValid = false;
+  }
+};
+
+PresentationFramesPtr
+PresentationFrames::Create() {
+  return std::make_shared<vrb::ConcreteClass<PresentationFrames, PresentationFrames::State> >();
+}
+
+void
+PresentationFrames::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
+  memset(m.buffer, 0, sizeof(m.buffer));
+  m.env = aEnv;
+  if (!m.env || !aActivity) {
+    return;
+  }
+  jclass surfaceTextureClass = m.env->FindClass(kSurfaceTextureClass);
+  if (surfaceTextureClass) {
+    m.updateTexImageMethod = m.env->GetMethodID(surfaceTextureClass, kUpdateTexImageName, kUpdateTexImageSignature);
+    m.env->DeleteLocalRef(surfaceTextureClass);
+  }
+  if (!m.updateTexImageMethod) {
+    VRB_LOG("Failed to find Java method: %s %s", kUpdateTexImageName, kUpdateTexImageSignature);
+    return;
+  }
+  jclass clazz = m.env->GetObjectClass(aActivity);
+  if (!clazz) {
+    return;
+  }
+  jmethodID setFrames = m.env->GetMethodID(clazz, kSetPresentationFramesName, kSetPresentationFramesSignature);
+  if (!setFrames) {
+    VRB_LOG("Failed to find Java method: %s %s", kSetPresentationFramesName, kSetPresentationFramesSignature);
+    return;
+  }
+  jobject byteBuffer = m.env->NewDirectByteBuffer(m.buffer, kBufferSize);
+  if (!byteBuffer) {
+    VRB_LOG("Failed to create PresentationFrames ByteBuffer");
+    return;
+  }
+  m.env->CallVoidMethod(aActivity, setFrames, byteBuffer);
+  m.env->DeleteLocalRef(byteBuffer);
+}
+
+void
+PresentationFrames::ShutdownJava() {
+  m.ReleaseTexture();
+  m.env = nullptr;
+  m.updateTexImageMethod = nullptr;
+}
+
+void
+PresentationFrames::SetSurfaceTexture(jobject aSurfaceTexture) {
+  m.ReleaseTexture();
+  if (aSurfaceTexture && m.env) {
+    m.texture = m.env->NewGlobalRef(aSurfaceTexture);
+  }
+}
+
+void
+PresentationFrames::SetDirect() {
+  m.ReleaseTexture();
+  m.direct = true;
+}
+
+bool
+PresentationFrames::IsAttached() const {
+  return m.Load(kAttachedOffset) != 0;
+}
+
+bool
+PresentationFrames::Update() {
+  m.changed = false;
+  m.lastDropped = 0;
+  // Java resets the count when a producer attaches, until then it may be the previous one's.
+  const bool latching = m.updateTexImageMethod && m.texture;
+  if (!m.env || !(latching || m.direct) || !IsAttached()) {
+    return false;
+  }
+  const uint32_t count = m.Load(kCountOffset);
+  if (count == m.latched) {
+    if (m.hasFrame) {
+      m.stats.repeated++;
+    }
+    return false;
+  }
+  const uint32_t pending = count - m.latched;
+  // The compositor picks up the newest frame on its own.
+  const uint32_t latches = m.direct ? 0 : std::min(pending, kMaxLatches);
+  for (uint32_t latch = 0; latch < latches; latch++) {
+    m.env->CallVoidMethod(m.texture, m.updateTexImageMethod);
+    if (m.env->ExceptionCheck()) {
+      // Thrown when the texture is not attached to the current context, e.g. during a GL restart.
+      m.env->ExceptionClear();
+      VRB_LOG("PresentationFrames failed to update the surface");
+      return false;
+    }
+  }
+  m.lastDropped = (int32_t)(pending - 1);
+  m.stats.dropped += m.lastDropped;
+  m.stats.presented++;
+  m.latched = count;
+  m.hasFrame = true;
+  m.changed = true;
+  m.poseValid = m.ReadSlot(count);
+  return true;
+}
+
+bool
+PresentationFrames::HasFrame() const {
+  return m.hasFrame;
+}
+
+bool
+PresentationFrames::IsChanged() const {
+  return m.changed;
+}
+
+bool
+PresentationFrames::GetFramePose(vrb::Matrix& aHeadTransform) const {
+  if (!m.poseValid) {
+    return false;
+  }
+  aHeadTransform = vrb::Matrix::Rotation(vrb::Quaternion(m.pose[0], m.pose[1], m.pose[2], m.pose[3]));
+  aHeadTransform.TranslateInPlace(vrb::Vector(m.pose[4], m.pose[5], m.pose[6]));
+  return true;
+}
+
+void
+PresentationFrames::FrameSubmitted() {
+  if (!m.changed || !m.poseValid) {
+    return;
+  }
+  const float latency = (float)((double)(Now() - m.timestamp) / kNanosecondsPerMillisecond);
+  m.lastLatency = (int32_t)(latency + 0.5f);
+  if (m.latencies.size() < kLatencySamples) {
+    m.latencies.push_back(latency);
+  } else {
+    m.latencies[m.nextLatency] = latency;
+  }
+  m.nextLatency = (m.nextLatency + 1) % kLatencySamples;
+}
+
+void
+PresentationFrames::GetStats(Stats& aStats) const {
+  aStats = m.stats;
+  if (m.latencies.empty()) {
+    return;
+  }
+  std::vector<float> sorted(m.latencies);
+  std::sort(sorted.begin(), sorted.end());
+  aStats.latencyP50 = sorted[(sorted.size() - 1) / 2];
+  aStats.latencyP95 = sorted[((sorted.size() - 1) * 95) / 100];
+}
+
+void
+PresentationFrames::GetLastFrame(int32_t& aDropped, int32_t& aLatency) const {
+  aDropped = m.lastDropped;
+  aLatency = m.lastLatency;
+}
+
+void
+PresentationFrames::ResetStats() {
+  m.stats = Stats();
+  m.latencies.clear();
+  m.nextLatency = 0;
+  m.lastDropped = 0;
+  m.lastLatency = 0;
+}
+
+PresentationFrames::PresentationFrames(State& aState) : m(aState) {}
+PresentationFrames::~PresentationFrames() {}
+
+} // namespace crow
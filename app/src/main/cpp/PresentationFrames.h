@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_PRESENTATIONFRAMES_H
+#define VRBROWSER_PRESENTATIONFRAMES_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class PresentationFrames;
+typedef std::shared_ptr<PresentationFrames> PresentationFramesPtr;
+
+// Consumer side of an immersive (WebVR) presentation. The producer renders side by side
+// stereo frames, left eye on the left, into one SurfaceTexture and publishes for each of
+// them the head pose it was rendered for into a direct ByteBuffer. The render thread
+// latches the newest frame, or follows the one the compositor shows when the producer
+// draws straight into a compositor surface, and keeps drop and latency statistics. Timestamps are
+// System.nanoTime(), i.e. CLOCK_MONOTONIC.
+//
+// The producer posts frame n to the surface, then writes slot[n % kFrameSlots] and stores
+// n as the frame count, so a counted frame is always queued. Frames are queued in order,
+// latching the surface count - latched times lands on frame count.
+//
+// Layout (native byte order), must be kept in sync with PresentationFrames.java:
+//   header: int32 frame count, int32 attached
+//   slot[kFrameSlots]: int32 frame, int32 reserved, int64 render timestamp,
+//                      float quaternion x, y, z, w, float position x, y, z, int32 reserved
+class PresentationFrames {
+public:
+  static const int32_t kFrameSlots = 8;
+  static const int32_t kHeaderSize = 8;
+  static const int32_t kSlotSize = 48;
+
+  struct Stats {
+    int32_t presented; // Frames shown at least once.
+    int32_t dropped; // Frames the producer posted that were never shown.
+    int32_t repeated; // Display frames without a new frame from the producer.
+    float latencyP50; // Milliseconds from rendering to submission.
+    float latencyP95;
+    Stats() : presented(0), dropped(0), repeated(0), latencyP50(0.0f), latencyP95(0.0f) {}
+  };
+
+  static PresentationFramesPtr Create();
+  void InitializeJava(JNIEnv* aEnv, jobject aActivity);
+  void ShutdownJava();
+  // aSurfaceTexture is an android.graphics.SurfaceTexture, nullptr detaches it and resets
+  // the frame count.
+  void SetSurfaceTexture(jobject aSurfaceTexture);
+  // The producer draws into a surface the compositor consumes, which shows the newest frame
+  // queued. Update() then only follows the frame count, there is nothing to latch. Cleared
+  // by SetSurfaceTexture().
+  void SetDirect();
+  // True while a producer draws into the surface.
+  bool IsAttached() const;
+  // Latches the newest frame, must be called on the GL thread once per display frame.
+  // Returns true if a new frame was latched, or posted since the last call when direct.
+  bool Update();
+  // True once a frame was latched since the surface was set.
+  bool HasFrame() const;
+  // True if the last Update() latched a new frame.
+  bool IsChanged() const;
+  // The head transform the latched frame was rendered for.
+  bool GetFramePose(vrb::Matrix& aHeadTransform) const;
+  // Records the latency of the latched frame, call after it has been submitted.
+  void FrameSubmitted();
+  void GetStats(Stats& aStats) const;
+  // Frames dropped and the latency in milliseconds of the last Update() and FrameSubmitted().
+  void GetLastFrame(int32_t& aDropped, int32_t& aLatency) const;
+  void ResetStats();
+protected:
+  struct State;
+  PresentationFrames(State& aState);
+  ~PresentationFrames();
+private:
+  State& m;
+  PresentationFrames() = delete;
+  VRB_NO_DEFAULTS(PresentationFrames)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_PRESENTATIONFRAMES_H
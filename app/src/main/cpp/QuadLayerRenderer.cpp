@@ -0,0 +1,315 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "QuadLayerRenderer.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Camera.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <GLES2/gl2ext.h>
+
+namespace {
+
+static const char* kVertexShader = R"SHADER(
+attribute vec3 aPosition;
+attribute vec2 aUV;
+uniform mat4 uProjection;
+uniform mat4 uView;
+varying vec2 vUV;
+void main() {
+  vUV = aUV;
+  gl_Position = uProjection * uView * vec4(aPosition, 1.0);
+}
+)SHADER";
+
+static const char* kTextureFragmentShader = R"SHADER(
+#extension GL_OES_EGL_image_external : require
+precision mediump float;
+uniform samplerExternalOES uTexture;
+varying vec2 vUV;
+void main() {
+  gl_FragColor = vec4(texture2D(uTexture, vUV).rgb, 1.0);
+}
+)SHADER";
+
+static const char* kHoleFragmentShader = R"SHADER(
+precision mediump float;
+varying vec2 vUV;
+void main() {
+  gl_FragColor = vec4(0.0);
+}
+)SHADER";
+
+// Same orientation as the widget quad: SurfaceTexture content is stored top row first.
+static const GLfloat kUVs[] = {
+    0.0f, 1.0f,
+    1.0f, 1.0f,
+    1.0f, 0.0f,
+    0.0f, 0.0f
+};
+
+static const GLfloat kBlitPositions[] = {
+    -1.0f, -1.0f, 0.0f,
+    1.0f, -1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    -1.0f, 1.0f, 0.0f
+};
+
+// kBlitPositions upside down, the first row of the texture lands in the first row of the target.
+static const GLfloat kCopyPositions[] = {
+    -1.0f, 1.0f, 0.0f,
+    1.0f, 1.0f, 0.0f,
+    1.0f, -1.0f, 0.0f,
+    -1.0f, -1.0f, 0.0f
+};
+
+GLuint
+LoadShader(const GLenum aType, const char* aSource) {
+  GLuint shader = glCreateShader(aType);
+  VRB_CHECK(glShaderSource(shader, 1, &aSource, nullptr));
+  VRB_CHECK(glCompileShader(shader));
+  GLint compiled = 0;
+  VRB_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+  if (!compiled) {
+    GLchar log[512];
+    VRB_CHECK(glGetShaderInfoLog(shader, sizeof(log), nullptr, log));
+    VRB_LOG("QuadLayerRenderer failed to compile shader: %s", log);
+    VRB_CHECK(glDeleteShader(shader));
+    return 0;
+  }
+  return shader;
+}
+
+struct Program {
+  GLuint program;
+  GLint aPosition;
+  GLint aUV;
+  GLint uProjection;
+  GLint uView;
+  GLint uTexture;
+  Program() : program(0), aPosition(-1), aUV(-1), uProjection(-1), uView(-1), uTexture(-1) {}
+
+  bool Link(const GLuint aVertex, const GLuint aFragment) {
+    program = glCreateProgram();
+    VRB_CHECK(glAttachShader(program, aVertex));
+    VRB_CHECK(glAttachShader(program, aFragment));
+    VRB_CHECK(glLinkProgram(program));
+    GLint linked = 0;
+    VRB_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (!linked) {
+      GLchar log[512];
+      VRB_CHECK(glGetProgramInfoLog(program, sizeof(log), nullptr, log));
+      VRB_LOG("QuadLayerRenderer failed to link program: %s", log);
+      Destroy();
+      return false;
+    }
+    aPosition = glGetAttribLocation(program, "aPosition");
+    aUV = glGetAttribLocation(program, "aUV");
+    uProjection = glGetUniformLocation(program, "uProjection");
+    uView = glGetUniformLocation(program, "uView");
+    uTexture = glGetUniformLocation(program, "uTexture");
+    return true;
+  }
+
+  void Destroy() {
+    if (program) {
+      VRB_CHECK(glDeleteProgram(program));
+      program = 0;
+    }
+  }
+};
+
+} // namespace
+
+namespace crow {
+
+struct QuadLayerRenderer::State {
+  Program texture;
+  Program hole;
+  GLuint positionBuffer;
+  GLuint uvBuffer;
+  bool initialized;
+  State() : positionBuffer(0), uvBuffer(0), initialized(false) {}
+
+  void Draw(const Program& aProgram, const GLuint aTexture, const GLfloat* aPositions, const GLfloat* aUVs,
+            const vrb::Matrix& aProjection, const vrb::Matrix& aView, const bool aDepthTest) {
+    GLint previousProgram = 0;
+    VRB_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram));
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    if (aDepthTest) { VRB_CHECK(glEnable(GL_DEPTH_TEST)); } else { VRB_CHECK(glDisable(GL_DEPTH_TEST)); }
+    VRB_CHECK(glDisable(GL_BLEND));
+    VRB_CHECK(glDisable(GL_CULL_FACE));
+
+    VRB_CHECK(glBindVertexArray(0));
+    VRB_CHECK(glUseProgram(aProgram.program));
+    VRB_CHECK(glUniformMatrix4fv(aProgram.uProjection, 1, GL_FALSE, aProjection.Data()));
+    VRB_CHECK(glUniformMatrix4fv(aProgram.uView, 1, GL_FALSE, aView.Data()));
+    if (aProgram.uTexture >= 0) {
+      VRB_CHECK(glActiveTexture(GL_TEXTURE0));
+      VRB_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, aTexture));
+      VRB_CHECK(glUniform1i(aProgram.uTexture, 0));
+    }
+    VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, positionBuffer));
+    VRB_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(kBlitPositions), aPositions));
+    VRB_CHECK(glEnableVertexAttribArray((GLuint)aProgram.aPosition));
+    VRB_CHECK(glVertexAttribPointer((GLuint)aProgram.aPosition, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+    if (aProgram.aUV >= 0) {
+      VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, uvBuffer));
+      VRB_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(kUVs), aUVs));
+      VRB_CHECK(glEnableVertexAttribArray((GLuint)aProgram.aUV));
+      VRB_CHECK(glVertexAttribPointer((GLuint)aProgram.aUV, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+    }
+    VRB_CHECK(glDrawArrays(GL_TRIANGLE_FAN, 0, kCornerCount));
+    VRB_CHECK(glDisableVertexAttribArray((GLuint)aProgram.aPosition));
+    if (aProgram.aUV >= 0) {
+      VRB_CHECK(glDisableVertexAttribArray((GLuint)aProgram.aUV));
+    }
+    VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    if (aProgram.uTexture >= 0) {
+      VRB_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0));
+    }
+
+    VRB_CHECK(glUseProgram((GLuint)previousProgram));
+    if (depthTest) { VRB_CHECK(glEnable(GL_DEPTH_TEST)); } else { VRB_CHECK(glDisable(GL_DEPTH_TEST)); }
+    if (blend) { VRB_CHECK(glEnable(GL_BLEND)); }
+    if (cullFace) { VRB_CHECK(glEnable(GL_CULL_FACE)); }
+  }
+
+  void DrawWorld(const Program& aProgram, const GLuint aTexture, const vrb::Vector aCorners[kCornerCount],
+                 const vrb::Camera& aCamera) {
+    GLfloat positions[kCornerCount * 3];
+    for (int32_t ix = 0; ix < kCornerCount; ix++) {
+      positions[(ix * 3) + 0] = aCorners[ix].x();
+      positions[(ix * 3) + 1] = aCorners[ix].y();
+      positions[(ix * 3) + 2] = aCorners[ix].z();
+    }
+    Draw(aProgram, aTexture, positions, kUVs, aCamera.GetPerspective(), aCamera.GetTransform().AfineInverse(), true);
+  }
+
+};
+
+void
+QuadLayerRenderer::GetCorners(const vrb::Matrix& aTransform, const vrb::Vector& aMin, const vrb::Vector& aMax,
+                              vrb::Vector aCorners[kCornerCount]) {
+  aCorners[0] = aTransform.MultiplyPosition(aMin);
+  aCorners[1] = aTransform.MultiplyPosition(vrb::Vector(aMax.x(), aMin.y(), aMin.z()));
+  aCorners[2] = aTransform.MultiplyPosition(aMax);
+  aCorners[3] = aTransform.MultiplyPosition(vrb::Vector(aMin.x(), aMax.y(), aMax.z()));
+}
+
+QuadLayerRendererPtr
+QuadLayerRenderer::Create() {
+  return std::make_shared<vrb::ConcreteClass<QuadLayerRenderer, QuadLayerRenderer::State> >();
+}
+
+bool
+QuadLayerRenderer::Initialize() {
+  if (m.initialized) {
+    return true;
+  }
+  GLuint vertex = LoadShader(GL_VERTEX_SHADER, kVertexShader);
+  GLuint textureFragment = LoadShader(GL_FRAGMENT_SHADER, kTextureFragmentShader);
+  GLuint holeFragment = LoadShader(GL_FRAGMENT_SHADER, kHoleFragmentShader);
+  bool linked = false;
+  if (vertex && textureFragment && holeFragment) {
+    linked = m.texture.Link(vertex, textureFragment) && m.hole.Link(vertex, holeFragment);
+  }
+  if (vertex) { VRB_CHECK(glDeleteShader(vertex)); }
+  if (textureFragment) { VRB_CHECK(glDeleteShader(textureFragment)); }
+  if (holeFragment) { VRB_CHECK(glDeleteShader(holeFragment)); }
+  if (!linked) {
+    Shutdown();
+    return false;
+  }
+
+  VRB_CHECK(glGenBuffers(1, &m.positionBuffer));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.positionBuffer));
+  VRB_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(kBlitPositions), kBlitPositions, GL_DYNAMIC_DRAW));
+  VRB_CHECK(glGenBuffers(1, &m.uvBuffer));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.uvBuffer));
+  VRB_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(kUVs), kUVs, GL_DYNAMIC_DRAW));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  m.initialized = true;
+  return true;
+}
+
+bool
+QuadLayerRenderer::IsInitialized() const {
+  return m.initialized;
+}
+
+void
+QuadLayerRenderer::Shutdown() {
+  m.texture.Destroy();
+  m.hole.Destroy();
+  if (m.positionBuffer) {
+    VRB_CHECK(glDeleteBuffers(1, &m.positionBuffer));
+    m.positionBuffer = 0;
+  }
+  if (m.uvBuffer) {
+    VRB_CHECK(glDeleteBuffers(1, &m.uvBuffer));
+    m.uvBuffer = 0;
+  }
+  m.initialized = false;
+}
+
+void
+QuadLayerRenderer::Draw(const GLuint aTexture, const vrb::Vector aCorners[kCornerCount], const vrb::Camera& aCamera) {
+  if (!m.initialized) {
+    return;
+  }
+  m.DrawWorld(m.texture, aTexture, aCorners, aCamera);
+}
+
+void
+QuadLayerRenderer::DrawHole(const vrb::Vector aCorners[kCornerCount], const vrb::Camera& aCamera) {
+  if (!m.initialized) {
+    return;
+  }
+  m.DrawWorld(m.hole, 0, aCorners, aCamera);
+}
+
+void
+QuadLayerRenderer::Blit(const GLuint aTexture) {
+  if (!m.initialized) {
+    return;
+  }
+  m.Draw(m.texture, aTexture, kBlitPositions, kUVs, vrb::Matrix::Identity(), vrb::Matrix::Identity(), false);
+}
+
+void
+QuadLayerRenderer::BlitRegion(const GLuint aTexture, const float aX, const float aY, const float aWidth,
+                              const float aHeight) {
+  if (!m.initialized) {
+    return;
+  }
+  // kUVs restricted to the region, top row first like the whole texture.
+  const GLfloat uvs[] = {
+      aX, aY + aHeight,
+      aX + aWidth, aY + aHeight,
+      aX + aWidth, aY,
+      aX, aY
+  };
+  m.Draw(m.texture, aTexture, kBlitPositions, uvs, vrb::Matrix::Identity(), vrb::Matrix::Identity(), false);
+}
+
+void
+QuadLayerRenderer::Copy(const GLuint aTexture) {
+  if (!m.initialized) {
+    return;
+  }
+  m.Draw(m.texture, aTexture, kCopyPositions, kUVs, vrb::Matrix::Identity(), vrb::Matrix::Identity(), false);
+}
+
+QuadLayerRenderer::QuadLayerRenderer(State& aState) : m(aState) {}
+QuadLayerRenderer::~QuadLayerRenderer() {}
+
+} // namespace crow
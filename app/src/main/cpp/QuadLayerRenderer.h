@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_QUADLAYERRENDERER_H
+#define VRBROWSER_QUADLAYERRENDERER_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <GLES3/gl3.h>
+#include <memory>
+
+namespace crow {
+
+class QuadLayerRenderer;
+typedef std::shared_ptr<QuadLayerRenderer> QuadLayerRendererPtr;
+
+// Draws external (SurfaceTexture) textures onto world space quads or copies them into the
+// bound framebuffer. Used by the device delegates to emulate or feed compositor quad
+// layers, and by BrowserWorld for snapshots, thumbnails and the presentation frames.
+// Corners are ordered bottom left, bottom right, top right, top left.
+class QuadLayerRenderer {
+public:
+  static const int32_t kCornerCount = 4;
+  static void GetCorners(const vrb::Matrix& aTransform, const vrb::Vector& aMin, const vrb::Vector& aMax,
+                         vrb::Vector aCorners[kCornerCount]);
+  static QuadLayerRendererPtr Create();
+  // Must be called with a current GL context.
+  bool Initialize();
+  bool IsInitialized() const;
+  void Shutdown();
+  // Draws the texture onto the quad as seen from aCamera.
+  void Draw(const GLuint aTexture, const vrb::Vector aCorners[kCornerCount], const vrb::Camera& aCamera);
+  // Clears color and alpha to zero where the quad is visible so a layer submitted underneath shows through.
+  void DrawHole(const vrb::Vector aCorners[kCornerCount], const vrb::Camera& aCamera);
+  // Copies the texture to the whole of the currently bound framebuffer.
+  void Blit(const GLuint aTexture);
+  // Like Blit() for the part of the texture at aX, aY of size aWidth x aHeight in texture
+  // coordinates, e.g. one eye of a side by side stereo frame.
+  void BlitRegion(const GLuint aTexture, const float aX, const float aY, const float aWidth, const float aHeight);
+  // Like Blit() but keeps the rows in SurfaceTexture order, top row first, so the copy is
+  // sampled like the source texture.
+  void Copy(const GLuint aTexture);
+protected:
+  struct State;
+  QuadLayerRenderer(State& aState);
+  ~QuadLayerRenderer();
+private:
+  State& m;
+  QuadLayerRenderer() = delete;
+  VRB_NO_DEFAULTS(QuadLayerRenderer)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_QUADLAYERRENDERER_H
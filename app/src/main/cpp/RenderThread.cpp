@@ -0,0 +1,257 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderThread.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <GLES2/gl2.h>
+#include <android_native_app_glue.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+namespace {
+
+static const char* kThreadName = "VRBRender";
+
+jobject
+GetAssetManager(JNIEnv *aEnv, jobject aActivity) {
+  jclass clazz = aEnv->GetObjectClass(aActivity);
+  jmethodID method = aEnv->GetMethodID(clazz, "getAssets", "()Landroid/content/res/AssetManager;");
+  jobject result = aEnv->CallObjectMethod(aActivity, method);
+  if (!result) {
+    VRB_LOG("Failed to get AssetManager instance!");
+  }
+  return result;
+}
+
+} // namespace
+
+namespace crow {
+
+struct RenderThread::State {
+  std::thread thread;
+  std::mutex lock;
+  std::condition_variable condition;
+  // Guarded by lock.
+  std::deque<std::function<void()> > tasks;
+  uint64_t queued;
+  uint64_t completed;
+  bool running;
+  bool stopRequested;
+  BrowserEGLContextPtr sharedEgl;
+  // Only used on the render thread.
+  android_app* app;
+  BrowserWorldPtr world;
+  PlatformDeviceDelegatePtr device;
+  BrowserEGLContextPtr egl;
+  ANativeWindow* window;
+  JNIEnv* env;
+  State() : queued(0), completed(0), running(false), stopRequested(false), app(nullptr), window(nullptr),
+            env(nullptr) {}
+
+  void RunAndWait(std::function<void()>&& aTask) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!running) {
+      return;
+    }
+    tasks.push_back(std::move(aTask));
+    const uint64_t ticket = ++queued;
+    condition.notify_all();
+    condition.wait(guard, [this, ticket]() { return (completed >= ticket) || !running; });
+  }
+
+  bool CanDraw() const {
+    return egl && window && !world->IsPaused() && device->IsInVRMode();
+  }
+
+  void Run(DeviceFactory aFactory) {
+    pthread_setname_np(pthread_self(), kThreadName);
+    app->activity->vm->AttachCurrentThread(&env, nullptr);
+    device = aFactory();
+    world->RegisterDeviceDelegate(device);
+    jobject assetManager = GetAssetManager(env, app->activity->clazz);
+    world->InitializeJava(env, app->activity->clazz, assetManager);
+    env->DeleteLocalRef(assetManager);
+
+    std::deque<std::function<void()> > pending;
+    while (true) {
+      uint64_t batch = 0;
+      bool stop = false;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        // Sleeps while paused or without a window, until the next lifecycle change.
+        condition.wait(guard, [this]() { return stopRequested || !tasks.empty() || CanDraw(); });
+        pending.swap(tasks);
+        batch = queued;
+        stop = stopRequested;
+      }
+      for (std::function<void()>& task: pending) {
+        task();
+      }
+      pending.clear();
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        completed = batch;
+        condition.notify_all();
+      }
+      if (stop) {
+        break;
+      }
+      if (CanDraw()) {
+        egl->MakeCurrent();
+        VRB_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        world->Draw();
+      }
+    }
+    Shutdown();
+  }
+
+  void Shutdown() {
+    if (egl) {
+      egl->MakeCurrent();
+    }
+    world->ShutdownGL();
+    world->ShutdownJava();
+    // The delegate releases the VR API from the thread that initialized it.
+    world->RegisterDeviceDelegate(nullptr);
+    device = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      sharedEgl = nullptr;
+      running = false;
+      condition.notify_all();
+    }
+    if (egl) {
+      egl->Destroy();
+      egl = nullptr;
+    }
+    app->activity->vm->DetachCurrentThread();
+  }
+
+  void ApplyWindow(ANativeWindow* aWindow) {
+    window = aWindow;
+    if (!aWindow) {
+      if (device->IsInVRMode()) {
+        device->LeaveVR();
+      }
+      if (egl) {
+        egl->UpdateNativeWindow(nullptr);
+      }
+      return;
+    }
+    if (!egl) {
+      egl = BrowserEGLContext::Create();
+      if (!egl->Initialize(aWindow)) {
+        // Retried when the next window arrives.
+        VRB_LOG("Failed to initialize the render thread EGL context");
+        egl->Destroy();
+        egl = nullptr;
+        return;
+      }
+      egl->MakeCurrent();
+      VRB_CHECK(glEnable(GL_DEPTH_TEST));
+      VRB_CHECK(glEnable(GL_CULL_FACE));
+      world->InitializeGL();
+      std::lock_guard<std::mutex> guard(lock);
+      sharedEgl = egl;
+    } else {
+      egl->UpdateNativeWindow(aWindow);
+      egl->MakeCurrent();
+    }
+    if (!world->IsPaused() && !device->IsInVRMode()) {
+      device->EnterVR(*egl);
+    }
+  }
+
+  void ApplyPause() {
+    world->Pause();
+    if (device->IsInVRMode()) {
+      device->LeaveVR();
+    }
+  }
+
+  void ApplyResume() {
+    world->Resume();
+    if (!device->IsInVRMode() && egl && egl->IsSurfaceReady()) {
+      device->EnterVR(*egl);
+    }
+  }
+};
+
+RenderThreadPtr
+RenderThread::Create() {
+  return std::make_shared<vrb::ConcreteClass<RenderThread, RenderThread::State> >();
+}
+
+void
+RenderThread::Start(android_app* aApp, BrowserWorldPtr aWorld, DeviceFactory&& aFactory) {
+  std::lock_guard<std::mutex> guard(m.lock);
+  if (m.running || !aApp || !aWorld) {
+    return;
+  }
+  m.app = aApp;
+  m.world = aWorld;
+  m.running = true;
+  m.stopRequested = false;
+  m.thread = std::thread(&State::Run, &m, std::move(aFactory));
+}
+
+void
+RenderThread::SetWindow(ANativeWindow* aWindow) {
+  m.RunAndWait([this, aWindow]() { m.ApplyWindow(aWindow); });
+}
+
+void
+RenderThread::Pause() {
+  m.RunAndWait([this]() { m.ApplyPause(); });
+}
+
+void
+RenderThread::Resume() {
+  m.RunAndWait([this]() { m.ApplyResume(); });
+}
+
+bool
+RenderThread::ExitApp() {
+  bool result = false;
+  m.RunAndWait([this, &result]() { result = m.device->ExitApp(); });
+  return result;
+}
+
+bool
+RenderThread::InitializeSharedContext(BrowserEGLContext& aContext) {
+  BrowserEGLContextPtr shared;
+  {
+    std::lock_guard<std::mutex> guard(m.lock);
+    shared = m.sharedEgl;
+  }
+  return shared && aContext.InitializeShared(*shared);
+}
+
+void
+RenderThread::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(m.lock);
+    m.stopRequested = true;
+    m.condition.notify_all();
+  }
+  if (m.thread.joinable()) {
+    m.thread.join();
+  }
+}
+
+RenderThread::RenderThread(State& aState) : m(aState) {}
+
+RenderThread::~RenderThread() {
+  Stop();
+}
+
+} // namespace crow
@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_RENDERTHREAD_H
+#define VRBROWSER_RENDERTHREAD_H
+
+#include "vrb/MacroUtils.h"
+
+#include "BrowserEGLContext.h"
+#include "BrowserWorld.h"
+#if defined(OCULUSVR)
+#include "DeviceDelegateOculusVR.h"
+#elif defined(SNAPDRAGONVR)
+#include "DeviceDelegateSVR.h"
+#endif
+
+#include <functional>
+#include <memory>
+
+struct android_app;
+struct ANativeWindow;
+
+namespace crow {
+
+#if defined(OCULUSVR)
+typedef DeviceDelegateOculusVR PlatformDeviceDelegate;
+typedef DeviceDelegateOculusVRPtr PlatformDeviceDelegatePtr;
+#elif defined(SNAPDRAGONVR)
+typedef DeviceDelegateSVR PlatformDeviceDelegate;
+typedef DeviceDelegateSVRPtr PlatformDeviceDelegatePtr;
+#endif
+
+class RenderThread;
+typedef std::shared_ptr<RenderThread> RenderThreadPtr;
+
+// Owns the EGL context, the device delegate and BrowserWorld's frames on a thread of its
+// own, so the NativeActivity thread only handles looper events, runnables and JNI, and a
+// slow runnable or looper event no longer costs a VR frame. The device is created on the
+// render thread because the VR APIs bind their JNI environment to the creating thread.
+// Calls block until the render thread has applied them, which android_native_app_glue
+// requires for window changes, so they must not be made from the render thread itself.
+class RenderThread {
+public:
+  typedef std::function<PlatformDeviceDelegatePtr()> DeviceFactory;
+  static RenderThreadPtr Create();
+  // Creates the device with aFactory and initializes the Java side of aWorld on the new thread.
+  void Start(android_app* aApp, BrowserWorldPtr aWorld, DeviceFactory&& aFactory);
+  // Drawing starts once there is a window and the activity is resumed.
+  void SetWindow(ANativeWindow* aWindow);
+  void Pause();
+  void Resume();
+  bool ExitApp();
+  // Initializes aContext to share with the render context. Fails until the first window arrived.
+  bool InitializeSharedContext(BrowserEGLContext& aContext);
+  // Shuts BrowserWorld and the device down on the render thread and joins it.
+  void Stop();
+protected:
+  struct State;
+  RenderThread(State& aState);
+  ~RenderThread();
+private:
+  State& m;
+  RenderThread() = delete;
+  VRB_NO_DEFAULTS(RenderThread)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_RENDERTHREAD_H
@@ -0,0 +1,294 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RunnableQueue.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+static const char* kRunnableClass = "java/lang/Runnable";
+static const char* kRunName = "run";
+static const char* kRunSignature = "()V";
+
+static const size_t kMask = (size_t)crow::RunnableQueue::kCapacity - 1;
+// Global references are released after this many runnables have run.
+static const int32_t kBatchSize = 32;
+
+// A slot is free for the producer claiming position N when its sequence is N and holds a
+// runnable for the consumer when it is N + 1.
+struct Slot {
+  std::atomic<size_t> sequence;
+  jobject runnable;
+};
+
+// The runnables of one priority class.
+struct Lane {
+  Slot slots[crow::RunnableQueue::kCapacity];
+  // Producer side, on its own cache line so claiming slots does not slow down the consumer.
+  alignas(64) std::atomic<size_t> tail;
+  std::atomic<int32_t> overflowCount;
+  std::mutex overflowLock;
+  std::deque<jobject> overflow;
+  // Only used by the consumer.
+  alignas(64) size_t head;
+
+  Lane() : tail(0), overflowCount(0), head(0) {
+    for (size_t ix = 0; ix < (size_t)crow::RunnableQueue::kCapacity; ix++) {
+      slots[ix].sequence.store(ix, std::memory_order_relaxed);
+      slots[ix].runnable = nullptr;
+    }
+  }
+
+  // Returns false when the runnable went to the overflow list.
+  bool Push(jobject aRunnable) {
+    // Once runnables spilled, later ones follow them so a producer's runnables stay in order.
+    if (overflowCount.load(std::memory_order_acquire) == 0) {
+      size_t position = tail.load(std::memory_order_relaxed);
+      while (true) {
+        Slot& slot = slots[position & kMask];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0) {
+          if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            slot.runnable = aRunnable;
+            slot.sequence.store(position + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (difference < 0) {
+          break; // Full.
+        } else {
+          position = tail.load(std::memory_order_relaxed);
+        }
+      }
+    }
+    std::lock_guard<std::mutex> guard(overflowLock);
+    overflow.push_back(aRunnable);
+    overflowCount.store((int32_t)overflow.size(), std::memory_order_release);
+    return false;
+  }
+
+  // The ring holds the older runnables, the overflow list is only used once it is empty.
+  bool Pop(jobject& aRunnable) {
+    Slot& slot = slots[head & kMask];
+    if (slot.sequence.load(std::memory_order_acquire) == (head + 1)) {
+      aRunnable = slot.runnable;
+      slot.runnable = nullptr;
+      slot.sequence.store(head + crow::RunnableQueue::kCapacity, std::memory_order_release);
+      head++;
+      return true;
+    }
+    if (overflowCount.load(std::memory_order_acquire) == 0) {
+      return false; // Empty, or the next producer has not finished writing its slot.
+    }
+    std::lock_guard<std::mutex> guard(overflowLock);
+    if (overflow.empty()) {
+      return false;
+    }
+    aRunnable = overflow.front();
+    overflow.pop_front();
+    overflowCount.store((int32_t)overflow.size(), std::memory_order_release);
+    return true;
+  }
+
+  // Approximate, a producer may be between claiming and writing a slot.
+  int32_t Size() const {
+    return (int32_t)(tail.load(std::memory_order_relaxed) - head) + overflowCount.load(std::memory_order_relaxed);
+  }
+};
+
+double
+NowMilliseconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((double)now.tv_sec * 1000.0) + ((double)now.tv_nsec / 1000000.0);
+}
+
+} // namespace
+
+namespace crow {
+
+struct RunnableQueue::State {
+  JavaVM* vm;
+  int wakeFd;
+  Lane lanes[kPriorityCount];
+  // Set by the producer that found the queue idle, cleared by the consumer before draining.
+  alignas(64) std::atomic<bool> signaled;
+  std::atomic<uint32_t> overflowTotal;
+  // Only used by the consumer.
+  alignas(64) float budget;
+  jmethodID runMethod;
+  jobject batch[kBatchSize];
+  int32_t batchCount;
+  Stats stats;
+
+  State() : vm(nullptr), wakeFd(-1), signaled(false), overflowTotal(0), budget(0.0f), runMethod(nullptr),
+            batchCount(0) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+      VRB_LOG("Failed to create RunnableQueue eventfd");
+    }
+  }
+
+  ~State() {
+    JNIEnv* env = GetEnv();
+    jobject runnable = nullptr;
+    for (Lane& lane: lanes) {
+      while (env && lane.Pop(runnable)) {
+        env->DeleteGlobalRef(runnable);
+      }
+    }
+    if (wakeFd >= 0) {
+      close(wakeFd);
+    }
+  }
+
+  JNIEnv* GetEnv() const {
+    JNIEnv* env = nullptr;
+    if (!vm || (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK)) {
+      return nullptr;
+    }
+    return env;
+  }
+
+  void Signal() {
+    if (signaled.exchange(true) || (wakeFd < 0)) {
+      return;
+    }
+    const uint64_t value = 1;
+    if (write(wakeFd, &value, sizeof(value)) < 0) {
+      VRB_LOG("Failed to signal the RunnableQueue eventfd");
+    }
+  }
+
+  void Run(JNIEnv* aEnv, jobject aRunnable) {
+    aEnv->CallVoidMethod(aRunnable, runMethod);
+    if (aEnv->ExceptionCheck()) {
+      VRB_LOG("Runnable threw an exception");
+      aEnv->ExceptionDescribe();
+      aEnv->ExceptionClear();
+    }
+    batch[batchCount++] = aRunnable;
+    if (batchCount == kBatchSize) {
+      ReleaseBatch(aEnv);
+    }
+  }
+
+  void ReleaseBatch(JNIEnv* aEnv) {
+    for (int32_t ix = 0; ix < batchCount; ix++) {
+      aEnv->DeleteGlobalRef(batch[ix]);
+    }
+    batchCount = 0;
+  }
+};
+
+RunnableQueuePtr
+RunnableQueue::Create(JavaVM* aVM) {
+  RunnableQueuePtr result = std::make_shared<vrb::ConcreteClass<RunnableQueue, RunnableQueue::State> >();
+  result->m.vm = aVM;
+  return result;
+}
+
+void
+RunnableQueue::AddRunnable(JNIEnv* aEnv, jobject aRunnable, const Priority aPriority) {
+  const int32_t lane = static_cast<int32_t>(aPriority);
+  if (!aEnv || !aRunnable || (lane < 0) || (lane >= kPriorityCount)) {
+    return;
+  }
+  if (!m.lanes[lane].Push(aEnv->NewGlobalRef(aRunnable)) &&
+      (m.overflowTotal.fetch_add(1, std::memory_order_relaxed) == 0)) {
+    VRB_LOG("RunnableQueue full, runnables spill to the overflow list");
+  }
+  m.Signal();
+}
+
+void
+RunnableQueue::SetBudget(const float aMilliseconds) {
+  m.budget = aMilliseconds > 0.0f ? aMilliseconds : 0.0f;
+}
+
+int32_t
+RunnableQueue::ProcessRunnables() {
+  uint64_t value = 0;
+  if ((m.wakeFd >= 0) && (read(m.wakeFd, &value, sizeof(value)) < 0)) {
+    // EAGAIN, the queue was polled without being signaled.
+  }
+  // Producers signal again for anything added from here on.
+  m.signaled.exchange(false);
+  m.stats = Stats();
+  JNIEnv* env = m.GetEnv();
+  if (!env) {
+    VRB_LOG("RunnableQueue consumer thread is not attached to the VM");
+    return 0;
+  }
+  if (!m.runMethod) {
+    jclass clazz = env->FindClass(kRunnableClass);
+    m.runMethod = clazz ? env->GetMethodID(clazz, kRunName, kRunSignature) : nullptr;
+    if (clazz) {
+      env->DeleteLocalRef(clazz);
+    }
+    if (!m.runMethod) {
+      VRB_LOG("Failed to find Java method: %s.%s %s", kRunnableClass, kRunName, kRunSignature);
+      return 0;
+    }
+  }
+  const double start = NowMilliseconds();
+  jobject runnable = nullptr;
+  int32_t deferrableRun = 0;
+  for (int32_t lane = 0; lane < kPriorityCount; lane++) {
+    const bool deferrable = lane != static_cast<int32_t>(Priority::High);
+    while (true) {
+      // At least one deferrable runnable runs per pass so a runnable longer than the
+      // budget does not stall the queue.
+      if (deferrable && (m.budget > 0.0f) && (deferrableRun > 0) &&
+          ((NowMilliseconds() - start) >= (double)m.budget)) {
+        break;
+      }
+      if (!m.lanes[lane].Pop(runnable)) {
+        break;
+      }
+      m.Run(env, runnable);
+      m.stats.run++;
+      if (deferrable) {
+        deferrableRun++;
+      }
+    }
+  }
+  m.ReleaseBatch(env);
+  for (int32_t lane = static_cast<int32_t>(Priority::Normal); lane < kPriorityCount; lane++) {
+    m.stats.deferred += m.lanes[lane].Size();
+  }
+  m.stats.milliseconds = (float)(NowMilliseconds() - start);
+  return m.stats.run;
+}
+
+const RunnableQueue::Stats&
+RunnableQueue::GetLastStats() const {
+  return m.stats;
+}
+
+int
+RunnableQueue::GetWakeFd() const {
+  return m.wakeFd;
+}
+
+uint32_t
+RunnableQueue::GetOverflowCount() const {
+  return m.overflowTotal.load(std::memory_order_relaxed);
+}
+
+RunnableQueue::RunnableQueue(State& aState) : m(aState) {}
+RunnableQueue::~RunnableQueue() {}
+
+} // namespace crow
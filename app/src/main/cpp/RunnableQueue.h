@@ -0,0 +1,75 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_RUNNABLEQUEUE_H
+#define VRBROWSER_RUNNABLEQUEUE_H
+
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class RunnableQueue;
+typedef std::shared_ptr<RunnableQueue> RunnableQueuePtr;
+
+// Multiple producer / single consumer queue of java.lang.Runnable instances posted from
+// Java through JNI and run on a native thread. Each priority class has a bounded ring of
+// preallocated slots. Producers claim a slot with a single compare and swap, no lock is
+// taken unless the ring is full, in which case runnables spill to a locked overflow list
+// until the consumer catches up. The consumer runs the runnables in priority order and
+// releases their global references in batches. With a time budget, Normal and Low
+// priority runnables that do not fit in it are deferred to the next pass, High priority
+// ones always run. GetWakeFd() is an eventfd that becomes readable when runnables are added
+// to an idle queue, so it can be polled with ALooper_addFd() instead of waking the looper
+// for every runnable.
+class RunnableQueue {
+public:
+  // Must be kept in sync with the RUNNABLE_PRIORITY constants in PlatformActivity.java
+  enum class Priority {
+    High,
+    Normal,
+    Low,
+    Count
+  };
+  static const int32_t kPriorityCount = static_cast<int32_t>(Priority::Count);
+  static const int32_t kCapacity = 256; // Per priority, must be a power of two.
+
+  struct Stats {
+    int32_t run;
+    // Runnables left for the next pass because the budget ran out.
+    int32_t deferred;
+    float milliseconds;
+    Stats() : run(0), deferred(0), milliseconds(0.0f) {}
+  };
+
+  static RunnableQueuePtr Create(JavaVM* aVM);
+  // May be called from any thread attached to the VM.
+  void AddRunnable(JNIEnv* aEnv, jobject aRunnable, const Priority aPriority = Priority::Normal);
+  // Zero, the default, runs everything queued on each pass.
+  void SetBudget(const float aMilliseconds);
+  // Must always be called from the same thread. Returns the number of runnables run.
+  // Deferred runnables do not signal the wake fd again, the consumer calls this again
+  // later while GetLastStats().deferred is not zero.
+  int32_t ProcessRunnables();
+  // Of the last ProcessRunnables() call, must be called from the same thread.
+  const Stats& GetLastStats() const;
+  int GetWakeFd() const;
+  // Runnables that did not fit in their ring since the queue was created.
+  uint32_t GetOverflowCount() const;
+protected:
+  struct State;
+  RunnableQueue(State& aState);
+  ~RunnableQueue();
+private:
+  State& m;
+  RunnableQueue() = delete;
+  VRB_NO_DEFAULTS(RunnableQueue)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_RUNNABLEQUEUE_H
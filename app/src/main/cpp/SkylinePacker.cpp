@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "SkylinePacker.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// A horizontal segment of the skyline. Segments are sorted by x and cover the whole width.
+struct Segment {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+};
+
+} // namespace
+
+namespace crow {
+
+struct SkylinePacker::State {
+  std::vector<Segment> skyline;
+  int32_t width;
+  int32_t height;
+  int32_t padding;
+  int64_t usedArea;
+  State() : width(0), height(0), padding(0), usedArea(0) {}
+
+  // Lowest y at which a aWidth wide rectangle starting at segment aIndex rests on the
+  // skyline, or -1 if it would stick out of the area.
+  int32_t Fit(const size_t aIndex, const int32_t aWidth, const int32_t aHeight) const {
+    const int32_t x = skyline[aIndex].x;
+    if ((x + aWidth) > width) {
+      return -1;
+    }
+    int32_t y = 0;
+    int32_t remaining = aWidth;
+    for (size_t ix = aIndex; remaining > 0; ix++) {
+      y = std::max(y, skyline[ix].y);
+      if ((y + aHeight) > height) {
+        return -1;
+      }
+      remaining -= skyline[ix].width;
+    }
+    return y;
+  }
+
+  // Raises the skyline under the rectangle placed at segment aIndex.
+  void Add(const size_t aIndex, const int32_t aX, const int32_t aY, const int32_t aWidth) {
+    skyline.insert(skyline.begin() + aIndex, {aX, aY, aWidth});
+    const int32_t right = aX + aWidth;
+    // Trim or drop the segments now under the new one.
+    size_t ix = aIndex + 1;
+    while (ix < skyline.size()) {
+      Segment& segment = skyline[ix];
+      if (segment.x >= right) {
+        break;
+      }
+      const int32_t shrink = right - segment.x;
+      if (shrink < segment.width) {
+        segment.x += shrink;
+        segment.width -= shrink;
+        break;
+      }
+      skyline.erase(skyline.begin() + ix);
+    }
+    // Neighbors at the same height become one segment.
+    for (ix = 0; (ix + 1) < skyline.size();) {
+      if (skyline[ix].y == skyline[ix + 1].y) {
+        skyline[ix].width += skyline[ix + 1].width;
+        skyline.erase(skyline.begin() + ix + 1);
+      } else {
+        ix++;
+      }
+    }
+  }
+};
+
+SkylinePackerPtr
+SkylinePacker::Create() {
+  return std::make_shared<vrb::ConcreteClass<SkylinePacker, SkylinePacker::State> >();
+}
+
+void
+SkylinePacker::Reset(const int32_t aWidth, const int32_t aHeight, const int32_t aPadding) {
+  m.width = std::max(0, aWidth);
+  m.height = std::max(0, aHeight);
+  m.padding = std::max(0, aPadding);
+  m.usedArea = 0;
+  m.skyline.clear();
+  if (m.width > 0) {
+    m.skyline.push_back({0, 0, m.width});
+  }
+}
+
+bool
+SkylinePacker::Insert(const int32_t aWidth, const int32_t aHeight, Rect& aResult) {
+  if ((aWidth <= 0) || (aHeight <= 0)) {
+    return false;
+  }
+  const int32_t width = aWidth + m.padding;
+  const int32_t height = aHeight + m.padding;
+  int32_t bestIndex = -1;
+  int32_t bestTop = m.height + 1;
+  int32_t bestWidth = 0;
+  for (size_t ix = 0; ix < m.skyline.size(); ix++) {
+    const int32_t y = m.Fit(ix, width, height);
+    if (y < 0) {
+      continue;
+    }
+    // Lowest top edge first, then the narrowest segment to keep wide gaps for wide rectangles.
+    const int32_t top = y + height;
+    if ((top < bestTop) || ((top == bestTop) && (m.skyline[ix].width < bestWidth))) {
+      bestIndex = (int32_t)ix;
+      bestTop = top;
+      bestWidth = m.skyline[ix].width;
+    }
+  }
+  if (bestIndex < 0) {
+    return false;
+  }
+  aResult.x = m.skyline[bestIndex].x;
+  aResult.y = bestTop - height;
+  aResult.width = aWidth;
+  aResult.height = aHeight;
+  m.Add((size_t)bestIndex, aResult.x, bestTop, width);
+  m.usedArea += (int64_t)width * (int64_t)height;
+  return true;
+}
+
+float
+SkylinePacker::GetOccupancy() const {
+  const int64_t area = (int64_t)m.width * (int64_t)m.height;
+  return area > 0 ? (float)m.usedArea / (float)area : 0.0f;
+}
+
+SkylinePacker::SkylinePacker(State& aState) : m(aState) {}
+SkylinePacker::~SkylinePacker() {}
+
+} // namespace crow
@@ -0,0 +1,51 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_SKYLINEPACKER_H
+#define VRBROWSER_SKYLINEPACKER_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class SkylinePacker;
+typedef std::shared_ptr<SkylinePacker> SkylinePackerPtr;
+
+// Packs rectangles into a fixed size area with the bottom left skyline heuristic: the
+// area is described by the top edge of the packed rectangles, and every new rectangle
+// goes where it leaves that edge lowest. Rectangles can not be freed one by one, the
+// owner resets the packer and inserts the remaining ones again when it is full.
+class SkylinePacker {
+public:
+  struct Rect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    Rect() : x(0), y(0), width(0), height(0) {}
+  };
+  static SkylinePackerPtr Create();
+  // Empties the packer and sets the size of the area. aPadding is kept free to the right
+  // of and above every rectangle so that filtering does not bleed between neighbors.
+  void Reset(const int32_t aWidth, const int32_t aHeight, const int32_t aPadding);
+  // Returns false, leaving aResult untouched, if the rectangle does not fit.
+  bool Insert(const int32_t aWidth, const int32_t aHeight, Rect& aResult);
+  // Area of the inserted rectangles, padding included, over the whole area.
+  float GetOccupancy() const;
+protected:
+  struct State;
+  SkylinePacker(State& aState);
+  ~SkylinePacker();
+private:
+  State& m;
+  SkylinePacker() = delete;
+  VRB_NO_DEFAULTS(SkylinePacker)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_SKYLINEPACKER_H
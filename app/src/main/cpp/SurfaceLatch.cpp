@@ -0,0 +1,208 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "SurfaceLatch.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+static const char* kSetFrameCountersName = "setSurfaceFrameCounters";
+static const char* kSetFrameCountersSignature = "(Ljava/nio/ByteBuffer;)V";
+static const char* kSurfaceTextureClass = "android/graphics/SurfaceTexture";
+static const char* kUpdateTexImageName = "updateTexImage";
+static const char* kUpdateTexImageSignature = "()V";
+
+static const int32_t kCountOffset = 0;
+static const int32_t kAttachedOffset = 4;
+
+static const size_t kBufferSize = crow::SurfaceLatch::kMaxSurfaces * crow::SurfaceLatch::kSlotSize;
+// The BufferQueue behind a SurfaceTexture holds at most this many queued frames.
+static const uint32_t kMaxLatchesPerUpdate = 3;
+
+struct Surface {
+  jobject texture;
+  uint32_t latched;
+  bool valid; // latched holds a count read from Java.
+  bool changed;
+  Surface() : texture(nullptr), latched(0), valid(false), changed(false) {}
+};
+
+} // namespace
+
+namespace crow {
+
+struct SurfaceLatch::State {
+  int32_t buffer[kBufferSize / sizeof(int32_t)];
+  std::vector<Surface> surfaces;
+  JNIEnv* env;
+  jmethodID updateTexImageMethod;
+  int32_t latchedCount;
+  int32_t skippedCount;
+
+  State()
+      : env(nullptr)
+      , updateTexImageMethod(nullptr)
+      , latchedCount(0)
+      , skippedCount(0)
+  {
+    memset(buffer, 0, sizeof(buffer));
+  }
+
+  uint32_t Load(const uint32_t aHandle, const int32_t aOffset) const {
+    const uint8_t* slot = reinterpret_cast<const uint8_t*>(buffer) + (aHandle * kSlotSize);
+    return __atomic_load_n(reinterpret_cast<const uint32_t*>(slot + aOffset), __ATOMIC_ACQUIRE);
+  }
+
+  void Release(Surface& aSurface) {
+    if (aSurface.texture && env) {
+      env->DeleteGlobalRef(aSurface.texture);
+    }
+    aSurface = Surface();
+  }
+};
+
+SurfaceLatchPtr
+SurfaceLatch::Create() {
+  return std::make_shared<vrb::ConcreteClass<SurfaceLatch, SurfaceLatch::State> >();
+}
+
+void
+SurfaceLatch::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
+  memset(m.buffer, 0, sizeof(m.buffer));
+  m.env = aEnv;
+  if (!m.env || !aActivity) {
+    return;
+  }
+  jclass surfaceTextureClass = m.env->FindClass(kSurfaceTextureClass);
+  if (surfaceTextureClass) {
+    m.updateTexImageMethod = m.env->GetMethodID(surfaceTextureClass, kUpdateTexImageName, kUpdateTexImageSignature);
+    m.env->DeleteLocalRef(surfaceTextureClass);
+  }
+  if (!m.updateTexImageMethod) {
+    VRB_LOG("Failed to find Java method: %s %s", kUpdateTexImageName, kUpdateTexImageSignature);
+    return;
+  }
+  jclass clazz = m.env->GetObjectClass(aActivity);
+  if (!clazz) {
+    return;
+  }
+  jmethodID setFrameCounters = m.env->GetMethodID(clazz, kSetFrameCountersName, kSetFrameCountersSignature);
+  if (!setFrameCounters) {
+    // Without counters every surface is latched every frame.
+    VRB_LOG("Failed to find Java method: %s %s", kSetFrameCountersName, kSetFrameCountersSignature);
+    return;
+  }
+  jobject byteBuffer = m.env->NewDirectByteBuffer(m.buffer, kBufferSize);
+  if (!byteBuffer) {
+    VRB_LOG("Failed to create SurfaceLatch ByteBuffer");
+    return;
+  }
+  m.env->CallVoidMethod(aActivity, setFrameCounters, byteBuffer);
+  m.env->DeleteLocalRef(byteBuffer);
+}
+
+void
+SurfaceLatch::ShutdownJava() {
+  for (Surface& surface: m.surfaces) {
+    m.Release(surface);
+  }
+  m.env = nullptr;
+  m.updateTexImageMethod = nullptr;
+}
+
+void
+SurfaceLatch::SetSurfaceTexture(const uint32_t aHandle, jobject aSurfaceTexture) {
+  if (aHandle >= m.surfaces.size()) {
+    if (!aSurfaceTexture) {
+      return;
+    }
+    m.surfaces.resize(aHandle + 1);
+  }
+  Surface& surface = m.surfaces[aHandle];
+  m.Release(surface);
+  if (aSurfaceTexture && m.env) {
+    surface.texture = m.env->NewGlobalRef(aSurfaceTexture);
+  }
+}
+
+void
+SurfaceLatch::Update() {
+  m.latchedCount = 0;
+  m.skippedCount = 0;
+  if (!m.env || !m.updateTexImageMethod) {
+    return;
+  }
+  for (uint32_t handle = 0; handle < m.surfaces.size(); handle++) {
+    Surface& surface = m.surfaces[handle];
+    surface.changed = false;
+    if (!surface.texture) {
+      continue;
+    }
+    bool counted = false;
+    uint32_t count = 0;
+    if ((handle < kMaxSurfaces) && m.Load(handle, kAttachedOffset)) {
+      counted = true;
+      count = m.Load(handle, kCountOffset);
+      if (surface.valid && (count == surface.latched)) {
+        m.skippedCount++;
+        continue;
+      }
+    }
+    // Each updateTexImage() consumes one queued frame, so the surface is latched once per
+    // frame counted since the last Update() to end up on the newest one. The first time
+    // a surface is counted the number of queued frames is unknown and it is latched once.
+    const uint32_t pending = (counted && surface.valid) ? count - surface.latched : 1;
+    const uint32_t latches = std::min(pending, kMaxLatchesPerUpdate);
+    bool failed = false;
+    for (uint32_t latch = 0; latch < latches; latch++) {
+      m.env->CallVoidMethod(surface.texture, m.updateTexImageMethod);
+      if (m.env->ExceptionCheck()) {
+        // Thrown when the texture is not attached to the current context, e.g. during a GL restart.
+        m.env->ExceptionClear();
+        VRB_LOG("SurfaceLatch failed to update surface %u", handle);
+        failed = true;
+        break;
+      }
+      surface.latched++;
+    }
+    if (failed) {
+      continue;
+    }
+    if (!surface.valid || (latches < pending)) {
+      // Either the first count, or the queue dropped the frames it could not hold.
+      surface.latched = count;
+    }
+    surface.valid = counted;
+    surface.changed = true;
+    m.latchedCount++;
+  }
+}
+
+bool
+SurfaceLatch::IsAttached(const uint32_t aHandle) const {
+  return (aHandle < kMaxSurfaces) && (m.Load(aHandle, kAttachedOffset) != 0);
+}
+
+bool
+SurfaceLatch::IsChanged(const uint32_t aHandle) const {
+  return (aHandle < m.surfaces.size()) && m.surfaces[aHandle].changed;
+}
+
+void
+SurfaceLatch::GetLastCounts(int32_t& aLatched, int32_t& aSkipped) const {
+  aLatched = m.latchedCount;
+  aSkipped = m.skippedCount;
+}
+
+SurfaceLatch::SurfaceLatch(State& aState) : m(aState) {}
+SurfaceLatch::~SurfaceLatch() {}
+
+} // namespace crow
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_SURFACELATCH_H
+#define VRBROWSER_SURFACELATCH_H
+
+#include "vrb/MacroUtils.h"
+
+#include <jni.h>
+#include <memory>
+
+namespace crow {
+
+class SurfaceLatch;
+typedef std::shared_ptr<SurfaceLatch> SurfaceLatchPtr;
+
+// Calls updateTexImage on the widget SurfaceTextures only when their producer queued a
+// new frame. Java counts onFrameAvailable per widget handle into a direct ByteBuffer and
+// the render thread compares the counts against the ones it last latched, calling
+// updateTexImage once per new frame so it ends up on the newest one. Surfaces Java
+// has not attached a listener to, or with a handle past kMaxSurfaces, are latched every frame.
+//
+// Layout (native byte order), must be kept in sync with SurfaceFrameCounters.java:
+//   slot[kMaxSurfaces]: int32 frame count, int32 attached
+class SurfaceLatch {
+public:
+  static const int32_t kMaxSurfaces = 64;
+  static const int32_t kSlotSize = 8;
+
+  static SurfaceLatchPtr Create();
+  void InitializeJava(JNIEnv* aEnv, jobject aActivity);
+  void ShutdownJava();
+  // aSurfaceTexture is an android.graphics.SurfaceTexture, nullptr detaches the handle.
+  void SetSurfaceTexture(const uint32_t aHandle, jobject aSurfaceTexture);
+  // Latches the surfaces with new frames, must be called on the GL thread.
+  void Update();
+  // True while Java counts the frames of the surface, i.e. a producer is attached to it.
+  bool IsAttached(const uint32_t aHandle) const;
+  // True if the surface was latched by the last Update().
+  bool IsChanged(const uint32_t aHandle) const;
+  // Surfaces latched and skipped by the last Update().
+  void GetLastCounts(int32_t& aLatched, int32_t& aSkipped) const;
+protected:
+  struct State;
+  SurfaceLatch(State& aState);
+  ~SurfaceLatch();
+private:
+  State& m;
+  SurfaceLatch() = delete;
+  VRB_NO_DEFAULTS(SurfaceLatch)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_SURFACELATCH_H
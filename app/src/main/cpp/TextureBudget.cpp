@@ -0,0 +1,155 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "TextureBudget.h"
+#include "vrb/ConcreteClass.h"
+
+#include <vector>
+
+namespace {
+
+typedef crow::TextureBudget::Residency Residency;
+
+// Widgets viewed within this many frames, about two seconds, are never evicted so that a
+// quick look around does not drop the surfaces of the windows around the user.
+static const int64_t kMinIdleFrames = 144;
+
+struct Entry {
+  int64_t bytes;
+  int64_t lastViewed;
+  int64_t residencyFrame;
+  Residency residency;
+  Entry() : bytes(0), lastViewed(0), residencyFrame(0), residency(Residency::Live) {}
+};
+
+} // namespace
+
+namespace crow {
+
+struct TextureBudget::State {
+  std::vector<Entry> entries;
+  int64_t budget;
+  int64_t frame;
+  State() : budget(0), frame(0) {}
+
+  Entry* GetEntry(const int32_t aIndex) {
+    if ((aIndex < 0) || (aIndex >= (int32_t)entries.size())) {
+      return nullptr;
+    }
+    return &entries[aIndex];
+  }
+
+  const Entry* GetEntry(const int32_t aIndex) const {
+    if ((aIndex < 0) || (aIndex >= (int32_t)entries.size())) {
+      return nullptr;
+    }
+    return &entries[aIndex];
+  }
+};
+
+TextureBudgetPtr
+TextureBudget::Create() {
+  return std::make_shared<vrb::ConcreteClass<TextureBudget, TextureBudget::State> >();
+}
+
+void
+TextureBudget::SetBudget(const int64_t aBytes) {
+  m.budget = aBytes < 0 ? 0 : aBytes;
+}
+
+int64_t
+TextureBudget::GetBudget() const {
+  return m.budget;
+}
+
+void
+TextureBudget::SetCount(const int32_t aCount) {
+  const size_t previous = m.entries.size();
+  m.entries.resize((size_t)(aCount < 0 ? 0 : aCount));
+  // New widgets count as just viewed so they get the chance to be seen before being evicted.
+  for (size_t ix = previous; ix < m.entries.size(); ix++) {
+    m.entries[ix].lastViewed = m.frame;
+    m.entries[ix].residencyFrame = m.frame;
+  }
+}
+
+void
+TextureBudget::BeginFrame() {
+  m.frame++;
+}
+
+void
+TextureBudget::Update(const int32_t aIndex, const int64_t aBytes, const bool aViewed) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (!entry) {
+    return;
+  }
+  entry->bytes = aBytes;
+  if (aViewed) {
+    entry->lastViewed = m.frame;
+  }
+}
+
+void
+TextureBudget::SetResidency(const int32_t aIndex, const Residency aResidency) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (!entry || (entry->residency == aResidency)) {
+    return;
+  }
+  entry->residency = aResidency;
+  entry->residencyFrame = m.frame;
+}
+
+TextureBudget::Residency
+TextureBudget::GetResidency(const int32_t aIndex) const {
+  const Entry* entry = m.GetEntry(aIndex);
+  return entry ? entry->residency : Residency::Live;
+}
+
+int32_t
+TextureBudget::GetResidencyFrames(const int32_t aIndex) const {
+  const Entry* entry = m.GetEntry(aIndex);
+  return entry ? (int32_t)(m.frame - entry->residencyFrame) : 0;
+}
+
+int64_t
+TextureBudget::GetUsedBytes() const {
+  int64_t result = 0;
+  for (const Entry& entry: m.entries) {
+    result += entry.bytes;
+  }
+  return result;
+}
+
+int32_t
+TextureBudget::FindEviction() const {
+  if (m.budget <= 0) {
+    return -1;
+  }
+  int64_t retained = 0;
+  for (const Entry& entry: m.entries) {
+    if (entry.residency != Residency::Releasing) {
+      retained += entry.bytes;
+    }
+  }
+  if (retained <= m.budget) {
+    return -1;
+  }
+  int32_t result = -1;
+  int64_t oldest = m.frame - kMinIdleFrames;
+  for (size_t ix = 0; ix < m.entries.size(); ix++) {
+    const Entry& entry = m.entries[ix];
+    if ((entry.residency == Residency::Live) && (entry.bytes > 0) && (entry.lastViewed < oldest)) {
+      oldest = entry.lastViewed;
+      result = (int32_t)ix;
+    }
+  }
+  return result;
+}
+
+TextureBudget::TextureBudget(State& aState) : m(aState) {}
+TextureBudget::~TextureBudget() {}
+
+} // namespace crow
@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_TEXTUREBUDGET_H
+#define VRBROWSER_TEXTUREBUDGET_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class TextureBudget;
+typedef std::shared_ptr<TextureBudget> TextureBudgetPtr;
+
+// Keeps the texture memory of the widget surfaces within a budget by picking which widgets
+// to hibernate. A hibernated widget has released its SurfaceTexture and is drawn from a
+// downscaled snapshot. Widgets are evicted least recently viewed first, and only once they
+// have been off screen for a while. BrowserWorld drives the residency of each widget:
+//   Live -> Releasing: the snapshot was taken and Java was asked to drop the producer.
+//   Releasing -> Hibernated: the SurfaceTexture was destroyed.
+//   Hibernated -> Restoring: the widget was viewed again and its SurfaceTexture recreated.
+//   Restoring -> Live: the first frame of the new surface was latched, the snapshot is freed.
+// Entries are indexed like BrowserWorld's widget list.
+class TextureBudget {
+public:
+  enum class Residency {
+    Live,
+    Releasing,
+    Hibernated,
+    Restoring
+  };
+  static TextureBudgetPtr Create();
+  // Zero disables hibernation.
+  void SetBudget(const int64_t aBytes);
+  int64_t GetBudget() const;
+  void SetCount(const int32_t aCount);
+  // Advances the clock that orders the widgets by when they were last viewed.
+  void BeginFrame();
+  // Texture memory held for the widget, and whether it was viewed this frame.
+  void Update(const int32_t aIndex, const int64_t aBytes, const bool aViewed);
+  void SetResidency(const int32_t aIndex, const Residency aResidency);
+  Residency GetResidency(const int32_t aIndex) const;
+  // Frames since the residency of the widget last changed.
+  int32_t GetResidencyFrames(const int32_t aIndex) const;
+  int64_t GetUsedBytes() const;
+  // The live widget to hibernate next, or -1 when the memory not already being released
+  // fits the budget or every live widget was viewed recently.
+  int32_t FindEviction() const;
+protected:
+  struct State;
+  TextureBudget(State& aState);
+  ~TextureBudget();
+private:
+  State& m;
+  TextureBudget() = delete;
+  VRB_NO_DEFAULTS(TextureBudget)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_TEXTUREBUDGET_H
@@ -0,0 +1,310 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ThumbnailAtlas.h"
+#include "vrb/ConcreteClass.h"
+
+#include "QuadLayerRenderer.h"
+#include "SkylinePacker.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+static const int64_t kBytesPerTexel = 4;
+// Texels kept free between thumbnails so linear filtering does not sample the neighbors.
+static const int32_t kPadding = 2;
+
+struct Thumbnail {
+  uint32_t key;
+  crow::SkylinePacker::Rect rect;
+  bool packed;
+  bool copied;
+  bool stale;
+  int64_t copyFrame;
+  // Pending copy, in queue order.
+  GLuint surface;
+  int64_t requestFrame;
+  Thumbnail(const uint32_t aKey) : key(aKey), packed(false), copied(false), stale(false), copyFrame(0), surface(0),
+                                   requestFrame(0) {}
+};
+
+} // namespace
+
+namespace crow {
+
+struct ThumbnailAtlas::State {
+  std::vector<Thumbnail> thumbnails;
+  SkylinePackerPtr packer;
+  GLuint texture;
+  GLuint framebuffer;
+  int32_t size;
+  int64_t frame;
+  State() : texture(0), framebuffer(0), size(0), frame(0) {
+    packer = SkylinePacker::Create();
+  }
+
+  Thumbnail* Find(const uint32_t aKey) {
+    for (Thumbnail& thumbnail: thumbnails) {
+      if (thumbnail.key == aKey) {
+        return &thumbnail;
+      }
+    }
+    return nullptr;
+  }
+
+  const Thumbnail* Find(const uint32_t aKey) const {
+    for (const Thumbnail& thumbnail: thumbnails) {
+      if (thumbnail.key == aKey) {
+        return &thumbnail;
+      }
+    }
+    return nullptr;
+  }
+
+  // Packs every thumbnail again from an empty atlas, tallest first. Their content is lost
+  // and the ones that no longer fit are dropped.
+  void Repack() {
+    packer->Reset(size, size, kPadding);
+    std::vector<Thumbnail*> order;
+    for (Thumbnail& thumbnail: thumbnails) {
+      order.push_back(&thumbnail);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Thumbnail* aLeft, const Thumbnail* aRight) {
+      return aLeft->rect.height > aRight->rect.height;
+    });
+    for (Thumbnail* thumbnail: order) {
+      thumbnail->packed = packer->Insert(thumbnail->rect.width, thumbnail->rect.height, thumbnail->rect);
+      thumbnail->copied = false;
+    }
+    const size_t count = thumbnails.size();
+    thumbnails.erase(std::remove_if(thumbnails.begin(), thumbnails.end(), [](const Thumbnail& aThumbnail) {
+      return !aThumbnail.packed;
+    }), thumbnails.end());
+    if (thumbnails.size() != count) {
+      VRB_LOG("ThumbnailAtlas dropped %d thumbnails while repacking", (int)(count - thumbnails.size()));
+    }
+  }
+
+  bool Copy(QuadLayerRenderer& aRenderer, const Thumbnail& aThumbnail) {
+    VRB_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer));
+    VRB_CHECK(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0));
+    const GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    if (status == GL_FRAMEBUFFER_COMPLETE) {
+      VRB_CHECK(glViewport(aThumbnail.rect.x, aThumbnail.rect.y, aThumbnail.rect.width, aThumbnail.rect.height));
+      aRenderer.Copy(aThumbnail.surface);
+    } else {
+      VRB_LOG("ThumbnailAtlas framebuffer incomplete: 0x%X", status);
+    }
+    VRB_CHECK(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0));
+    return status == GL_FRAMEBUFFER_COMPLETE;
+  }
+};
+
+ThumbnailAtlasPtr
+ThumbnailAtlas::Create() {
+  return std::make_shared<vrb::ConcreteClass<ThumbnailAtlas, ThumbnailAtlas::State> >();
+}
+
+bool
+ThumbnailAtlas::Initialize(const int32_t aSize) {
+  if (m.texture) {
+    return true;
+  }
+  if (aSize <= 0) {
+    return false;
+  }
+  m.size = aSize;
+  VRB_CHECK(glGenTextures(1, &m.texture));
+  VRB_CHECK(glBindTexture(GL_TEXTURE_2D, m.texture));
+  VRB_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m.size, m.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  VRB_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  VRB_CHECK(glGenFramebuffers(1, &m.framebuffer));
+  m.packer->Reset(m.size, m.size, kPadding);
+  m.thumbnails.clear();
+  return true;
+}
+
+bool
+ThumbnailAtlas::IsInitialized() const {
+  return m.texture != 0;
+}
+
+void
+ThumbnailAtlas::Shutdown() {
+  if (m.texture) {
+    VRB_CHECK(glDeleteTextures(1, &m.texture));
+    m.texture = 0;
+  }
+  if (m.framebuffer) {
+    VRB_CHECK(glDeleteFramebuffers(1, &m.framebuffer));
+    m.framebuffer = 0;
+  }
+  m.thumbnails.clear();
+  m.size = 0;
+}
+
+bool
+ThumbnailAtlas::RequestCopy(const uint32_t aKey, const GLuint aSurface, const int32_t aWidth,
+                            const int32_t aHeight) {
+  if (!m.texture || !aSurface || (aWidth <= 0) || (aHeight <= 0) || (aWidth > m.size) || (aHeight > m.size)) {
+    return false;
+  }
+  Thumbnail* thumbnail = m.Find(aKey);
+  if (!thumbnail) {
+    m.thumbnails.emplace_back(aKey);
+    thumbnail = &m.thumbnails.back();
+  }
+  if ((thumbnail->rect.width != aWidth) || (thumbnail->rect.height != aHeight)) {
+    // The old space is only reclaimed by the next repack.
+    thumbnail->rect.width = aWidth;
+    thumbnail->rect.height = aHeight;
+    thumbnail->packed = m.packer->Insert(aWidth, aHeight, thumbnail->rect);
+    thumbnail->copied = false;
+    if (!thumbnail->packed) {
+      m.Repack();
+      thumbnail = m.Find(aKey);
+      if (!thumbnail) {
+        return false;
+      }
+    }
+  }
+  if (!thumbnail->surface) {
+    thumbnail->requestFrame = m.frame;
+  }
+  thumbnail->surface = aSurface;
+  return true;
+}
+
+void
+ThumbnailAtlas::CancelCopy(const uint32_t aKey) {
+  Thumbnail* thumbnail = m.Find(aKey);
+  if (thumbnail) {
+    thumbnail->surface = 0;
+  }
+}
+
+void
+ThumbnailAtlas::Remove(const uint32_t aKey) {
+  m.thumbnails.erase(std::remove_if(m.thumbnails.begin(), m.thumbnails.end(), [aKey](const Thumbnail& aThumbnail) {
+    return aThumbnail.key == aKey;
+  }), m.thumbnails.end());
+}
+
+void
+ThumbnailAtlas::Invalidate(const uint32_t aKey) {
+  Thumbnail* thumbnail = m.Find(aKey);
+  if (thumbnail) {
+    thumbnail->stale = true;
+  }
+}
+
+bool
+ThumbnailAtlas::IsStale(const uint32_t aKey) const {
+  const Thumbnail* thumbnail = m.Find(aKey);
+  return thumbnail && thumbnail->stale;
+}
+
+int32_t
+ThumbnailAtlas::Update(QuadLayerRenderer& aRenderer, const int32_t aMaxCopies) {
+  m.frame++;
+  if (!m.texture || !aRenderer.IsInitialized()) {
+    return 0;
+  }
+  std::vector<Thumbnail*> queue;
+  for (Thumbnail& thumbnail: m.thumbnails) {
+    if (thumbnail.surface) {
+      queue.push_back(&thumbnail);
+    }
+  }
+  if (queue.empty()) {
+    return 0;
+  }
+  std::stable_sort(queue.begin(), queue.end(), [](const Thumbnail* aLeft, const Thumbnail* aRight) {
+    return aLeft->requestFrame < aRight->requestFrame;
+  });
+  GLint previousFramebuffer = 0;
+  GLint viewport[4] = {0, 0, 0, 0};
+  VRB_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer));
+  VRB_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+  const GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  VRB_CHECK(glDisable(GL_SCISSOR_TEST));
+  int32_t copies = 0;
+  for (Thumbnail* thumbnail: queue) {
+    if (copies >= aMaxCopies) {
+      break;
+    }
+    if (m.Copy(aRenderer, *thumbnail)) {
+      thumbnail->copied = true;
+      thumbnail->stale = false;
+      thumbnail->copyFrame = m.frame;
+    }
+    thumbnail->surface = 0;
+    copies++;
+  }
+  VRB_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousFramebuffer));
+  VRB_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+  if (scissor) { VRB_CHECK(glEnable(GL_SCISSOR_TEST)); }
+  return copies;
+}
+
+bool
+ThumbnailAtlas::HasThumbnail(const uint32_t aKey) const {
+  const Thumbnail* thumbnail = m.Find(aKey);
+  return thumbnail && thumbnail->copied;
+}
+
+bool
+ThumbnailAtlas::IsCopyPending(const uint32_t aKey) const {
+  const Thumbnail* thumbnail = m.Find(aKey);
+  return thumbnail && thumbnail->surface;
+}
+
+int32_t
+ThumbnailAtlas::GetAge(const uint32_t aKey) const {
+  const Thumbnail* thumbnail = m.Find(aKey);
+  if (!thumbnail || !thumbnail->copied) {
+    return -1;
+  }
+  return (int32_t)(m.frame - thumbnail->copyFrame);
+}
+
+GLuint
+ThumbnailAtlas::GetTexture() const {
+  return m.texture;
+}
+
+int64_t
+ThumbnailAtlas::GetBytes() const {
+  return (int64_t)m.size * (int64_t)m.size * kBytesPerTexel;
+}
+
+bool
+ThumbnailAtlas::SetInstance(const uint32_t aKey, WidgetQuadRenderer::Instance& aInstance) const {
+  const Thumbnail* thumbnail = m.Find(aKey);
+  if (!thumbnail || !thumbnail->copied) {
+    return false;
+  }
+  // Inset by half a texel so the edges sample the thumbnail and not the padding.
+  const float scale = 1.0f / (float)m.size;
+  const SkylinePacker::Rect& rect = thumbnail->rect;
+  aInstance.texture = m.texture;
+  aInstance.target = GL_TEXTURE_2D;
+  aInstance.SetUVRect(((float)rect.x + 0.5f) * scale, ((float)rect.y + 0.5f) * scale,
+                      ((float)rect.width - 1.0f) * scale, ((float)rect.height - 1.0f) * scale);
+  return true;
+}
+
+ThumbnailAtlas::ThumbnailAtlas(State& aState) : m(aState) {}
+ThumbnailAtlas::~ThumbnailAtlas() {}
+
+} // namespace crow
@@ -0,0 +1,72 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_THUMBNAILATLAS_H
+#define VRBROWSER_THUMBNAILATLAS_H
+
+#include "vrb/MacroUtils.h"
+
+#include "WidgetQuadRenderer.h"
+
+#include <GLES3/gl3.h>
+#include <memory>
+
+namespace crow {
+
+class QuadLayerRenderer;
+class ThumbnailAtlas;
+typedef std::shared_ptr<ThumbnailAtlas> ThumbnailAtlasPtr;
+
+// Downscaled copies of many widget surfaces packed into one square GL_TEXTURE_2D, so that
+// a tab overview draws every thumbnail with a single instanced draw. Space is handed out
+// by a SkylinePacker; when it runs out the atlas is repacked and the thumbnails have to be
+// copied again. Copies are queued and made a few per frame by Update(), spreading the
+// cost of refreshing dozens of thumbnails over several frames. Thumbnails are identified
+// by a caller chosen key, e.g. the widget handle. Calls touching GL need a current context.
+class ThumbnailAtlas {
+public:
+  static ThumbnailAtlasPtr Create();
+  // Allocates the aSize x aSize atlas texture.
+  bool Initialize(const int32_t aSize);
+  bool IsInitialized() const;
+  // Deletes the texture and forgets every thumbnail.
+  void Shutdown();
+  // Reserves aWidth x aHeight texels for the thumbnail of aKey and queues a copy of the
+  // external texture aSurface into it, replacing a pending copy of the same key. Returns
+  // false if the thumbnail does not fit even in an empty atlas.
+  bool RequestCopy(const uint32_t aKey, const GLuint aSurface, const int32_t aWidth, const int32_t aHeight);
+  // Drops a pending copy, e.g. because its surface is about to be destroyed. The thumbnail
+  // keeps its last content.
+  void CancelCopy(const uint32_t aKey);
+  void Remove(const uint32_t aKey);
+  // Marks the thumbnail as older than its surface, e.g. after a new frame was latched.
+  void Invalidate(const uint32_t aKey);
+  bool IsStale(const uint32_t aKey) const;
+  // Advances the frame clock and makes up to aMaxCopies of the queued copies, oldest first.
+  // Returns the number of copies made.
+  int32_t Update(QuadLayerRenderer& aRenderer, const int32_t aMaxCopies);
+  // True once a copy was made into the current space of the thumbnail.
+  bool HasThumbnail(const uint32_t aKey) const;
+  bool IsCopyPending(const uint32_t aKey) const;
+  // Frames since the thumbnail was last copied, or -1 if it has no content.
+  int32_t GetAge(const uint32_t aKey) const;
+  GLuint GetTexture() const;
+  int64_t GetBytes() const;
+  // Points aInstance, already Set() with the thumbnail quad, at the thumbnail of aKey.
+  // Returns false if the thumbnail has no content.
+  bool SetInstance(const uint32_t aKey, WidgetQuadRenderer::Instance& aInstance) const;
+protected:
+  struct State;
+  ThumbnailAtlas(State& aState);
+  ~ThumbnailAtlas();
+private:
+  State& m;
+  ThumbnailAtlas() = delete;
+  VRB_NO_DEFAULTS(ThumbnailAtlas)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_THUMBNAILATLAS_H
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ViewFrustum.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Camera.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+namespace {
+
+enum Corner {
+  NearBottomLeft,
+  NearBottomRight,
+  NearTopRight,
+  NearTopLeft,
+  FarBottomLeft,
+  FarBottomRight,
+  FarTopRight,
+  FarTopLeft,
+  CornerCount
+};
+
+struct Plane {
+  vrb::Vector normal;
+  float distance;
+  Plane() : distance(0.0f) {}
+  void Set(const vrb::Vector& aA, const vrb::Vector& aB, const vrb::Vector& aC, const vrb::Vector& aInside) {
+    normal = (aB - aA).Cross(aC - aA).Normalize();
+    distance = -normal.Dot(aA);
+    // Keep the normal pointing into the frustum regardless of the corner winding.
+    if (DistanceTo(aInside) < 0.0f) {
+      normal = -normal;
+      distance = -distance;
+    }
+  }
+  float DistanceTo(const vrb::Vector& aPoint) const {
+    return normal.Dot(aPoint) + distance;
+  }
+};
+
+void
+GetCorners(const vrb::Camera& aCamera, vrb::Vector aCorners[CornerCount]) {
+  static const vrb::Vector kNDC[CornerCount] = {
+      vrb::Vector(-1.0f, -1.0f, -1.0f), vrb::Vector(1.0f, -1.0f, -1.0f),
+      vrb::Vector(1.0f, 1.0f, -1.0f), vrb::Vector(-1.0f, 1.0f, -1.0f),
+      vrb::Vector(-1.0f, -1.0f, 1.0f), vrb::Vector(1.0f, -1.0f, 1.0f),
+      vrb::Vector(1.0f, 1.0f, 1.0f), vrb::Vector(-1.0f, 1.0f, 1.0f)
+  };
+  const vrb::Matrix inversePerspective = aCamera.GetPerspective().Inverse();
+  const vrb::Matrix& transform = aCamera.GetTransform();
+  for (int32_t ix = 0; ix < CornerCount; ix++) {
+    aCorners[ix] = transform.MultiplyPosition(inversePerspective.MultiplyPosition(kNDC[ix]));
+  }
+}
+
+} // namespace
+
+namespace crow {
+
+struct ViewFrustum::State {
+  enum PlaneIndex { Left, Right, Top, Bottom, Near, Far, PlaneCount };
+  Plane planes[PlaneCount];
+  bool valid;
+  State() : valid(false) {}
+};
+
+ViewFrustumPtr
+ViewFrustum::Create() {
+  return std::make_shared<vrb::ConcreteClass<ViewFrustum, ViewFrustum::State> >();
+}
+
+void
+ViewFrustum::Update(const vrb::Camera& aLeft, const vrb::Camera& aRight) {
+  vrb::Vector left[CornerCount];
+  vrb::Vector right[CornerCount];
+  GetCorners(aLeft, left);
+  GetCorners(aRight, right);
+  vrb::Vector inside;
+  for (int32_t ix = 0; ix < CornerCount; ix++) {
+    inside += left[ix];
+    inside += right[ix];
+  }
+  inside = inside * (1.0f / (float)(CornerCount * 2));
+
+  m.planes[State::Left].Set(left[NearBottomLeft], left[NearTopLeft], left[FarBottomLeft], inside);
+  m.planes[State::Right].Set(right[NearBottomRight], right[NearTopRight], right[FarBottomRight], inside);
+  m.planes[State::Top].Set(left[NearTopLeft], left[FarTopLeft], right[FarTopRight], inside);
+  m.planes[State::Bottom].Set(left[NearBottomLeft], left[FarBottomLeft], right[FarBottomRight], inside);
+  m.planes[State::Near].Set(left[NearBottomLeft], left[NearTopLeft], right[NearBottomRight], inside);
+  m.planes[State::Far].Set(left[FarBottomLeft], left[FarTopLeft], right[FarBottomRight], inside);
+  m.valid = true;
+}
+
+bool
+ViewFrustum::IsValid() const {
+  return m.valid;
+}
+
+bool
+ViewFrustum::IntersectsSphere(const vrb::Vector& aCenter, const float aRadius) const {
+  if (!m.valid) {
+    return true;
+  }
+  for (const Plane& plane: m.planes) {
+    if (plane.DistanceTo(aCenter) < -aRadius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ViewFrustum::ViewFrustum(State& aState) : m(aState) {}
+ViewFrustum::~ViewFrustum() {}
+
+} // namespace crow
@@ -0,0 +1,39 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_VIEWFRUSTUM_H
+#define VRBROWSER_VIEWFRUSTUM_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class ViewFrustum;
+typedef std::shared_ptr<ViewFrustum> ViewFrustumPtr;
+
+// World space frustum enclosing both eyes: the left plane comes from the left camera,
+// the right plane from the right camera and the remaining planes are shared.
+class ViewFrustum {
+public:
+  static ViewFrustumPtr Create();
+  void Update(const vrb::Camera& aLeft, const vrb::Camera& aRight);
+  bool IsValid() const;
+  bool IntersectsSphere(const vrb::Vector& aCenter, const float aRadius) const;
+protected:
+  struct State;
+  ViewFrustum(State& aState);
+  ~ViewFrustum();
+private:
+  State& m;
+  ViewFrustum() = delete;
+  VRB_NO_DEFAULTS(ViewFrustum)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_VIEWFRUSTUM_H
@@ -12,7 +12,6 @@
 #include "vrb/Geometry.h"
 #include "vrb/RenderState.h"
 #include "vrb/SurfaceTextureFactory.h"
-#include "vrb/TextureSurface.h"
 #include "vrb/Toggle.h"
 #include "vrb/Transform.h"
 #include "vrb/Vector.h"
@@ -22,6 +21,7 @@ namespace crow {
 
 const float kWidth = 9.0f;
 const float kHeight = kWidth * 0.5625f;
+const float kPointerOffset = 0.1f;
 static uint32_t sWidgetCount;
 
 struct Widget::State {
@@ -31,14 +31,28 @@ struct Widget::State {
   uint32_t handle;
   int32_t textureWidth;
   int32_t textureHeight;
+  int32_t surfaceWidth;
+  int32_t surfaceHeight;
   vrb::Vector windowMin;
   vrb::Vector windowMax;
-  vrb::Vector windowNormal;
   vrb::TogglePtr root;
   vrb::TransformPtr transform;
-  vrb::TextureSurfacePtr surface;
+  vrb::Matrix inverseTransform;
+  bool inverseDirty;
+  vrb::TogglePtr cullToggle;
+  bool culled;
+  uint32_t textureHandle;
+  int32_t quadLayer;
+  vrb::Vector boundsCenter;
+  float boundsRadius;
+  bool boundsDirty;
+  bool contentChanged;
+  uint32_t snapshot;
   vrb::TogglePtr pointerToggle;
   vrb::TransformPtr pointer;
+  // Mirrors pointerToggle and pointer so unchanged state is not pushed into the scene graph.
+  bool pointerVisible;
+  vrb::Vector pointerPosition;
   vrb::NodePtr pointerGeometry;
 
   State()
@@ -46,102 +60,123 @@ struct Widget::State {
       , handle(0)
       , textureWidth(1920)
       , textureHeight(1080)
+      , surfaceWidth(0)
+      , surfaceHeight(0)
       , windowMin(-kWidth, 0.0f, 0.0f)
       , windowMax(kWidth, kHeight * 2.0f, 0.0f)
+      , inverseTransform(vrb::Matrix::Identity())
+      , inverseDirty(true)
+      , culled(false)
+      , textureHandle(0)
+      , quadLayer(-1)
+      , boundsRadius(0.0f)
+      , boundsDirty(true)
+      , contentChanged(false)
+      , snapshot(0)
+      , pointerVisible(false)
   {}
 
   void Initialize(const int32_t aType) {
     type = aType;
+    surfaceWidth = textureWidth;
+    surfaceHeight = textureHeight;
     handle = sWidgetCount;
     sWidgetCount++;
     name = "crow::Widget-";
     name += std::to_string(type) + "-" + std::to_string(handle);
-    surface = vrb::TextureSurface::Create(context, name);
-    vrb::VertexArrayPtr array = vrb::VertexArray::Create(context);
-    const vrb::Vector bottomRight(windowMax.x(), windowMin.y(), windowMin.z());
-    array->AppendVertex(windowMin); // Bottom left
-    array->AppendVertex(bottomRight); // Bottom right
-    array->AppendVertex(windowMax); // Top right
-    array->AppendVertex(vrb::Vector(windowMin.x(), windowMax.y(), windowMax.z())); // Top left
-
-    array->AppendUV(vrb::Vector(0.0f, 1.0f, 0.0f));
-    array->AppendUV(vrb::Vector(1.0f, 1.0f, 0.0f));
-    array->AppendUV(vrb::Vector(1.0f, 0.0f, 0.0f));
-    array->AppendUV(vrb::Vector(0.0f, 0.0f, 0.0f));
-
-    windowNormal = (bottomRight - windowMin).Cross(windowMax - windowMin).Normalize();
-    array->AppendNormal(windowNormal);
-
-    vrb::RenderStatePtr state = vrb::RenderState::Create(context);
-    state->SetTexture(surface);
-    state->SetMaterial(vrb::Color(0.4f, 0.4f, 0.4f), vrb::Color(1.0f, 1.0f, 1.0f), vrb::Color(0.0f, 0.0f, 0.0f),
-                       0.0f);
-    vrb::GeometryPtr geometry = vrb::Geometry::Create(context);
-    pointerGeometry = geometry;
-    geometry->SetVertexArray(array);
-    geometry->SetRenderState(state);
-
-    std::vector<int> index;
-    index.push_back(1);
-    index.push_back(2);
-    index.push_back(3);
-    index.push_back(4);
-    std::vector<int> normalIndex;
-    normalIndex.push_back(1);
-    normalIndex.push_back(1);
-    normalIndex.push_back(1);
-    normalIndex.push_back(1);
-    geometry->AddFace(index, index, normalIndex);
-
-    // Draw the back for now
-    index.clear();
-    index.push_back(1);
-    index.push_back(4);
-    index.push_back(3);
-    index.push_back(2);
-
-    array->AppendNormal(-windowNormal);
-    normalIndex.clear();
-    normalIndex.push_back(2);
-    normalIndex.push_back(2);
-    normalIndex.push_back(2);
-    normalIndex.push_back(2);
-    geometry->AddFace(index, index, normalIndex);
-
+    // The SurfaceTexture is created without a vrb::TextureSurface, which would latch it every
+    // frame. BrowserWorld latches it through SurfaceLatch and draws the quad with instancing.
+    vrb::ContextPtr strongContext = context.lock();
+    if (strongContext) {
+      strongContext->GetSurfaceTextureFactory()->CreateSurfaceTexture(name, nullptr);
+    }
+
+    cullToggle = vrb::Toggle::Create(context);
     transform = vrb::Transform::Create(context);
-    transform->AddNode(geometry);
+    transform->AddNode(cullToggle);
     root = vrb::Toggle::Create(context);
     root->AddNode(transform);
-    const float kOffset = 0.1f;
-    array = vrb::VertexArray::Create(context);
-    array->AppendVertex(vrb::Vector(0.1f, -0.2f, kOffset));
-    array->AppendVertex(vrb::Vector(0.2f, -0.1f, kOffset));
-    array->AppendVertex(vrb::Vector(0.0f, 0.0f, kOffset));
-    array->AppendNormal(vrb::Vector(0.0f, 0.0f, 1.0f));
-    index.clear();
-    index.push_back(1);
-    index.push_back(2);
-    index.push_back(3);
-    normalIndex.clear();
-    normalIndex.push_back(1);
-    normalIndex.push_back(1);
-    normalIndex.push_back(1);
-    std::vector<int> uvIndex;
-    geometry = vrb::Geometry::Create(context);
-    geometry->SetVertexArray(array);
-    geometry->AddFace(index, uvIndex, normalIndex);
-    state = vrb::RenderState::Create(context);
-    state->SetMaterial(vrb::Color(1.0f, 0.0f, 0.0f), vrb::Color(1.0f, 0.0f, 0.0f), vrb::Color(0.0f, 0.0f, 0.0f),
-                       0.0f);
-    geometry->SetRenderState(state);
+    // The pointer mesh is shared by all widgets, see SetPointerGeometry().
     pointer = vrb::Transform::Create(context);
-    pointer->AddNode(geometry);
     pointerToggle = vrb::Toggle::Create(context);
     pointerToggle->AddNode(pointer);
-    transform->AddNode(pointerToggle);
+    pointerToggle->ToggleAll(false);
+    cullToggle->AddNode(pointerToggle);
+  }
+
+  const vrb::Matrix& GetInverseTransform() {
+    if (inverseDirty) {
+      inverseTransform = transform->GetTransform().AfineInverse();
+      inverseDirty = false;
+    }
+    return inverseTransform;
+  }
+
+  void SetPointerPosition(const vrb::Vector& aPoint) {
+    vrb::Vector result = aPoint;
+    // Clamp to keep pointer in window.
+    if (result.x() > windowMax.x()) { result.x() = windowMax.x(); }
+    else if (result.x() < windowMin.x()) { result.x() = windowMin.x(); }
+
+    if (result.y() > windowMax.y()) { result.y() = windowMax.y(); }
+    else if (result.y() < windowMin.y()) { result.y() = windowMin.y(); }
+
+    if ((result.x() == pointerPosition.x()) && (result.y() == pointerPosition.y()) &&
+        (result.z() == pointerPosition.z())) {
+      return;
+    }
+    pointerPosition = result;
+    pointer->SetTransform(vrb::Matrix::Position(result));
+  }
+
+  void UpdateBounds() {
+    const vrb::Matrix& matrix = transform->GetTransform();
+    const vrb::Vector corners[] = {
+        windowMin,
+        vrb::Vector(windowMax.x(), windowMin.y(), windowMin.z()),
+        windowMax,
+        vrb::Vector(windowMin.x(), windowMax.y(), windowMax.z())
+    };
+    boundsCenter = matrix.MultiplyPosition((windowMin + windowMax) * 0.5f);
+    boundsRadius = 0.0f;
+    for (const vrb::Vector& corner: corners) {
+      const float distance = (matrix.MultiplyPosition(corner) - boundsCenter).Magnitude();
+      if (distance > boundsRadius) {
+        boundsRadius = distance;
+      }
+    }
+    // Leave room for the pointer which floats slightly in front of the quad.
+    boundsRadius += kPointerOffset;
+    boundsDirty = false;
   }
 };
 
+vrb::NodePtr
+Widget::CreatePointerGeometry(vrb::ContextWeak aContext) {
+  vrb::VertexArrayPtr array = vrb::VertexArray::Create(aContext);
+  array->AppendVertex(vrb::Vector(0.1f, -0.2f, kPointerOffset));
+  array->AppendVertex(vrb::Vector(0.2f, -0.1f, kPointerOffset));
+  array->AppendVertex(vrb::Vector(0.0f, 0.0f, kPointerOffset));
+  array->AppendNormal(vrb::Vector(0.0f, 0.0f, 1.0f));
+  std::vector<int> index;
+  index.push_back(1);
+  index.push_back(2);
+  index.push_back(3);
+  std::vector<int> normalIndex;
+  normalIndex.push_back(1);
+  normalIndex.push_back(1);
+  normalIndex.push_back(1);
+  std::vector<int> uvIndex;
+  vrb::GeometryPtr geometry = vrb::Geometry::Create(aContext);
+  geometry->SetVertexArray(array);
+  geometry->AddFace(index, uvIndex, normalIndex);
+  vrb::RenderStatePtr state = vrb::RenderState::Create(aContext);
+  state->SetMaterial(vrb::Color(1.0f, 0.0f, 0.0f), vrb::Color(1.0f, 0.0f, 0.0f), vrb::Color(0.0f, 0.0f, 0.0f),
+                     0.0f);
+  geometry->SetRenderState(state);
+  return geometry;
+}
+
 WidgetPtr
 Widget::Create(vrb::ContextWeak aContext, const int32_t aType) {
   WidgetPtr result = std::make_shared<vrb::ConcreteClass<Widget, Widget::State> >(aContext);
@@ -194,56 +229,21 @@ Widget::GetSurfaceTextureSize(int32_t& aWidth, int32_t& aHeight) const {
 }
 
 void
-Widget::GetWidgetMinAndMax(vrb::Vector& aMin, vrb::Vector& aMax) const {
-  aMin = m.windowMin;
-  aMax = m.windowMax;
+Widget::SetSurfaceSize(const int32_t aWidth, const int32_t aHeight) {
+  m.surfaceWidth = aWidth;
+  m.surfaceHeight = aHeight;
 }
 
-static const float kEpsilon = 0.00000001f;
-
-bool
-Widget::TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, bool& aIsInWidget, float& aDistance) const {
-  aDistance = -1.0f;
-  if (!m.root->IsEnabled(*m.transform)) {
-    return false;
-  }
-  vrb::Matrix modelView = m.transform->GetTransform().AfineInverse();
-  vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
-  vrb::Vector direction = modelView.MultiplyDirection(aDirection);
-  const float dotNormals = direction.Dot(m.windowNormal);
-  if (dotNormals > -kEpsilon) {
-    // Not pointed at the plane
-    return false;
-  }
-
-  const float dotV = (m.windowMin - point).Dot(m.windowNormal);
-
-  if ((dotV < kEpsilon) && (dotV > -kEpsilon)) {
-    return false;
-  }
-
-  const float length = dotV / dotNormals;
-  vrb::Vector result = point + (direction * length);
-
-  if ((result.x() >= m.windowMin.x()) && (result.y() >= m.windowMin.y()) &&(result.z() >= (m.windowMin.z() - 0.1f)) &&
-      (result.x() <= m.windowMax.x()) && (result.y() <= m.windowMax.y()) &&(result.z() <= (m.windowMax.z() + 0.1f))) {
-    aIsInWidget = true;
-  }
-
-  aResult = result;
-
-  aDistance = (aResult - point).Magnitude();
-
-  // Clamp to keep pointer in window.
-  if (result.x() > m.windowMax.x()) { result.x() = m.windowMax.x(); }
-  else if (result.x() < m.windowMin.x()) { result.x() = m.windowMin.x(); }
-
-  if (result.y() > m.windowMax.y()) { result.y() = m.windowMax.y(); }
-  else if (result.y() < m.windowMin.y()) { result.y() = m.windowMin.y(); }
-
-  m.pointer->SetTransform(vrb::Matrix::Position(result));
+void
+Widget::GetSurfaceSize(int32_t& aWidth, int32_t& aHeight) const {
+  aWidth = m.surfaceWidth;
+  aHeight = m.surfaceHeight;
+}
 
-  return true;
+void
+Widget::GetWidgetMinAndMax(vrb::Vector& aMin, vrb::Vector& aMax) const {
+  aMin = m.windowMin;
+  aMax = m.windowMax;
 }
 
 void
@@ -272,6 +272,23 @@ Widget::GetTransform() const {
 void
 Widget::SetTransform(const vrb::Matrix& aTransform) {
   m.transform->SetTransform(aTransform);
+  m.boundsDirty = true;
+  m.inverseDirty = true;
+}
+
+const vrb::Matrix&
+Widget::GetInverseTransform() const {
+  return m.GetInverseTransform();
+}
+
+bool
+Widget::IsEnabled() const {
+  return m.root->IsEnabled(*m.transform);
+}
+
+void
+Widget::SetPointerPosition(const vrb::Vector& aPoint) {
+  m.SetPointerPosition(aPoint);
 }
 
 void
@@ -281,9 +298,81 @@ Widget::ToggleWidget(const bool aEnabled) {
 
 void
 Widget::TogglePointer(const bool aEnabled) {
+  if (m.pointerVisible == aEnabled) {
+    return;
+  }
+  m.pointerVisible = aEnabled;
   m.pointerToggle->ToggleAll(aEnabled);
 }
 
+void
+Widget::GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const {
+  if (m.boundsDirty) {
+    m.UpdateBounds();
+  }
+  aCenter = m.boundsCenter;
+  aRadius = m.boundsRadius;
+}
+
+void
+Widget::SetCulled(const bool aCulled) {
+  if (m.culled == aCulled) {
+    return;
+  }
+  m.culled = aCulled;
+  m.cullToggle->ToggleAll(!aCulled);
+}
+
+bool
+Widget::IsCulled() const {
+  return m.culled;
+}
+
+void
+Widget::SetSurfaceTextureHandle(const uint32_t aHandle) {
+  m.textureHandle = aHandle;
+}
+
+uint32_t
+Widget::GetSurfaceTextureHandle() const {
+  return m.textureHandle;
+}
+
+void
+Widget::SetQuadLayer(const int32_t aLayer) {
+  m.quadLayer = aLayer < 0 ? -1 : aLayer;
+}
+
+void
+Widget::SetContentChanged(const bool aChanged) {
+  m.contentChanged = aChanged;
+}
+
+bool
+Widget::IsContentChanged() const {
+  return m.contentChanged;
+}
+
+void
+Widget::SetSnapshot(const uint32_t aTexture) {
+  m.snapshot = aTexture;
+}
+
+uint32_t
+Widget::GetSnapshot() const {
+  return m.snapshot;
+}
+
+int32_t
+Widget::GetQuadLayer() const {
+  return m.quadLayer;
+}
+
+bool
+Widget::IsLayerBacked() const {
+  return m.quadLayer >= 0;
+}
+
 vrb::NodePtr
 Widget::GetRoot() {
   return m.root;
@@ -19,21 +19,56 @@ typedef std::shared_ptr<Widget> WidgetPtr;
 
 class Widget {
 public:
+  // The pointer mesh, created once and handed to every widget with SetPointerGeometry().
+  static vrb::NodePtr CreatePointerGeometry(vrb::ContextWeak aContext);
   static WidgetPtr Create(vrb::ContextWeak aContext, const int aType);
   static WidgetPtr Create(vrb::ContextWeak aContext, const int aType, const int32_t aWidth, const int32_t aHeight, float aWorldWidth);
   static WidgetPtr Create(vrb::ContextWeak aContext, const int aType, const int32_t aWidth, const int32_t aHeight, const vrb::Vector& aMin, const vrb::Vector& aMax);
   int32_t GetType() const;
   uint32_t GetHandle() const;
   const std::string& GetSurfaceTextureName() const;
+  // Full size of the surface, the space ConvertToWidgetCoordinates() maps into.
   void GetSurfaceTextureSize(int32_t& aWidth, int32_t& aHeight) const;
+  // Size the surface is currently allocated at, at most the full size. See WidgetResolution.
+  void SetSurfaceSize(const int32_t aWidth, const int32_t aHeight);
+  void GetSurfaceSize(int32_t& aWidth, int32_t& aHeight) const;
   void GetWidgetMinAndMax(vrb::Vector& aMin, vrb::Vector& aMax) const;
-  bool TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, bool& aIsInWidget, float& aDistance) const;
   void ConvertToWidgetCoordinates(const vrb::Vector& aPoint, float& aX, float& aY) const;
   void ConvertToWorldCoordinates(const vrb::Vector& aPoint, vrb::Vector& aResult) const;
   const vrb::Matrix GetTransform() const;
   void SetTransform(const vrb::Matrix& aTransform);
+  // Cached, recomputed only after SetTransform().
+  const vrb::Matrix& GetInverseTransform() const;
+  bool IsEnabled() const;
+  // Moves the pointer to aPoint in widget space, clamped to the window. The pointer
+  // transform is only touched when the position changes.
+  void SetPointerPosition(const vrb::Vector& aPoint);
   void ToggleWidget(const bool aEnabled);
+  // Pointers start hidden. Does nothing when the visibility is unchanged.
   void TogglePointer(const bool aEnabled);
+  // World space bounding sphere of the widget quad, recomputed only when the transform changes.
+  void GetBoundingSphere(vrb::Vector& aCenter, float& aRadius) const;
+  // Culled widgets are skipped when drawing but still receive controller input.
+  void SetCulled(const bool aCulled);
+  bool IsCulled() const;
+  // GL handle of the external texture backing the widget surface, zero until it is created.
+  void SetSurfaceTextureHandle(const uint32_t aHandle);
+  uint32_t GetSurfaceTextureHandle() const;
+  // True when a new frame from the surface was latched this frame. Stages that only depend
+  // on the surface content, e.g. copying it into a compositor layer, can skip their work.
+  void SetContentChanged(const bool aChanged);
+  bool IsContentChanged() const;
+  // GL_TEXTURE_2D copy of the surface, drawn instead of it while the widget hibernates.
+  // Zero when the widget is drawn from its surface. See TextureBudget.
+  void SetSnapshot(const uint32_t aTexture);
+  uint32_t GetSnapshot() const;
+  // Layer backed widgets are presented by a compositor quad layer instead of being drawn
+  // into the eye buffers. The pointer is still drawn in the scene. -1 clears the layer.
+  // Other widgets are drawn by BrowserWorld from their texture handle, GetRoot() only
+  // holds the pointer.
+  void SetQuadLayer(const int32_t aLayer);
+  int32_t GetQuadLayer() const;
+  bool IsLayerBacked() const;
   vrb::NodePtr GetRoot();
   vrb::NodePtr GetPointerGeometry();
   void SetPointerGeometry(vrb::NodePtr& aNode);
@@ -0,0 +1,158 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetAttention.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+typedef crow::WidgetAttention::Level Level;
+
+// Cosine of the angle between the gaze and the closest point of a window that still
+// counts as looking at it, about 20 degrees.
+static const float kFocusCosine = 0.94f;
+// Frames a lower level has to be asked for before it is applied, about half a second
+// to lose focus and one second to be paused.
+static const int32_t kPeripheralFrames = 36;
+static const int32_t kInvisibleFrames = 72;
+static const float kMinDistance = 0.01f;
+
+struct Entry {
+  Level level;
+  Level pendingLevel;
+  int32_t pendingCount;
+  bool reported;
+  Entry() : level(Level::Focused), pendingLevel(Level::Focused), pendingCount(0), reported(false) {}
+};
+
+float
+Clamp(const float aValue, const float aMin, const float aMax) {
+  return std::max(aMin, std::min(aMax, aValue));
+}
+
+} // namespace
+
+namespace crow {
+
+struct WidgetAttention::State {
+  std::vector<Entry> entries;
+  vrb::Vector head;
+  vrb::Vector gaze;
+  State() : gaze(0.0f, 0.0f, -1.0f) {}
+
+  Entry* GetEntry(const int32_t aIndex) {
+    if ((aIndex < 0) || (aIndex >= (int32_t)entries.size())) {
+      return nullptr;
+    }
+    return &entries[aIndex];
+  }
+
+  // True if the gaze passes within kFocusCosine of the window.
+  bool IsLookedAt(const vrb::Matrix& aTransform, const vrb::Vector& aMin, const vrb::Vector& aMax) const {
+    const vrb::Vector origin = aTransform.MultiplyPosition(vrb::Vector());
+    const vrb::Vector axisX = aTransform.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f));
+    const vrb::Vector axisY = aTransform.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f));
+    const vrb::Vector normal = axisX.Cross(axisY);
+    // Where the gaze crosses the window plane, or its center when looking away from the plane.
+    float x = (aMin.x() + aMax.x()) * 0.5f;
+    float y = (aMin.y() + aMax.y()) * 0.5f;
+    const float facing = gaze.Dot(normal);
+    if ((facing * facing) > (kMinDistance * normal.Dot(normal))) {
+      const float t = (origin - head).Dot(normal) / facing;
+      if (t > 0.0f) {
+        const vrb::Vector local = head + (gaze * t) - origin;
+        x = local.Dot(axisX) / axisX.Dot(axisX);
+        y = local.Dot(axisY) / axisY.Dot(axisY);
+      }
+    }
+    const vrb::Vector closest = origin + (axisX * Clamp(x, aMin.x(), aMax.x())) +
+                                (axisY * Clamp(y, aMin.y(), aMax.y()));
+    const vrb::Vector toClosest = closest - head;
+    const float distance = toClosest.Magnitude();
+    if (distance < kMinDistance) {
+      return true;
+    }
+    return gaze.Dot(toClosest) >= (kFocusCosine * distance);
+  }
+};
+
+WidgetAttentionPtr
+WidgetAttention::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetAttention, WidgetAttention::State> >();
+}
+
+void
+WidgetAttention::SetCount(const int32_t aCount) {
+  m.entries.resize((size_t)(aCount < 0 ? 0 : aCount));
+}
+
+void
+WidgetAttention::Reset(const int32_t aIndex) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (entry) {
+    entry->reported = false;
+  }
+}
+
+void
+WidgetAttention::SetHead(const vrb::Matrix& aHeadTransform) {
+  m.head = aHeadTransform.GetTranslation();
+  m.gaze = aHeadTransform.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f)).Normalize();
+}
+
+bool
+WidgetAttention::Evaluate(const int32_t aIndex, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                          const vrb::Vector& aMax, const bool aVisible, const bool aPointed) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (!entry) {
+    return false;
+  }
+  Level level = Level::Invisible;
+  if (aVisible) {
+    level = (aPointed || m.IsLookedAt(aTransform, aMin, aMax)) ? Level::Focused : Level::Peripheral;
+  }
+  bool changed = false;
+  if (level < entry->level) {
+    entry->level = level;
+    entry->pendingCount = 0;
+    changed = true;
+  } else if (level > entry->level) {
+    // Demote to the most attentive level asked for during the streak.
+    entry->pendingLevel = entry->pendingCount ? std::min(entry->pendingLevel, level) : level;
+    entry->pendingCount++;
+    const int32_t frames = (entry->pendingLevel == Level::Invisible) ? kInvisibleFrames : kPeripheralFrames;
+    if (entry->pendingCount >= frames) {
+      entry->level = entry->pendingLevel;
+      entry->pendingCount = 0;
+      changed = true;
+    }
+  } else {
+    entry->pendingCount = 0;
+  }
+  if (!entry->reported) {
+    entry->reported = true;
+    return true;
+  }
+  return changed;
+}
+
+WidgetAttention::Level
+WidgetAttention::GetLevel(const int32_t aIndex) const {
+  if ((aIndex < 0) || (aIndex >= (int32_t)m.entries.size())) {
+    return Level::Focused;
+  }
+  return m.entries[aIndex].level;
+}
+
+WidgetAttention::WidgetAttention(State& aState) : m(aState) {}
+WidgetAttention::~WidgetAttention() {}
+
+} // namespace crow
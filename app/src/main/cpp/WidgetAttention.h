@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGETATTENTION_H
+#define VRBROWSER_WIDGETATTENTION_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class WidgetAttention;
+typedef std::shared_ptr<WidgetAttention> WidgetAttentionPtr;
+
+// Classifies each widget as focused, peripheral or invisible so the content behind
+// unfocused windows can be painted and latched at a lower rate. A widget is focused while
+// a controller points at it or the head looks at or close to it, invisible while it
+// is culled or disabled, and peripheral otherwise. Promotions apply on the frame they are
+// seen, demotions only once they held for a while so glancing around does not thrash
+// Gecko. Entries are indexed like BrowserWorld's widget list.
+class WidgetAttention {
+public:
+  // Must be kept in sync with Widget.java
+  enum class Level : int32_t {
+    Focused = 0,
+    Peripheral = 1,
+    Invisible = 2
+  };
+  static WidgetAttentionPtr Create();
+  void SetCount(const int32_t aCount);
+  // Forgets the level last reported for the widget, the next Evaluate() reports it again.
+  void Reset(const int32_t aIndex);
+  // Head pose used by the following Evaluate() calls.
+  void SetHead(const vrb::Matrix& aHeadTransform);
+  // Classifies the widget window aMin to aMax. Returns true when GetLevel() changed.
+  bool Evaluate(const int32_t aIndex, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                const vrb::Vector& aMax, const bool aVisible, const bool aPointed);
+  Level GetLevel(const int32_t aIndex) const;
+protected:
+  struct State;
+  WidgetAttention(State& aState);
+  ~WidgetAttention();
+private:
+  State& m;
+  WidgetAttention() = delete;
+  VRB_NO_DEFAULTS(WidgetAttention)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGETATTENTION_H
@@ -0,0 +1,271 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetHitTable.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+
+#include <float.h>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VRBROWSER_HIT_NEON
+#elif defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define VRBROWSER_HIT_SSE
+#endif
+
+namespace {
+
+static const int32_t kLanes = 4;
+static const float kEpsilon = 0.00000001f;
+
+// Four widgets, one per lane. matrix holds the top three rows of each inverse model
+// matrix, element (row, column) at [row * 4 + column].
+struct Block {
+  float matrix[12][kLanes];
+  float minX[kLanes];
+  float maxX[kLanes];
+  float minY[kLanes];
+  float maxY[kLanes];
+  float planeZ[kLanes];
+  Block() {
+    for (int32_t lane = 0; lane < kLanes; lane++) {
+      for (int32_t element = 0; element < 12; element++) {
+        matrix[element][lane] = 0.0f;
+      }
+      planeZ[lane] = 0.0f;
+      Disable(lane);
+    }
+  }
+  // An empty rectangle never contains the hit point.
+  void Disable(const int32_t aLane) {
+    minX[aLane] = minY[aLane] = FLT_MAX;
+    maxX[aLane] = maxY[aLane] = -FLT_MAX;
+  }
+};
+
+#if defined(VRBROWSER_HIT_NEON)
+typedef float32x4_t Float4;
+typedef uint32x4_t Mask4;
+inline Float4 Load(const float* aValues) { return vld1q_f32(aValues); }
+inline Float4 Splat(const float aValue) { return vdupq_n_f32(aValue); }
+inline Float4 Add(const Float4 aA, const Float4 aB) { return vaddq_f32(aA, aB); }
+inline Float4 Sub(const Float4 aA, const Float4 aB) { return vsubq_f32(aA, aB); }
+inline Float4 Mul(const Float4 aA, const Float4 aB) { return vmulq_f32(aA, aB); }
+inline Float4 Div(const Float4 aA, const Float4 aB) {
+#if defined(__aarch64__)
+  return vdivq_f32(aA, aB);
+#else
+  // ARMv7 has no vector divide, refine the reciprocal estimate twice.
+  Float4 reciprocal = vrecpeq_f32(aB);
+  reciprocal = vmulq_f32(vrecpsq_f32(aB, reciprocal), reciprocal);
+  reciprocal = vmulq_f32(vrecpsq_f32(aB, reciprocal), reciprocal);
+  return vmulq_f32(aA, reciprocal);
+#endif // defined(__aarch64__)
+}
+inline Mask4 Less(const Float4 aA, const Float4 aB) { return vcltq_f32(aA, aB); }
+inline Mask4 LessEqual(const Float4 aA, const Float4 aB) { return vcleq_f32(aA, aB); }
+inline Mask4 And(const Mask4 aA, const Mask4 aB) { return vandq_u32(aA, aB); }
+inline void Store(float* aResult, const Float4 aValue) { vst1q_f32(aResult, aValue); }
+inline int32_t Bits(const Mask4 aMask) {
+  uint32_t lanes[kLanes];
+  vst1q_u32(lanes, aMask);
+  return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+}
+#elif defined(VRBROWSER_HIT_SSE)
+typedef __m128 Float4;
+typedef __m128 Mask4;
+inline Float4 Load(const float* aValues) { return _mm_loadu_ps(aValues); }
+inline Float4 Splat(const float aValue) { return _mm_set1_ps(aValue); }
+inline Float4 Add(const Float4 aA, const Float4 aB) { return _mm_add_ps(aA, aB); }
+inline Float4 Sub(const Float4 aA, const Float4 aB) { return _mm_sub_ps(aA, aB); }
+inline Float4 Mul(const Float4 aA, const Float4 aB) { return _mm_mul_ps(aA, aB); }
+inline Float4 Div(const Float4 aA, const Float4 aB) { return _mm_div_ps(aA, aB); }
+inline Mask4 Less(const Float4 aA, const Float4 aB) { return _mm_cmplt_ps(aA, aB); }
+inline Mask4 LessEqual(const Float4 aA, const Float4 aB) { return _mm_cmple_ps(aA, aB); }
+inline Mask4 And(const Mask4 aA, const Mask4 aB) { return _mm_and_ps(aA, aB); }
+inline void Store(float* aResult, const Float4 aValue) { _mm_storeu_ps(aResult, aValue); }
+inline int32_t Bits(const Mask4 aMask) { return _mm_movemask_ps(aMask); }
+#else
+struct Float4 { float v[kLanes]; };
+struct Mask4 { bool v[kLanes]; };
+#define VRBROWSER_HIT_LANES(expression) for (int32_t lane = 0; lane < kLanes; lane++) { expression; }
+inline Float4 Load(const float* aValues) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aValues[lane]) return r; }
+inline Float4 Splat(const float aValue) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aValue) return r; }
+inline Float4 Add(const Float4 aA, const Float4 aB) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] + aB.v[lane]) return r; }
+inline Float4 Sub(const Float4 aA, const Float4 aB) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] - aB.v[lane]) return r; }
+inline Float4 Mul(const Float4 aA, const Float4 aB) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] * aB.v[lane]) return r; }
+inline Float4 Div(const Float4 aA, const Float4 aB) { Float4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] / aB.v[lane]) return r; }
+inline Mask4 Less(const Float4 aA, const Float4 aB) { Mask4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] < aB.v[lane]) return r; }
+inline Mask4 LessEqual(const Float4 aA, const Float4 aB) { Mask4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] <= aB.v[lane]) return r; }
+inline Mask4 And(const Mask4 aA, const Mask4 aB) { Mask4 r; VRBROWSER_HIT_LANES(r.v[lane] = aA.v[lane] && aB.v[lane]) return r; }
+inline void Store(float* aResult, const Float4 aValue) { VRBROWSER_HIT_LANES(aResult[lane] = aValue.v[lane]) }
+inline int32_t Bits(const Mask4 aMask) { int32_t r = 0; VRBROWSER_HIT_LANES(r |= aMask.v[lane] ? (1 << lane) : 0) return r; }
+#undef VRBROWSER_HIT_LANES
+#endif
+
+// Row aRow of the inverse matrices applied to a point, or to a direction when aPoint is false.
+inline Float4
+TransformRow(const Block& aBlock, const int32_t aRow, const Float4 aX, const Float4 aY, const Float4 aZ,
+             const bool aPoint) {
+  Float4 result = Mul(Load(aBlock.matrix[aRow * 4]), aX);
+  result = Add(result, Mul(Load(aBlock.matrix[(aRow * 4) + 1]), aY));
+  result = Add(result, Mul(Load(aBlock.matrix[(aRow * 4) + 2]), aZ));
+  return aPoint ? Add(result, Load(aBlock.matrix[(aRow * 4) + 3])) : result;
+}
+
+} // namespace
+
+namespace crow {
+
+struct WidgetHitTable::State {
+  std::vector<Block> blocks;
+  std::vector<vrb::Vector> mins;
+  std::vector<vrb::Vector> maxs;
+  std::vector<bool> enabled;
+  int32_t count;
+  State() : count(0) {}
+
+  bool IsValid(const int32_t aIndex) const {
+    return (aIndex >= 0) && (aIndex < count);
+  }
+
+  void UpdateRect(const int32_t aIndex) {
+    Block& block = blocks[aIndex / kLanes];
+    const int32_t lane = aIndex % kLanes;
+    if (!enabled[aIndex]) {
+      block.Disable(lane);
+      return;
+    }
+    block.minX[lane] = mins[aIndex].x();
+    block.maxX[lane] = maxs[aIndex].x();
+    block.minY[lane] = mins[aIndex].y();
+    block.maxY[lane] = maxs[aIndex].y();
+    block.planeZ[lane] = mins[aIndex].z();
+  }
+};
+
+WidgetHitTablePtr
+WidgetHitTable::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetHitTable, WidgetHitTable::State> >();
+}
+
+void
+WidgetHitTable::SetCount(const int32_t aCount) {
+  const int32_t count = aCount < 0 ? 0 : aCount;
+  m.blocks.resize((count + kLanes - 1) / kLanes);
+  m.mins.resize(count);
+  m.maxs.resize(count);
+  // New entries stay disabled until SetWidget() is called.
+  m.enabled.resize(count, false);
+  // Lanes past the end of the last block must not report hits.
+  for (int32_t index = count; index < (int32_t)m.blocks.size() * kLanes; index++) {
+    m.blocks[index / kLanes].Disable(index % kLanes);
+  }
+  m.count = count;
+}
+
+int32_t
+WidgetHitTable::GetCount() const {
+  return m.count;
+}
+
+void
+WidgetHitTable::SetWidget(const int32_t aIndex, const vrb::Matrix& aInverseTransform, const vrb::Vector& aMin,
+                          const vrb::Vector& aMax) {
+  if (!m.IsValid(aIndex)) {
+    return;
+  }
+  Block& block = m.blocks[aIndex / kLanes];
+  const int32_t lane = aIndex % kLanes;
+  // vrb matrices are column major.
+  const float* data = aInverseTransform.Data();
+  for (int32_t row = 0; row < 3; row++) {
+    for (int32_t column = 0; column < 4; column++) {
+      block.matrix[(row * 4) + column][lane] = data[(column * 4) + row];
+    }
+  }
+  m.mins[aIndex] = aMin;
+  m.maxs[aIndex] = aMax;
+  m.enabled[aIndex] = true;
+  m.UpdateRect(aIndex);
+}
+
+void
+WidgetHitTable::SetEnabled(const int32_t aIndex, const bool aEnabled) {
+  if (!m.IsValid(aIndex) || (m.enabled[aIndex] == aEnabled)) {
+    return;
+  }
+  m.enabled[aIndex] = aEnabled;
+  m.UpdateRect(aIndex);
+}
+
+bool
+WidgetHitTable::Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                          Hit& aHit) const {
+  const Float4 startX = Splat(aStart.x());
+  const Float4 startY = Splat(aStart.y());
+  const Float4 startZ = Splat(aStart.z());
+  const Float4 directionX = Splat(aDirection.x());
+  const Float4 directionY = Splat(aDirection.y());
+  const Float4 directionZ = Splat(aDirection.z());
+  const Float4 zero = Splat(0.0f);
+  const Float4 minusEpsilon = Splat(-kEpsilon);
+  float nearest = aMaxDistance;
+  int32_t hitIndex = -1;
+  float hitX = 0.0f, hitY = 0.0f, hitZ = 0.0f;
+  for (size_t blockIndex = 0; blockIndex < m.blocks.size(); blockIndex++) {
+    const Block& block = m.blocks[blockIndex];
+    // The ray in widget space. The direction is not renormalized so distances stay in world units.
+    const Float4 localStartZ = TransformRow(block, 2, startX, startY, startZ, true);
+    const Float4 localDirectionZ = TransformRow(block, 2, directionX, directionY, directionZ, false);
+    const Float4 planeZ = Load(block.planeZ);
+    const Float4 distance = Div(Sub(planeZ, localStartZ), localDirectionZ);
+    // Widgets are only hit from their front (+z) side.
+    Mask4 mask = And(Less(localDirectionZ, minusEpsilon), LessEqual(zero, distance));
+    mask = And(mask, Less(distance, Splat(nearest)));
+    if (!Bits(mask)) {
+      continue;
+    }
+    const Float4 x = Add(TransformRow(block, 0, startX, startY, startZ, true),
+                         Mul(TransformRow(block, 0, directionX, directionY, directionZ, false), distance));
+    const Float4 y = Add(TransformRow(block, 1, startX, startY, startZ, true),
+                         Mul(TransformRow(block, 1, directionX, directionY, directionZ, false), distance));
+    mask = And(mask, And(LessEqual(Load(block.minX), x), LessEqual(x, Load(block.maxX))));
+    mask = And(mask, And(LessEqual(Load(block.minY), y), LessEqual(y, Load(block.maxY))));
+    const int32_t bits = Bits(mask);
+    if (!bits) {
+      continue;
+    }
+    float distances[kLanes], xs[kLanes], ys[kLanes];
+    Store(distances, distance);
+    Store(xs, x);
+    Store(ys, y);
+    for (int32_t lane = 0; lane < kLanes; lane++) {
+      if ((bits & (1 << lane)) && (distances[lane] < nearest)) {
+        nearest = distances[lane];
+        hitIndex = ((int32_t)blockIndex * kLanes) + lane;
+        hitX = xs[lane];
+        hitY = ys[lane];
+        hitZ = block.planeZ[lane];
+      }
+    }
+  }
+  if (hitIndex < 0) {
+    return false;
+  }
+  aHit.index = hitIndex;
+  aHit.distance = nearest;
+  aHit.point = vrb::Vector(hitX, hitY, hitZ);
+  return true;
+}
+
+WidgetHitTable::WidgetHitTable(State& aState) : m(aState) {}
+WidgetHitTable::~WidgetHitTable() {}
+
+} // namespace crow
@@ -0,0 +1,56 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGETHITTABLE_H
+#define VRBROWSER_WIDGETHITTABLE_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "vrb/Vector.h"
+
+#include <memory>
+
+namespace crow {
+
+class WidgetHitTable;
+typedef std::shared_ptr<WidgetHitTable> WidgetHitTablePtr;
+
+// Widget quads laid out as structure-of-arrays blocks of four, so a controller ray is
+// tested against four widgets at a time with NEON or SSE (scalar on other targets).
+// Each entry holds the cached inverse model matrix and the window rectangle in
+// widget space. Entries are indexed like BrowserWorld's widget list.
+class WidgetHitTable {
+public:
+  struct Hit {
+    int32_t index;
+    float distance; // World units along the ray.
+    vrb::Vector point; // Widget space, on the window plane.
+    Hit() : index(-1), distance(0.0f) {}
+  };
+
+  static WidgetHitTablePtr Create();
+  void SetCount(const int32_t aCount);
+  int32_t GetCount() const;
+  // aMin and aMax are the window corners as returned by Widget::GetWidgetMinAndMax().
+  void SetWidget(const int32_t aIndex, const vrb::Matrix& aInverseTransform, const vrb::Vector& aMin,
+                 const vrb::Vector& aMax);
+  // Disabled entries are never hit.
+  void SetEnabled(const int32_t aIndex, const bool aEnabled);
+  // Nearest window hit from the front side within aMaxDistance. aDirection must be normalized.
+  bool Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                 Hit& aHit) const;
+protected:
+  struct State;
+  WidgetHitTable(State& aState);
+  ~WidgetHitTable();
+private:
+  State& m;
+  WidgetHitTable() = delete;
+  VRB_NO_DEFAULTS(WidgetHitTable)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGETHITTABLE_H
@@ -0,0 +1,423 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetQuadRenderer.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Camera.h"
+#include "vrb/Color.h"
+#include "vrb/GLError.h"
+#include "vrb/Light.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+// The shared unit square is expanded to the widget window by the per instance model matrix,
+// and its texture coordinates to the per instance rectangle of the texture. The light is
+// the same for the whole quad, so both faces are lit per vertex and the fragment shader
+// picks the one facing the camera. The back face uses the opposite normal, as it did when
+// the widgets were geometry with a face on each side.
+static const char* kVertexShader = R"SHADER(
+attribute vec2 aCorner;
+attribute mat4 aModel;
+attribute vec4 aUVRect;
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform vec3 uLightDirection;
+uniform vec3 uAmbient;
+uniform vec3 uDiffuse;
+varying vec2 vUV;
+varying vec3 vFrontLight;
+varying vec3 vBackLight;
+void main() {
+  vUV = aUVRect.xy + (vec2(aCorner.x, 1.0 - aCorner.y) * aUVRect.zw);
+  float facing = dot(normalize(cross(aModel[0].xyz, aModel[1].xyz)), -uLightDirection);
+  vFrontLight = uAmbient + (max(facing, 0.0) * uDiffuse);
+  vBackLight = uAmbient + (max(-facing, 0.0) * uDiffuse);
+  gl_Position = uProjection * uView * aModel * vec4(aCorner, 0.0, 1.0);
+}
+)SHADER";
+
+static const char* kExternalFragmentShader = R"SHADER(
+#extension GL_OES_EGL_image_external : require
+precision mediump float;
+uniform samplerExternalOES uTexture;
+varying vec2 vUV;
+varying vec3 vFrontLight;
+varying vec3 vBackLight;
+void main() {
+  vec3 light = gl_FrontFacing ? vFrontLight : vBackLight;
+  gl_FragColor = vec4(texture2D(uTexture, vUV).rgb * light, 1.0);
+}
+)SHADER";
+
+static const char* kFlatFragmentShader = R"SHADER(
+precision mediump float;
+uniform sampler2D uTexture;
+varying vec2 vUV;
+varying vec3 vFrontLight;
+varying vec3 vBackLight;
+void main() {
+  vec3 light = gl_FrontFacing ? vFrontLight : vBackLight;
+  gl_FragColor = vec4(texture2D(uTexture, vUV).rgb * light, 1.0);
+}
+)SHADER";
+
+// Bottom left, bottom right, top right, top left of the unit square.
+static const GLfloat kUnitCorners[] = {
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    1.0f, 1.0f,
+    0.0f, 1.0f
+};
+static const GLsizei kCornerCount = 4;
+
+static const int32_t kModelColumns = 4;
+static const int32_t kModelFloats = 16;
+static const int32_t kUVRectFloats = 4;
+// Model matrix then UV rectangle.
+static const int32_t kInstanceFloats = kModelFloats + kUVRectFloats;
+
+// The widget material: ambient 0.4, diffuse 1.0 and no specular.
+static const float kMaterialAmbient = 0.4f;
+static const float kMaterialDiffuse = 1.0f;
+
+GLuint
+LoadShader(const GLenum aType, const char* aSource) {
+  GLuint shader = glCreateShader(aType);
+  VRB_CHECK(glShaderSource(shader, 1, &aSource, nullptr));
+  VRB_CHECK(glCompileShader(shader));
+  GLint compiled = 0;
+  VRB_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+  if (!compiled) {
+    GLchar log[512];
+    VRB_CHECK(glGetShaderInfoLog(shader, sizeof(log), nullptr, log));
+    VRB_LOG("WidgetQuadRenderer failed to compile shader: %s", log);
+    VRB_CHECK(glDeleteShader(shader));
+    return 0;
+  }
+  return shader;
+}
+
+struct Program {
+  GLuint program;
+  GLint aCorner;
+  GLint aModel;
+  GLint aUVRect;
+  GLint uProjection;
+  GLint uView;
+  GLint uLightDirection;
+  GLint uAmbient;
+  GLint uDiffuse;
+  GLint uTexture;
+  Program() : program(0), aCorner(-1), aModel(-1), aUVRect(-1), uProjection(-1), uView(-1),
+              uLightDirection(-1), uAmbient(-1), uDiffuse(-1), uTexture(-1) {}
+
+  bool Link(const char* aVertexSource, const char* aFragmentSource) {
+    GLuint vertex = LoadShader(GL_VERTEX_SHADER, aVertexSource);
+    GLuint fragment = LoadShader(GL_FRAGMENT_SHADER, aFragmentSource);
+    GLint linked = 0;
+    if (vertex && fragment) {
+      program = glCreateProgram();
+      VRB_CHECK(glAttachShader(program, vertex));
+      VRB_CHECK(glAttachShader(program, fragment));
+      VRB_CHECK(glLinkProgram(program));
+      VRB_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+      if (!linked) {
+        GLchar log[512];
+        VRB_CHECK(glGetProgramInfoLog(program, sizeof(log), nullptr, log));
+        VRB_LOG("WidgetQuadRenderer failed to link program: %s", log);
+      }
+    }
+    if (vertex) { VRB_CHECK(glDeleteShader(vertex)); }
+    if (fragment) { VRB_CHECK(glDeleteShader(fragment)); }
+    if (!linked) {
+      Destroy();
+      return false;
+    }
+    aCorner = glGetAttribLocation(program, "aCorner");
+    aModel = glGetAttribLocation(program, "aModel");
+    aUVRect = glGetAttribLocation(program, "aUVRect");
+    uProjection = glGetUniformLocation(program, "uProjection");
+    uView = glGetUniformLocation(program, "uView");
+    uLightDirection = glGetUniformLocation(program, "uLightDirection");
+    uAmbient = glGetUniformLocation(program, "uAmbient");
+    uDiffuse = glGetUniformLocation(program, "uDiffuse");
+    uTexture = glGetUniformLocation(program, "uTexture");
+    return (aCorner >= 0) && (aModel >= 0) && (aUVRect >= 0);
+  }
+
+  void Destroy() {
+    if (program) {
+      VRB_CHECK(glDeleteProgram(program));
+      program = 0;
+    }
+  }
+};
+
+// Instances sharing a texture, drawn with a single call.
+struct InstanceGroup {
+  GLenum target;
+  GLuint texture;
+  GLint first;
+  GLsizei count;
+};
+
+} // namespace
+
+namespace crow {
+
+struct WidgetQuadRenderer::State {
+  Program external;
+  Program flat;
+  GLuint cornerBuffer;
+  GLuint instanceBuffer;
+  GLsizeiptr instanceCapacity;
+  std::vector<GLfloat> instanceData;
+  std::vector<InstanceGroup> groups;
+  // World space, with the material already applied. Until SetLight() is called the quads
+  // are drawn at full brightness.
+  GLfloat lightDirection[3];
+  GLfloat ambient[3];
+  GLfloat diffuse[3];
+  bool initialized;
+  State() : cornerBuffer(0), instanceBuffer(0), instanceCapacity(0), initialized(false) {
+    for (int32_t ix = 0; ix < 3; ix++) {
+      lightDirection[ix] = ix == 2 ? -1.0f : 0.0f;
+      ambient[ix] = 1.0f;
+      diffuse[ix] = 0.0f;
+    }
+  }
+
+  void SetInstancePointers(const Program& aProgram, const GLint aFirst) {
+    const GLsizei stride = kInstanceFloats * sizeof(GLfloat);
+    for (int32_t column = 0; column < kModelColumns; column++) {
+      const size_t offset = (size_t)((aFirst * kInstanceFloats) + (column * kModelColumns)) * sizeof(GLfloat);
+      VRB_CHECK(glVertexAttribPointer((GLuint)(aProgram.aModel + column), kModelColumns, GL_FLOAT, GL_FALSE,
+                                      stride, (const GLvoid*)offset));
+    }
+    const size_t offset = (size_t)((aFirst * kInstanceFloats) + kModelFloats) * sizeof(GLfloat);
+    VRB_CHECK(glVertexAttribPointer((GLuint)aProgram.aUVRect, kUVRectFloats, GL_FLOAT, GL_FALSE, stride,
+                                    (const GLvoid*)offset));
+  }
+
+  // Draws the groups sampling aTarget.
+  void Draw(const Program& aProgram, const GLenum aTarget, const vrb::Matrix& aProjection,
+            const vrb::Matrix& aView) {
+    if (!aProgram.program || std::none_of(groups.begin(), groups.end(), [aTarget](const InstanceGroup& aGroup) {
+          return aGroup.target == aTarget;
+        })) {
+      return;
+    }
+    GLint previousProgram = 0;
+    VRB_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram));
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    VRB_CHECK(glEnable(GL_DEPTH_TEST));
+    VRB_CHECK(glDisable(GL_BLEND));
+    VRB_CHECK(glDisable(GL_CULL_FACE));
+
+    VRB_CHECK(glBindVertexArray(0));
+    VRB_CHECK(glUseProgram(aProgram.program));
+    VRB_CHECK(glUniformMatrix4fv(aProgram.uProjection, 1, GL_FALSE, aProjection.Data()));
+    VRB_CHECK(glUniformMatrix4fv(aProgram.uView, 1, GL_FALSE, aView.Data()));
+    VRB_CHECK(glUniform3fv(aProgram.uLightDirection, 1, lightDirection));
+    VRB_CHECK(glUniform3fv(aProgram.uAmbient, 1, ambient));
+    VRB_CHECK(glUniform3fv(aProgram.uDiffuse, 1, diffuse));
+    VRB_CHECK(glActiveTexture(GL_TEXTURE0));
+    VRB_CHECK(glUniform1i(aProgram.uTexture, 0));
+
+    const GLuint corner = (GLuint)aProgram.aCorner;
+    VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer));
+    VRB_CHECK(glEnableVertexAttribArray(corner));
+    VRB_CHECK(glVertexAttribPointer(corner, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+    VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer));
+    for (int32_t column = 0; column < kModelColumns; column++) {
+      VRB_CHECK(glEnableVertexAttribArray((GLuint)(aProgram.aModel + column)));
+      VRB_CHECK(glVertexAttribDivisor((GLuint)(aProgram.aModel + column), 1));
+    }
+    VRB_CHECK(glEnableVertexAttribArray((GLuint)aProgram.aUVRect));
+    VRB_CHECK(glVertexAttribDivisor((GLuint)aProgram.aUVRect, 1));
+    for (const InstanceGroup& group: groups) {
+      if (group.target != aTarget) {
+        continue;
+      }
+      // ES 3.0 has no base instance, the instance attributes are offset to the group instead.
+      SetInstancePointers(aProgram, group.first);
+      VRB_CHECK(glBindTexture(aTarget, group.texture));
+      VRB_CHECK(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, kCornerCount, group.count));
+    }
+    for (int32_t column = 0; column < kModelColumns; column++) {
+      VRB_CHECK(glVertexAttribDivisor((GLuint)(aProgram.aModel + column), 0));
+      VRB_CHECK(glDisableVertexAttribArray((GLuint)(aProgram.aModel + column)));
+    }
+    VRB_CHECK(glVertexAttribDivisor((GLuint)aProgram.aUVRect, 0));
+    VRB_CHECK(glDisableVertexAttribArray((GLuint)aProgram.aUVRect));
+    VRB_CHECK(glDisableVertexAttribArray(corner));
+    VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    VRB_CHECK(glBindTexture(aTarget, 0));
+
+    VRB_CHECK(glUseProgram((GLuint)previousProgram));
+    if (!depthTest) { VRB_CHECK(glDisable(GL_DEPTH_TEST)); }
+    if (blend) { VRB_CHECK(glEnable(GL_BLEND)); }
+    if (cullFace) { VRB_CHECK(glEnable(GL_CULL_FACE)); }
+  }
+};
+
+void
+WidgetQuadRenderer::Instance::Set(const vrb::Matrix& aTransform, const vrb::Vector& aMin, const vrb::Vector& aMax,
+                                  const GLuint aTexture, const GLenum aTarget) {
+  // Column major: scale x and y by the window size, then move the origin to aMin.
+  const float* matrix = aTransform.Data();
+  const float width = aMax.x() - aMin.x();
+  const float height = aMax.y() - aMin.y();
+  for (int32_t row = 0; row < kModelColumns; row++) {
+    model[row] = matrix[row] * width;
+    model[4 + row] = matrix[4 + row] * height;
+    model[8 + row] = matrix[8 + row];
+    model[12 + row] = (matrix[row] * aMin.x()) + (matrix[4 + row] * aMin.y()) + (matrix[8 + row] * aMin.z()) +
+                      matrix[12 + row];
+  }
+  texture = aTexture;
+  target = aTarget;
+  SetUVRect(0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+void
+WidgetQuadRenderer::Instance::SetUVRect(const float aX, const float aY, const float aWidth, const float aHeight) {
+  uvRect[0] = aX;
+  uvRect[1] = aY;
+  uvRect[2] = aWidth;
+  uvRect[3] = aHeight;
+}
+
+WidgetQuadRendererPtr
+WidgetQuadRenderer::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetQuadRenderer, WidgetQuadRenderer::State> >();
+}
+
+bool
+WidgetQuadRenderer::Initialize() {
+  if (m.initialized) {
+    return true;
+  }
+  if (!m.external.Link(kVertexShader, kExternalFragmentShader) || !m.flat.Link(kVertexShader, kFlatFragmentShader)) {
+    Shutdown();
+    return false;
+  }
+  VRB_CHECK(glGenBuffers(1, &m.cornerBuffer));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.cornerBuffer));
+  VRB_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(kUnitCorners), kUnitCorners, GL_STATIC_DRAW));
+  VRB_CHECK(glGenBuffers(1, &m.instanceBuffer));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  m.instanceCapacity = 0;
+  m.instanceData.clear();
+  m.groups.clear();
+  m.initialized = true;
+  return true;
+}
+
+bool
+WidgetQuadRenderer::IsInitialized() const {
+  return m.initialized;
+}
+
+void
+WidgetQuadRenderer::Shutdown() {
+  m.external.Destroy();
+  m.flat.Destroy();
+  if (m.cornerBuffer) {
+    VRB_CHECK(glDeleteBuffers(1, &m.cornerBuffer));
+    m.cornerBuffer = 0;
+  }
+  if (m.instanceBuffer) {
+    VRB_CHECK(glDeleteBuffers(1, &m.instanceBuffer));
+    m.instanceBuffer = 0;
+  }
+  m.instanceCapacity = 0;
+  m.instanceData.clear();
+  m.groups.clear();
+  m.initialized = false;
+}
+
+void
+WidgetQuadRenderer::SetLight(const vrb::Light& aLight) {
+  const vrb::Vector direction = aLight.GetDirection().Normalize();
+  const vrb::Color& ambient = aLight.GetAmbientColor();
+  const vrb::Color& diffuse = aLight.GetDiffuseColor();
+  m.lightDirection[0] = direction.x();
+  m.lightDirection[1] = direction.y();
+  m.lightDirection[2] = direction.z();
+  m.ambient[0] = ambient.Red() * kMaterialAmbient;
+  m.ambient[1] = ambient.Green() * kMaterialAmbient;
+  m.ambient[2] = ambient.Blue() * kMaterialAmbient;
+  m.diffuse[0] = diffuse.Red() * kMaterialDiffuse;
+  m.diffuse[1] = diffuse.Green() * kMaterialDiffuse;
+  m.diffuse[2] = diffuse.Blue() * kMaterialDiffuse;
+}
+
+void
+WidgetQuadRenderer::SetInstances(std::vector<Instance>& aInstances) {
+  if (!m.initialized) {
+    return;
+  }
+  std::stable_sort(aInstances.begin(), aInstances.end(), [](const Instance& aLeft, const Instance& aRight) {
+    return (aLeft.target != aRight.target) ? (aLeft.target < aRight.target) : (aLeft.texture < aRight.texture);
+  });
+  m.groups.clear();
+  const size_t floatCount = aInstances.size() * kInstanceFloats;
+  const bool resized = m.instanceData.size() != floatCount;
+  bool changed = resized;
+  m.instanceData.resize(floatCount);
+  for (size_t ix = 0; ix < aInstances.size(); ix++) {
+    const Instance& instance = aInstances[ix];
+    GLfloat* data = &m.instanceData[ix * kInstanceFloats];
+    if (changed || (memcmp(data, instance.model, sizeof(instance.model)) != 0) ||
+        (memcmp(data + kModelFloats, instance.uvRect, sizeof(instance.uvRect)) != 0)) {
+      memcpy(data, instance.model, sizeof(instance.model));
+      memcpy(data + kModelFloats, instance.uvRect, sizeof(instance.uvRect));
+      changed = true;
+    }
+    if (m.groups.empty() || (m.groups.back().texture != instance.texture) ||
+        (m.groups.back().target != instance.target)) {
+      m.groups.push_back({instance.target, instance.texture, (GLint)ix, 0});
+    }
+    m.groups.back().count++;
+  }
+  if (!changed || m.instanceData.empty()) {
+    return;
+  }
+  const GLsizeiptr size = (GLsizeiptr)(m.instanceData.size() * sizeof(GLfloat));
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m.instanceBuffer));
+  if (size > m.instanceCapacity) {
+    VRB_CHECK(glBufferData(GL_ARRAY_BUFFER, size, m.instanceData.data(), GL_DYNAMIC_DRAW));
+    m.instanceCapacity = size;
+  } else {
+    VRB_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, size, m.instanceData.data()));
+  }
+  VRB_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void
+WidgetQuadRenderer::DrawInstances(const vrb::Camera& aCamera) {
+  if (!m.initialized) {
+    return;
+  }
+  const vrb::Matrix view = aCamera.GetTransform().AfineInverse();
+  m.Draw(m.external, GL_TEXTURE_EXTERNAL_OES, aCamera.GetPerspective(), view);
+  m.Draw(m.flat, GL_TEXTURE_2D, aCamera.GetPerspective(), view);
+}
+
+WidgetQuadRenderer::WidgetQuadRenderer(State& aState) : m(aState) {}
+WidgetQuadRenderer::~WidgetQuadRenderer() {}
+
+} // namespace crow
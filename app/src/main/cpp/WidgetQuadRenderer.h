@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGETQUADRENDERER_H
+#define VRBROWSER_WIDGETQUADRENDERER_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <GLES3/gl3.h>
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class WidgetQuadRenderer;
+typedef std::shared_ptr<WidgetQuadRenderer> WidgetQuadRendererPtr;
+
+// Draws the widget quads with instancing, one draw per texture. The quads are lit by the
+// scene light with the material the widget geometry used to have in the scene graph.
+class WidgetQuadRenderer {
+public:
+  // One widget quad. The model matrix maps the shared unit square onto the widget window,
+  // so every instance uses the same immutable vertex buffer. aTarget is
+  // GL_TEXTURE_EXTERNAL_OES for widget surfaces, or GL_TEXTURE_2D for copies made with
+  // QuadLayerRenderer::Copy(), e.g. the snapshots of hibernated widgets. uvRect selects the
+  // part of the texture drawn, as offset and size in texture coordinates, so the thumbnails
+  // packed in an atlas share one texture and one draw.
+  struct Instance {
+    GLuint texture;
+    GLenum target;
+    GLfloat model[16];
+    GLfloat uvRect[4];
+    // Also resets the UV rectangle to the whole texture.
+    void Set(const vrb::Matrix& aTransform, const vrb::Vector& aMin, const vrb::Vector& aMax, const GLuint aTexture,
+             const GLenum aTarget);
+    void SetUVRect(const float aX, const float aY, const float aWidth, const float aHeight);
+  };
+  static WidgetQuadRendererPtr Create();
+  // Must be called with a current GL context.
+  bool Initialize();
+  bool IsInitialized() const;
+  void Shutdown();
+  void SetLight(const vrb::Light& aLight);
+  // Sorts aInstances by target and texture and uploads them for DrawInstances(). The instance buffer
+  // is only rewritten when the instances changed since the previous call.
+  void SetInstances(std::vector<Instance>& aInstances);
+  // One instanced draw per texture, one program per target. Depth tested, both sides are visible.
+  void DrawInstances(const vrb::Camera& aCamera);
+protected:
+  struct State;
+  WidgetQuadRenderer(State& aState);
+  ~WidgetQuadRenderer();
+private:
+  State& m;
+  WidgetQuadRenderer() = delete;
+  VRB_NO_DEFAULTS(WidgetQuadRenderer)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGETQUADRENDERER_H
@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetResolution.h"
+#include "vrb/ConcreteClass.h"
+
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+static const int32_t kSteps = 8;
+static const int32_t kMinStep = kSteps / 2;
+// The density has to move this far past the current size before a resize is considered.
+static const float kHysteresis = 0.1f;
+static const int32_t kShrinkEvaluations = 4;
+static const float kMinDistance = 0.01f;
+
+struct Entry {
+  int32_t fullWidth;
+  int32_t fullHeight;
+  int32_t step;
+  int32_t pendingStep;
+  int32_t pendingCount;
+  Entry() : fullWidth(0), fullHeight(0), step(kSteps), pendingStep(kSteps), pendingCount(0) {}
+};
+
+// Length of aEdge across the line of sight aView.
+float
+ProjectedLength(const vrb::Vector& aEdge, const vrb::Vector& aView) {
+  return (aEdge - (aView * aEdge.Dot(aView))).Magnitude();
+}
+
+} // namespace
+
+namespace crow {
+
+struct WidgetResolution::State {
+  std::vector<Entry> entries;
+  float pixelsPerRadian;
+  State() : pixelsPerRadian(0.0f) {}
+
+  Entry* GetEntry(const int32_t aIndex) {
+    if ((aIndex < 0) || (aIndex >= (int32_t)entries.size())) {
+      return nullptr;
+    }
+    return &entries[aIndex];
+  }
+};
+
+WidgetResolutionPtr
+WidgetResolution::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetResolution, WidgetResolution::State> >();
+}
+
+void
+WidgetResolution::SetCount(const int32_t aCount) {
+  m.entries.resize((size_t)(aCount < 0 ? 0 : aCount));
+}
+
+void
+WidgetResolution::SetFullSize(const int32_t aIndex, const int32_t aWidth, const int32_t aHeight) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (!entry) {
+    return;
+  }
+  *entry = Entry();
+  entry->fullWidth = aWidth;
+  entry->fullHeight = aHeight;
+}
+
+void
+WidgetResolution::GetSize(const int32_t aIndex, int32_t& aWidth, int32_t& aHeight) const {
+  const Entry* entry = m.GetEntry(aIndex);
+  if (!entry) {
+    aWidth = aHeight = 0;
+    return;
+  }
+  aWidth = std::max(1, (entry->fullWidth * entry->step + (kSteps / 2)) / kSteps);
+  aHeight = std::max(1, (entry->fullHeight * entry->step + (kSteps / 2)) / kSteps);
+}
+
+void
+WidgetResolution::SetEyeBuffer(const int32_t aWidth, const int32_t aHeight, const vrb::Matrix& aPerspective) {
+  // Near the center of the view one radian spans the focal length in NDC, half the buffer each.
+  const float* projection = aPerspective.Data();
+  const float horizontal = std::fabs(projection[0]) * (float)aWidth * 0.5f;
+  const float vertical = std::fabs(projection[5]) * (float)aHeight * 0.5f;
+  m.pixelsPerRadian = std::max(horizontal, vertical);
+}
+
+bool
+WidgetResolution::Evaluate(const int32_t aIndex, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                           const vrb::Vector& aMax, const vrb::Vector& aEye, const bool aVisible) {
+  Entry* entry = m.GetEntry(aIndex);
+  if (!entry || !aVisible || (m.pixelsPerRadian <= 0.0f) || (entry->fullWidth <= 0) || (entry->fullHeight <= 0)) {
+    if (entry) {
+      entry->pendingCount = 0;
+    }
+    return false;
+  }
+  const vrb::Vector center = aTransform.MultiplyPosition((aMin + aMax) * 0.5f);
+  const vrb::Vector toEye = aEye - center;
+  const float distance = toEye.Magnitude();
+  float scale = 1.0f;
+  if (distance > kMinDistance) {
+    const vrb::Vector view = toEye * (1.0f / distance);
+    const vrb::Vector edgeX = aTransform.MultiplyDirection(vrb::Vector(aMax.x() - aMin.x(), 0.0f, 0.0f));
+    const vrb::Vector edgeY = aTransform.MultiplyDirection(vrb::Vector(0.0f, aMax.y() - aMin.y(), 0.0f));
+    const float pixelsX = ProjectedLength(edgeX, view) / distance * m.pixelsPerRadian;
+    const float pixelsY = ProjectedLength(edgeY, view) / distance * m.pixelsPerRadian;
+    scale = std::max(pixelsX / (float)entry->fullWidth, pixelsY / (float)entry->fullHeight);
+  }
+
+  const float current = (float)entry->step / (float)kSteps;
+  int32_t step = entry->step;
+  if (scale > current * (1.0f + kHysteresis)) {
+    step = (int32_t)std::ceil(scale * (float)kSteps);
+  } else if (scale < current * (1.0f - kHysteresis)) {
+    // Round up so the shrunk surface still has at least one texel per pixel.
+    step = (int32_t)std::ceil(scale * (1.0f + kHysteresis) * (float)kSteps);
+  }
+  step = std::max(kMinStep, std::min(kSteps, step));
+  if (step == entry->step) {
+    entry->pendingCount = 0;
+    return false;
+  }
+  if (step < entry->step) {
+    // Shrink to the largest size asked for during the streak.
+    entry->pendingStep = entry->pendingCount ? std::max(entry->pendingStep, step) : step;
+    entry->pendingCount++;
+    if (entry->pendingCount < kShrinkEvaluations) {
+      return false;
+    }
+    step = entry->pendingStep;
+  }
+  entry->step = step;
+  entry->pendingStep = step;
+  entry->pendingCount = 0;
+  return true;
+}
+
+WidgetResolution::WidgetResolution(State& aState) : m(aState) {}
+WidgetResolution::~WidgetResolution() {}
+
+} // namespace crow
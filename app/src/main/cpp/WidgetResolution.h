@@ -0,0 +1,50 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGETRESOLUTION_H
+#define VRBROWSER_WIDGETRESOLUTION_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class WidgetResolution;
+typedef std::shared_ptr<WidgetResolution> WidgetResolutionPtr;
+
+// Picks the SurfaceTexture size of each widget from the number of eye buffer pixels it
+// covers, so that distant or oblique windows are rasterized at a lower resolution.
+// Sizes are a fraction of the full size in steps of 1/8, never below half. Growing is
+// applied on the first evaluation that asks for it, shrinking only once it has been
+// asked for by several evaluations in a row. Entries are indexed like BrowserWorld's
+// widget list.
+class WidgetResolution {
+public:
+  static WidgetResolutionPtr Create();
+  void SetCount(const int32_t aCount);
+  // Size the widget was created with, the surface is assumed to have it until resized.
+  void SetFullSize(const int32_t aIndex, const int32_t aWidth, const int32_t aHeight);
+  void GetSize(const int32_t aIndex, int32_t& aWidth, int32_t& aHeight) const;
+  // Eye buffer size in pixels and the projection used to draw into it.
+  void SetEyeBuffer(const int32_t aWidth, const int32_t aHeight, const vrb::Matrix& aPerspective);
+  // Measures the widget window aMin to aMax as seen from aEye. Returns true when the
+  // surface should be resized to the new GetSize(). Hidden widgets keep their size.
+  bool Evaluate(const int32_t aIndex, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                const vrb::Vector& aMax, const vrb::Vector& aEye, const bool aVisible);
+protected:
+  struct State;
+  WidgetResolution(State& aState);
+  ~WidgetResolution();
+private:
+  State& m;
+  WidgetResolution() = delete;
+  VRB_NO_DEFAULTS(WidgetResolution)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGETRESOLUTION_H
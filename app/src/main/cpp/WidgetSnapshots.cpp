@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetSnapshots.h"
+#include "vrb/ConcreteClass.h"
+
+#include "QuadLayerRenderer.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+static const int64_t kBytesPerTexel = 4;
+
+struct Snapshot {
+  GLuint texture;
+  int64_t bytes;
+};
+
+} // namespace
+
+namespace crow {
+
+struct WidgetSnapshots::State {
+  std::vector<Snapshot> snapshots;
+  GLuint framebuffer;
+  State() : framebuffer(0) {}
+};
+
+WidgetSnapshotsPtr
+WidgetSnapshots::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetSnapshots, WidgetSnapshots::State> >();
+}
+
+GLuint
+WidgetSnapshots::Capture(QuadLayerRenderer& aRenderer, const GLuint aSurface, const int32_t aWidth,
+                         const int32_t aHeight) {
+  if (!aSurface || (aWidth <= 0) || (aHeight <= 0) || !aRenderer.IsInitialized()) {
+    return 0;
+  }
+  if (!m.framebuffer) {
+    VRB_CHECK(glGenFramebuffers(1, &m.framebuffer));
+  }
+  GLuint texture = 0;
+  VRB_CHECK(glGenTextures(1, &texture));
+  VRB_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  VRB_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, aWidth, aHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+  VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  VRB_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+  GLint previousFramebuffer = 0;
+  GLint viewport[4] = {0, 0, 0, 0};
+  VRB_CHECK(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer));
+  VRB_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+  VRB_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m.framebuffer));
+  VRB_CHECK(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0));
+  const GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+  if (status == GL_FRAMEBUFFER_COMPLETE) {
+    VRB_CHECK(glViewport(0, 0, aWidth, aHeight));
+    aRenderer.Copy(aSurface);
+  }
+  VRB_CHECK(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0));
+  VRB_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousFramebuffer));
+  VRB_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    VRB_LOG("Widget snapshot framebuffer incomplete: 0x%X", status);
+    VRB_CHECK(glDeleteTextures(1, &texture));
+    return 0;
+  }
+  m.snapshots.push_back({texture, (int64_t)aWidth * (int64_t)aHeight * kBytesPerTexel});
+  return texture;
+}
+
+void
+WidgetSnapshots::Release(const GLuint aSnapshot) {
+  auto found = std::find_if(m.snapshots.begin(), m.snapshots.end(), [aSnapshot](const Snapshot& aEntry) {
+    return aEntry.texture == aSnapshot;
+  });
+  if (found == m.snapshots.end()) {
+    return;
+  }
+  VRB_CHECK(glDeleteTextures(1, &found->texture));
+  *found = m.snapshots.back();
+  m.snapshots.pop_back();
+}
+
+int64_t
+WidgetSnapshots::GetBytes() const {
+  int64_t result = 0;
+  for (const Snapshot& snapshot: m.snapshots) {
+    result += snapshot.bytes;
+  }
+  return result;
+}
+
+void
+WidgetSnapshots::Shutdown() {
+  for (Snapshot& snapshot: m.snapshots) {
+    VRB_CHECK(glDeleteTextures(1, &snapshot.texture));
+  }
+  m.snapshots.clear();
+  if (m.framebuffer) {
+    VRB_CHECK(glDeleteFramebuffers(1, &m.framebuffer));
+    m.framebuffer = 0;
+  }
+}
+
+WidgetSnapshots::WidgetSnapshots(State& aState) : m(aState) {}
+WidgetSnapshots::~WidgetSnapshots() {}
+
+} // namespace crow
@@ -0,0 +1,47 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGETSNAPSHOTS_H
+#define VRBROWSER_WIDGETSNAPSHOTS_H
+
+#include "vrb/MacroUtils.h"
+
+#include <GLES3/gl3.h>
+#include <memory>
+
+namespace crow {
+
+class QuadLayerRenderer;
+class WidgetSnapshots;
+typedef std::shared_ptr<WidgetSnapshots> WidgetSnapshotsPtr;
+
+// Downscaled GL_TEXTURE_2D copies of widget surfaces, shown in place of the widgets whose
+// SurfaceTexture was released to stay within the texture budget. Snapshots keep the row
+// order of the surface so they are drawn with the same texture coordinates. All calls
+// need a current GL context.
+class WidgetSnapshots {
+public:
+  static WidgetSnapshotsPtr Create();
+  // Copies the external texture aSurface into a new aWidth x aHeight snapshot. Returns the
+  // snapshot texture, or 0 if the copy could not be made.
+  GLuint Capture(QuadLayerRenderer& aRenderer, const GLuint aSurface, const int32_t aWidth, const int32_t aHeight);
+  void Release(const GLuint aSnapshot);
+  // Memory held by the live snapshots.
+  int64_t GetBytes() const;
+  // Deletes every snapshot and the copy framebuffer.
+  void Shutdown();
+protected:
+  struct State;
+  WidgetSnapshots(State& aState);
+  ~WidgetSnapshots();
+private:
+  State& m;
+  WidgetSnapshots() = delete;
+  VRB_NO_DEFAULTS(WidgetSnapshots)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGETSNAPSHOTS_H
@@ -11,14 +11,10 @@
 #include "vrb/Logger.h"
 #include "vrb/GLError.h"
 #include "BrowserEGLContext.h"
+#include "RenderThread.h"
+#include "RunnableQueue.h"
 #include <android_native_app_glue.h>
 #include <cstdlib>
-#include <vrb/RunnableQueue.h>
-#if defined(OCULUSVR)
-#include "DeviceDelegateOculusVR.h"
-#elif defined(SNAPDRAGONVR)
-#include "DeviceDelegateSVR.h"
-#endif
 
 #include <android/looper.h>
 #include <unistd.h>
@@ -29,33 +25,23 @@
 
 using namespace crow;
 
-#if defined(OCULUSVR)
-typedef DeviceDelegateOculusVR PlatformDeviceDelegate;
-typedef DeviceDelegateOculusVRPtr PlatformDeviceDelegatePtr;
-#elif defined(SNAPDRAGONVR)
-typedef DeviceDelegateSVR PlatformDeviceDelegate;
-typedef DeviceDelegateSVRPtr PlatformDeviceDelegatePtr;
-#endif
-
 namespace {
 
-jobject
-GetAssetManager(JNIEnv *aEnv, jobject aActivity) {
-  jclass clazz = aEnv->GetObjectClass(aActivity);
-  jmethodID method = aEnv->GetMethodID(clazz, "getAssets", "()Landroid/content/res/AssetManager;");
-  jobject result = aEnv->CallObjectMethod(aActivity, method);
-  if (!result) {
-    VRB_LOG("Failed to get AssetManager instance!");
-  }
-  return result;
-}
-
+// Looper ident of the runnable queue wakeup fd.
+static const int kRunnableQueueIdent = LOOPER_ID_USER;
+// Runnables share the GPU with the render thread through the shared context, so a burst
+// of them is spread over several frames.
+static const float kRunnableBudget = 2.0f; // milliseconds
+static const int kDeferredRunnableDelay = 14; // milliseconds, about a frame.
 
 struct AppContext {
-  vrb::RunnableQueuePtr mQueue;
+  RunnableQueuePtr mQueue;
+  ALooper* mLooper;
   BrowserWorldPtr mWorld;
+  RenderThreadPtr mRenderThread;
+  // Shares textures with the render context, for the runnables that create GL objects.
   BrowserEGLContextPtr mEgl;
-  PlatformDeviceDelegatePtr mDevice;
+  AppContext() : mLooper(nullptr) {}
 };
 typedef std::shared_ptr<AppContext> AppContextPtr;
 
@@ -71,22 +57,17 @@ CommandCallback(android_app *aApp, int32_t aCmd) {
     // android_app->window will contain the new window surface.
     case APP_CMD_INIT_WINDOW:
       VRB_LOG("APP_CMD_INIT_WINDOW %p", aApp->window);
+      ctx->mRenderThread->SetWindow(aApp->window);
       if (!ctx->mEgl) {
-        ctx->mEgl = BrowserEGLContext::Create();
-        ctx->mEgl->Initialize(aApp->window);
-        ctx->mEgl->MakeCurrent();
-        VRB_CHECK(glEnable(GL_DEPTH_TEST));
-        VRB_CHECK(glEnable(GL_CULL_FACE));
-        ctx->mWorld->InitializeGL();
-      } else {
-        ctx->mEgl->UpdateNativeWindow(aApp->window);
-        ctx->mEgl->MakeCurrent();
+        BrowserEGLContextPtr egl = BrowserEGLContext::Create();
+        if (ctx->mRenderThread->InitializeSharedContext(*egl)) {
+          ctx->mEgl = egl;
+          // Runnables may create GL objects so they are only run from here on, starting
+          // with the ones queued before there was a context.
+          ALooper_addFd(ctx->mLooper, ctx->mQueue->GetWakeFd(), kRunnableQueueIdent, ALOOPER_EVENT_INPUT,
+                        nullptr, nullptr);
+        }
       }
-
-      if (!ctx->mWorld->IsPaused() && !ctx->mDevice->IsInVRMode()) {
-        ctx->mDevice->EnterVR(*ctx->mEgl);
-      }
-
       break;
 
     // The existing ANativeWindow needs to be terminated.  Upon receiving this command,
@@ -94,29 +75,18 @@ CommandCallback(android_app *aApp, int32_t aCmd) {
     // after calling android_app_exec_cmd it will be set to NULL.
     case APP_CMD_TERM_WINDOW:
       VRB_LOG("APP_CMD_TERM_WINDOW");
-      if (ctx->mDevice->IsInVRMode()) {
-         ctx->mDevice->LeaveVR();
-      }
-      if (ctx->mEgl) {
-        ctx->mEgl->UpdateNativeWindow(nullptr);
-      }
+      ctx->mRenderThread->SetWindow(nullptr);
       break;
     // The app's activity has been paused.
     case APP_CMD_PAUSE:
       VRB_LOG("APP_CMD_PAUSE");
-      ctx->mWorld->Pause();
-      if (ctx->mDevice->IsInVRMode()) {
-        ctx->mDevice->LeaveVR();
-      }
+      ctx->mRenderThread->Pause();
       break;
 
     // The app's activity has been resumed.
     case APP_CMD_RESUME:
       VRB_LOG("APP_CMD_RESUME");
-      ctx->mWorld->Resume();
-      if (!ctx->mDevice->IsInVRMode() && ctx->mEgl && ctx->mEgl->IsSurfaceReady() ) {
-         ctx->mDevice->EnterVR(*ctx->mEgl);
-      }
+      ctx->mRenderThread->Resume();
       break;
 
     // the app's activity is being destroyed,
@@ -145,72 +115,101 @@ android_main(android_app *aAppState) {
 
   // Create Browser context
   sAppContext = std::make_shared<AppContext>();
-  sAppContext->mQueue = vrb::RunnableQueue::Create(aAppState->activity->vm);
+  sAppContext->mQueue = RunnableQueue::Create(aAppState->activity->vm);
+  sAppContext->mQueue->SetBudget(kRunnableBudget);
+  sAppContext->mLooper = ALooper_forThread();
   sAppContext->mWorld = BrowserWorld::Create();
 
-  // Create device delegate
-  sAppContext->mDevice = PlatformDeviceDelegate::Create(sAppContext->mWorld->GetWeakContext(),
-                                                        aAppState);
-  sAppContext->mWorld->RegisterDeviceDelegate(sAppContext->mDevice);
-
-  // Initialize java
-  auto assetManager = GetAssetManager(jniEnv, aAppState->activity->clazz);
-  sAppContext->mWorld->InitializeJava(jniEnv, aAppState->activity->clazz, assetManager);
-  jniEnv->DeleteLocalRef(assetManager);
+  // The device delegate and BrowserWorld's Java side are set up on the render thread.
+  sAppContext->mRenderThread = RenderThread::Create();
+  vrb::ContextWeak context = sAppContext->mWorld->GetWeakContext();
+  sAppContext->mRenderThread->Start(aAppState, sAppContext->mWorld, [context, aAppState]() -> PlatformDeviceDelegatePtr {
+    return PlatformDeviceDelegate::Create(context, aAppState);
+  });
 
   // Set up activity & SurfaceView life cycle callbacks
   aAppState->userData = sAppContext.get();
   aAppState->onAppCmd = CommandCallback;
 
-  // Main render loop
+  // Event loop. Frames are drawn on the render thread, so this thread sleeps until a
+  // looper event arrives or runnables are queued.
   while (true) {
     int events;
-    android_poll_source *pSource;
-
-    // Loop until all events are read
-    // If the activity is paused use a blocking call to read events.
-    while (ALooper_pollAll(sAppContext->mWorld->IsPaused() ? -1 : 0,
-                           NULL,
-                           &events,
-                           (void **) &pSource) >= 0) {
-      // Process event.
-      if (pSource) {
-        pSource->process(aAppState, pSource);
-      }
+    android_poll_source *pSource = nullptr;
+    const bool deferred = sAppContext->mEgl && (sAppContext->mQueue->GetLastStats().deferred > 0);
+    const int ident = ALooper_pollAll(deferred ? kDeferredRunnableDelay : -1, NULL, &events, (void **) &pSource);
 
-      // Check if we are exiting.
-      if (aAppState->destroyRequested != 0) {
-        sAppContext->mEgl->MakeCurrent();
-        sAppContext->mWorld->ShutdownGL();
-        sAppContext->mWorld->ShutdownJava();
+    // Process event.
+    if (pSource) {
+      pSource->process(aAppState, pSource);
+    }
+
+    // Check if we are exiting.
+    if (aAppState->destroyRequested != 0) {
+      if (sAppContext->mEgl) {
+        ALooper_removeFd(sAppContext->mLooper, sAppContext->mQueue->GetWakeFd());
         sAppContext->mEgl->Destroy();
-        sAppContext.reset();
-        aAppState->activity->vm->DetachCurrentThread();
-        return;
       }
+      sAppContext->mRenderThread->Stop();
+      sAppContext.reset();
+      aAppState->activity->vm->DetachCurrentThread();
+      return;
     }
-    if (sAppContext->mEgl) {
-      sAppContext->mEgl->MakeCurrent();
-    }
-    sAppContext->mQueue->ProcessRunnables();
-    if (!sAppContext->mWorld->IsPaused() && sAppContext->mDevice->IsInVRMode()) {
-      VRB_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-      sAppContext->mWorld->Draw();
+
+    if ((ident == kRunnableQueueIdent) || (ident == ALOOPER_POLL_TIMEOUT)) {
+      sAppContext->mQueue->ProcessRunnables();
     }
   }
 }
 
 JNI_METHOD(void, queueRunnable)
-(JNIEnv *aEnv, jobject, jobject aRunnable) {
+(JNIEnv *aEnv, jobject, jobject aRunnable, jint aPriority) {
   if (sAppContext) {
-    sAppContext->mQueue->AddRunnable(aEnv, aRunnable);
+    sAppContext->mQueue->AddRunnable(aEnv, aRunnable, (RunnableQueue::Priority) aPriority);
+  }
+}
+
+JNI_METHOD(jfloatArray, getFrameStats)
+(JNIEnv *aEnv, jobject) {
+  if (sAppContext && sAppContext->mWorld) {
+    return sAppContext->mWorld->GetFrameStats()->GetJavaSummaries(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(jintArray, getGLCounters)
+(JNIEnv *aEnv, jobject) {
+  if (sAppContext && sAppContext->mWorld) {
+    return sAppContext->mWorld->GetGLCounters()->GetJavaCounters(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(void, setTabOverview)
+(JNIEnv *, jobject, jboolean aEnabled) {
+  if (sAppContext && sAppContext->mWorld) {
+    sAppContext->mWorld->SetTabOverview(aEnabled != JNI_FALSE);
+  }
+}
+
+JNI_METHOD(void, startPresentation)
+(JNIEnv *, jobject, jint aWidth, jint aHeight) {
+  if (sAppContext && sAppContext->mWorld) {
+    sAppContext->mWorld->StartPresentation(aWidth, aHeight);
+  }
+}
+
+JNI_METHOD(void, stopPresentation)
+(JNIEnv *, jobject) {
+  if (sAppContext && sAppContext->mWorld) {
+    sAppContext->mWorld->StopPresentation();
   }
 }
 
 JNI_METHOD(jboolean, platformExit)
 (JNIEnv *aEnv, jobject, jobject aRunnable) {
-  if (sAppContext && sAppContext->mDevice) {
-    return (jboolean) sAppContext->mDevice->ExitApp();
+  if (sAppContext && sAppContext->mRenderThread) {
+    return (jboolean) sAppContext->mRenderThread->ExitApp();
   }
   return (jboolean) false;
 }
@@ -6,6 +6,7 @@
 #include "DeviceDelegateNoAPI.h"
 #include "ElbowModel.h"
 #include "GestureDelegate.h"
+#include "QuadLayerRenderer.h"
 
 #include "vrb/CameraSimple.h"
 #include "vrb/Color.h"
@@ -21,6 +22,15 @@ namespace crow {
 
 static vrb::Vector sHomePosition(0.0f, 1.7f, 0.0f);
 
+// Software emulation of a compositor quad layer, drawn over the scene with depth testing.
+struct QuadLayer {
+  GLuint texture;
+  vrb::Vector corners[QuadLayerRenderer::kCornerCount];
+  bool visible;
+  bool active;
+  QuadLayer() : texture(0), visible(false), active(false) {}
+};
+
 struct DeviceDelegateNoAPI::State {
   vrb::ContextWeak context;
   vrb::Matrix controller;
@@ -30,6 +40,8 @@ struct DeviceDelegateNoAPI::State {
   vrb::Matrix headingMatrix;
   vrb::Vector position;
   bool clicked;
+  std::vector<QuadLayer> layers;
+  QuadLayerRendererPtr layerRenderer;
   State()
       : controller(vrb::Matrix::Identity())
       , headingMatrix(vrb::Matrix::Identity())
@@ -41,9 +53,18 @@ struct DeviceDelegateNoAPI::State {
   void Initialize() {
     camera = vrb::CameraSimple::Create(context);
     camera->SetTransform(vrb::Matrix::Translation(sHomePosition));
+    layerRenderer = QuadLayerRenderer::Create();
   }
 
   void Shutdown() {
+    layers.clear();
+  }
+
+  QuadLayer* GetLayer(const int32_t aLayer) {
+    if ((aLayer < 0) || (aLayer >= layers.size()) || !layers[aLayer].active) {
+      return nullptr;
+    }
+    return &layers[aLayer];
   }
 };
 
@@ -106,6 +127,12 @@ DeviceDelegateNoAPI::GetControllerButtonState(const int32_t aWhichController, co
   return m.clicked;
 }
 
+void
+DeviceDelegateNoAPI::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  aWidth = (int32_t)m.camera->GetViewportWidth();
+  aHeight = (int32_t)m.camera->GetViewportHeight();
+}
+
 void
 DeviceDelegateNoAPI::StartFrame() {
   VRB_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
@@ -125,6 +152,53 @@ DeviceDelegateNoAPI::EndFrame() {
   // noop
 }
 
+int32_t
+DeviceDelegateNoAPI::CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) {
+  QuadLayer layer;
+  layer.texture = aTexture;
+  layer.active = true;
+  for (size_t ix = 0; ix < m.layers.size(); ix++) {
+    if (!m.layers[ix].active) {
+      m.layers[ix] = layer;
+      return (int32_t)ix;
+    }
+  }
+  m.layers.push_back(layer);
+  return (int32_t)m.layers.size() - 1;
+}
+
+void
+DeviceDelegateNoAPI::UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                                     const vrb::Vector& aMax, const bool aVisible,
+                                     const bool aContentChanged) {
+  QuadLayer* layer = m.GetLayer(aLayer);
+  if (!layer) {
+    return;
+  }
+  QuadLayerRenderer::GetCorners(aTransform, aMin, aMax, layer->corners);
+  layer->visible = aVisible;
+}
+
+void
+DeviceDelegateNoAPI::DestroyQuadLayer(const int32_t aLayer) {
+  QuadLayer* layer = m.GetLayer(aLayer);
+  if (layer) {
+    *layer = QuadLayer();
+  }
+}
+
+void
+DeviceDelegateNoAPI::DrawQuadLayers(const vrb::Camera& aCamera) {
+  if (m.layers.empty() || !m.layerRenderer->Initialize()) {
+    return;
+  }
+  for (const QuadLayer& layer: m.layers) {
+    if (layer.active && layer.visible) {
+      m.layerRenderer->Draw(layer.texture, layer.corners, aCamera);
+    }
+  }
+}
+
 void
 DeviceDelegateNoAPI::SetViewport(const int aWidth, const int aHeight) {
   m.camera->SetViewport(aWidth, aHeight);
@@ -31,9 +31,16 @@ public:
   const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
   bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton, bool& aChangedState) override;
   bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override { return false; }
+  void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const override;
   void StartFrame() override;
   void BindEye(const CameraEnum aWhich) override;
   void EndFrame() override;
+  bool SupportsQuadLayers() const override { return true; }
+  int32_t CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) override;
+  void UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                       const vrb::Vector& aMax, const bool aVisible, const bool aContentChanged) override;
+  void DestroyQuadLayer(const int32_t aLayer) override;
+  void DrawQuadLayers(const vrb::Camera& aCamera) override;
   // DeviceDelegateNoAPI interface
   void SetViewport(const int aWidth, const int aHeight);
   void Pause();
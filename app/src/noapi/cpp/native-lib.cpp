@@ -8,11 +8,14 @@
 
 #include "BrowserWorld.h"
 #include "DeviceDelegateNoAPI.h"
+#include "DeviceDelegateReplay.h"
 #include "vrb/GLError.h"
 #include "vrb/Logger.h"
 
 static crow::BrowserWorldPtr sWorld;
 static crow::DeviceDelegateNoAPIPtr sDevice;
+// Set when a recorded device trace is replayed in place of the emulated device.
+static crow::DeviceDelegateReplayPtr sReplay;
 
 #define JNI_METHOD(return_type, method_name) \
   JNIEXPORT return_type JNICALL              \
@@ -43,14 +46,24 @@ JNI_METHOD(void, activityCreated)
   if (!sDevice) {
     sDevice = crow::DeviceDelegateNoAPI::Create(sWorld->GetWeakContext());
   }
+  if (!sReplay) {
+    sReplay = crow::DeviceDelegateReplay::CreateIfRequested(sWorld->GetWeakContext());
+  }
   sDevice->Resume();
-  sWorld->RegisterDeviceDelegate(sDevice);
+  if (sReplay) {
+    sWorld->RegisterDeviceDelegate(sReplay);
+  } else {
+    sWorld->RegisterDeviceDelegate(sDevice);
+  }
   sWorld->InitializeJava(aEnv, aActivity, aAssetManager);
   sWorld->InitializeGL();
 }
 
 JNI_METHOD(void, updateViewport)
 (JNIEnv*, jobject, int aWidth, int aHeight) {
+  if (sReplay) {
+    sReplay->SetViewport(aWidth, aHeight);
+  }
   if (sDevice) {
     sDevice->SetViewport(aWidth, aHeight);
   } else {
@@ -63,6 +76,7 @@ JNI_METHOD(void, activityDestroyed)
   sWorld->ShutdownJava();
   sWorld->RegisterDeviceDelegate(nullptr);
   sDevice = nullptr;
+  sReplay = nullptr;
 }
 
 JNI_METHOD(void, drawGL)
@@ -85,6 +99,43 @@ JNI_METHOD(void, touchEvent)
   sDevice->TouchEvent(aDown, aX, aY);
 }
 
+JNI_METHOD(jfloatArray, getFrameStats)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetFrameStats()->GetJavaSummaries(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(jintArray, getGLCounters)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetGLCounters()->GetJavaCounters(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(void, setTabOverview)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  if (sWorld) {
+    sWorld->SetTabOverview(aEnabled != JNI_FALSE);
+  }
+}
+
+JNI_METHOD(void, startPresentation)
+(JNIEnv*, jobject, jint aWidth, jint aHeight) {
+  if (sWorld) {
+    sWorld->StartPresentation(aWidth, aHeight);
+  }
+}
+
+JNI_METHOD(void, stopPresentation)
+(JNIEnv*, jobject) {
+  if (sWorld) {
+    sWorld->StopPresentation();
+  }
+}
+
 jint JNI_OnLoad(JavaVM* aVm, void*) {
   sWorld = crow::BrowserWorld::Create();
   return JNI_VERSION_1_6;
@@ -93,6 +144,7 @@ jint JNI_OnLoad(JavaVM* aVm, void*) {
 void JNI_OnUnLoad(JavaVM* vm, void* reserved) {
   sWorld = nullptr;
   sDevice = nullptr;
+  sReplay = nullptr;
 }
 
 } // extern "C"
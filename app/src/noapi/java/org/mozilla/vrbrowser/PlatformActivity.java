@@ -18,6 +18,11 @@ import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
 public class PlatformActivity extends Activity {
+    // Priority classes of queueRunnable(), must be kept in sync with RunnableQueue::Priority.
+    // High priority runnables always run, the others may be deferred to a later frame.
+    static final int RUNNABLE_PRIORITY_HIGH = 0;
+    static final int RUNNABLE_PRIORITY_NORMAL = 1;
+    static final int RUNNABLE_PRIORITY_LOW = 2;
     static String LOGTAG = "VRB";
     static final float ROTATION = 0.098174770424681f;
     // Used to load the 'native-lib' library on application startup.
@@ -161,6 +166,11 @@ public class PlatformActivity extends Activity {
         mView.queueEvent(aRunnable);
     }
 
+    // GLSurfaceView runs its queued events in order before each frame, without priorities.
+    void queueRunnable(Runnable aRunnable, int aPriority) {
+        mView.queueEvent(aRunnable);
+    }
+
     private void setupUI() {
         findViewById(R.id.up_button).setOnClickListener(new View.OnClickListener() {
             @Override
@@ -249,4 +259,20 @@ public class PlatformActivity extends Activity {
     private native void moveAxis(float aX, float aY, float aZ);
     private native void rotateHeading(float aHeading);
     private native void touchEvent(boolean aDown, float aX, float aY);
+    // Returns {p50, p95, p99 (milliseconds), over budget frame count, frames run} for each frame phase:
+    // ProcessEvents, Update, UpdateControllers, Cull, Copies, StartFrame, DrawLeft, DrawRight, EndFrame, Total.
+    // Followed by the last frame's {FrameSlack, FrameSleep, FramesMissed, PresentationDropped,
+    // PresentationRepeated, PresentationLatency, WidgetsHibernated, TextureMegabytes}.
+    protected native float[] getFrameStats();
+    // Returns the GL command counts of the last frame, all zero when built with GL_COUNTERS=OFF.
+    // {DrawCalls, Triangles, ProgramSwitches, TextureBinds, UniformUploads, BufferBinds, FramebufferBinds,
+    // StateChanges, Clears, Uploads} for each of Frame, LeftEye and RightEye, followed by the scene counts
+    // {Widgets, WidgetsCulled, WidgetsLayered, Controllers, SurfacesLatched, DrawablesEmitted}.
+    protected native int[] getGLCounters();
+    // Shows the browser widget thumbnails in a grid in front of the user.
+    protected native void setTabOverview(boolean aEnabled);
+    // Immersive presentation of side by side stereo frames, twice the eye buffer width when the
+    // size is zero. The surface is handed over through dispatchPresentationSurface().
+    protected native void startPresentation(int aWidth, int aHeight);
+    protected native void stopPresentation();
 }
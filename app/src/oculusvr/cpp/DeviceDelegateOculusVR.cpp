@@ -6,9 +6,11 @@
 #include "DeviceDelegateOculusVR.h"
 #include "ElbowModel.h"
 #include "BrowserEGLContext.h"
+#include "QuadLayerRenderer.h"
 
 #include <android_native_app_glue.h>
 #include <EGL/egl.h>
+#include <GLES3/gl3.h>
 #include "vrb/CameraEye.h"
 #include "vrb/Color.h"
 #include "vrb/ConcreteClass.h"
@@ -18,6 +20,7 @@
 #include "vrb/Vector.h"
 #include "vrb/Quaternion.h"
 
+#include <algorithm>
 #include <vector>
 #include <cstdlib>
 
@@ -28,6 +31,23 @@
 
 namespace crow {
 
+static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
+// vrapi accepts a small fixed number of layers per frame, one is kept for the eye buffers.
+static const size_t kMaxQuadLayers = 8;
+// Images per quad layer swap chain, one presented, one queued and one being copied into.
+static const int kQuadLayerBufferCount = 3;
+
+// Maps the tan angle texture coordinates of aEye into its half of a side by side stereo
+// frame. Row 2 of the matrix is the divisor, one for points on the view plane.
+static ovrMatrix4f
+SideBySideTanAngleMatrix(const ovrMatrix4f& aMatrix, const int aEye) {
+  ovrMatrix4f result = aMatrix;
+  for (int ix = 0; ix < 4; ix++) {
+    result.M[0][ix] = (0.5f * aMatrix.M[0][ix]) + (0.5f * (float)aEye * aMatrix.M[2][ix]);
+  }
+  return result;
+}
+
 class OculusEyeSwapChain;
 
 typedef std::shared_ptr<OculusEyeSwapChain> OculusEyeSwapChainPtr;
@@ -78,6 +98,81 @@ struct OculusEyeSwapChain {
   }
 };
 
+class OculusLayerSwapChain;
+
+typedef std::shared_ptr<OculusLayerSwapChain> OculusLayerSwapChainPtr;
+
+// Color only swap chain for a quad layer. The layer texture is copied into it without
+// depth testing, so unlike the eye buffers the framebuffers have no depth or multisample
+// attachments.
+struct OculusLayerSwapChain {
+  ovrTextureSwapChain *ovrSwapChain = nullptr;
+  std::vector<GLuint> framebuffers;
+  int64_t bytes = 0;
+
+  static OculusLayerSwapChainPtr create() {
+    return std::make_shared<OculusLayerSwapChain>();
+  }
+
+  void Init(const int32_t aWidth, const int32_t aHeight) {
+    Destroy();
+    ovrSwapChain = vrapi_CreateTextureSwapChain3(VRAPI_TEXTURE_TYPE_2D, GL_RGBA8, aWidth, aHeight, 1,
+                                                 kQuadLayerBufferCount);
+    if (!ovrSwapChain) {
+      VRB_LOG("FAILED to create quad layer swap chain");
+      return;
+    }
+    const int length = vrapi_GetTextureSwapChainLength(ovrSwapChain);
+    framebuffers.resize((size_t)length, 0);
+    VRB_CHECK(glGenFramebuffers(length, framebuffers.data()));
+    for (int i = 0; i < length; ++i) {
+      const GLuint texture = vrapi_GetTextureSwapChainHandle(ovrSwapChain, i);
+      VRB_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+      VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+      VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+      VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+      VRB_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+      VRB_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]));
+      VRB_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0));
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        VRB_LOG("FAILED to make valid quad layer framebuffer");
+        framebuffers[i] = 0;
+      }
+    }
+    VRB_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+    VRB_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    framebuffers.erase(std::remove(framebuffers.begin(), framebuffers.end(), 0), framebuffers.end());
+    bytes = (int64_t)aWidth * (int64_t)aHeight * 4 * length;
+  }
+
+  void Destroy() {
+    if (!framebuffers.empty()) {
+      VRB_CHECK(glDeleteFramebuffers((GLsizei)framebuffers.size(), framebuffers.data()));
+      framebuffers.clear();
+    }
+    if (ovrSwapChain) {
+      vrapi_DestroyTextureSwapChain(ovrSwapChain);
+      ovrSwapChain = nullptr;
+    }
+    bytes = 0;
+  }
+};
+
+// A widget surface presented by the compositor. The external texture is copied into a swap
+// chain each frame since vrapi layers can not sample a SurfaceTexture directly.
+struct OculusQuadLayer {
+  GLuint texture = 0;
+  int32_t width = 0;
+  int32_t height = 0;
+  vrb::Vector corners[QuadLayerRenderer::kCornerCount];
+  bool visible = false;
+  bool active = false;
+  // The swap chain image holding the latest copy of the texture, -1 until the first copy.
+  int32_t imageIndex = -1;
+  bool contentChanged = true;
+  OculusLayerSwapChainPtr swapChain;
+};
+
 struct DeviceDelegateOculusVR::State {
   vrb::ContextWeak context;
   android_app* app = nullptr;
@@ -89,6 +184,7 @@ struct DeviceDelegateOculusVR::State {
   vrb::CameraEyePtr cameras[2];
   uint32_t frameIndex = 0;
   double predictedDisplayTime = 0;
+  double displayPeriod = 0;
   ovrTracking2 predictedTracking = {};
   uint32_t renderWidth = 0;
   uint32_t renderHeight = 0;
@@ -100,6 +196,14 @@ struct DeviceDelegateOculusVR::State {
   vrb::Matrix controllerTransform = vrb::Matrix::Identity();
   ovrInputStateTrackedRemote controllerState = {};
   crow::ElbowModelPtr elbow;
+  std::vector<OculusQuadLayer> quadLayers;
+  QuadLayerRendererPtr quadRenderer;
+  // Pose the eye buffers of this frame were rendered for, when not the predicted one.
+  bool eyeBufferPoseSet = false;
+  ovrPosef eyeBufferPose = {};
+  // Android surface the immersive presentation is drawn into, submitted as the eye buffers.
+  ovrTextureSwapChain* presentationSwapChain = nullptr;
+  bool presentationSubmit = false;
 
   int32_t cameraIndex(CameraEnum aWhich) {
     if (CameraEnum::Left == aWhich) { return 0; }
@@ -139,15 +243,87 @@ struct DeviceDelegateOculusVR::State {
                                                         VRAPI_SYS_PROP_SUGGESTED_EYE_TEXTURE_WIDTH) * 1.5;
     renderHeight = (uint32_t) vrapi_GetSystemPropertyInt(&java,
                                                          VRAPI_SYS_PROP_SUGGESTED_EYE_TEXTURE_HEIGHT) * 1.5;
+    const float refreshRate = vrapi_GetSystemPropertyFloat(&java, VRAPI_SYS_PROP_DISPLAY_REFRESH_RATE);
+    displayPeriod = refreshRate > 0.0f ? 1.0 / refreshRate : 0.0;
 
     for (int i = 0; i < VRAPI_EYE_COUNT; ++i) {
       cameras[i] = vrb::CameraEye::Create(context);
       eyeSwapChains[i] = OculusEyeSwapChain::create();
     }
+    quadRenderer = QuadLayerRenderer::Create();
     UpdatePerspective();
   }
 
+  OculusQuadLayer* GetQuadLayer(const int32_t aLayer) {
+    if ((aLayer < 0) || (aLayer >= quadLayers.size()) || !quadLayers[aLayer].active) {
+      return nullptr;
+    }
+    return &quadLayers[aLayer];
+  }
+
+  // Copies each visible layer texture into the next image of its swap chain. Layers whose
+  // texture did not change keep presenting the image they were last copied into.
+  void BlitQuadLayers() {
+    if (quadLayers.empty() || !quadRenderer->Initialize()) {
+      return;
+    }
+    for (OculusQuadLayer& layer: quadLayers) {
+      if (!layer.active || !layer.visible) {
+        continue;
+      }
+      if (!layer.swapChain) {
+        layer.swapChain = OculusLayerSwapChain::create();
+        layer.swapChain->Init(layer.width, layer.height);
+      }
+      if (layer.swapChain->framebuffers.empty() || ((layer.imageIndex >= 0) && !layer.contentChanged)) {
+        continue;
+      }
+      layer.imageIndex = (layer.imageIndex + 1) % (int32_t)layer.swapChain->framebuffers.size();
+      VRB_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, layer.swapChain->framebuffers[layer.imageIndex]));
+      VRB_CHECK(glViewport(0, 0, layer.width, layer.height));
+      quadRenderer->Blit(layer.texture);
+      // Every texel is overwritten, the tiler does not need to keep the previous contents.
+      const GLenum attachment = GL_COLOR_ATTACHMENT0;
+      VRB_CHECK(glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment));
+      VRB_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+      layer.contentChanged = false;
+    }
+  }
+
+  // Maps the unit square onto the layer quad in tracking space.
+  ovrMatrix4f GetQuadLayerModel(const OculusQuadLayer& aLayer) const {
+    const vrb::Vector* corners = aLayer.corners;
+    const vrb::Vector halfX = (corners[1] - corners[0]) * 0.5f;
+    const vrb::Vector halfY = (corners[3] - corners[0]) * 0.5f;
+    const vrb::Vector normal = halfX.Cross(halfY).Normalize();
+    const vrb::Vector center = ((corners[0] + corners[2]) * 0.5f) - kAverageHeight;
+    ovrMatrix4f result = ovrMatrix4f_CreateIdentity();
+    result.M[0][0] = halfX.x(); result.M[0][1] = halfY.x(); result.M[0][2] = normal.x(); result.M[0][3] = center.x();
+    result.M[1][0] = halfX.y(); result.M[1][1] = halfY.y(); result.M[1][2] = normal.y(); result.M[1][3] = center.y();
+    result.M[2][0] = halfX.z(); result.M[2][1] = halfY.z(); result.M[2][2] = normal.z(); result.M[2][3] = center.z();
+    return result;
+  }
+
+  void DestroyQuadLayerSwapChains() {
+    for (OculusQuadLayer& layer: quadLayers) {
+      if (layer.swapChain) {
+        layer.swapChain->Destroy();
+        layer.swapChain.reset();
+      }
+      layer.imageIndex = -1;
+    }
+  }
+
+  void DestroyPresentationSwapChain() {
+    if (presentationSwapChain) {
+      vrapi_DestroyTextureSwapChain(presentationSwapChain);
+      presentationSwapChain = nullptr;
+    }
+    presentationSubmit = false;
+  }
+
   void Shutdown() {
+    DestroyPresentationSwapChain();
     // Shutdown Oculus mobile SDK
     if (initialized) {
       vrapi_Shutdown();
@@ -297,6 +473,23 @@ DeviceDelegateOculusVR::GetControllerScrolled(const int32_t aWhichController, fl
   return m.controllerState.TrackpadStatus;
 }
 
+void
+DeviceDelegateOculusVR::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  aWidth = (int32_t)m.renderWidth;
+  aHeight = (int32_t)m.renderHeight;
+}
+
+bool
+DeviceDelegateOculusVR::GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const {
+  if (!m.ovr || (m.displayPeriod <= 0.0)) {
+    return false;
+  }
+  // VrApi times are seconds on the monotonic clock.
+  aPredictedDisplayTime = vrapi_GetPredictedDisplayTime(m.ovr, m.frameIndex + 1);
+  aDisplayPeriod = m.displayPeriod;
+  return true;
+}
+
 void
 DeviceDelegateOculusVR::StartFrame() {
   if (!m.ovr) {
@@ -330,7 +523,6 @@ DeviceDelegateOculusVR::StartFrame() {
     head.TranslateInPlace(translation);
   }
 
-  static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
   head.TranslateInPlace(kAverageHeight);
 
   m.cameras[VRAPI_EYE_LEFT]->SetHeadTransform(head);
@@ -380,10 +572,62 @@ DeviceDelegateOculusVR::EndFrame() {
     m.currentFBO->Unbind();
     m.currentFBO.reset();
   }
+  // The presentation covers the whole view, the widget layers are not shown under it.
+  const bool presenting = m.presentationSubmit && m.presentationSwapChain;
+  m.presentationSubmit = false;
+
+  if (!presenting) {
+    m.BlitQuadLayers();
+  }
+
+  // Quad layers are composited underneath the eye buffers, which have alpha holes
+  // punched where the layers should be visible.
+  ovrLayerProjection2 quads[kMaxQuadLayers];
+  ovrLayerHeader2* layers[kMaxQuadLayers + 1];
+  int layerCount = 0;
+  for (const OculusQuadLayer& quad: m.quadLayers) {
+    if (presenting || !quad.active || !quad.visible || !quad.swapChain || (quad.imageIndex < 0)) {
+      continue;
+    }
+    ovrLayerProjection2& quadLayer = quads[layerCount];
+    quadLayer = vrapi_DefaultLayerProjection2();
+    quadLayer.HeadPose = m.predictedTracking.HeadPose;
+    quadLayer.Header.Flags |= VRAPI_FRAME_LAYER_FLAG_CLIP_TO_TEXTURE_RECT;
+    const ovrMatrix4f model = m.GetQuadLayerModel(quad);
+    for (int i = 0; i < VRAPI_FRAME_LAYER_EYE_MAX; ++i) {
+      const ovrMatrix4f modelView = ovrMatrix4f_Multiply(&m.predictedTracking.Eye[i].ViewMatrix, &model);
+      quadLayer.Textures[i].ColorSwapChain = quad.swapChain->ovrSwapChain;
+      quadLayer.Textures[i].SwapChainIndex = quad.imageIndex;
+      quadLayer.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromUnitSquare(&modelView);
+    }
+    layers[layerCount] = &quadLayer.Header;
+    layerCount++;
+  }
 
   auto layer = vrapi_DefaultLayerProjection2();
   layer.HeadPose = m.predictedTracking.HeadPose;
+  if (m.eyeBufferPoseSet) {
+    // The compositor reprojects the frame from the pose it was rendered for.
+    layer.HeadPose.Pose = m.eyeBufferPose;
+    m.eyeBufferPoseSet = false;
+  }
+  if (presenting) {
+    // The compositor shows the newest frame posted to the surface, each eye reads its half.
+    layer.Header.Flags |= VRAPI_FRAME_LAYER_FLAG_CLIP_TO_TEXTURE_RECT;
+  }
   for (int i = 0; i < VRAPI_FRAME_LAYER_EYE_MAX; ++i) {
+    if (presenting) {
+      const ovrMatrix4f tanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(
+          &m.predictedTracking.Eye[i].ProjectionMatrix);
+      layer.Textures[i].ColorSwapChain = m.presentationSwapChain;
+      layer.Textures[i].SwapChainIndex = 0;
+      layer.Textures[i].TexCoordsFromTanAngles = SideBySideTanAngleMatrix(tanAngles, i);
+      layer.Textures[i].TextureRect.x = 0.5f * (float)i;
+      layer.Textures[i].TextureRect.y = 0.0f;
+      layer.Textures[i].TextureRect.width = 0.5f;
+      layer.Textures[i].TextureRect.height = 1.0f;
+      continue;
+    }
     const auto &eyeSwapChain = m.eyeSwapChains[i];
     int swapChainIndex = m.frameIndex % eyeSwapChain->swapChainLength;
     // Set up OVR layer textures
@@ -392,6 +636,12 @@ DeviceDelegateOculusVR::EndFrame() {
     layer.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(
         &m.predictedTracking.Eye[i].ProjectionMatrix);
   }
+  if (layerCount > 0) {
+    layer.Header.SrcBlend = VRAPI_FRAME_LAYER_BLEND_SRC_ALPHA;
+    layer.Header.DstBlend = VRAPI_FRAME_LAYER_BLEND_ONE_MINUS_SRC_ALPHA;
+  }
+  layers[layerCount] = &layer.Header;
+  layerCount++;
 
   ovrSubmitFrameDescription2 frameDesc = {};
   frameDesc.Flags = 0;
@@ -400,13 +650,123 @@ DeviceDelegateOculusVR::EndFrame() {
   frameDesc.DisplayTime = m.predictedDisplayTime;
   frameDesc.CompletionFence = 0;
 
-  ovrLayerHeader2* layers[] = {&layer.Header};
-  frameDesc.LayerCount = sizeof(layers) / sizeof(layers[0]);
+  frameDesc.LayerCount = layerCount;
   frameDesc.Layers = layers;
 
   vrapi_SubmitFrame2(m.ovr, &frameDesc);
 }
 
+void
+DeviceDelegateOculusVR::SetEyeBufferPose(const vrb::Matrix& aHeadTransform) {
+  // Undo the conversion StartFrame() made from the tracking pose.
+  const vrb::Quaternion orientation(aHeadTransform);
+  const vrb::Vector position = aHeadTransform.GetTranslation() - kAverageHeight;
+  m.eyeBufferPose.Orientation.x = orientation.x();
+  m.eyeBufferPose.Orientation.y = orientation.y();
+  m.eyeBufferPose.Orientation.z = orientation.z();
+  m.eyeBufferPose.Orientation.w = orientation.w();
+  m.eyeBufferPose.Position.x = position.x();
+  m.eyeBufferPose.Position.y = position.y();
+  m.eyeBufferPose.Position.z = position.z();
+  m.eyeBufferPoseSet = true;
+}
+
+jobject
+DeviceDelegateOculusVR::CreatePresentationSurface(const int32_t aWidth, const int32_t aHeight) {
+  m.DestroyPresentationSwapChain();
+  m.presentationSwapChain = vrapi_CreateAndroidSurfaceSwapChain(aWidth, aHeight);
+  if (!m.presentationSwapChain) {
+    VRB_LOG("Failed to create the presentation surface swap chain");
+    return nullptr;
+  }
+  return vrapi_GetTextureSwapChainAndroidSurface(m.presentationSwapChain);
+}
+
+void
+DeviceDelegateOculusVR::SubmitPresentationSurface() {
+  m.presentationSubmit = true;
+}
+
+void
+DeviceDelegateOculusVR::DestroyPresentationSurface() {
+  m.DestroyPresentationSwapChain();
+}
+
+bool
+DeviceDelegateOculusVR::SupportsQuadLayers() const {
+  return true;
+}
+
+int32_t
+DeviceDelegateOculusVR::CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) {
+  if ((aWidth <= 0) || (aHeight <= 0)) {
+    return -1;
+  }
+  OculusQuadLayer layer;
+  layer.texture = aTexture;
+  layer.width = aWidth;
+  layer.height = aHeight;
+  layer.active = true;
+  for (size_t ix = 0; ix < m.quadLayers.size(); ix++) {
+    if (!m.quadLayers[ix].active) {
+      m.quadLayers[ix] = layer;
+      return (int32_t)ix;
+    }
+  }
+  if (m.quadLayers.size() >= kMaxQuadLayers) {
+    return -1;
+  }
+  m.quadLayers.push_back(layer);
+  return (int32_t)m.quadLayers.size() - 1;
+}
+
+void
+DeviceDelegateOculusVR::UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                                        const vrb::Vector& aMax, const bool aVisible,
+                                        const bool aContentChanged) {
+  OculusQuadLayer* layer = m.GetQuadLayer(aLayer);
+  if (!layer) {
+    return;
+  }
+  QuadLayerRenderer::GetCorners(aTransform, aMin, aMax, layer->corners);
+  layer->visible = aVisible;
+  // Frames latched while the layer was hidden still have to be copied once it shows again.
+  layer->contentChanged = layer->contentChanged || aContentChanged;
+}
+
+void
+DeviceDelegateOculusVR::DestroyQuadLayer(const int32_t aLayer) {
+  OculusQuadLayer* layer = m.GetQuadLayer(aLayer);
+  if (!layer) {
+    return;
+  }
+  if (layer->swapChain) {
+    layer->swapChain->Destroy();
+  }
+  *layer = OculusQuadLayer();
+}
+
+int64_t
+DeviceDelegateOculusVR::GetQuadLayerBytes(const int32_t aLayer) const {
+  if ((aLayer < 0) || (aLayer >= m.quadLayers.size())) {
+    return 0;
+  }
+  const OculusQuadLayer& layer = m.quadLayers[aLayer];
+  return layer.active && layer.swapChain ? layer.swapChain->bytes : 0;
+}
+
+void
+DeviceDelegateOculusVR::DrawQuadLayers(const vrb::Camera& aCamera) {
+  if (m.quadLayers.empty() || !m.quadRenderer->Initialize()) {
+    return;
+  }
+  for (const OculusQuadLayer& layer: m.quadLayers) {
+    if (layer.active && layer.visible) {
+      m.quadRenderer->DrawHole(layer.corners, aCamera);
+    }
+  }
+}
+
 void
 DeviceDelegateOculusVR::EnterVR(const crow::BrowserEGLContext& aEGLContext) {
   if (m.ovr) {
@@ -444,6 +804,7 @@ DeviceDelegateOculusVR::LeaveVR() {
   for (int i = 0; i < VRAPI_EYE_COUNT; ++i) {
     m.eyeSwapChains[i]->Destroy();
   }
+  m.DestroyQuadLayerSwapChains();
 }
 
 bool
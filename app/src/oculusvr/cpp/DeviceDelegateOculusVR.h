@@ -34,9 +34,22 @@ public:
   const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
   bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton, bool& aChangedState) override;
   bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override;
+  void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const override;
+  bool GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const override;
   void StartFrame() override;
   void BindEye(const CameraEnum aWhich) override;
   void EndFrame() override;
+  bool SupportsQuadLayers() const override;
+  int32_t CreateQuadLayer(const uint32_t aTexture, const int32_t aWidth, const int32_t aHeight) override;
+  void UpdateQuadLayer(const int32_t aLayer, const vrb::Matrix& aTransform, const vrb::Vector& aMin,
+                       const vrb::Vector& aMax, const bool aVisible, const bool aContentChanged) override;
+  void DestroyQuadLayer(const int32_t aLayer) override;
+  int64_t GetQuadLayerBytes(const int32_t aLayer) const override;
+  void DrawQuadLayers(const vrb::Camera& aCamera) override;
+  void SetEyeBufferPose(const vrb::Matrix& aHeadTransform) override;
+  jobject CreatePresentationSurface(const int32_t aWidth, const int32_t aHeight) override;
+  void SubmitPresentationSurface() override;
+  void DestroyPresentationSurface() override;
   // Custom methods for NativeActivity render loop based devices.
   void EnterVR(const crow::BrowserEGLContext& aEGLContext);
   void LeaveVR();
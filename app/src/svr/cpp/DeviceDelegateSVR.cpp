@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <cstdlib>
+#include <time.h>
 #include <unistd.h>
 
 #include "svrApi.h"
@@ -88,6 +89,7 @@ struct DeviceDelegateSVR::State {
   vrb::CameraEyePtr cameras[2];
   uint32_t frameIndex = 0;
   svrHeadPoseState predictedPose = {};
+  double displayPeriod = 0;
   svrLayoutCoords layoutCoords = {};
   uint32_t renderWidth = 0;
   uint32_t renderHeight = 0;
@@ -160,6 +162,7 @@ struct DeviceDelegateSVR::State {
 
     renderWidth = (uint32_t) info.targetEyeWidthPixels;
     renderHeight = (uint32_t) info.targetEyeHeightPixels;
+    displayPeriod = info.displayRefreshRateHz > 0.0f ? 1.0 / info.displayRefreshRateHz : 0.0;
     near = info.leftEyeFrustum.near;
     far = info.leftEyeFrustum.far;
 
@@ -275,6 +278,26 @@ DeviceDelegateSVR::GetControllerButtonState(const int32_t aWhichController, cons
   return (m.controllerState.buttonState & SVR_BUTTONS[aWhichButton]) != 0;
 }
 
+void
+DeviceDelegateSVR::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  aWidth = (int32_t)m.renderWidth;
+  aHeight = (int32_t)m.renderHeight;
+}
+
+bool
+DeviceDelegateSVR::GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const {
+  if (!m.isInVRMode || (m.displayPeriod <= 0.0)) {
+    return false;
+  }
+  // SVR predicts milliseconds from now, convert them to the monotonic timeline.
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  aPredictedDisplayTime = (double)now.tv_sec + ((double)now.tv_nsec * 1.0e-9) +
+                          ((double)svrGetPredictedDisplayTime() * 1.0e-3);
+  aDisplayPeriod = m.displayPeriod;
+  return true;
+}
+
 void
 DeviceDelegateSVR::StartFrame() {
   if (!m.isInVRMode) {
@@ -34,6 +34,8 @@ public:
   const vrb::Matrix& GetControllerTransform(const int32_t aWhichController) override;
   bool GetControllerButtonState(const int32_t aWhichController, const int32_t aWhichButton, bool& aChangedState) override;
   bool GetControllerScrolled(const int32_t aWhichController, float& aScrollX, float& aScrollY) override { return false; }
+  void GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const override;
+  bool GetDisplayTiming(double& aPredictedDisplayTime, double& aDisplayPeriod) const override;
   void StartFrame() override;
   void BindEye(const CameraEnum aWhich) override;
   void EndFrame() override;
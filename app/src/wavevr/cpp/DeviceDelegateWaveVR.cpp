@@ -404,6 +404,12 @@ DeviceDelegateWaveVR::GetControllerScrolled(const int32_t aWhichController, floa
 }
 
 
+void
+DeviceDelegateWaveVR::GetEyeBufferSize(int32_t& aWidth, int32_t& aHeight) const {
+  aWidth = (int32_t)m.renderWidth;
+  aHeight = (int32_t)m.renderHeight;
+}
+
 void
 DeviceDelegateWaveVR::StartFrame() {
   VRB_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
@@ -16,14 +16,18 @@
 
 #include "BrowserWorld.h"
 #include "DeviceDelegateWaveVR.h"
+#include "RunnableQueue.h"
 #include "vrb/Logger.h"
 #include "vrb/GLError.h"
-#include "vrb/RunnableQueue.h"
 
 using namespace crow;
 
+// Runnables are run on the render thread before each frame, a burst of them is spread
+// over several frames.
+static const float kRunnableBudget = 2.0f; // milliseconds
+
 static bool sJavaInitialized = false;
-static vrb::RunnableQueuePtr sQueue;
+static RunnableQueuePtr sQueue;
 static BrowserWorldPtr sWorld;
 static DeviceDelegateWaveVRPtr sDevice;
 
@@ -84,8 +88,8 @@ int main(int argc, char *argv[]) {
 }
 
 JNI_METHOD(void, queueRunnable)
-(JNIEnv* aEnv, jobject, jobject aRunnable) {
-  sQueue->AddRunnable(aEnv, aRunnable);
+(JNIEnv* aEnv, jobject, jobject aRunnable, jint aPriority) {
+  sQueue->AddRunnable(aEnv, aRunnable, (RunnableQueue::Priority) aPriority);
 }
 
 JNI_METHOD(void, initializeJava)
@@ -94,8 +98,46 @@ JNI_METHOD(void, initializeJava)
   sWorld->InitializeJava(aEnv, aActivity, aAssets);
 }
 
+JNI_METHOD(jfloatArray, getFrameStats)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetFrameStats()->GetJavaSummaries(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(jintArray, getGLCounters)
+(JNIEnv* aEnv, jobject) {
+  if (sWorld) {
+    return sWorld->GetGLCounters()->GetJavaCounters(aEnv);
+  }
+  return nullptr;
+}
+
+JNI_METHOD(void, setTabOverview)
+(JNIEnv*, jobject, jboolean aEnabled) {
+  if (sWorld) {
+    sWorld->SetTabOverview(aEnabled != JNI_FALSE);
+  }
+}
+
+JNI_METHOD(void, startPresentation)
+(JNIEnv*, jobject, jint aWidth, jint aHeight) {
+  if (sWorld) {
+    sWorld->StartPresentation(aWidth, aHeight);
+  }
+}
+
+JNI_METHOD(void, stopPresentation)
+(JNIEnv*, jobject) {
+  if (sWorld) {
+    sWorld->StopPresentation();
+  }
+}
+
 jint JNI_OnLoad(JavaVM* aVm, void*) {
-  sQueue = vrb::RunnableQueue::Create(aVm);
+  sQueue = RunnableQueue::Create(aVm);
+  sQueue->SetBudget(kRunnableBudget);
   sWorld = BrowserWorld::Create();
   WVR_RegisterMain(main);
   return JNI_VERSION_1_6;